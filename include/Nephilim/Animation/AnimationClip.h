@@ -10,11 +10,16 @@
 
 NEPHILIM_NS_BEGIN
 
+class AnimationPose;
+
 /**
 	\class AnimationClip
 	\brief Stores a keyframe animation
 
 	Contains all the data required to perform skeleton based animation on a set of bones, or something else
+
+	This is the editable form of a clip, with every key stored in full. Use CompressedAnimationClip
+	to play many instances of it at a fraction of the memory.
 */
 class NEPHILIM_API AnimationClip
 {
@@ -25,7 +30,7 @@ public:
 		vec3       position;
 		vec3       scale;
 		Quat orientation;
-		float      time;
+		float      time; ///< Time of the key in seconds, keys of a track are sorted by it
 	};
 
 	/**
@@ -38,10 +43,13 @@ public:
 	{
 	public:
 
-		/// Get the local track transform at time t
-		/// t must be between 0 and frames.size(), the fractional part is interpolated between two frames
+		/// Get the local track transform at time t, in seconds
+		/// t is clamped to the first and last key, and interpolated between the two keys around it
 		mat4 getTransformFromTime(float t);
 
+		/// Sample the track at time t, in seconds, without building a matrix
+		void sample(float t, vec3& position, Quat& orientation, vec3& scale) const;
+
 		String                name;
 		std::vector<KeyFrame> frames;
 	};
@@ -52,6 +60,15 @@ public:
 
 	void getTransformsFromTime(float t, std::vector<mat4>& transforms);
 
+	/// Sample every track at time t, in seconds, into pose
+	void sample(float t, AnimationPose& pose) const;
+
+	/// Get the time of the last key of the clip, in seconds
+	float getDuration() const;
+
+	/// Get the number of bytes the clip takes in memory
+	std::size_t getMemoryUsage() const;
+
 	std::vector<Track> tracks;
 	Int32 playbackFramesPerSecond; ///< How many frames pass in a second for the animation to run at normal speed
 	Int32 numFrames;
@@ -0,0 +1,48 @@
+#ifndef NephilimAnimationPose_h__
+#define NephilimAnimationPose_h__
+
+#include <Nephilim/Platform.h>
+#include <Nephilim/Foundation/Quat.h>
+#include <Nephilim/Foundation/Vector.h>
+#include <Nephilim/Foundation/Matrix.h>
+
+#include <vector>
+
+NEPHILIM_NS_BEGIN
+
+/**
+	\class AnimationPose
+	\brief Local transforms of a set of animation tracks, one array per channel
+
+	Clips sample into a pose instead of building matrices right away,
+	so poses can be blended together channel by channel first.
+	Only the final pose needs to be turned into matrices.
+*/
+class NEPHILIM_API AnimationPose
+{
+public:
+	std::vector<vec3> translations;
+	std::vector<Quat> rotations;
+	std::vector<vec3> scales;
+
+public:
+
+	/// Resize the pose to count tracks, new tracks start at the identity transform
+	void resize(std::size_t count);
+
+	/// Get the number of tracks in the pose
+	std::size_t size() const;
+
+	/// Build the local matrix of one track, translation * rotation * scale
+	mat4 getMatrix(std::size_t index) const;
+
+	/// Build the local matrices of all tracks into out, which must hold size() matrices
+	void toMatrices(mat4* out) const;
+
+	/// Blend two poses of the same size into out, weight 0 gives a and weight 1 gives b
+	/// out may be a or b
+	static void blend(const AnimationPose& a, const AnimationPose& b, float weight, AnimationPose& out);
+};
+
+NEPHILIM_NS_END
+#endif // NephilimAnimationPose_h__
@@ -0,0 +1,131 @@
+#ifndef NephilimCompressedAnimationClip_h__
+#define NephilimCompressedAnimationClip_h__
+
+#include <Nephilim/Platform.h>
+#include <Nephilim/Foundation/Quat.h>
+#include <Nephilim/Foundation/Vector.h>
+#include <Nephilim/Foundation/String.h>
+
+#include <vector>
+
+NEPHILIM_NS_BEGIN
+
+class AnimationClip;
+class AnimationPose;
+
+/**
+	\class CompressedAnimationClip
+	\brief Read only, compact form of an AnimationClip made for playback
+
+	Every track is split into translation, rotation and scale channels, which are compressed separately:
+	- Channels that never move beyond the tolerance keep a single key
+	- Keys that linear interpolation of their neighbours already reproduces are dropped
+	- Key times are stored as 16 bit fractions of the clip duration
+	- Translation and scale keys are 16 bit fractions of the channel bounds
+	- Rotations keep their three smallest components at 15 bits each, the largest one is rebuilt on sampling
+
+	Sampling writes the channels into an AnimationPose, which can be blended with other
+	poses before building any matrix. Passing a SamplingCache remembers the key each
+	channel was at, so playing forward costs nothing to find the keys again.
+*/
+class NEPHILIM_API CompressedAnimationClip
+{
+public:
+
+	/// Error allowed in each channel when compressing, in the units of the channel
+	struct Settings
+	{
+		float translationTolerance; ///< Largest error on any axis of a position
+		float rotationTolerance;    ///< Largest error on any component of a unit quaternion
+		float scaleTolerance;       ///< Largest error on any axis of a scale
+
+		Settings();
+	};
+
+	/// Per instance playback state, keeps the current key of every channel
+	class SamplingCache
+	{
+	public:
+		/// Forget the cached keys, the next sample searches them from scratch
+		void reset();
+
+	private:
+		friend class CompressedAnimationClip;
+
+		std::vector<Uint32> cursors; ///< Key index relative to each channel
+	};
+
+public:
+
+	/// Creates an empty clip
+	CompressedAnimationClip();
+
+	/// Compress clip into this one, replacing its contents
+	void compress(const AnimationClip& clip, const Settings& settings = Settings());
+
+	/// Sample every track at time t, in seconds, into pose
+	/// t is clamped to the duration of the clip, cache is optional
+	void sample(float t, AnimationPose& pose, SamplingCache* cache = nullptr) const;
+
+	/// Get the number of tracks
+	std::size_t getTrackCount() const;
+
+	/// Get the name of a track
+	const String& getTrackName(std::size_t index) const;
+
+	/// Get the index of a track by its name, or -1
+	Int32 getTrackIndexByName(const String& name) const;
+
+	/// Get the time of the last key of the clip, in seconds
+	float getDuration() const;
+
+	/// Get the number of keys kept across all channels
+	std::size_t getKeyCount() const;
+
+	/// Get the number of bytes the clip takes in memory
+	std::size_t getMemoryUsage() const;
+
+	/// Release everything
+	void clear();
+
+	/// Log the memory of a clip of tracks x keys against its compressed form,
+	/// and the time to sample a pose from each while playing it forward samples times
+	static void benchmark(std::size_t tracks = 60, std::size_t keys = 300, std::size_t samples = 10000);
+
+private:
+
+	/// Keys of one channel of one track
+	struct Channel
+	{
+		Uint32 firstKey; ///< Index of the first key in mKeyTimes, and of its values in mKeyValues times 3
+		Uint32 keyCount; ///< One means the channel is constant
+		vec3   minimum;  ///< Bounds of the values, vec3 channels only
+		vec3   extent;
+	};
+
+	enum ChannelKind
+	{
+		TranslationChannel = 0,
+		RotationChannel,
+		ScaleChannel,
+		ChannelsPerTrack
+	};
+
+	/// Find the key at or before u, a time in 16 bit units, starting from the cached cursor
+	Uint32 findKey(const Channel& channel, float u, Uint32* cursor) const;
+
+	/// Decode a vec3 key of a channel
+	vec3 decodeVector(const Channel& channel, Uint32 key) const;
+
+	/// Decode a rotation key
+	Quat decodeRotation(Uint32 key) const;
+
+	std::vector<String>  mTrackNames;
+	std::vector<Channel> mChannels;  ///< ChannelsPerTrack per track, in ChannelKind order
+	std::vector<Uint16>  mKeyTimes;  ///< Key times of all channels, as fractions of mDuration
+	std::vector<Uint16>  mKeyValues; ///< Three quantized values per key
+	float                mDuration;
+};
+
+NEPHILIM_NS_END
+#endif // NephilimCompressedAnimationClip_h__
@@ -12,6 +12,7 @@ namespace PluginSDK
 		Physics = 0,
 		Scripting,
 		Audio,
+		Graphics,
 	};
 };
 
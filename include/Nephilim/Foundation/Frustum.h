@@ -0,0 +1,59 @@
+#ifndef NephilimFoundationFrustum_h__
+#define NephilimFoundationFrustum_h__
+
+#include <Nephilim/Platform.h>
+#include <Nephilim/Foundation/Vector.h>
+#include <Nephilim/Foundation/Matrix.h>
+#include <Nephilim/Foundation/BBox.h>
+
+NEPHILIM_NS_BEGIN
+
+/**
+	\class Frustum
+	\brief The six planes bounding what a camera can see
+
+	Built from a combined projection * view matrix, the planes are in world space.
+	Multiplying a model matrix in gives planes in that model's local space instead,
+	which lets local bounding boxes be tested without transforming them.
+*/
+class NEPHILIM_API Frustum
+{
+public:
+	enum PlaneIndex
+	{
+		Left = 0,
+		Right,
+		Bottom,
+		Top,
+		Near,
+		Far,
+		PlaneCount
+	};
+
+	/// Each plane is (a, b, c, d) with the normal pointing inside, a point p is inside when a*p.x + b*p.y + c*p.z + d >= 0
+	vec4 planes[PlaneCount];
+
+public:
+
+	/// Creates a frustum that contains everything
+	Frustum();
+
+	/// Extract the planes of a projection * view (* model) matrix
+	explicit Frustum(const mat4& clipMatrix);
+
+	/// Extract the planes of a projection * view (* model) matrix
+	void setFromMatrix(const mat4& clipMatrix);
+
+	/// Check if the point is inside the frustum
+	bool contains(const vec3& point) const;
+
+	/// Check if any part of the axis aligned box between minimum and maximum may be visible
+	/// Conservative: boxes near the corners of the frustum can pass even if fully outside
+	bool intersects(const vec3& minimum, const vec3& maximum) const;
+
+	/// Check if any part of the box may be visible
+	bool intersects(const BBox& box) const;
+};
+
+NEPHILIM_NS_END
+#endif // NephilimFoundationFrustum_h__
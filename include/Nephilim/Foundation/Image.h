@@ -41,6 +41,9 @@ public:
 	/// Attempts to load an image from an open stream
 	bool loadFromStream(File* stream);
 
+	/// Attempts to decode an image file already in memory, like a view into a package
+	bool loadFromMemory(const void* data, std::size_t size);
+
 	/// Set the color of an individual pixel
 	void setPixel(unsigned int x, unsigned int y, const Color& color);
 
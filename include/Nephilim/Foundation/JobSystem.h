@@ -0,0 +1,158 @@
+#ifndef NephilimFoundationJobSystem_h__
+#define NephilimFoundationJobSystem_h__
+
+#include <Nephilim/Platform.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+NEPHILIM_NS_BEGIN
+
+/**
+	\class JobSystem
+	\brief Work stealing scheduler that runs small tasks on a pool of worker threads
+
+	Every worker has its own deque of jobs. Jobs submitted from a worker go to the back
+	of its deque, and the worker takes its work from the back too, so related jobs stay on
+	the same core. Idle workers steal from the front of the other deques, taking the oldest,
+	usually biggest pieces of work. Jobs submitted from any other thread are shared by all workers.
+
+	Jobs can depend on other jobs, they only start once all their prerequisites finished.
+	Waiting on a job runs other jobs in the meantime, so waiting from inside a job,
+	like a parallelFor within a system update, doesn't stall a worker.
+
+	Until start() is called there are no workers and wait() runs the jobs on the calling thread,
+	so code written against the job system also works single threaded.
+*/
+class NEPHILIM_API JobSystem
+{
+public:
+	typedef std::function<void()> Task;
+
+	/// A unit of work and the jobs waiting for it
+	struct Job
+	{
+		Task                             task;
+		std::atomic<int>                 blockers;   ///< Unfinished prerequisites, plus one until submitted
+		std::atomic<bool>                finished;
+		std::mutex                       mutex;      ///< Guards dependents against the job finishing
+		std::vector<std::shared_ptr<Job> > dependents;
+	};
+
+	typedef std::shared_ptr<Job> JobHandle;
+
+	/// Creates the job system with no workers
+	JobSystem();
+
+	/// Stops the workers, running whatever is still queued
+	~JobSystem();
+
+	/// Launch the workers, by default one per core besides the calling thread
+	void start(std::size_t workerCount = 0);
+
+	/// Finish all queued jobs and join the workers
+	void stop();
+
+	/// Check if there are workers running
+	bool isRunning() const;
+
+	/// Get the number of worker threads
+	std::size_t getWorkerCount() const;
+
+	/// Create a job without scheduling it, so dependencies can be added before submit()
+	JobHandle createJob(const Task& task);
+
+	/// Make job wait for prerequisite to finish, must be called before job is submitted
+	void addDependency(const JobHandle& job, const JobHandle& prerequisite);
+
+	/// Schedule a job, it runs as soon as its prerequisites are done
+	void submit(const JobHandle& job);
+
+	/// Create and schedule a job with no dependencies
+	JobHandle run(const Task& task);
+
+	/// Block until the job finished, running other jobs meanwhile
+	void wait(const JobHandle& job);
+
+	/// Block until all the jobs finished, running other jobs meanwhile
+	void wait(const std::vector<JobHandle>& jobs);
+
+	/// Call fn(first, last) over consecutive ranges covering [begin, end), in parallel
+	/// grainSize is the most indices in a range, 0 picks a size that gives a few ranges per worker
+	template<typename Fn>
+	void parallelFor(std::size_t begin, std::size_t end, std::size_t grainSize, Fn fn);
+
+private:
+	/// A worker thread and its deque of jobs
+	struct Worker
+	{
+		std::thread           thread;
+		std::mutex            mutex;
+		std::deque<JobHandle> jobs;
+	};
+
+	/// Queue a job whose prerequisites are all done
+	void enqueue(const JobHandle& job);
+
+	/// Get the next job for a worker, or for any other thread with worker -1
+	/// Takes from the back of the worker's own deque, then the shared queue, then steals
+	JobHandle takeJob(int worker);
+
+	/// Run a job and release the jobs that were waiting on it
+	void execute(const JobHandle& job);
+
+	/// Main loop of the worker threads
+	void workerMain(std::size_t index);
+
+	/// Get the index of the worker running on the calling thread, or -1
+	int currentWorker() const;
+
+	std::vector<std::unique_ptr<Worker> > mWorkers;
+	std::deque<JobHandle>                 mShared;      ///< Jobs submitted from outside the workers
+	std::mutex                            mSharedMutex;
+	std::mutex                            mSleepMutex;
+	std::condition_variable               mWakeUp;
+	std::atomic<int>                      mQueued;      ///< Jobs waiting in any queue, idle workers sleep while it is 0
+	std::atomic<bool>                     mRunning;
+};
+
+/// Call fn(first, last) over consecutive ranges covering [begin, end), in parallel
+template<typename Fn>
+void JobSystem::parallelFor(std::size_t begin, std::size_t end, std::size_t grainSize, Fn fn)
+{
+	if (end <= begin)
+		return;
+
+	const std::size_t count = end - begin;
+	if (grainSize == 0)
+	{
+		grainSize = count / ((mWorkers.size() + 1) * 4);
+		if (grainSize == 0)
+			grainSize = 1;
+	}
+
+	if (!isRunning() || count <= grainSize)
+	{
+		fn(begin, end);
+		return;
+	}
+
+	std::vector<JobHandle> jobs;
+	jobs.reserve(count / grainSize + 1);
+	for (std::size_t first = begin; first < end; first += grainSize)
+	{
+		const std::size_t last = (end - first > grainSize) ? first + grainSize : end;
+		jobs.push_back(run([&fn, first, last]() { fn(first, last); }));
+	}
+
+	wait(jobs);
+}
+
+NEPHILIM_NS_END
+#endif // NephilimFoundationJobSystem_h__
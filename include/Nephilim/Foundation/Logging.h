@@ -4,16 +4,107 @@
 #include <Nephilim/Platform.h>
 #include <Nephilim/Foundation/String.h>
 
+#include <atomic>
+
 NEPHILIM_NS_BEGIN
 
-/// Logs a simple formatted string
-void Log(const char * format, ...);
+/// Severity of a log message, from the most verbose to the most serious
+namespace LogLevel
+{
+	enum Type
+	{
+		Trace = 0,
+		Debug,
+		Info,
+		Warning,
+		Error,
+		Off     ///< Only as a filter, silences a category
+	};
+}
+
+/**
+	\class LogCategory
+	\brief A named channel of log messages with its own runtime level
+
+	Categories are declared once, usually at namespace scope, and the level check
+	is a relaxed load on the category itself, so filtered messages cost a compare and a branch.
+*/
+class NEPHILIM_API LogCategory
+{
+public:
+	/// Register a category, messages below level are dropped before formatting
+	explicit LogCategory(const char* name, LogLevel::Type level = LogLevel::Debug);
+
+	/// Check if a message at level passes the filter
+	bool isEnabled(LogLevel::Type level) const
+	{
+		return level >= mLevel.load(std::memory_order_relaxed);
+	}
+
+	/// Set the least severe level still written
+	void setLevel(LogLevel::Type level);
+
+	/// Get the least severe level still written
+	LogLevel::Type getLevel() const;
+
+	/// Get the name messages are tagged with
+	const char* getName() const;
+
+private:
+	LogCategory(const LogCategory&);
+	LogCategory& operator=(const LogCategory&);
+
+	const char*      mName;
+	std::atomic<int> mLevel;
+};
+
+/// The category of Log() and of anything without a better one
+NEPHILIM_API extern LogCategory LogGeneral;
+
+/// Graphics devices, textures and shaders
+NEPHILIM_API extern LogCategory LogGraphics;
+
+/// Worlds, actors and their components
+NEPHILIM_API extern LogCategory LogWorld;
+
+/// Content loading, packages and the file system
+NEPHILIM_API extern LogCategory LogContent;
+
+/**
+	\class LogRateLimit
+	\brief Caps how many messages one call site writes per second
+
+	Log() and the LOG_ macros keep one per call site, so a message inside a loop
+	can't flood the output. What was held back is counted and reported
+	with the next message the site gets to write.
+*/
+class NEPHILIM_API LogRateLimit
+{
+public:
+	LogRateLimit();
+
+	/// Check if the site can write now, returns false and counts the message otherwise
+	/// When allowed, suppressed is set to how many messages were held back since the last one
+	bool allow(Uint32& suppressed);
+
+private:
+	std::atomic<Int64>  mWindow;      ///< Second the count belongs to
+	std::atomic<Uint32> mCount;       ///< Messages in the window so far
+	std::atomic<Uint32> mSuppressed;  ///< Held back and not yet reported
+};
 
 /**
 	\class Logger
 	\brief Process-wide logger
 
-	If you are looking for more focused and configurable logging, use X instead. (TODO)
+	Messages are formatted on the calling thread into a slot of a fixed size,
+	lock-free ring shared by every thread, and written out by a background thread,
+	so logging costs about one formatting and never waits on the console or the disk.
+	When the ring is full, messages are dropped and counted rather than blocking.
+	Errors wait for the writer to catch up, so they are out before a crash can lose them.
+
+	Messages below NEPHILIM_LOG_MIN_LEVEL are compiled out of the LOG_ macros,
+	and the rest are filtered at runtime by the level of their category.
 */
 class NEPHILIM_API Logger
 {
@@ -21,10 +112,91 @@ public:
 	/// The tag prefix for Log()
 	static String m_tag;
 
+	/// Write a formatted message, bypassing the filters
+	static void write(LogCategory& category, LogLevel::Type level, const char* format, ...);
+
+	/// Write a formatted message held back from a rate limited call site
+	static void writeLimited(LogCategory& category, LogLevel::Type level, LogRateLimit& limit, const char* format, ...);
+
+	/// Set the level of every category at once
+	static void setLevel(LogLevel::Type level);
+
+	/// Set the level of a category by name, returns false if there is no such category
+	static bool setCategoryLevel(const String& name, LogLevel::Type level);
+
+	/// Set how many messages a call site can write per second, 0 for no limit
+	static void setRateLimit(Uint32 messagesPerSecond);
+
+	/// Get how many messages a call site can write per second
+	static Uint32 getRateLimit();
+
+	/// Enable or disable writing to the standard output, or the android log
+	static void setConsoleOutput(bool enable);
+
+	/// Also write every message to a file, an empty name closes it
+	static bool setOutputFile(const String& filename);
+
+	/// Wait until every message logged so far was written
+	static void flush();
+
+	/// Get how many messages were lost to a full ring since the start
+	static Uint64 getDroppedCount();
+
+	/// Log how long a filtered, a rate limited and an emitted message take to log
+	static void benchmark(std::size_t messages = 100000);
+
 	Logger& operator<<(const String& s);
 };
 
 extern Logger NLog;
 
+/// Messages below this level are compiled out of the LOG_ macros
+#ifndef NEPHILIM_LOG_MIN_LEVEL
+#if defined NEPHILIM_RELEASE
+#define NEPHILIM_LOG_MIN_LEVEL 2
+#else
+#define NEPHILIM_LOG_MIN_LEVEL 0
+#endif
+#endif
+
+#define NEPHILIM_LOG_(category, level, ...) \
+	do { \
+		if ((category).isEnabled(level)) \
+		{ \
+			static ::NEPHILIM_NS::LogRateLimit _logRateLimit; \
+			::NEPHILIM_NS::Logger::writeLimited(category, level, _logRateLimit, __VA_ARGS__); \
+		} \
+	} while (0)
+
+/// Logs a simple formatted string, as information in the general category
+/// Like the LOG_ macros, every call site has its own rate limit
+#define Log(...) NEPHILIM_LOG_(::NEPHILIM_NS::LogGeneral, ::NEPHILIM_NS::LogLevel::Info, __VA_ARGS__)
+
+#if NEPHILIM_LOG_MIN_LEVEL <= 0
+#define LOG_TRACE(category, ...) NEPHILIM_LOG_(category, ::NEPHILIM_NS::LogLevel::Trace, __VA_ARGS__)
+#else
+#define LOG_TRACE(category, ...) do {} while (0)
+#endif
+
+#if NEPHILIM_LOG_MIN_LEVEL <= 1
+#define LOG_DEBUG(category, ...) NEPHILIM_LOG_(category, ::NEPHILIM_NS::LogLevel::Debug, __VA_ARGS__)
+#else
+#define LOG_DEBUG(category, ...) do {} while (0)
+#endif
+
+#if NEPHILIM_LOG_MIN_LEVEL <= 2
+#define LOG_INFO(category, ...) NEPHILIM_LOG_(category, ::NEPHILIM_NS::LogLevel::Info, __VA_ARGS__)
+#else
+#define LOG_INFO(category, ...) do {} while (0)
+#endif
+
+#if NEPHILIM_LOG_MIN_LEVEL <= 3
+#define LOG_WARNING(category, ...) NEPHILIM_LOG_(category, ::NEPHILIM_NS::LogLevel::Warning, __VA_ARGS__)
+#else
+#define LOG_WARNING(category, ...) do {} while (0)
+#endif
+
+#define LOG_ERROR(category, ...) NEPHILIM_LOG_(category, ::NEPHILIM_NS::LogLevel::Error, __VA_ARGS__)
+
 NEPHILIM_NS_END
 #endif // NephilimFoundationLogger_h__
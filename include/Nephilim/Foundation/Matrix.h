@@ -4,6 +4,8 @@
 #include <Nephilim/Platform.h>
 #include <Nephilim/Foundation/Vector.h>
 
+#include <cstddef>
+
 NEPHILIM_NS_BEGIN
 
 class mat3;
@@ -14,6 +16,10 @@ class mat3;
 	\brief 4x4 Matrix oriented for OpenGL transformations
 
 	Note: Row major
+
+	Products and vector transforms use SSE or NEON when the platform has them
+	(see NEPHILIM_NOSIMD in Platform.h), with a scalar fallback otherwise.
+	For many matrices or points at once, prefer the batch functions over looping on the operators.
 */
 class NEPHILIM_API mat4
 {
@@ -56,7 +62,7 @@ public:
 
 	/// Get the determinant of the 4x4 matrix
 	/// DOES NOT WORK YET IN ALL CASES
-	float determinant();
+	float determinant() const;
 
 	/// Calculate the determinant of the matrix (only if it is a 2D transform)
 	/// Ignores the third row and column, and computes the determinant
@@ -105,6 +111,18 @@ public:
 	/// Multiply by a scalar
 	mat4 operator*(float scalar);
 
+	/// Compute out = a * b without temporaries, out may be the same as a or b
+	static void multiply(const mat4& a, const mat4& b, mat4& out);
+
+	/// Compute out[i] = a[i] * b[i] for count pairs of matrices, out may alias a or b
+	static void multiply(const mat4* a, const mat4* b, mat4* out, std::size_t count);
+
+	/// Compute out[i] = a * b[i] for count matrices, out may alias b
+	static void multiply(const mat4& a, const mat4* b, mat4* out, std::size_t count);
+
+	/// Compute out[i] = m * in[i] for count vectors, out may alias in
+	static void transform(const mat4& m, const vec4* in, vec4* out, std::size_t count);
+
 	/// Identity matrix
 	static const mat4 identity;
 
@@ -141,5 +159,12 @@ private:
 
 void debugPrint(mat4& m);
 
+/// Log how long mat4 * mat4, mat4 * vec4 and Quat * Quat take with the scalar code and with the kernels in use
+NEPHILIM_API void benchmarkMathKernels(std::size_t count = 10000, std::size_t rounds = 10);
+
+/// Check that the kernels in use, operators and batch functions alike, give the products of the scalar code
+/// Differences are relative to the scalar result past 1, logs the largest ones and returns whether they stay within epsilon
+NEPHILIM_API bool verifyMathKernels(float epsilon = 1e-5f);
+
 NEPHILIM_NS_END
 #endif // NephilimMathMatrix_h__
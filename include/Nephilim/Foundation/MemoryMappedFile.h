@@ -0,0 +1,59 @@
+#ifndef NephilimFoundationMemoryMappedFile_h__
+#define NephilimFoundationMemoryMappedFile_h__
+
+#include <Nephilim/Platform.h>
+#include <Nephilim/Foundation/String.h>
+
+#include <vector>
+
+NEPHILIM_NS_BEGIN
+
+/**
+	\class MemoryMappedFile
+	\brief Read only view of a whole file, mapped into the address space
+
+	Pages are brought in by the OS as they are touched, so opening is cheap no
+	matter the file size and reading any part of it costs no copies.
+	Where the file can't be mapped, like android assets, it is read into memory instead.
+*/
+class NEPHILIM_API MemoryMappedFile
+{
+public:
+	/// Constructs an unopened mapping
+	MemoryMappedFile();
+
+	/// Unmaps the file
+	~MemoryMappedFile();
+
+	/// Map a file, closing the previous one
+	bool open(const String& path);
+
+	/// Unmap the file
+	void close();
+
+	/// Check if a file is mapped
+	bool isOpen() const;
+
+	/// Get the start of the file contents
+	const char* getData() const;
+
+	/// Get the size of the file in bytes
+	Int64 getSize() const;
+
+private:
+	MemoryMappedFile(const MemoryMappedFile&);
+	MemoryMappedFile& operator=(const MemoryMappedFile&);
+
+	const char*       m_data;
+	Int64             m_size;
+	bool              m_mapped;    ///< m_data is a mapping rather than m_buffer
+	std::vector<char> m_buffer;    ///< Contents when the file couldn't be mapped
+
+#ifdef NEPHILIM_WINDOWS
+	void*             m_fileHandle;
+	void*             m_mappingHandle;
+#endif
+};
+
+NEPHILIM_NS_END
+#endif // NephilimFoundationMemoryMappedFile_h__
@@ -3,46 +3,144 @@
 
 #include <Nephilim/Platform.h>
 #include <Nephilim/Foundation/String.h>
+#include <Nephilim/Foundation/MemoryMappedFile.h>
 
 #include <vector>
 
 NEPHILIM_NS_BEGIN
 
 class PackageBuilder;
+
 /**
 	\class Package
 	\brief This class allows to open a package, inspect its contents and load assets out of it
+
+	Packages are memory mapped, so opening one only reads its header, and finding
+	an entry is a lookup in a hash table stored in the file. Entries stored uncompressed
+	are handed out as views straight into the mapping, without any copies.
+
+	Layout of a version 2 package, all integers little endian:
+	- Header: "NXPK", version, entry count, bucket count, alignment and the table offsets
+	- Entries: name hash, content hash, data offset, stored and original size, name and flags
+	- Buckets: open addressing table of entry indices, indexed by name hash
+	- Names: the entry names, not null terminated
+	- Data: the entries, each starting at a multiple of the alignment
+
+	Version 1 packages, a plain list of names, offsets and lengths, can still be extracted.
 */
 class NEPHILIM_API Package
 {
 public:
+	/// Current version of the format
+	static const Uint32 Version = 2;
+
+	/// Flags of an entry
+	enum EntryFlags
+	{
+		Compressed = 1 << 0   ///< Stored as a zlib stream
+	};
+
+	/// A read only window into the mapped package, valid while the package is open
+	struct View
+	{
+		const char* data;
+		Int64       size;
+	};
+
 	/// Constructs an uninitialized package reader
 	Package();
 
 	/// Constructs directly from a package file
 	Package(const String& source);
 
+	/// Map a package file and validate its table of contents
+	bool open(const String& source);
+
+	/// Unmap the package, invalidating every view
+	void close();
+
+	/// Check if the package is open
+	bool isOpen() const;
+
+	/// Get the package source file
+	const String& getSource() const;
+
+	/// Get the number of entries
+	std::size_t getEntryCount() const;
+
+	/// Get the name of the entry at index
+	String getEntryName(std::size_t index) const;
+
+	/// Check if there is an entry with the given name
+	bool contains(const String& name) const;
+
+	/// Get the original size of an entry, or -1 if there is no such entry
+	Int64 getEntrySize(const String& name) const;
+
+	/// Check if an entry is stored compressed, and so can't be mapped
+	bool isCompressed(const String& name) const;
+
+	/// Get a zero-copy view of an entry stored uncompressed
+	bool map(const String& name, View& view) const;
+
+	/// Read the contents of an entry, decompressing if needed
+	bool read(const String& name, std::vector<char>& data) const;
+
+	/// Check the contents of an entry against the hash recorded when building
+	bool verify(const String& name) const;
+
 	/// Attempts to extract the package contents to a directory
 	bool extract(const String& directory);
 
-private:
-	String m_file; ///< The package source file
+	/// Hash used for entry names and contents
+	static Uint64 hash(const char* data, std::size_t size, Uint64 seed = 14695981039346656037ULL);
 
+private:
 	friend class PackageBuilder;
 
-	struct pFile
+	/// Header at the start of the file
+	struct pHeader
 	{
-		Int64 m_offset;
-		Int64 m_length;
-		String m_name;
+		char   m_magic[4];
+		Uint32 m_version;
+		Uint32 m_entryCount;
+		Uint32 m_bucketCount;    ///< Power of two
+		Uint32 m_alignment;
+		Uint32 m_reserved;
+		Uint64 m_entriesOffset;
+		Uint64 m_bucketsOffset;
+		Uint64 m_namesOffset;
 	};
 
-	struct pHeader
+	/// Table of contents record of one file
+	struct pEntry
 	{
-		std::vector< pFile > m_files;
+		Uint64 m_nameHash;
+		Uint64 m_contentHash;    ///< Of the original, uncompressed contents
+		Uint64 m_offset;
+		Uint64 m_storedSize;
+		Uint64 m_size;
+		Uint32 m_nameOffset;     ///< Into the names block
+		Uint32 m_nameLength;
+		Uint32 m_flags;
+		Uint32 m_reserved;
 	};
 
-	pHeader m_header;
+	/// Marks a free slot of the bucket table
+	static const Uint32 EmptyBucket = 0xFFFFFFFF;
+
+	/// Find the entry of a name, nullptr if there is none
+	const pEntry* find(const String& name) const;
+
+	/// Extract a version 1 package
+	bool extractLegacy(const String& directory);
+
+	String           m_file;    ///< The package source file
+	MemoryMappedFile m_mapping;
+	const pHeader*   m_header;
+	const pEntry*    m_entries;
+	const Uint32*    m_buckets;
+	const char*      m_names;
 };
 
 /**
@@ -54,15 +152,30 @@ class NEPHILIM_API PackageBuilder
 {
 public:
 
-	/// Adds a file to the package builder
-	void addFile(const String& source, const String& destination);
+	/// Creates a builder aligning entries to 16 bytes
+	PackageBuilder();
+
+	/// Adds a file to the package builder, compressed entries are smaller but can't be mapped
+	void addFile(const String& source, const String& destination, bool compress = false);
+
+	/// Set the boundary entries start at, must be a power of two
+	/// Aligning to the page size lets entries be mapped on their own
+	void setAlignment(Uint32 alignment);
 
 	/// Generates the final package
-	bool build();
+	bool build(const String& filename = "package.pkg");
 
 private:
-	std::vector<std::pair<String,String> > m_files; ///< The files queued for adding
-	Package::pHeader m_header; ///< Header struct to fill
+	/// A file queued for adding
+	struct pSource
+	{
+		String m_source;
+		String m_destination;
+		bool   m_compress;
+	};
+
+	std::vector<pSource> m_files; ///< The files queued for adding
+	Uint32 m_alignment;
 };
 
 NEPHILIM_NS_END
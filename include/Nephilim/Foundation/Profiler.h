@@ -3,88 +3,166 @@
 
 #include <Nephilim/Platform.h>
 #include <Nephilim/Foundation/String.h>
-#include <Nephilim/Foundation/Clock.h>
-
-#include <map>
 
+#include <vector>
 
 NEPHILIM_NS_BEGIN
 
 /**
 	\ingroup Foundation
-	\class ProfileStatistics
-	\brief Profiler statistic tracker
+	\struct ProfileZone
+	\brief Static description of an instrumented scope, one per call site
 */
-class NEPHILIM_API ProfileStatistics
+struct ProfileZone
 {
-public:	
+	const char* name;
+	const char* file;
+	int         line;
+};
 
-	struct fnTrack
-	{
-		fnTrack()
-		{
-			counter = 0;
-			m_total = 0.f;
-		}
+/**
+	\ingroup Foundation
+	\class Profiler
+	\brief Collects timed, nested zones from every thread, per frame
 
-		void add()
-		{
-			counter++;
-			if(counter >= 1000)
-			{
-				//cout << "Profiler: Fn ran 1000 times with a total time of: "<<m_total <<endl;
-				counter = 0;
-			}
-		}
+	Zones are opened with PROFILE_ZONE("name") and close at the end of the scope.
+	Each thread writes its finished zones into its own ring buffer, with no locks,
+	and endFrame() drains all of them on the main thread into the statistics of the frame.
+	Events that don't fit in a full buffer are dropped and counted.
 
-		float m_total;
-		int counter;
+	While capturing, every event is also kept, so the capture can be exported
+	to the Chrome trace format and inspected in chrome://tracing or Perfetto.
+
+	The macros compile to nothing with NEPHILIM_NOPROFILER defined. They stay in release
+	builds, which are the ones worth profiling, and cost a branch while disabled with setEnabled().
+*/
+class NEPHILIM_API Profiler
+{
+public:
+	/// A finished zone, times in nanoseconds since the profiler started
+	struct Event
+	{
+		const ProfileZone* zone;
+		Int64              start;
+		Int64              end;
+		Uint32             depth;  ///< Zones open around it on the same thread
+		Uint32             thread;
 	};
 
-	static Clock clock;
-	static std::map<String, fnTrack> m_functions;
+	/// The time spent in one zone at one nesting depth, during a frame
+	struct ZoneStats
+	{
+		const ProfileZone* zone;
+		Uint32             depth;
+		Uint32             calls;
+		double             totalMilliseconds;
+		double             maxMilliseconds;
+		Int64              firstStart;  ///< To list the zones in the order they first ran
+	};
 
-	static void trackFn(const String& fn, float time)
+	/// Everything collected between two endFrame() calls
+	struct FrameStats
 	{
-		//cout<< "Track: "<<fn<<endl;
-		m_functions[fn].add();
-		m_functions[fn].m_total += time;
-	} 
+		Uint64                 frame;
+		double                 milliseconds;
+		std::vector<ZoneStats> zones;   ///< Ordered by first start, so nested zones follow their parents
+		Uint32                 dropped; ///< Events lost to full buffers
+	};
+
+	/// Turn collection on or off, zones cost two clock reads when on and a branch when off
+	static void setEnabled(bool enabled);
+
+	/// Check if zones are being collected
+	static bool isEnabled();
+
+	/// Get a zone for a name only known at runtime, the same one for every call with that name
+	/// Zones made this way live until the program exits, so events can keep pointing at them
+	static const ProfileZone* internZone(const String& name);
+
+	/// Name the calling thread in the exported traces
+	static void setThreadName(const String& name);
+
+	/// Collect the events of every thread into the statistics of the frame that ended
+	/// Call once per frame, from the main thread
+	static void endFrame();
+
+	/// Get the statistics of the last finished frame
+	static const FrameStats& getLastFrame();
+
+	/// Keep every event from now on, up to maxEvents, for exporting
+	static void startCapture(std::size_t maxEvents = 1 << 20);
+
+	/// Stop keeping events, what was captured stays until the next capture
+	static void stopCapture();
+
+	/// Check if events are being captured
+	static bool isCapturing();
+
+	/// Write the captured events as Chrome trace JSON, readable by Perfetto too
+	static bool exportChromeTrace(const String& filename);
+
+	/// Get the current time in nanoseconds since the profiler started
+	static Int64 now();
+
+	/// Increase the nesting depth of the calling thread, returning the depth of the new zone
+	static Uint32 enterZone();
+
+	/// Record a finished zone and decrease the nesting depth of the calling thread
+	static void leaveZone(const ProfileZone* zone, Int64 start, Uint32 depth);
 };
 
 /**
 	\ingroup Foundation
-	\class AutoFnProfiler
-	\brief Profiling unit to track a function
+	\class ProfileScope
+	\brief Times a zone from its construction to the end of the scope
 */
-class AutoFnProfiler
+class ProfileScope
 {
 public:
-	AutoFnProfiler(const char* name, void* obj)
+	explicit ProfileScope(const ProfileZone* zone)
+	: mZone(Profiler::isEnabled() ? zone : nullptr)
 	{
-		m_funcName = name;
-		this->obj = obj;
+		if (mZone)
+		{
+			mDepth = Profiler::enterZone();
+			mStart = Profiler::now();
+		}
 	}
 
-	~AutoFnProfiler()
+	~ProfileScope()
 	{
-		ProfileStatistics::trackFn(m_funcName, clock.getElapsedTime().seconds());
+		if (mZone)
+			Profiler::leaveZone(mZone, mStart, mDepth);
 	}
 
-	String m_funcName;
-	void* obj;
-	Clock clock;
+private:
+	ProfileScope(const ProfileScope&);
+	ProfileScope& operator=(const ProfileScope&);
+
+	const ProfileZone* mZone;
+	Int64              mStart;
+	Uint32             mDepth;
 };
 
-/// -- Fully disable all macros for release and global disable
-#if defined NEPHILIM_NOPROFILER || defined NEPHILIM_RELEASE
+#define NEPHILIM_PROFILE_CONCAT_(a, b) a##b
+#define NEPHILIM_PROFILE_CONCAT(a, b) NEPHILIM_PROFILE_CONCAT_(a, b)
+
+/// -- Fully disable all macros with the global disable
+#if defined NEPHILIM_NOPROFILER
+#define PROFILE_ZONE(name)
+#define PROFILE_SCOPE(zone)
 #define PROFILE_FN
 #define PROFILE_MFN
 #else
-#define PROFILE_FN AutoFnProfiler _profilerAuto(__FUNCTION__, NULL);
-#define PROFILE_MFN AutoFnProfiler _profilerAuto(__FUNCTION__, this);
+/// Time the rest of the scope as a zone with a fixed name
+#define PROFILE_ZONE(name) \
+	static const ::NEPHILIM_NS::ProfileZone NEPHILIM_PROFILE_CONCAT(_profilerZone, __LINE__) = { name, __FILE__, __LINE__ }; \
+	::NEPHILIM_NS::ProfileScope NEPHILIM_PROFILE_CONCAT(_profilerScope, __LINE__)(&NEPHILIM_PROFILE_CONCAT(_profilerZone, __LINE__))
+/// Time the rest of the scope as a zone described elsewhere, when the name is only known at runtime
+#define PROFILE_SCOPE(zone) ::NEPHILIM_NS::ProfileScope NEPHILIM_PROFILE_CONCAT(_profilerScope, __LINE__)(zone)
+#define PROFILE_FN PROFILE_ZONE(__FUNCTION__);
+#define PROFILE_MFN PROFILE_ZONE(__FUNCTION__);
 #endif
 
-
 NEPHILIM_NS_END
 #endif // NephilimFoundationProfiler_h__
@@ -6,6 +6,8 @@
 #include <Nephilim/Foundation/Matrix.h>
 #include <Nephilim/Foundation/Spherical.h>
 
+#include <cstddef>
+
 NEPHILIM_NS_BEGIN
 
 /**
@@ -56,6 +58,10 @@ public:
 
 	static Quat lerp(Quat& q1, Quat& q2, float blend);
 
+	/// Multiply count pairs of quaternions, out[i] = a[i] * b[i]
+	/// out may be the same array as a or b
+	static void multiply(const Quat* a, const Quat* b, Quat* out, std::size_t count);
+
 	static float dot(Quat& q1, Quat& q2);
 
 	/// Equivalent to mat4::rotatez
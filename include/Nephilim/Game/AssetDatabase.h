@@ -5,6 +5,8 @@
 #include <Nephilim/Foundation/String.h>
 #include <Nephilim/Foundation/Package.h>
 
+#include <vector>
+
 NEPHILIM_NS_BEGIN
 
 /**
@@ -15,9 +17,16 @@ class NEPHILIM_API AssetDatabase
 {
 public:
 
+	/// Make the assets of a package known, the package must outlive the database
+	void addPackage(Package* package);
+
 	/// Get the package that contains the asset
 	/// Returns nullptr if the asset isn't in a known package
+	/// Packages added last are searched first, so they can override older ones
 	Package* getAssetPackage(const String& asset);
+
+private:
+	std::vector<Package*> m_packages;
 };
 
 NEPHILIM_NS_END
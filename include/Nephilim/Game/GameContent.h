@@ -7,15 +7,23 @@
 #include <Nephilim/Foundation/StringHash.h>
 #include <Nephilim/Foundation/File.h>
 #include <Nephilim/Foundation/PluginLoader.h>
+#include <Nephilim/Foundation/Image.h>
+#include <Nephilim/Foundation/Time.h>
+#include <Nephilim/Foundation/Clock.h>
+#include <Nephilim/Foundation/JobSystem.h>
 
 #include <Nephilim/Game/Resource.h>
 
 #include <Nephilim/Graphics/Font.h>
 #include <Nephilim/Graphics/Sprite.h>
 #include <Nephilim/Graphics/Texture2D.h>
+#include <Nephilim/Graphics/MipChain.h>
 
+#include <atomic>
+#include <deque>
 #include <map>
 #include <memory>
+#include <mutex>
 
 NEPHILIM_NS_BEGIN
 
@@ -24,6 +32,70 @@ class SkeletalMesh;
 class ExtensionImporter;
 
 
+/// What the pixels of a requested texture hold, which decides how its mipmaps are averaged
+namespace TextureData
+{
+	enum Type
+	{
+		Color,   ///< sRGB colors, mipmaps are averaged in linear space
+		Linear   ///< Normal maps, masks and other data, mipmaps are averaged as stored
+	};
+}
+
+/// A texture being streamed in by the content manager, shared between its handles and the loaders
+struct StreamedTexture
+{
+	enum State
+	{
+		Pending,   ///< Queued for reading, being decoded or waiting for the upload
+		Ready,     ///< Uploaded, texture can be used
+		Failed     ///< The file couldn't be read or decoded
+	};
+
+	String             name;
+	std::atomic<int>   state;
+	int                priority;   ///< Higher loads first, only read under the load queue lock
+	TextureData::Type  data;       ///< Set by the first request, before any loader sees the texture
+	Image              image;      ///< Decoded pixels, handed from the worker to the upload queue
+	MipChain           mips;       ///< Levels built by the worker instead, when mipmapping
+	Texture2D          texture;
+};
+
+/**
+	\class TextureHandle
+	\brief Reference to a texture requested from GameContent, which may still be loading
+
+	While the texture is pending or if it failed to load, get() returns the
+	content manager's placeholder, so the handle can always be drawn with.
+*/
+class NEPHILIM_API TextureHandle
+{
+public:
+	/// Creates an invalid handle, that refers to no texture
+	TextureHandle();
+
+	/// Check if the handle refers to a requested texture
+	bool isValid() const;
+
+	/// Check if the texture is still loading
+	bool isPending() const;
+
+	/// Check if the texture is uploaded and usable
+	bool isReady() const;
+
+	/// Check if the texture couldn't be loaded
+	bool hasFailed() const;
+
+	/// Get the texture if ready, otherwise the placeholder, or nullptr for an invalid handle
+	Texture2D* get() const;
+
+private:
+	friend class GameContent;
+
+	std::shared_ptr<StreamedTexture> mTexture;
+	Texture2D*                       mPlaceholder;
+};
+
 // used to assist in automatic loading of third party importers
 // not needed for native formats
 struct ModelImportSettings
@@ -58,6 +130,34 @@ public:
 	/// All allocated textures
 	std::vector<Texture2D*> _textures;
 
+	/// Jobs reading and decoding streamed textures, they load on the calling thread when null
+	JobSystem* jobSystem = nullptr;
+
+	/// Main thread time spent uploading streamed textures per processUploads()
+	Time uploadBudget = Time::fromMiliSeconds(2);
+
+	/// Build mipmaps of streamed textures on the loaders, the main thread only uploads them
+	/// They are gamma correct unless the texture was requested as TextureData::Linear
+	bool mipmapTextures = false;
+
+	/// Priorities to request textures with, higher loads first
+	enum LoadPriority
+	{
+		Background = 0,   ///< Preloading, not needed yet
+		Visible    = 100  ///< Something is drawing with the placeholder right now
+	};
+
+	/// Throughput and backlog of the texture streaming
+	struct StreamingStats
+	{
+		Uint64      bytesLoaded;       ///< Total bytes read from disk
+		float       bytesPerSecond;    ///< Read throughput over the last second
+		std::size_t loadQueueDepth;    ///< Requests waiting for a loader
+		std::size_t uploadQueueDepth;  ///< Decoded textures waiting for the main thread
+		std::size_t texturesReady;
+		std::size_t texturesFailed;
+	};
+
 public:
 
 	/// Creates the default group - no name ""
@@ -85,9 +185,52 @@ public:
 
 	/// The most elemental form of loading an asset
 	/// Simply takes the filename and tries to deduce how to load it from extension
+	/// Textures are only requested, they become available with getTexture() once streamed in
 	bool load(const String& filename);
 
+	/// Get a streamed texture if it is ready, nullptr while it is loading or if it was never requested
 	Texture2D* getTexture(const String& name);
+
+	/// Start streaming a texture in, or raise the priority of a pending request for it
+	/// Reading and decoding happen in the background, the upload in processUploads()
+	/// The data type of the first request for a texture is the one its mipmaps are built for
+	TextureHandle requestTexture(const String& name, int priority = Background, TextureData::Type data = TextureData::Color);
+
+	/// Upload decoded textures to the GPU, for up to uploadBudget, must be called from the rendering thread
+	/// At least one texture is uploaded per call, so the queue always drains
+	void processUploads();
+
+	/// Block until every requested texture is loaded and uploaded, for loading screens and tools
+	void finishLoading();
+
+	/// Get the texture drawn in place of the ones still loading
+	Texture2D* getPlaceholderTexture();
+
+	/// Get the current streaming statistics
+	StreamingStats getStreamingStats();
+
+private:
+
+	typedef std::shared_ptr<StreamedTexture> StreamedTexturePtr;
+
+	/// Read and decode the highest priority request, runs on the job system
+	void loadNextTexture();
+
+	/// Drop the bookkeeping of load jobs that already ran
+	void pruneLoadJobs();
+
+	std::map<String, StreamedTexturePtr> mStreamedTextures;  ///< Every requested texture, main thread only
+	std::vector<StreamedTexturePtr>       mLoadQueue;         ///< Requests waiting for a loader
+	std::mutex                            mLoadQueueMutex;
+	std::deque<StreamedTexturePtr>        mUploadQueue;       ///< Decoded, waiting for processUploads()
+	std::mutex                            mUploadQueueMutex;
+	std::vector<JobSystem::JobHandle>     mLoadJobs;          ///< Loads in flight, waited for on destruction
+	std::unique_ptr<Texture2D>            mPlaceholder;       ///< Created on first use, once there is a device
+
+	std::atomic<Uint64>                   mBytesLoaded;
+	Uint64                                mBytesAtLastSample;
+	float                                 mBytesPerSecond;
+	Clock                                 mThroughputClock;
 };
 
 NEPHILIM_NS_END
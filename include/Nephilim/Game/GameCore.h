@@ -19,6 +19,7 @@
 #include <Nephilim/Game/GameAudio.h> 
 #include <Nephilim/Game/GameNetwork.h> 
 #include <Nephilim/Game/GameExtensions.h> 
+#include <Nephilim/Game/GameThreads.h>
 
 #include <Nephilim/Graphics/GraphicsDevice.h>
 
@@ -62,6 +63,9 @@ public:
 	/// List of currently setup scripting solutions
 	std::vector<ExtensionScripting*> scriptingEnvironments;
 
+	/// Graphics devices created by plugins, next to the window's own renderer
+	std::vector<GraphicsDevice*> graphicsDevices;
+
 	/// Hub for dealing with audio on this game
 	GameAudio gameAudio;
 
@@ -89,6 +93,12 @@ public:
 	/// The central game input manager, used to query at any time for key state etc
 	GameInput gameInput;
 
+	/// The worker threads of the game, its worlds run their systems on them
+	GameThreads gameThreads;
+
+	/// Draw the profiler statistics of the last frame over everything else
+	bool showProfiler = false;
+
 
 public: 
 // Interface API
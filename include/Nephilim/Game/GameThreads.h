@@ -2,9 +2,7 @@
 #define NephilimGameThreads_h__
 
 #include <Nephilim/Platform.h>
-#include <Nephilim/Foundation/Object.h>
-
-#include <vector>
+#include <Nephilim/Foundation/JobSystem.h>
 
 NEPHILIM_NS_BEGIN
 
@@ -12,33 +10,27 @@ NEPHILIM_NS_BEGIN
 	\class GameThreads
 	\brief Tracks and manages all threads open by this game
 
-	This is an utility thread manager for the game. Threads launched this way
-	have additional features like dynamic function relocation for the thread, 
-	clever thread safe messaging, integration with the job system, future 
-	function calls can be scheduled unto any thread, etc.
+	This is an utility thread manager for the game. Instead of every subsystem
+	opening its own threads, the game keeps one pool of worker threads, one per core,
+	and all parallel work is handed to it as jobs.
+
+	Worlds created by the game use it to update independent systems at the same time,
+	and systems can split their own loops with JobSystem::parallelFor or World::parallelEach.
+	For a long running OS thread, like a blocking network listener, just launch a Thread instead.
 */
 class NEPHILIM_API GameThreads
 {
 public:
+	/// The job system all the game's parallel work goes through
+	JobSystem jobs;
 
-	/*
-		\class GameThread
-		\brief A runnable thread, extend it if you need or just link the function you want, it will support all features
-		
-		For a typical OS thread, just launch with Thread class.
-	*/
-	class GameThread : public Object
-	{
-	public:
-
-		/// This is the thread function for every game thread
-		/// your custom thread code will be called somewhere within this
-		void launcher();
+public:
 
-	};
+	/// Launch the worker threads, by default one per core besides the main thread
+	void start(std::size_t workerCount = 0);
 
-	/// List of threads currently going (doesn't include the main() thread
-	std::vector<GameThread> gameThreads;
+	/// Finish the queued jobs and join the worker threads
+	void stop();
 };
 
 NEPHILIM_NS_END
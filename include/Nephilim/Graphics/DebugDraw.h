@@ -10,6 +10,8 @@
 
 NEPHILIM_NS_BEGIN
 
+class UIPainter;
+
 /**
 	\class DebugDraw
 	\brief Able to render primitives into the scene for prototyping purposes
@@ -25,6 +27,10 @@ public:
 
 	/// Draw a colored box
 	void drawBox(float x, float y, float z, float size, Color a);
+
+	/// Draw the profiler statistics of the last frame as a text panel, with its top-left corner at x, y
+	/// Nested zones are indented under their parents, the painter needs a font for the text
+	void drawProfiler(UIPainter& painter, float x, float y);
 };
 
 NEPHILIM_NS_END
@@ -2,6 +2,7 @@
 #define NephilimGraphicsFont_h__
 
 #include <Nephilim/Platform.h>
+#include <Nephilim/Foundation/String.h>
 #include <Nephilim/Graphics/Glyph.h>
 #include <Nephilim/Graphics/Texture2D.h>
 
@@ -17,6 +18,17 @@ class File;
 	\ingroup Graphics
 	\class Font
 	\brief Loads and stores information about a freetype font
+
+	By default glyphs are rasterized for every character size they are asked in,
+	each size getting its own texture. In distance field mode, glyphs are rasterized
+	once at a base size into a signed distance field and a single atlas serves every size,
+	staying sharp when scaled. Text draws such fonts with a shader that thresholds the field.
+
+	Distance field atlases can be baked ahead of time with preloadGlyphs() and
+	saveDistanceFieldAtlas(), so a shipped game never rasterizes while running.
+
+	New glyphs are written to a copy of the texture kept in memory and uploaded
+	together, once per frame at most, when the texture is next asked for.
 */
 class NEPHILIM_API Font
 {
@@ -171,6 +183,74 @@ public :
     ////////////////////////////////////////////////////////////
     Font& operator =(const Font& right);
 
+    ////////////////////////////////////////////////////////////
+    /// \brief Switch to signed distance field glyphs, one atlas for every size
+    ///
+    /// Glyphs already loaded are discarded.
+    ///
+    /// \param baseSize Character size the glyphs are rasterized at
+    /// \param spread   Distance in pixels of the base size the field covers around the outlines
+    ///
+    ////////////////////////////////////////////////////////////
+    void enableDistanceField(unsigned int baseSize = 48, unsigned int spread = 6);
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Check if the glyphs are signed distance fields
+    ///
+    ////////////////////////////////////////////////////////////
+    bool isDistanceField() const;
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get how much of the texture alpha one screen pixel spans
+    ///
+    /// Text uses it to antialias the edges of distance field glyphs.
+    ///
+    /// \param characterSize Character size the text is drawn at
+    ///
+    ////////////////////////////////////////////////////////////
+    float getDistanceFieldSmoothing(unsigned int characterSize) const;
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Rasterize a range of characters ahead of time
+    ///
+    /// \param first         First code point of the range
+    /// \param last          Last code point of the range, included
+    /// \param characterSize Character size, ignored for distance fields
+    /// \param bold          Load the bold versions
+    ///
+    ////////////////////////////////////////////////////////////
+    void preloadGlyphs(Uint32 first, Uint32 last, unsigned int characterSize, bool bold = false) const;
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Write the distance field atlas and its glyphs to a file
+    ///
+    /// \return True if the file was written
+    ///
+    ////////////////////////////////////////////////////////////
+    bool saveDistanceFieldAtlas(const String& filename) const;
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Load a distance field atlas baked with saveDistanceFieldAtlas()
+    ///
+    /// This switches the font to distance field mode. A font face is still
+    /// needed for kerning and for glyphs that weren't baked, but text made only
+    /// of baked glyphs can be drawn from the atlas alone.
+    ///
+    /// \return True if the atlas was loaded
+    ///
+    ////////////////////////////////////////////////////////////
+    bool loadDistanceFieldAtlas(const String& filename);
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get a number that changes whenever built text geometry goes stale
+    ///
+    /// It changes when a texture grows, which moves every texture
+    /// coordinate, or when the glyphs are discarded. No two fonts
+    /// ever share a value, so it also tells fonts at the same address apart.
+    ///
+    ////////////////////////////////////////////////////////////
+    Uint64 getGeneration() const;
+
     ////////////////////////////////////////////////////////////
     /// \brief Return the default built-in font
     ///
@@ -212,12 +292,27 @@ private :
     struct Page
     {
         Page();
+
+        /// Copy the glyphs and pixels into a texture of its own
+        Page(const Page& copy);
+
 		~Page();
 
-        GlyphTable       glyphs;  ///< Table mapping code points to their corresponding glyph
-        Texture2D        texture; ///< Texture containing the pixels of the glyphs
-        unsigned int     nextRow; ///< Y position of the next new row in the texture
-        std::vector<Row> rows;    ///< List containing the position of all the existing rows
+        /// Copy glyph coverage into the pixels, to be uploaded with the next flush
+        void write(const Uint8* alpha, unsigned int width, unsigned int height, unsigned int x, unsigned int y);
+
+        /// Upload the rows written since the last flush
+        void flush();
+
+        GlyphTable         glyphs;      ///< Table mapping code points to their corresponding glyph
+        Texture2D          texture;     ///< Texture containing the pixels of the glyphs
+        unsigned int       nextRow;     ///< Y position of the next new row in the texture
+        std::vector<Row>   rows;        ///< List containing the position of all the existing rows
+        std::vector<Uint8> pixels;      ///< Copy of the texture, so it can grow without reading it back
+        unsigned int       width;       ///< Size of the texture in pixels
+        unsigned int       height;
+        unsigned int       dirtyTop;    ///< Rows written and not uploaded yet, empty when top >= bottom
+        unsigned int       dirtyBottom;
     };
 
     ////////////////////////////////////////////////////////////
@@ -250,6 +345,18 @@ private :
     ////////////////////////////////////////////////////////////
     IntRect findGlyphRect(Page& page, unsigned int width, unsigned int height) const;
 
+    ////////////////////////////////////////////////////////////
+    /// \brief Get a glyph scaled from the distance field atlas
+    ///
+    ////////////////////////////////////////////////////////////
+    const Glyph& getDistanceFieldGlyph(Uint32 codePoint, unsigned int characterSize, bool bold) const;
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Rasterize a glyph at the base size into the distance field atlas
+    ///
+    ////////////////////////////////////////////////////////////
+    Glyph loadDistanceFieldGlyph(Uint32 codePoint, bool bold) const;
+
     ////////////////////////////////////////////////////////////
     /// \brief Make sure that the given size is the current one
     ///
@@ -274,6 +381,13 @@ private :
     int*                       m_refCount;    ///< Reference counter used by implicit sharing
     mutable PageTable          m_pages;       ///< Table containing the glyphs pages by character size
     mutable std::vector<Uint8> m_pixelBuffer; ///< Pixel buffer holding a glyph's pixels before being written to the texture
+    bool                       m_distanceField;         ///< Are glyphs rasterized once as distance fields?
+    unsigned int               m_distanceFieldSize;     ///< Character size the distance fields are made at
+    unsigned int               m_distanceFieldSpread;   ///< Pixels of the base size covered around the outlines
+    int                        m_distanceFieldSpacing;  ///< Line spacing at the base size, for atlases loaded without a face
+    mutable Page*              m_distanceFieldPage;     ///< The atlas of every size, created on first use
+    mutable std::map<unsigned int, GlyphTable> m_scaledGlyphs; ///< Metrics of the atlas glyphs, per character size
+    mutable Uint64             m_generation;            ///< See getGeneration()
 };
 
 NEPHILIM_NS_END
@@ -8,6 +8,7 @@
 NEPHILIM_NS_BEGIN
 
 class Image;
+class MipChain;
 
 /**
 	\class GDI_Texture2D
@@ -16,6 +17,9 @@ class Image;
 class NEPHILIM_API GDI_Texture2D
 {
 public:
+	/// Implementations release their resource when the owning Texture2D deletes them
+	virtual ~GDI_Texture2D();
+
 
 	/// Create or recreate the texture with a given size
 	virtual bool create(unsigned int width, unsigned int height);
@@ -34,6 +38,12 @@ public:
 	/// Loads the texture from a image buffer
 	virtual bool loadFromImage(const Image& image);
 
+	/// Loads every level of a mipmap chain
+	virtual bool loadFromMipChain(const MipChain& chain);
+
+	/// Build mipmaps for the images loaded from now on
+	virtual void setMipmapped(bool mipmapped);
+
 	/// Sets the texture repeat mode
 	virtual void setRepeated(bool repeated);
 
@@ -3,16 +3,29 @@
 
 #include <Nephilim/Platform.h>
 
+#include <cstddef>
+
 NEPHILIM_NS_BEGIN
 
 /**
 	\class GDI_VertexBuffer
 	\brief Interface for implementing geometry buffers
+
+	Implementations are made by GraphicsDevice::createVertexBuffer(),
+	so the buffer lives wherever that device can draw from.
 */
 class NEPHILIM_API GDI_VertexBuffer
 {
 public:
-	
+	/// Implementations release their resource when deleted
+	virtual ~GDI_VertexBuffer();
+
+	/// Allocate size bytes, dropping the previous contents
+	/// Dynamic buffers are expected to be rewritten every frame
+	virtual void allocate(std::size_t size, bool dynamic);
+
+	/// Overwrite size bytes starting at offset, without reallocating
+	virtual void write(const void* data, std::size_t size, std::size_t offset);
 };
 
 NEPHILIM_NS_END
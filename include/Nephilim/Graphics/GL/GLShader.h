@@ -6,12 +6,17 @@
 #include <Nephilim/Foundation/String.h>
 
 #include <vector>
+#include <map>
 
 NEPHILIM_NS_BEGIN
 
 /**
 	\class GLShader
 	\brief Single shader program (OpenGL Shader: GLSL)
+
+	The locations of all active uniforms are read once when the program links,
+	so setting a uniform by name is a table lookup instead of a driver query.
+	Binding is skipped when the program is already the last one bound.
 */
 class NEPHILIM_API GLShader : public GDI_ShaderProgram
 {
@@ -48,8 +53,16 @@ public:
 	bool loadShaderFromFile(ShaderTypes type, const String& filename);
 
 	/// Binds the shader to the GPU
+	/// Does nothing when it is already the last program bound through bind()
 	void bind() const;
 
+	/// Check if this program is the one last bound through bind(), without querying OpenGL
+	bool isBound() const;
+
+	/// Get the location of an active uniform, or -1 if the program doesn't use it
+	/// Arrays can be looked up with or without the [0] suffix
+	int getUniformLocation(const String& uniform) const;
+
 	/// Returns whether or not shaders can be used at the moment
 	/// The result of this function depends primarily on the machine you're running the program on
 	static bool isAvailable();
@@ -58,6 +71,10 @@ public:
 	/// Returns 0 if none is active.
 	static unsigned int getCurrentActiveProgram();
 
+	/// Forget which program is bound, the next bind() always reaches OpenGL
+	/// Call this after binding programs with glUseProgram directly
+	static void forgetBoundProgram();
+
 	/// Returns the string
 	static String getVersion();
 
@@ -72,10 +89,16 @@ public:
 
 	unsigned int getIdentifier();
 
+private:
+
+	/// Fill the uniform table from the active uniforms of the linked program
+	void reflectUniforms();
+
 public:
 	unsigned int m_id; ///< Internal shader identifier
 	std::vector<std::pair<ShaderTypes, unsigned int> > m_shaders; ///< List of compiled shaders
 	std::vector<std::pair<unsigned int, String> > m_attribs; ///< List of pre-binded attribute locations
+	std::map<String, int> m_uniforms; ///< Locations of the active uniforms, filled when linking
 };
 
 NEPHILIM_NS_END
@@ -10,6 +10,7 @@
 NEPHILIM_NS_BEGIN
 
 class Image;
+class MipChain;
 
 /**
 	\class GLTexture2D
@@ -30,8 +31,15 @@ public:
 	/// Unload the texture
 	void unload();
 
+	/// Let the GPU driver generate the mipmaps of the current contents, desktop only
 	void generateMipMaps();
 
+	/// Build mipmaps for the images loaded from now on, gamma correct, with MipChain
+	void setMipmapped(bool mipmapped);
+
+	/// Check if images loaded from now on get mipmaps
+	bool isMipmapped() const;
+
 	/// Get the internal OpenGL identifier of this texture
 	unsigned int getIdentifier() const;
 
@@ -57,6 +65,10 @@ public:
 	/// Loads directly from an image
 	bool loadFromImage(const Image &image);
 
+	/// Load every level of a chain built beforehand, like on a loader thread
+	/// On OpenGL ES without OES_texture_npot, non power of two textures only get level 0
+	bool loadFromMipChain(const MipChain& chain);
+
 	/// Load a texture from a file
 	/// This is a proxy for Image::loadFromFile() and then Texture::loadFromImage()
 	bool loadFromFile(const String &path);
@@ -65,9 +77,14 @@ public:
 	Vector2<int> getSize() const;
 
 	/// Bind this texture to the currently active texture unit
+	/// Does nothing when it is already the last texture bound through bind()
 	void bind() const;
 
+	/// Check if this texture is the one last bound through bind(), without querying OpenGL
+	bool isBound() const;
+
 	/// Updates a given region inside the texture with an array of pixels
+	/// Only level 0 is updated, so a mipmapped texture stops using its mipmaps until it is loaded again
 	void update(const Uint8* pixels, unsigned int width, unsigned int height, unsigned int x, unsigned int y);
 
 	/// Update the texture on the GPU with an array of pixels
@@ -83,6 +100,10 @@ public:
 	/// Get the id of the currently bound texture for the currently set texture unit
 	static unsigned int getCurrentBoundTexture();
 
+	/// Forget which texture is bound, the next bind() always reaches OpenGL
+	/// Call this after binding textures or switching texture units with OpenGL directly
+	static void forgetBoundTexture();
+
 private:
 	unsigned int m_texture; ///< OpenGL texture
 	Vec2i m_size;           ///< Requested size of the texture
@@ -90,6 +111,8 @@ private:
 	bool m_pixelsFlipped;   ///< Is this texture upside-down?
 	bool m_isSmooth;        ///< Is this texture smoothed?
 	bool m_isRepeated;      ///< Is this texture repeating?
+	bool m_isMipmapped;     ///< Are mipmaps built for the loaded images?
+	bool m_hasMipmaps;      ///< Does the texture in the GPU have all its levels?
 };
 
 NEPHILIM_NS_END
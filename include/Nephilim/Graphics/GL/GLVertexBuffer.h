@@ -34,6 +34,12 @@ public:
 	/// Make sure the opengl resource has been released and its data
 	~GLVertexBuffer();
 
+	/// Create the buffer if needed and allocate size bytes, streamed when dynamic
+	virtual void allocate(std::size_t size, bool dynamic);
+
+	/// Overwrite size bytes starting at offset, the buffer gets bound
+	virtual void write(const void* data, std::size_t size, std::size_t offset);
+
 	/// Activate this VBO as current
 	void bind();
 
@@ -49,6 +55,9 @@ public:
 	/// Upload a VertexArray to the GPU memory
 	void upload(const VertexArray& vertexArray, StorageMode mode);
 
+	/// Overwrite <size> bytes of the buffer starting at <offset>, without reallocating it
+	void update(const void* data, Int32 size, Int32 offset);
+
 	/// Check if the VBO is valid (initialized)
 	operator bool() const;
 
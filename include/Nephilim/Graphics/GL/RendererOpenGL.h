@@ -35,6 +35,9 @@ public:
 	/// Draw a vertex array
 	virtual void draw(const VertexArray2D& varray, const RenderState& state);
 
+	/// Draw count vertices of a vertex array, starting at first
+	virtual void drawRange(const VertexArray2D& varray, std::size_t first, std::size_t count);
+
 	/// This will cancel all shader-related settings and activate the default shader/fixed pipeline
 	virtual void setDefaultShader();
 
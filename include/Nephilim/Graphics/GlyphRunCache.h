@@ -0,0 +1,112 @@
+#ifndef NephilimGraphicsGlyphRunCache_h__
+#define NephilimGraphicsGlyphRunCache_h__
+
+#include <Nephilim/Platform.h>
+#include <Nephilim/Foundation/String.h>
+#include <Nephilim/Foundation/Color.h>
+#include <Nephilim/Foundation/Rect.h>
+#include <Nephilim/Graphics/VertexArray2D.h>
+
+#include <list>
+#include <string>
+#include <unordered_map>
+
+NEPHILIM_NS_BEGIN
+
+class Font;
+class GraphicsDevice;
+
+/**
+	\ingroup Graphics
+	\class GlyphRunCache
+	\brief Keeps the laid out geometry of recently drawn strings
+
+	Laying out text means a glyph and a kerning lookup and a quad per character.
+	Labels and world text are mostly the same strings frame after frame, so their
+	runs are kept here, keyed by string, font, size, style and color, and drawn
+	again as they are. The least recently used runs are evicted past the capacity.
+
+	A run is rebuilt when its font's generation changed, because the glyph
+	texture grew or the glyphs were reloaded since it was laid out.
+*/
+class NEPHILIM_API GlyphRunCache
+{
+public:
+	/// A string laid out into triangles, with the origin at the top left of its first line
+	struct Run
+	{
+		VertexArray2D vertices;
+		FloatRect     bounds;
+		const Font*   font;
+		unsigned int  characterSize;
+		Uint64        generation;  ///< Of the font when laid out
+	};
+
+	/// How well the cache is doing since the last reset
+	struct Statistics
+	{
+		Uint64      hits;
+		Uint64      misses;
+		Uint64      evictions;
+		std::size_t runs;      ///< Runs currently kept
+		std::size_t vertices;  ///< Vertices held by those runs
+
+		/// Fraction of the lookups that found their run, 0 without lookups
+		float getHitRate() const;
+	};
+
+	/// Creates a cache keeping up to capacity runs
+	explicit GlyphRunCache(std::size_t capacity = 1024);
+
+	/// Get the run of a string, laying it out if it isn't kept or is stale
+	/// The reference stays valid until the run is evicted, at least until the next get()
+	const Run& get(const String& string, const Font& font, unsigned int characterSize, Uint32 style = 0, const Color& color = Color::White);
+
+	/// Draw a run with the current model matrix
+	static void draw(GraphicsDevice* renderer, const Run& run);
+
+	/// Change how many runs are kept, evicting the oldest if needed
+	void setCapacity(std::size_t capacity);
+
+	/// Get how many runs are kept at most
+	std::size_t getCapacity() const;
+
+	/// Forget every run
+	void clear();
+
+	/// Get the hit rate and size of the cache
+	Statistics getStatistics() const;
+
+	/// Start counting hits and misses from zero
+	void resetStatistics();
+
+	/// Get the cache shared by the painters and the renderer
+	static GlyphRunCache& instance();
+
+private:
+	struct Entry
+	{
+		std::string key;
+		Run         run;
+	};
+
+	typedef std::list<Entry> EntryList;
+
+	/// Pack everything a run depends on into one string
+	static void makeKey(std::string& key, const String& string, const Font& font, unsigned int characterSize, Uint32 style, const Color& color);
+
+	/// Drop the least recently used runs down to the capacity
+	void evict();
+
+	EntryList                                              m_entries;  ///< Most recently used first
+	std::unordered_map<std::string, EntryList::iterator>   m_index;
+	std::size_t                                            m_capacity;
+	std::size_t                                            m_vertexCount;
+	Uint64                                                 m_hits;
+	Uint64                                                 m_misses;
+	Uint64                                                 m_evictions;
+	std::string                                            m_keyBuffer; ///< Reused so hits don't allocate
+};
+
+NEPHILIM_NS_END
+#endif // NephilimGraphicsGlyphRunCache_h__
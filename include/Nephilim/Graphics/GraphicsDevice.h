@@ -31,6 +31,9 @@ class VertexArray;
 class IndexArray;
 class Shader;
 class VertexBuffer;
+class IndexBuffer;
+class GDI_Texture2D;
+class GDI_VertexBuffer;
 
 /**
 	\class GraphicsDevice
@@ -42,9 +45,21 @@ class VertexBuffer;
 	  the drawable
 	- Textures are activated at texture unit 0, as default
 	- Whether the vertex array is textured or not, a uniform int textured variable will be set with 1 or 0, for true or false.
+
+	The device shadows the bound program and texture, blending, depth testing and the matrices,
+	and drops any change that wouldn't alter them. Code that changes that state with OpenGL
+	directly must call invalidateStateCache() afterwards.
 */
 class NEPHILIM_API GraphicsDevice
 {
+public:
+	/// Counters of the render state changes asked from the device during a frame
+	struct StateStatistics
+	{
+		int issued;  ///< Changes that reached OpenGL
+		int skipped; ///< Changes dropped because the state was already set
+	};
+
 protected:
 	/// Enumerates all types of native renderers
 	enum Type
@@ -70,10 +85,22 @@ protected:
 	bool		          m_shaderUsageHint; ///< Hint for the default shader usage
 	Texture2D	          m_defaultTexture;  ///< Full white 1x1 default texture
 	std::stack<FloatRect> m_scissorStack;    ///< Stack of scissor test regions
+	StateStatistics       m_stateStatistics;     ///< State changes of the frame in progress
+	StateStatistics       m_lastStateStatistics; ///< State changes of the last finished frame
+	int                   m_blendMode;        ///< Shadow of the blend function, -1 when unknown
+	int                   m_blendingEnabled;  ///< Shadow of GL_BLEND, -1 when unknown
+	int                   m_depthTestEnabled; ///< Shadow of GL_DEPTH_TEST, -1 when unknown
+	bool                  m_textureUnitKnown; ///< Whether texture unit 0 is known to be the active one
+	Uint64                m_drawCallCount;    ///< Draw calls made through drawArrays() and drawElements()
 
 	/// Conversion table of Render::Primitive::Type to GLenum
 	std::map<Render::Primitive::Type, int> m_primitiveTable;
 
+	/// Make a shader the active program, its matrix uniforms are brought up to date when it changes
+	void activateShader(GLShader* shader);
+
+	/// Store a new value for one of the matrices, returns false when it already held it
+	bool changeMatrix(mat4& current, const mat4& value);
 
 public:
 
@@ -116,10 +143,24 @@ public:
 		return nullptr;
 	}
 
+	/// Create the implementation of a new Texture2D for this device
+	virtual GDI_Texture2D* createTexture2D();
+
+	/// Create the implementation of a new VertexBuffer for this device
+	/// The caller owns it, usually by storing it in VertexBuffer::_impl
+	virtual GDI_VertexBuffer* createVertexBuffer();
+
+	/// Create the index buffer if needed and fill it with the indices, replacing what it held
+	virtual void uploadIndexBuffer(IndexBuffer* indexBuffer, const IndexArray& indices);
+
 	/// Activates a given vertex buffer for any subsequent draw calls
 	/// Passing nullptr unbinds any vertex buffer
 	virtual void setVertexBuffer(VertexBuffer* vertexBuffer);
 
+	/// Activates a given index buffer for any subsequent indexed draw calls
+	/// Passing nullptr unbinds any index buffer
+	virtual void setIndexBuffer(IndexBuffer* indexBuffer);
+
 
 	/// Push client-side geometry to the GPU
 	/// This is usually slower than using a VBO because the data is uploaded to the GPU every time
@@ -131,6 +172,10 @@ public:
 	/// Draw a vertex array
 	virtual void draw(const VertexArray2D& varray, const RenderState& state = RenderState());
 
+	/// Draw count vertices of a vertex array, starting at first
+	/// The default copies the range out and draws it with draw(), renderers override it to draw in place
+	virtual void drawRange(const VertexArray2D& varray, std::size_t first, std::size_t count);
+
 	/// Allows a drawable to draw itself
 	virtual void draw(Drawable &drawable);
 
@@ -238,24 +283,42 @@ public:
 	mat4 getModelMatrix();
 
 	/// Capture the currently bound frame buffer pixles to an image
-	bool readPixels(Image& image);
+	virtual bool readPixels(Image& image);
 
 	/// Orders the renderer to reload the default texture etc
 	void reloadResources();
 
+	/// Start counting state changes for a new frame and forget the shadowed state
+	/// The counters of the frame that just ended remain available from getStateStatistics()
+	void beginFrame();
+
+	/// Forget the shadowed render state, so the next change of each kind reaches OpenGL
+	void invalidateStateCache();
+
+	/// Get the counters of state changes of the last finished frame
+	StateStatistics getStateStatistics() const;
+
+	/// Get how many draw calls were made through drawArrays() and drawElements() since the device was created
+	/// Comparing two readings tells whether something drew in between
+	Uint64 getDrawCallCount() const;
+
 	// -- Low level calls
 
 	/// Mimics glDrawArrays()
-	void drawArrays(Render::Primitive::Type primitiveType, int start, int count);
+	virtual void drawArrays(Render::Primitive::Type primitiveType, int start, int count);
+
+	/// Mimics glDrawElements() with 16 bit indices
+	/// indices is a pointer to client memory, or a byte offset when an index buffer is bound
+	virtual void drawElements(Render::Primitive::Type primitiveType, int count, const void* indices);
 
 	/// Mimics glEnableVertexAttribArray()
-	void enableVertexAttribArray(unsigned int index);
+	virtual void enableVertexAttribArray(unsigned int index);
 
 	/// Mimics glDisableVertexAttribArray()
-	void disableVertexAttribArray(unsigned int index);
+	virtual void disableVertexAttribArray(unsigned int index);
 
 	/// Mimics glVertexAttribPointer()
-	void setVertexAttribPointer(unsigned int index, int numComponents, int componentType, bool normalized, int stride, const void* ptr);
+	virtual void setVertexAttribPointer(unsigned int index, int numComponents, int componentType, bool normalized, int stride, const void* ptr);
 
 	/// The renderer always has a target resolution to operate
 	/// On windowed mode, its the size of the window's client area and in fullscreen the native resolution we're running at
@@ -3,8 +3,12 @@
 
 #include <Nephilim/Platform.h>
 
+#include <vector>
+
 NEPHILIM_NS_BEGIN
 
+class IndexArray;
+
 class NEPHILIM_API IndexBuffer
 {
 public:
@@ -23,6 +27,15 @@ public:
 	/// Eliminate the opengl resource and its data
 	void destroy();
 
+	/// Upload the indices to the GPU memory, the buffer must be bound
+	void upload(const IndexArray& indexArray);
+
+	/// Check if the buffer is valid (initialized)
+	operator bool() const;
+
+	/// Indices kept in system memory by devices that draw without a GPU, empty otherwise
+	std::vector<Uint16> clientIndices;
+
 private:
 	unsigned int mObject;
 };
@@ -0,0 +1,84 @@
+#ifndef NephilimGraphicsMipChain_h__
+#define NephilimGraphicsMipChain_h__
+
+#include <Nephilim/Platform.h>
+#include <Nephilim/Foundation/Vector.h>
+
+#include <vector>
+
+NEPHILIM_NS_BEGIN
+
+class Image;
+class JobSystem;
+
+/**
+	\ingroup Graphics
+	\class MipChain
+	\brief Every mipmap level of a RGBA image, down to 1x1, in one buffer
+
+	Each level halves the previous one, rounding down, with a box filter: 2x2 pixels make one
+	where the previous level has an even size. Where it has an odd size, three pixels make one
+	with weights that follow how much of each the destination pixel covers, so nothing shifts
+	or drops from level to level on textures that aren't a power of two.
+
+	Gamma correct chains average the colors in linear space and store them back as sRGB,
+	so bright and dark areas don't get darker as they shrink. Alpha is always averaged as is.
+	Data like normal maps should be built without it.
+
+	Levels are built one after another, each split in rows over the job system if one is given.
+	The whole chain is allocated once, level 0 being a copy of the source pixels,
+	so it can be built on a loader thread and uploaded later in a single pass.
+*/
+class NEPHILIM_API MipChain
+{
+public:
+	/// Creates an empty chain
+	MipChain();
+
+	/// Build the chain of a width x height RGBA image, replacing the previous one
+	/// Returns false if the image is empty
+	bool build(const Uint8* pixels, int width, int height, bool gammaCorrect = true, JobSystem* jobs = nullptr);
+
+	/// Build the chain of an image, replacing the previous one
+	bool build(const Image& image, bool gammaCorrect = true, JobSystem* jobs = nullptr);
+
+	/// Release the levels
+	void clear();
+
+	/// Check if there are no levels
+	bool isEmpty() const;
+
+	/// Get the number of levels, 0 while empty
+	int getLevelCount() const;
+
+	/// Get the size of a level
+	Vec2i getLevelSize(int level) const;
+
+	/// Get the pixels of a level, tightly packed rows of RGBA
+	const Uint8* getLevelPixels(int level) const;
+
+	/// Get the bytes used by every level together
+	std::size_t getByteSize() const;
+
+	/// Get how many levels a full chain of a width x height image has
+	static int getLevelCount(int width, int height);
+
+	/// Log how long the chain of a width x height image takes to build, against the old Image::scale levels
+	/// Gamma correct and linear chains are timed on the calling thread, and over the job system if one is given
+	static void benchmark(int width = 2048, int height = 2048, std::size_t rounds = 5, JobSystem* jobs = nullptr);
+
+private:
+	/// Where a level is in the buffer
+	struct Level
+	{
+		int         width;
+		int         height;
+		std::size_t offset;
+	};
+
+	std::vector<Level> m_levels;
+	std::vector<Uint8> m_pixels;  ///< Every level, the largest first
+};
+
+NEPHILIM_NS_END
+#endif // NephilimGraphicsMipChain_h__
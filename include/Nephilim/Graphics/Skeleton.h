@@ -36,9 +36,22 @@ public:
 	/// Takes an array of bone transforms in their local spaces and converts them to transformed global space
 	void convertToWorldSpace(std::vector<mat4>& localBoneTransforms);
 
+	/// Computes the global transform of every bone from its local transform in a single pass
+	/// Both arrays are indexed by bone and must hold bones.size() elements, they may be the same array
+	void computeWorldPose(const mat4* localBoneTransforms, mat4* worldBoneTransforms);
+
+	/// Prepare the order bones are evaluated in, parents always come before their children
+	/// Must be called again when bones are added, removed or reparented; the pose functions call it if the bone count changed
+	void compile();
+
 	Int32 getIndexFromName(const String& name);
 
 	std::vector<Bone> bones;
+
+private:
+
+	/// Bone indices sorted so every parent comes before its children
+	std::vector<Int32> mEvaluationOrder;
 };
 
 NEPHILIM_NS_END
@@ -0,0 +1,123 @@
+#ifndef NephilimGraphicsSpriteBatch_h__
+#define NephilimGraphicsSpriteBatch_h__
+
+#include <Nephilim/Platform.h>
+#include <Nephilim/Foundation/Matrix.h>
+#include <Nephilim/Foundation/Vector.h>
+#include <Nephilim/Foundation/Color.h>
+#include <Nephilim/Foundation/Rect.h>
+
+#include <Nephilim/Graphics/RenderModes.h>
+#include <Nephilim/Graphics/VertexBuffer.h>
+#include <Nephilim/Graphics/IndexBuffer.h>
+
+#include <vector>
+
+NEPHILIM_NS_BEGIN
+
+class GraphicsDevice;
+class Texture2D;
+
+/**
+	\class SpriteBatch
+	\brief Collects textured quads and draws them with as few draw calls as possible
+
+	Quads are queued between begin() and end(). On end(), they are sorted by layer, blend mode,
+	texture and depth, written into one streaming vertex buffer and drawn with one indexed
+	draw call per run of quads that share the same layer and state.
+
+	Layers are what orders quads of different states: a lower layer is always drawn first.
+	Within a layer, quads are grouped by state and depth only orders the quads of a run,
+	so depth never splits a batch. Put quads that must be ordered against other textures,
+	like overlapping alpha blended sprites, in different layers.
+	Quads with equal keys keep their submission order, so the result is stable from frame to frame.
+
+	Both buffers are made by the device passed to end(), so the batch draws on any device that
+	implements createVertexBuffer() and uploadIndexBuffer(). The vertex buffer is kept across
+	frames and only grows, while the index buffer holds a fixed quad pattern uploaded once.
+	The vertex layout matches the default shader: position at location 0, color at 1
+	and texture coordinates at 2.
+*/
+class NEPHILIM_API SpriteBatch
+{
+public:
+
+	/// Counters of the last finished batch
+	struct Statistics
+	{
+		int sprites;   ///< Quads submitted
+		int batches;   ///< Runs of consecutive quads sharing layer, texture and blend mode
+		int drawCalls; ///< Draw calls issued, can exceed batches when a run overflows the index range
+	};
+
+	/// Maximum number of quads in a single draw call, limited by 16 bit indices
+	static const int MaxQuadsPerDraw = 16384;
+
+public:
+
+	/// Initialize an empty batch
+	SpriteBatch();
+
+	/// Release the buffers
+	~SpriteBatch();
+
+	/// Start collecting quads for a new frame, dropping anything not yet drawn
+	void begin();
+
+	/// Queue a quad
+	/// rect is in local space and gets transformed by transform on the CPU
+	/// texRect is in normalized texture coordinates
+	/// depth orders the quad within its batch, layer orders it against every other quad
+	void draw(const Texture2D* texture, const mat4& transform, const FloatRect& rect, const FloatRect& texRect, const Color& color, Render::Blend::Mode blendMode = Render::Blend::Alpha, float depth = 0.f, int layer = 0);
+
+	/// Sort, upload and draw everything queued since begin()
+	void end(GraphicsDevice* device);
+
+	/// Get the counters of the last end()
+	Statistics getStatistics() const;
+
+	/// Draw a known set of quads on a recording device, which needs no GPU or window,
+	/// and check the batch and draw call counts against the expected ones
+	/// Logs the outcome and returns whether every count matched
+	static bool verifyBatching();
+
+private:
+
+	/// One queued quad, already in world space
+	struct Quad
+	{
+		const Texture2D*   texture;
+		Render::Blend::Mode blendMode;
+		float              depth;
+		int                layer;
+		vec2               corners[4];
+		vec2               uv[4];
+		vec4               color;
+	};
+
+	/// Interleaved vertex as seen by the shader
+	struct Vertex
+	{
+		vec2 position;
+		vec4 color;
+		vec2 uv;
+	};
+
+	/// Make sure the buffers of the device can hold this many quads
+	void reserveBuffers(GraphicsDevice* device, std::size_t quadCount);
+
+	/// Issue the draw calls for quads [first, first + count) already in the vertex buffer
+	void flush(GraphicsDevice* device, const Quad& state, std::size_t first, std::size_t count);
+
+	std::vector<Quad>        mQuads;            ///< Quads queued this frame
+	std::vector<std::size_t> mOrder;            ///< Sorted draw order, indices into mQuads
+	std::vector<Vertex>      mVertices;         ///< CPU staging for the vertex buffer
+	VertexBuffer             mVertexBuffer;     ///< Streaming vertex buffer, reused across frames
+	IndexBuffer              mIndexBuffer;      ///< Static quad index pattern
+	GraphicsDevice*          mBufferDevice;     ///< Device that made the buffers, they are remade for another one
+	std::size_t              mVertexCapacity;   ///< Quads the vertex buffer can hold
+	Statistics               mStatistics;       ///< Counters of the last end()
+};
+
+NEPHILIM_NS_END
+#endif // NephilimGraphicsSpriteBatch_h__
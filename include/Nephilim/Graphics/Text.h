@@ -63,7 +63,7 @@ public:
 		//*this += L'H';
 	} 
 
-	std::size_t getSize(){
+	std::size_t getSize() const {
 		return size();
 	}
 };
@@ -116,6 +116,16 @@ public:
 		const Font& getFont() const;
 		unsigned int getCharacterSize() const;
 
+		/// Lay out a string into textured triangles, with the origin at the top left of the first line
+		/// Returns the bounds of the geometry. This is all updateGeometry() does, shared with GlyphRunCache
+		static FloatRect buildGeometry(const UString& string, const Font& font, unsigned int characterSize, Uint32 style, const Color& color, VertexArray2D& vertices);
+
+		/// Draw vertices made by buildGeometry(), with the current model matrix
+		static void drawGeometry(GraphicsDevice* renderer, const Font& font, unsigned int characterSize, const VertexArray2D& vertices);
+
+		/// Draw count vertices made by buildGeometry(), starting at first, with the current model matrix
+		static void drawGeometry(GraphicsDevice* renderer, const Font& font, unsigned int characterSize, const VertexArray2D& vertices, std::size_t first, std::size_t count);
+
 
 	////////////////////////////////////////////////////////////
     /// \brief Enumeration of the string drawing styles
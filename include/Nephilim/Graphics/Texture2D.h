@@ -9,6 +9,7 @@ NEPHILIM_NS_BEGIN
 
 class GDI_Texture2D;
 class Image;
+class MipChain;
 
 /**
 	\class Texture2D
@@ -63,6 +64,12 @@ public:
 	/// Should be avoided in favor of the central asset loading
 	bool loadFromImage(const Image& image);
 
+	/// Loads every level of a mipmap chain, built beforehand like on a loader thread
+	bool loadFromMipChain(const MipChain& chain);
+
+	/// Build gamma correct mipmaps for the images loaded from now on
+	void setMipmapped(bool mipmapped);
+
 	/// Retrieve the texture from the GPU and into an image
 	/// Does not work in OpenGL ES platforms. An warning is logged in such platforms.
 	/// Returns false if the operation fails
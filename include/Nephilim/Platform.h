@@ -6,6 +6,7 @@
 /// NEPHILIM_SFML       - Defined for platforms that use SFML to manage a window
 /// NEPHILIM_NOPROFILER - Disables the profiling tools globally if defined
 /// NEPHILIM_GLES1		- Define this globally so the engine uses a OpenGL ES 1.1 renderer by default
+/// NEPHILIM_NOSIMD     - Forces the scalar fallback of the math kernels even if SSE or NEON are available
 
 /**
 	\namespace pE
@@ -79,6 +80,15 @@
 #endif
 
 
+// -- SIMD instruction set used by the math kernels
+#if !defined NEPHILIM_NOSIMD
+	#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+		#define NEPHILIM_SIMD_SSE
+	#elif defined __ARM_NEON__ || defined __ARM_NEON
+		#define NEPHILIM_SIMD_NEON
+	#endif
+#endif
+
 // -- DLL/SO Exports to compile as dynamic library
 #if defined NEPHILIM_DYNAMIC
 	#define NEPHILIM_API __declspec(dllexport)
@@ -13,10 +13,21 @@ NEPHILIM_NS_BEGIN
 class NEPHILIM_API IScript
 {
 public:
+	/// Scripts are deleted through this interface
+	virtual ~IScript(){}
+
 	virtual	void call(const String& funcName){}
 
 	virtual void callOnObject(const String& function_name, void* obj){}
 
+	/// Call the same method on many objects, like the update of every behavior of one kind
+	/// Implementations should resolve the method and set up the call once for the whole batch
+	virtual void callOnObjects(const String& function_name, void* const* objects, std::size_t count)
+	{
+		for (std::size_t i = 0; i < count; ++i)
+			callOnObject(function_name, objects[i]);
+	}
+
 	virtual void* createClassInstance(const String& className){ return nullptr; }
 
 	virtual void setMemberRef(const String& identifier, void* obj, void* ref){}
@@ -4,17 +4,97 @@
 #include <Nephilim/Platform.h>
 #include <Nephilim/Foundation/String.h>
 #include <Nephilim/Foundation/Color.h>
+#include <Nephilim/Foundation/StringHash.h>
 
 #include <vector>
+#include <unordered_map>
 
 NEPHILIM_NS_BEGIN
 
+/**
+	\class StyleValue
+	\brief A property value, parsed once when its rule is added to a stylesheet
+*/
+class NEPHILIM_API StyleValue
+{
+public:
+	enum Type
+	{
+		NoValue,
+		KeywordValue,  ///< Anything else, kept as text and as an id
+		ColorValue,    ///< A color name, #rgb, #rrggbb, #rrggbbaa, rgb() or rgba()
+		LengthValue,   ///< A number with a px, % or em unit
+		NumberValue    ///< A plain number
+	};
+
+	enum LengthUnit
+	{
+		Pixels,
+		Percent,
+		Em
+	};
+
+	/// An empty value
+	StyleValue();
+
+	/// Parse a value as written in CSS
+	static StyleValue parse(const String& text);
+
+	/// Get the length in pixels, resolving percentages against reference and em against fontSize
+	float toPixels(float reference, float fontSize = 12.f) const;
+
+	Type       type;
+	Color      color;
+	float      number;   ///< The number of lengths and plain numbers
+	LengthUnit unit;
+	StringID   keyword;  ///< Id of the text, for comparing keywords without strings
+	String     text;     ///< The value as it was written, trimmed
+};
+
+/**
+	\class ComputedStyle
+	\brief The properties that apply to one widget, after matching every rule of a stylesheet
+
+	Properties are sorted by id, so a lookup is a binary search with no string compares.
+*/
+class NEPHILIM_API ComputedStyle
+{
+public:
+	typedef std::pair<StringID, StyleValue> Property;
+
+	/// Get a property, null if no rule set it
+	const StyleValue* get(StringID property) const;
+
+	/// Get a property, null if no rule set it
+	/// The name is matched regardless of case, like the declarations
+	const StyleValue* get(const String& property) const;
+
+	/// Get a color property, or fallback if it isn't set or isn't a color
+	Color getColor(const String& property, const Color& fallback) const;
+
+	/// Get a length property in pixels, or fallback if it isn't set or isn't a length
+	float getLength(const String& property, float reference, float fallback) const;
+
+	/// Forget every property
+	void clear();
+
+	/// Check if no property was set
+	bool empty() const;
+
+	std::vector<Property> properties;
+};
+
 /*
 	\class StyleSheet
 	\brief Contains a set of definitions to style an UI
 
 	A stylesheet is a set of rule blocks, bound to selectors,
 	a clever way to match elements
+
+	Selectors are compiled when their rule is added. Each is a type, an #id, any number of
+	.classes and :pseudo-classes, all kept as interned ids, and is filed under the most specific
+	of them, so matching a widget only looks at the selectors filed under its own id, classes and type.
+	Combinators aren't supported and selectors using them are ignored.
 */
 class NEPHILIM_API StyleSheet
 {
@@ -24,35 +104,64 @@ public:
 	{
 	public:
 		StyleEntry(const String& val)
+		: value(val)
+		, parsed(StyleValue::parse(val))
+		{
+		}
+
+		StyleEntry(const String& val, const StyleValue& parsedValue)
+		: value(val)
+		, parsed(parsedValue)
 		{
-			value = val;
 		}
 
 		Color toColor();
 
 		String value;
+		StyleValue parsed;
 	};
 
-	class StyleArray
+	class NEPHILIM_API StyleArray
 	{
 	public:
+		/// The declarations as written, in order
 		std::vector<std::pair<String, String> > entries;
 
+		/// The declarations parsed and sorted by property id, made by compile()
+		std::vector<ComputedStyle::Property> properties;
+
 	public:
 
-		StyleEntry getEntry(const String& entry)
-		{
-			for (auto it = entries.begin(); it != entries.end(); ++it)
-			{
-				if ((*it).first == entry)
-				{
-					return StyleEntry((*it).second);
-				}
-			}
-
-			return StyleEntry("");
-		}
+		/// Find a declaration, empty if there is none
+		/// The name is matched regardless of case, like the declarations
+		StyleEntry getEntry(const String& entry) const;
+
+		/// Find a parsed declaration, null if there is none
+		const StyleValue* getValue(StringID property) const;
+
+		/// Parse the entries into properties, the last declaration of a property wins
+		void compile();
+	};
 
+	/// What a selector needs to know about a widget to match it
+	struct Subject
+	{
+		StringID                     type;
+		StringID                     name;
+		const std::vector<StringID>* classes;        ///< Sorted
+		const std::vector<StringID>* pseudoClasses;  ///< Sorted
+	};
+
+	/// A compound selector, like button.primary:hover
+	struct Selector
+	{
+		StringID              type;           ///< 0 matches any
+		StringID              name;           ///< 0 matches any
+		std::vector<StringID> classes;        ///< Sorted
+		std::vector<StringID> pseudoClasses;  ///< Sorted
+		int                   specificity;
+		std::size_t           rule;           ///< Into stylesList
+		std::size_t           order;          ///< Later selectors win ties
 	};
 
 	std::vector<String>     selectorList;
@@ -60,8 +169,47 @@ public:
 
 public:
 
+	/// Creates an empty stylesheet
+	StyleSheet();
+
+	/// Add a rule block for a selector, or a comma separated list of them
+	void addRule(const String& selector, const StyleArray& styles);
+
+	/// Get the rule block of a selector, an empty one is added if there is none
+	/// Changes made to it directly take effect after rebuild()
 	StyleArray& getRule(const String& selector);
 
+	/// Compile every rule again, after they were changed directly
+	void rebuild();
+
+	/// Remove every rule
+	void clear();
+
+	/// Collect the properties of every rule matching subject into style, by specificity and then order
+	void computeStyle(const Subject& subject, ComputedStyle& style) const;
+
+	/// Get a number that changes whenever the rules change, to know when computed styles are stale
+	Uint64 getGeneration() const;
+
+	/// Parse one compound selector, returns false if it uses something that isn't supported
+	static bool parseSelector(const String& text, Selector& selector);
+
+	/// Check if a selector applies to a subject
+	static bool matches(const Selector& selector, const Subject& subject);
+
+private:
+	typedef std::unordered_map<StringID, std::vector<std::size_t> > SelectorBuckets;
+
+	/// Compile one selector of a rule and file it in a bucket, returns false if it isn't supported
+	bool compileSelector(const String& text, std::size_t rule);
+
+	std::vector<Selector>                     m_selectors;
+	SelectorBuckets                           m_byName;
+	SelectorBuckets                           m_byClass;
+	SelectorBuckets                           m_byType;
+	std::vector<std::size_t>                  m_universal;
+	std::unordered_map<StringID, std::size_t> m_ruleIndex;  ///< Rule of each selector text
+	Uint64                                    m_generation;
 };
 
 NEPHILIM_NS_END
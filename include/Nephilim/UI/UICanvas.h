@@ -3,6 +3,7 @@
 
 #include <Nephilim/UI/UxNode.h>
 #include <Nephilim/UI/UICore.h>
+#include <Nephilim/UI/UIDrawList.h>
 
 #include <Nephilim/Foundation/Event.h>
 
@@ -53,6 +54,7 @@ public:
 	void setWindowSize(int w, int h);
 
 	/// Returns a control in the hierarchy with the name, or NULL if not found
+	/// Looked up in the name index, so it doesn't walk the hierarchy
 	Widget* getControlByName(const String& name);
 
 	/// Adds a layer to this canvas for 2D controls
@@ -103,6 +105,8 @@ public:
 	typedef std::vector<Widget*> ControlList;
 
 	/// Makes a list of controls from a selector - CSS like
+	/// Takes compound selectors like button.primary:hover or #name, separated by commas
+	/// When every selector has an #id, only the widgets with those names are looked at
 	ControlList selectControls(const String& selector);
 
 	void showMessageBox(const String& message);
@@ -110,8 +114,13 @@ public:
 	UICore& getCore();
 
 	/// Draw the UI
+	/// Flat windows and the popups are recorded into a draw list, so widgets that didn't change
+	/// aren't painted again and their geometry is drawn in a few batches
 	void draw(GraphicsDevice* renderer);
 
+	/// Get the counters of the last drawn frame, like the batches and the widgets painted again
+	const UIDrawList::Statistics& getDrawStatistics() const;
+
 	/// Update the state of the ui
 	void update(float elapsedTime);
 	
@@ -120,6 +129,7 @@ public:
 
 	/// Process a mouve movement event
 	/// Returns false if the mouse isnt on any control
+	/// The widgets under the pointer are found in the widget index of the core, from where they were last drawn
 	bool processMouseMove(int x, int y);
 
 	void processTouchMove(int x, int y);
@@ -146,6 +156,15 @@ public:
 	Color m_backgroundColor;
 
 private:
+	/// Collect the visible widgets under a point that pointer events reach, in the order of the hierarchy
+	void collectHits(vec2 point, ControlList& hits);
+
+	/// Hover the widgets under the pointer and leave the ones it moved out of
+	void updateHover(int x, int y, bool notifyEnter);
+
+	/// Get the surface a widget is in, NULL if it isn't in any surface of this canvas
+	UIWindow* findSurface(Widget* widget);
+
 	/// The bounds of the window
 	/// In nearly every case, the bounds match exactly the dimensions of the screen
 	/// But for particular reasons, the working area of the user interface system can be smaller or bigger.
@@ -158,6 +177,12 @@ private:
 	/// The shared state of this ui system
 	UICore m_state;
 
+	/// What the widgets painted, kept between frames
+	UIDrawList m_drawList;
+
+	/// Widgets the pointer was over after the last movement
+	ControlList m_hoveredWidgets;
+
 	enum PendingChangeType
 	{
 		Add,
@@ -1,7 +1,9 @@
 #ifndef NephilimUI_Console_h__
 #define NephilimUI_Console_h__
 
-#include <Nephilim/UI/Widget.h>
+#include <Nephilim/UI/UIRowView.h>
+
+#include <vector>
 
 NEPHILIM_NS_BEGIN
 
@@ -10,8 +12,12 @@ class UILineEdit;
 /**
 	\class UIConsole
 	\brief A Console window to input commands
+
+	The log is kept in a ring buffer of lines, the oldest going away once it is full,
+	and is shown as rows, so only the lines in view have a widget.
+	While the view is at the bottom it follows the new lines.
 */
-class NEPHILIM_API UIConsole : public Widget
+class NEPHILIM_API UIConsole : public UIRowView
 {
 public:
 	String m_input;
@@ -22,7 +28,37 @@ public:
 
 public:
 
+	/// Construct an empty console
+	UIConsole();
+
+	/// Add a line to the log
+	void addLine(const String& line);
+
+	/// Set how many lines are kept, the oldest go away first
+	void setCapacity(std::size_t lines);
+
+	/// Get how many lines are kept at most
+	std::size_t getCapacity() const;
+
+	/// Forget every line
+	void clearLines();
+
+	/// Get a line, 0 is the oldest kept
+	const String& getLine(int index) const;
+
+	/// Get how many lines are kept
+	int getRowCount();
+
 	void draw(GraphicsDevice* renderer);
+
+protected:
+	/// Show a line of the log
+	void fillRow(Row& widget, int row);
+
+private:
+	std::vector<String> mLines;      ///< Ring buffer, grows up to the capacity
+	std::size_t         mFirstLine;  ///< Index of the oldest line
+	std::size_t         mCapacity;
 };
 
 NEPHILIM_NS_END
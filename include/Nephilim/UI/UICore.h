@@ -6,6 +6,7 @@
 #include <Nephilim/Graphics/Font.h>
 #include <Nephilim/Foundation/Localization.h>
 #include <Nephilim/UI/Stylesheet.h>
+#include <Nephilim/UI/UIWidgetIndex.h>
 
 NEPHILIM_NS_BEGIN
 
@@ -13,6 +14,7 @@ class UICanvas;
 class Widget;
 class GameContent;
 class UIController;
+class UIDrawList;
 
 class NEPHILIM_API UIDragEvent
 {
@@ -74,6 +76,12 @@ public:
 	/// Every UICore has a global stylesheet
 	StyleSheet stylesheet;
 
+	/// The list widgets record their painting into while the canvas draws, null when they draw directly
+	UIDrawList* drawList = nullptr;
+
+	/// Where every widget of the hierarchy was last drawn and what it is named, for pointer events and lookups
+	UIWidgetIndex widgetIndex;
+
 	/// \ingroup UI
 	/// \class FontResource
 	/// \brief A font resource used by the UI system
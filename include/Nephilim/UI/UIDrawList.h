@@ -0,0 +1,163 @@
+#ifndef NephilimUI_UIDrawList_h__
+#define NephilimUI_UIDrawList_h__
+
+#include <Nephilim/Platform.h>
+#include <Nephilim/Foundation/Matrix.h>
+#include <Nephilim/Foundation/Rect.h>
+#include <Nephilim/Foundation/Color.h>
+#include <Nephilim/Graphics/VertexArray2D.h>
+
+#include <vector>
+
+NEPHILIM_NS_BEGIN
+
+class Font;
+class GraphicsDevice;
+
+/**
+	\ingroup UI
+	\class UIDrawList
+	\brief Collects what the widgets paint into few draw calls
+
+	While a canvas draws, painters record their rectangles and text into this list
+	instead of drawing them. Every widget keeps what its onPaint() recorded as a Chunk,
+	already in canvas coordinates, and appends it again as it is while nothing it depends on changed,
+	so a still interface costs copying vertices around rather than laying them out.
+
+	The geometry is grouped into batches by texture and clip rectangle. A command may join an earlier
+	batch with the same state when nothing recorded after that batch overlaps it, so the drawing order
+	is preserved where it is visible. flush() copies the batches into one shared vertex array and
+	draws each with a single call. Rectangles are drawn with the white square every font page reserves,
+	so they batch together with the text of the same font.
+
+	Anything drawn directly with the GraphicsDevice in between must flush() the list first.
+*/
+class NEPHILIM_API UIDrawList
+{
+public:
+	/// A run of vertices sharing the same texture
+	struct Command
+	{
+		const Font*  font;          ///< Owner of the texture, null for the default white texture
+		unsigned int characterSize; ///< Picks the font page and the distance field smoothing
+		Uint64       generation;    ///< Of the font when recorded
+		std::size_t  first;         ///< Into the vertices of the chunk
+		std::size_t  count;
+		FloatRect    bounds;        ///< Of the vertices, in canvas coordinates
+	};
+
+	/// What a widget painted, kept between frames
+	struct Chunk
+	{
+		std::vector<VertexArray2D::Vertex> vertices;
+		std::vector<Command>               commands;
+
+		/// Forget the recorded geometry
+		void clear();
+
+		/// Check if a font changed its glyph textures since the geometry was recorded
+		bool isStale() const;
+	};
+
+	/// Counters of the last finished frame
+	struct Statistics
+	{
+		int         batches;           ///< Draw calls made for the recorded geometry
+		int         commands;          ///< Runs of vertices that went into those batches
+		int         flushes;           ///< Times the list was drawn, including the early ones before direct drawing
+		int         paintedWidgets;    ///< Widgets whose onPaint() ran and was recorded
+		int         reusedWidgets;     ///< Widgets drawn from what they recorded before
+		int         immediateWidgets;  ///< Widgets that draw with the device directly
+		std::size_t vertices;
+	};
+
+	/// Creates an empty list
+	UIDrawList();
+
+	/// Start counting a new frame, the counters of the last one remain available from getStatistics()
+	void beginFrame();
+
+	/// Get the counters of the last finished frame
+	const Statistics& getStatistics() const;
+
+	/// Start recording the painting of a widget into chunk, clearing it
+	void beginChunk(Chunk& chunk);
+
+	/// Stop recording into the chunk and append it to the frame
+	void endChunk();
+
+	/// Check if a chunk is being recorded
+	bool isRecording() const;
+
+	/// Record a rectangle, transformed to canvas coordinates
+	/// With a font, the rectangle is textured with the white square of its page for characterSize
+	void addRect(const FloatRect& rect, const mat4& transform, const Color& color, const Font* font, unsigned int characterSize);
+
+	/// Record vertices laid out with font, like the runs of GlyphRunCache, transformed to canvas coordinates
+	void addText(const VertexArray2D& vertices, const mat4& transform, const Font& font, unsigned int characterSize);
+
+	/// Append what a widget recorded before, clipped by the current clip rectangle
+	void append(const Chunk& chunk);
+
+	/// Clip what is appended from now on to rect, in canvas coordinates, until popClipRect()
+	void pushClipRect(const FloatRect& rect);
+
+	/// Go back to the clip rectangle before the last pushClipRect()
+	void popClipRect();
+
+	/// Bring the device clipping to the current clip rectangle of the list
+	void applyClipRect(GraphicsDevice* device) const;
+
+	/// Draw and forget everything appended so far
+	void flush(GraphicsDevice* device);
+
+	/// Count a widget whose onPaint() ran and was recorded this frame
+	void countPainted();
+
+	/// Count a widget drawn from its recorded chunk this frame
+	void countReused();
+
+	/// Count a widget that draws with the device directly this frame
+	void countImmediate();
+
+private:
+	/// A command of the frame, linked to the next one of the same batch
+	struct PendingCommand
+	{
+		std::size_t first;  ///< Into m_recorded
+		std::size_t count;
+		int         next;
+	};
+
+	/// Commands drawn together with the same texture and clipping
+	struct Batch
+	{
+		const Font*  font;
+		unsigned int characterSize;
+		bool         clipped;
+		FloatRect    clip;
+		FloatRect    bounds;
+		int          firstCommand;
+		int          lastCommand;
+		std::size_t  vertexOffset;  ///< Into the shared array, once flushed
+		std::size_t  vertexCount;
+	};
+
+	/// Add a run of vertices of the frame to a batch, joining an earlier one when the order allows
+	void addCommand(const Command& command, std::size_t first);
+
+	/// Append the vertices of a new command to the chunk being recorded
+	Command& beginCommand(const Font* font, unsigned int characterSize, std::size_t vertexCount);
+
+	Chunk*                             m_chunk;       ///< Being recorded, null otherwise
+	std::vector<VertexArray2D::Vertex> m_recorded;    ///< Vertices appended this frame, in painting order
+	std::vector<PendingCommand>        m_commands;
+	std::vector<Batch>                 m_batches;
+	std::vector<FloatRect>             m_clipStack;
+	VertexArray2D                      m_vertices;    ///< The shared vertex array the batches are drawn from
+	Statistics                         m_statistics;      ///< Of the frame in progress
+	Statistics                         m_lastStatistics;  ///< Of the last finished frame
+};
+
+NEPHILIM_NS_END
+#endif // NephilimUI_UIDrawList_h__
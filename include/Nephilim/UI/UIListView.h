@@ -1,19 +1,42 @@
 #ifndef NephilimUIComponentListView_h__
 #define NephilimUIComponentListView_h__
 
-#include <Nephilim/UI/Widget.h>
+#include <Nephilim/UI/UIRowView.h>
 
 NEPHILIM_NS_BEGIN
 
+class DataModel;
+
 /**
 	\class UIListView
 	\brief Control that displays a list of items
+
+	Shows one column of a DataModel, one row per row of the model. Only the rows in view
+	have a widget and their text is read from the model when they come into view,
+	so the model can be as long as needed. Call refreshRows() after the model changes.
 */
-class NEPHILIM_API UIListView : public Widget
+class NEPHILIM_API UIListView : public UIRowView
 {
 public:
-	
+
+	/// Show a column of a model
+	void setModel(DataModel* model, int column = 0);
+
+	/// Get the model being shown, null if there is none
+	DataModel* getModel();
+
+	/// Get how many rows the model has
+	int getRowCount();
+
 	void onRender(GraphicsDevice* renderer, Widget* view);
+
+protected:
+	/// Read the text of a row from the model
+	void fillRow(Row& widget, int row);
+
+private:
+	DataModel* mModel = nullptr;
+	int        mColumn = 0;
 };
 
 NEPHILIM_NS_END
@@ -10,6 +10,7 @@ NEPHILIM_NS_BEGIN
 class GraphicsDevice;
 class Font;
 class String;
+class UIDrawList;
 
 namespace PainterFlags
 {
@@ -30,7 +31,8 @@ namespace PainterFlags
 	as if the class changes it will still have a typedef for UIPainter for all code to remain valid.
 
 	Note 2: 
-	A nice optimization is to batch orders and commit everything at once in the end, either RAII on the destructor or with a commit() function.
+	While drawList is recording, the orders go there instead of the graphics device, so the canvas
+	can keep them between frames and draw them in batches. See UIDrawList.
 
 	This is a state based painter utility, for quickly putting high quality graphics together for UI.
 	The class can also render with GPU with full acceleration.
@@ -52,6 +54,9 @@ public:
 	/// Currently active font, all text is rendered by default with it
 	Font* activeFont = nullptr;
 
+	/// When recording, shapes and text are recorded here instead of drawn
+	UIDrawList* drawList = nullptr;
+
 public:
 
 	/// Set a new fill color for subsequent shapes
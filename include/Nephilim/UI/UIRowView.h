@@ -0,0 +1,114 @@
+#ifndef NephilimUI_UIRowView_h__
+#define NephilimUI_UIRowView_h__
+
+#include <Nephilim/UI/Widget.h>
+
+#include <vector>
+
+NEPHILIM_NS_BEGIN
+
+/**
+	\ingroup UI
+	\class UIRowView
+	\brief Base for widgets showing a long list of equally tall rows
+
+	Only the rows in view have a widget. The widgets are kept in a pool and bound to other rows
+	as the view scrolls, and each is filled by fillRow() when it is bound to a row, so memory and
+	frame time depend on the height of the view rather than on how many rows there are.
+	A row keeps its widget while it stays in view, so scrolling by one row fills one widget.
+
+	The rows scroll with scrolling_offset like the children of any widget, so UIScrollBar works with the view,
+	and the mouse wheel scrolls it too.
+*/
+class NEPHILIM_API UIRowView : public Widget
+{
+public:
+	/// A pooled widget showing one row
+	class NEPHILIM_API Row : public Widget
+	{
+	public:
+		int    row = -1;              ///< Row it shows, -1 while unused
+		String text;
+		float  indent = 0.f;          ///< Left margin of the text, for nesting
+		String marker;                ///< Drawn in the margin, like the expand sign of a tree node
+		bool   selected = false;
+		Color  textColor = Color::White;
+
+		/// Paint the selection and the text
+		void onPaint(UIPainter& painter);
+	};
+
+	/// Emitted with the row that was clicked
+	sigc::signal<void, int> onRowClicked;
+
+public:
+	/// Construct an empty view
+	UIRowView();
+
+	/// Set the height of every row
+	void setRowHeight(float height);
+
+	/// Get the height of every row
+	float getRowHeight() const;
+
+	/// Get how many rows there are
+	virtual int getRowCount();
+
+	/// Scroll by pixels, down for positive values, without going past the rows
+	void scrollBy(float pixels);
+
+	/// Scroll as little as needed to have a row in view
+	void scrollToRow(int row);
+
+	/// Scroll to the last row
+	void scrollToBottom();
+
+	/// Check if the last row is in view
+	bool isScrolledToBottom();
+
+	/// Select a row, -1 for none
+	void setSelectedRow(int row);
+
+	/// Get the selected row, -1 if there is none
+	int getSelectedRow() const;
+
+	/// Fill the rows in view again at the next draw, after the rows or their content changed
+	void refreshRows();
+
+	/// Get how many row widgets were made, which stays about as many as fit in view
+	std::size_t getRowWidgetCount() const;
+
+	/// The bounding box of every row, not only of those in view, and of the other children, for the scroll bars
+	FloatRect childrenRect();
+
+protected:
+	/// Fill a row widget with the content of a row, called when it is bound to it
+	virtual void fillRow(Row& widget, int row);
+
+	/// Called when a row is clicked, after it is selected
+	virtual void rowClicked(int row);
+
+	/// Bind the row widgets to the rows in view before they are drawn
+	void preRender(GraphicsDevice* renderer);
+
+	/// Scroll with the mouse wheel
+	bool onEventNotification(Event& event);
+
+private:
+	/// Keep the scrolling within the rows and bind the row widgets to the rows in view
+	void layoutRows();
+
+	/// A row widget was clicked
+	void rowWidgetClicked(Row* widget);
+
+	/// Get the height of every row together, or down to the lowest child that isn't a row widget if that is more
+	float getContentHeight();
+
+	std::vector<Row*> mRowWidgets;    ///< The pool, row r goes to widget r % size while the pool doesn't grow
+	float             mRowHeight;
+	int               mSelectedRow;
+	bool              mRowsDirty;     ///< Every bound row is filled again
+};
+
+NEPHILIM_NS_END
+#endif // NephilimUI_UIRowView_h__
@@ -1,7 +1,7 @@
 #ifndef UITreeView_h__
 #define UITreeView_h__
 
-#include <Nephilim/UI/Widget.h>
+#include <Nephilim/UI/UIRowView.h>
 
 NEPHILIM_NS_BEGIN
 
@@ -12,8 +12,15 @@ class UITreeViewItem;
 /**
 	\class UITreeView
 	\brief Official widget for displaying tree views
+
+	A model is shown as rows, like a UIListView. Its tree is read once into a flat index, from the parent row
+	in column 3, like FileSystemModel has it, and the expanded nodes are kept as a flat list of the rows in
+	display order, which expanding and collapsing splice. Only the rows in view have a widget and their names,
+	from column 0, are read when they come into view, so the model can have any number of rows.
+
+	Trees made with createTree() have a widget per item, for small trees put together by hand.
 */
-class NEPHILIM_API UITreeView : public Widget
+class NEPHILIM_API UITreeView : public UIRowView
 {
 public:
 
@@ -41,9 +48,21 @@ public:
 	/// Construct the tree view
 	UITreeView();
 
-	/// Set a new data model to this tree view
+	/// Set a new data model to this tree view, with every node collapsed
 	void setModel(DataModel* dataModel);
 
+	/// Expand or collapse the node of a model row
+	void setExpanded(int modelRow, bool expanded);
+
+	/// Check if the node of a model row is expanded
+	bool isExpanded(int modelRow) const;
+
+	/// Get the model row shown in a row of the view, -1 if there is none
+	int getModelRow(int row) const;
+
+	/// Get how many rows are shown, counting the children of expanded nodes
+	int getRowCount();
+
 	void itemClicked(Widget* node);
 
 	/// Refresh the entire tree view structure, heavyweight, use with care
@@ -55,6 +74,31 @@ public:
 
 	/// This will ensure positioning of the children
 	void positionRows();
+
+protected:
+	/// Read the name of a row from the model
+	void fillRow(Row& widget, int row);
+
+	/// Expand or collapse the clicked node
+	void rowClicked(int row);
+
+private:
+	/// Get the first child of a model row, or the first top level row for -1
+	int getFirstChild(int modelRow) const;
+
+	/// Collect the descendants of a model row that are shown when it is expanded, in display order
+	void collectVisible(int modelRow, int depth, std::vector<int>& rows, std::vector<int>& depths) const;
+
+	/// Expand or collapse the node shown in a row of the view
+	void setRowExpanded(int row, bool expanded);
+
+	std::vector<int>  mNodeParents;   ///< Parent of each model row, -1 for top level rows
+	std::vector<int>  mFirstChildren; ///< First child of each model row, -1 for leaves
+	std::vector<int>  mNextSiblings;  ///< Next row with the same parent, -1 for the last one
+	std::vector<char> mExpanded;      ///< Of each model row, kept while its parent is collapsed
+	int               mFirstRoot;     ///< First top level row
+	std::vector<int>  mVisibleRows;   ///< Model rows in display order
+	std::vector<int>  mVisibleDepths; ///< Nesting of each of them
 };
 
 
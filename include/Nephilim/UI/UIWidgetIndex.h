@@ -0,0 +1,99 @@
+#ifndef NephilimUI_UIWidgetIndex_h__
+#define NephilimUI_UIWidgetIndex_h__
+
+#include <Nephilim/Platform.h>
+#include <Nephilim/Foundation/Rect.h>
+#include <Nephilim/Foundation/Vector.h>
+#include <Nephilim/Foundation/String.h>
+#include <Nephilim/Foundation/StringHash.h>
+
+#include <vector>
+#include <unordered_map>
+
+NEPHILIM_NS_BEGIN
+
+class Widget;
+
+/**
+	\ingroup UI
+	\class UIWidgetIndex
+	\brief Finds the widgets of a canvas by where they were drawn and by name
+
+	Every widget files the bounding box of its rectangle, as last drawn, into a uniform grid of cells,
+	so finding what is under the pointer only looks at the few widgets sharing its cell instead of
+	walking every surface. A widget only moves in the grid when its drawn rectangle changes.
+	Widgets covering too many cells, like backgrounds, are kept in a short list checked on every query instead.
+
+	Names are kept in a hash table so lookups don't walk the hierarchy either.
+
+	The index knows nothing about the hierarchy: a widget remains in it while detached or hidden,
+	so callers check that a result is still reachable and visible.
+*/
+class NEPHILIM_API UIWidgetIndex
+{
+public:
+	/// Creates an empty index with square cells of cellSize pixels
+	UIWidgetIndex(float cellSize = 64.f);
+
+	/// File a widget under the bounds it was drawn with, moving it if it was filed elsewhere
+	void update(Widget* widget, const FloatRect& bounds);
+
+	/// Forget a widget, by position and by name
+	void remove(Widget* widget);
+
+	/// Check if a widget is filed by position, widgets are removed as they are destroyed
+	bool contains(Widget* widget) const;
+
+	/// Collect the widgets whose bounds contain point, in no particular order
+	void query(vec2 point, std::vector<Widget*>& results) const;
+
+	/// File a widget under its name, once
+	void addName(Widget* widget);
+
+	/// Move a widget from the name it had to the one it has now
+	void rename(Widget* widget, const String& previousName);
+
+	/// Collect the widgets named name, in the order they were named
+	void findByName(const String& name, std::vector<Widget*>& results) const;
+
+	/// Collect the widgets whose name has the id name, like the #id of a selector
+	void findById(StringID name, std::vector<Widget*>& results) const;
+
+	/// Get how many widgets are filed by position
+	std::size_t getWidgetCount() const;
+
+	/// Forget every widget
+	void clear();
+
+private:
+	typedef Int64 CellKey;
+
+	/// Where a widget is filed
+	struct Entry
+	{
+		FloatRect bounds;
+		int       left, top, right, bottom;  ///< Cells covered, inclusive
+		bool      large;                     ///< In m_large rather than the cells
+	};
+
+	/// Get the key of the cell at a column and row
+	static CellKey makeKey(int x, int y);
+
+	/// Get the column or row of a coordinate
+	int toCell(float coordinate) const;
+
+	/// Take a widget out of the cells it covers
+	void unlink(Widget* widget, const Entry& entry);
+
+	/// Put a widget in the cells it covers
+	void link(Widget* widget, const Entry& entry);
+
+	float                                            m_cellSize;
+	std::unordered_map<Widget*, Entry>               m_entries;
+	std::unordered_map<CellKey, std::vector<Widget*> > m_cells;
+	std::vector<Widget*>                             m_large;
+	std::unordered_map<StringID, std::vector<Widget*> > m_names;
+};
+
+NEPHILIM_NS_END
+#endif // NephilimUI_UIWidgetIndex_h__
@@ -4,6 +4,7 @@
 #include <Nephilim/UI/UxNode.h>
 #include <Nephilim/UI/UxEvent.h>
 #include <Nephilim/UI/UIPainter.h>
+#include <Nephilim/UI/UIDrawList.h>
 #include <Nephilim/UI/UILayoutEngine.h>
 #include <Nephilim/UI/UICore.h>
 #include <Nephilim/UI/UIProperty.h>
@@ -125,6 +126,12 @@ public:
 	std::map<String, UIPropertyMap> m_styleInfo;
 	std::map<String, bool>          m_classInfo;
 
+	std::vector<StringID> mStyleClasses;           ///< Classes for the stylesheet selectors, sorted
+	std::vector<StringID> mPseudoClasses;          ///< Pseudo classes currently active, sorted
+	ComputedStyle         mComputedStyle;          ///< Rules of the stylesheet that apply, resolved by getComputedStyle()
+	Uint64                mStyleGeneration = 0;    ///< Of the stylesheet the computed style was resolved with
+	bool                  mStyleDirty = true;      ///< Classes, pseudo classes or the name changed since
+
 	int m_pointerPressCount; // to remove, double and triple clicks need to be guessed in the central input manager
 
 	///< Animations
@@ -133,6 +140,24 @@ public:
 	
 	std::map<String, String> mStringProperties;
 
+	/// How onPaint() was found to draw, decides if what it paints can be kept in the canvas draw list
+	enum PaintMode
+	{
+		PaintUnknown,   ///< Not drawn yet, the list is flushed around it while finding out
+		PaintRecorded,  ///< Only paints through the painter, what onPaint() recorded is reused
+		PaintImmediate  ///< Draws with the device directly, so it paints every frame with the list flushed before
+	};
+
+	UIDrawList::Chunk mPaintCache;                 ///< What onPaint() recorded the last time it ran
+	mat4              mPaintMatrix;                ///< Painter base matrix the cache was recorded with
+	Vector2D          mPaintSize;                  ///< Size the cache was recorded with
+	Font*             mPaintFont = nullptr;        ///< Painter font the cache was recorded with
+	bool              mPaintHovered = false;       ///< Hover state the cache was recorded with
+	bool              mPaintFocused = false;       ///< Focus state the cache was recorded with
+	bool              mPaintDirty = true;          ///< Set by invalidatePaint()
+	PaintMode         mPaintMode = PaintUnknown;
+	bool              mDrawsDirectly = false;      ///< Draws with the device from draw(), its controllers, preRender() or postRender()
+
 public:
 
 	struct UIControlOperation
@@ -163,6 +188,10 @@ public:
 	/// Called on the subclass to have it paint its contents
 	virtual void onPaint(UIPainter& painter);
 
+	/// Have onPaint() run again at the next draw, instead of drawing what it recorded before
+	/// Position, size, hover and focus are noticed already, subclasses call this when other state onPaint() reads changes
+	void invalidatePaint();
+
 	/// Called on subclasses to notify the widget was just resized
 	virtual void onResize();
 
@@ -221,14 +250,29 @@ public:
 	void startAnimation(const String& animationAsset);
 
 	/// Refresh the visual styles on this view
+	/// The computed style is only resolved again if something it depends on changed
 	void updateStyles();
 
+	/// Get the properties of the stylesheet rules that apply to this widget
+	/// Resolved again only after a class, pseudo class, the name or the stylesheet changed
+	const ComputedStyle& getComputedStyle();
+
+	/// Add or remove a class the stylesheet selectors can match
+	void setStyleClass(const String& name, bool enabled);
+
+	/// Check if the widget has a class
+	bool hasStyleClass(const String& name) const;
+
+	/// Get what the stylesheet selectors are matched against, valid while the widget doesn't change
+	StyleSheet::Subject getStyleSubject();
+
 	/// Set styles directly to the view
 	void setStyleSheet(const String& stylesheet);
 
 	/// Get the bounding box of the children
 	/// Coordinates in local space, relative to this view
-	FloatRect childrenRect();
+	/// Views that only make widgets for what is in view return the extent of all their content
+	virtual FloatRect childrenRect();
 
 	/// Set any flags for the view
 	void setFlag(Uint32 flags);
@@ -291,6 +335,7 @@ public:
 	Widget* getParent();
 
 	/// Find a control by its name in the control tree
+	/// Looked up in the name index of the canvas when the widget is in one
 	Widget* findByName(const String& name);
 
 	/// Creates a new UIView, names it and attaches it as a child, then returns it
@@ -420,6 +465,9 @@ public:
 	/// Get the global coordinates for this widget
 	FloatRect getGlobalRect();
 
+	/// Get the bounding box of the rectangle as it was last drawn, in canvas coordinates
+	FloatRect getDrawnBounds();
+
 	Vec2f getMiddlePosition();
 
 	/// Resizes the control over a defined time
@@ -10,6 +10,8 @@
 
 NEPHILIM_NS_BEGIN
 
+class TransformHierarchy;
+
 /**
 	\class ASceneComponent
 	\brief This is the base class for the Actor components
@@ -17,23 +19,65 @@ NEPHILIM_NS_BEGIN
 	The main difference between Component and ActorComponent
 	is that ActorComponent has virtual tables due to some
 	polymorphic API.
+
+	Scene components form a hierarchy, each one is placed relative to its parent.
+	Moving a component flags it and everything attached below it as dirty, and the
+	world matrices are only recomputed when asked for. After changing t directly,
+	call markTransformDirty() so the change is picked up.
 */
 class ASceneComponent : public Component
 {
 public:
-	mat4 absoluteTransform;
-
 	Transform t;
 
 	std::vector<ASceneComponent*> attachedComponents;
 
 public:
 
+	/// Detaches the component from its parent, children and hierarchy
+	virtual ~ASceneComponent();
+
 	/// Set this component position, relative to its parent's origin
 	void setPosition(float x, float y, float z);
 
+	/// Set the whole local transform, relative to its parent
+	void setTransform(const Transform& transform);
+
+	/// Attach this component under another one, detaching it from its current parent first
+	void attachTo(ASceneComponent* parent);
+
+	/// Detach this component from its parent, making it a root
+	void detach();
+
+	/// Get the component this one is attached to, if any
+	ASceneComponent* getParent() const;
+
+	/// Flag this component and its subtree as moved
+	void markTransformDirty();
+
+	/// Check if the world matrix needs to be recomputed
+	bool isTransformDirty() const;
+
+	/// Get the transform from this component's space to world space
+	/// Recomputes whatever moved since the last time, if needed
+	/// While the hierarchy is being updated, like when asked from within its update(),
+	/// it is computed on the spot from the parents instead of read from the hierarchy
+	mat4 getWorldMatrix();
+
 	/// Update the subtree of transforms
 	void updateTransforms();
+
+private:
+	friend class TransformHierarchy;
+
+	/// Flag the children subtrees, stopping at the ones already flagged
+	void markChildrenDirty();
+
+	ASceneComponent*    mParent = nullptr;
+	TransformHierarchy* mHierarchy = nullptr; ///< Where the world matrix is stored, if any
+	Uint32              mHierarchyIndex = 0;   ///< Index into the hierarchy arrays, valid while the layout is
+	Uint32              mMemberIndex = 0;      ///< Index into the members of the hierarchy, for O(1) removal
+	bool                mTransformDirty = true;
 };
 
 NEPHILIM_NS_END
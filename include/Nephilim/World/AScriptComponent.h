@@ -43,7 +43,8 @@ public:
 	/// This object represents the individual instance of the behavior for this component
 	void* object = nullptr;
 
-	/// Tick the script
+	/// Tick the script of this component alone
+	/// The world's ScriptSystem ticks all of them in batches, one per script
 	void tickScript();
 };
 
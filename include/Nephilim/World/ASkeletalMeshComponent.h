@@ -23,6 +23,8 @@
 #include <Nephilim/Graphics/GL/GLShader.h>
 
 #include <Nephilim/Animation/AnimationClip.h>
+#include <Nephilim/Animation/CompressedAnimationClip.h>
+#include <Nephilim/Animation/AnimationPose.h>
 
 NEPHILIM_NS_BEGIN
 
@@ -42,8 +44,26 @@ public:
 	AnimationClip clip;
 	Skeleton modelSkeleton;
 	mat4 boneTransforms[128];
-	float mAnimationTime;
-	float mAnimationDuration;
+	float mAnimationTime;     ///< Playback position in seconds
+	float mAnimationDuration; ///< Length of one loop in seconds
+
+	/// Compact copy of clip that playback samples from, built in bindClip()
+	CompressedAnimationClip mCompressedClip;
+
+	/// Keeps the current key of every channel between updates
+	CompressedAnimationClip::SamplingCache mSamplingCache;
+
+	/// Sampled local transforms, one per track
+	AnimationPose mPose;
+
+	/// For each track of the clip, the bone it animates or -1, resolved once in bindClip()
+	std::vector<Int32> mTrackToBone;
+
+	/// Local space pose of every bone, bones without a track stay at identity
+	std::vector<mat4> mLocalPose;
+
+	/// Global pose of every bone, computed from mLocalPose
+	std::vector<mat4> mWorldPose;
 
 	GLShader rigShader;
 
@@ -58,6 +78,10 @@ public:
 	/// Load an animation to be played in our skeleton
 	void loadAnimation(const String& filename, const String& skeletonName);
 
+	/// Resolve which bone each track of the clip animates and prepare the pose buffers
+	/// Must be called whenever clip or modelSkeleton change
+	void bindClip();
+
 	Texture2D myT;
 
 public:
@@ -47,6 +47,10 @@ public:
 	vec2 tex_rect_size;
 
 	vec2 scale;
+
+	/// Sprites of a lower layer are drawn first whatever their texture,
+	/// within a layer the depth only orders sprites that share a texture
+	int layer;
 };
 
 NEPHILIM_NS_END
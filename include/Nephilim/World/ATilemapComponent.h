@@ -9,17 +9,46 @@
 #include <Nephilim/World/Tilemap.h>
 #include <Nephilim/Graphics/VertexArray.h>
 #include <Nephilim/Graphics/IndexArray.h>
+#include <Nephilim/Graphics/VertexBuffer.h>
+#include <Nephilim/Graphics/IndexBuffer.h>
 
 #include <vector>
 
 NEPHILIM_NS_BEGIN
 
 class Tilemap;
+class Frustum;
+class GraphicsDevice;
+class JobSystem;
 
+/**
+	\class Tilemap2DLayer
+	\brief Render data of one layer inside one chunk
+
+	The geometry is built on the CPU, one vertex and index array per tileset,
+	then uploaded once to static buffers by generateRenderData() and dropped from memory.
+	Layers own their buffers, so they can be moved but not copied.
+*/
 class NEPHILIM_API Tilemap2DLayer
 {
 public:
-	void generateRenderData();
+	/// Creates an empty layer
+	Tilemap2DLayer();
+
+	/// Takes over the data and buffers of other, leaving it empty
+	Tilemap2DLayer(Tilemap2DLayer&& other);
+
+	/// Releases the buffers and takes over the data and buffers of other, leaving it empty
+	Tilemap2DLayer& operator=(Tilemap2DLayer&& other);
+
+	/// Releases the buffers
+	~Tilemap2DLayer();
+
+	/// Upload the geometry built since the last call to static buffers made by device, then free the CPU copy
+	void generateRenderData(GraphicsDevice* device);
+
+	/// Destroy the buffers
+	void releaseRenderData();
 
 	String           mName;       ///< Name of the layer
 	int              mWidth;      ///< Amount of tiles per line
@@ -31,15 +60,37 @@ public:
 	std::vector<VertexArray> mVertexSets;
 	std::vector<IndexArray>  mIndexSets;
 	std::vector<String>      mTextureSets;
+
+	/// GPU side of each tileset, filled by generateRenderData()
+	std::vector<VertexBuffer> mVertexBuffers;
+	std::vector<IndexBuffer*> mIndexBuffers;
+	std::vector<int>          mIndexCounts;
+
+	/// The CPU sets changed and need to be uploaded
+	bool mDirty;
+
+private:
+	/// Not copyable, the buffers have a single owner
+	Tilemap2DLayer(const Tilemap2DLayer&);
+	Tilemap2DLayer& operator=(const Tilemap2DLayer&);
 };
 
 /**
 	\class ATilemapComponent
 	\brief Place a tilemap into the world
+
+	The map is split in chunks of mChunkSize tiles, at most MaxChunkTiles each so 16 bit
+	indices can address every vertex of a chunk. Preparing a layer builds the geometry of
+	every chunk, in parallel over the job system if one is set, and each chunk is uploaded
+	to static buffers the first time it is drawn. Only the chunks inside the camera frustum
+	are drawn, and editing a tile only rebuilds the chunk that contains it.
 */
 class NEPHILIM_API ATilemapComponent : public ASceneComponent
 {
 public:
+	/// Most tiles in one chunk, each tile takes four vertices and 16 bit indices address 65536
+	static const int MaxChunkTiles = 16384;
+
 	/// Initializes an empty world
 	ATilemapComponent();
 
@@ -74,6 +125,7 @@ public:
 	bool load(const String& filename);
 
 	/// Generates a chunk list for culling out for the entire map
+	/// mChunkSize is clamped so a chunk has at most MaxChunkTiles tiles
 	void allocateChunks();
 
 	/// Converts the in memory tile data from a single layer to renderizable chunk data
@@ -88,9 +140,30 @@ public:
 
 	void getTileShape(int index, float& x, float &y, float& w, float& h);
 
+	/// Build the geometry of one chunk for one layer, safe to call for different chunks in parallel
+	void buildChunkLayer(std::size_t chunkIndex, Tilemap::Layer* tileLayer, const String& destLayer);
+
+	/// Change a tile of a prepared layer, only the chunk containing it is rebuilt
+	void setTile(const String& layerName, int x, int y, Uint16 gid);
+
+	/// Build the chunks over a job system when preparing a layer, nullptr builds them on the calling thread
+	void setJobSystem(JobSystem* jobs);
+
+	/// Get the bounds of a chunk, in the component's local space
+	void getChunkBounds(std::size_t chunkIndex, vec3& minimum, vec3& maximum);
+
+	/// Fill visible with the indices of the chunks inside the frustum
+	/// The frustum must be in the component's local space
+	void getVisibleChunks(const Frustum& frustum, std::vector<std::size_t>& visible);
+
 	/// Change the tile size
 	void setTileSize(vec3 size);
 
+	/// Log how long a tiles x tiles TMX map takes to load through Tilemap, to build into chunks on the
+	/// calling thread and over jobs if given, to edit one tile and to cull the chunks of a 1080p view
+	/// The map is written to scratchFile, which must end in .tmx, and removed afterwards
+	static void benchmark(const String& scratchFile, int tiles = 4096, JobSystem* jobs = nullptr);
+
 	std::vector<Layer> mLayers; ///< The layer information for this tilemap level
 	std::vector<Chunk> mChunks;
 
@@ -101,6 +174,7 @@ public:
 	vec2 mLevelSizeInTiles; ///< Size of this level, in number of tiles
 	vec2 mChunkSize; ///< The total size of each chunk, in tiles
 	vec2i mNumChunks; ///< Number of horizontal and vertical chunks allocated
+	JobSystem* mJobSystem; ///< Splits the chunk builds when set
 
 	class Chunk
 	{
@@ -117,12 +191,14 @@ public:
 		Layer(const String& name)
 		: mName(name)
 		, mCubeBased(false)
+		, mPrepared(false)
 		{
 
 		}
 
 		String mName;
 		bool mCubeBased;
+		bool mPrepared; ///< The chunks have render data for this layer
 	};
 };
 
@@ -91,6 +91,11 @@ public:
 	/// Returns nullptr if there isn't any
 	template<typename T>
 	T* searchComponent();
+
+private:
+
+	/// Index a freshly created component in the level, so it can be found by type queries
+	void registerComponent(Component* component);
 };
 
 /// Create a new instance of component type T
@@ -99,6 +104,7 @@ T* Actor::createComponent()
 {
 	T* component = new T();
 	components.push_back(component);
+	registerComponent(component);
 
 	/*if (root == nullptr)
 	{
@@ -17,13 +17,48 @@ class ComponentManager;
 
 	This handle can be used to quickly query a component manager if the handle remains valid
 	as well as getting a real object reference to manipulate from it.
+
+	The handle packs a slot index in the lower IndexBits bits and a generation counter in the
+	remaining upper bits. When a slot is recycled its generation is bumped, so handles to the
+	previous occupant no longer match and are detected as stale. A value of zero is always invalid.
 */
 class NEPHILIM_API CHandle
 {
 public:
-	Uint32 handle;
+	enum
+	{
+		IndexBits = 20,
+		IndexMask = (1 << IndexBits) - 1,
+		GenerationMask = (1 << (32 - IndexBits)) - 1
+	};
 
-	operator bool()
+	Uint32 handle = 0;
+
+public:
+
+	CHandle()
+	{
+	}
+
+	/// Build a handle from a slot index and its generation (generation must not be zero)
+	CHandle(Uint32 index, Uint32 generation)
+	{
+		handle = ((generation & GenerationMask) << IndexBits) | (index & IndexMask);
+	}
+
+	/// Get the slot index this handle refers to
+	Uint32 getIndex() const
+	{
+		return handle & IndexMask;
+	}
+
+	/// Get the generation of the slot at the time the handle was issued
+	Uint32 getGeneration() const
+	{
+		return (handle >> IndexBits) & GenerationMask;
+	}
+
+	operator bool() const
 	{
 		return handle > 0;
 	}
@@ -54,7 +89,10 @@ public:
 template<typename T>
 T* component_ptr<T>::operator->()
 {
-	return nullptr;
+	if (!manager || !handle)
+		return nullptr;
+
+	return static_cast<T*>(manager->getComponent(handle));
 }
 
 NEPHILIM_NS_END
@@ -21,6 +21,11 @@ public:
 
 	/// Destructor
 	virtual ~Component();
+
+private:
+	friend class Level;
+
+	std::size_t mLevelListIndex = 0;  ///< Where the component is in the type list of its level
 };
 
 NEPHILIM_NS_END
@@ -3,25 +3,52 @@
 
 #include <Nephilim/Platform.h>
 #include <Nephilim/World/ComponentManager.h>
+#include <Nephilim/World/ComponentSparseSet.h>
+#include <Nephilim/World/CHandle.h>
 
 #include <vector>
 #include <map>
 
 NEPHILIM_NS_BEGIN
 
+/// How a ComponentArray binds its components to entities
+namespace ComponentStorage
+{
+	enum Type
+	{
+		SparseSet,  ///< Sparse array indexed by entity id, O(1) lookup and swap-with-last removal
+		Map         ///< std::map binding, removal keeps the order of the array and shifts it
+	};
+}
+
 /**
 	\class ComponentArray
 	\brief Array of components, acting as a cache efficient pool of components of one type
 
-	This particular implementation of component manager stores the components
+	The components are stored contiguously, either way the storage is picked at construction.
+	With ComponentStorage::SparseSet everything goes through a ComponentSparseSet.
+	With ComponentStorage::Map the components are bound to entities with a std::map and removal
+	shifts the array, which keeps the creation order at the cost of O(n) despawns.
+
+	Both storages hand out generational handles through getHandleFromEntity(),
+	and getComponent() returns nullptr for handles whose component was removed.
 */
 template<typename T>
 class ComponentArray : public ComponentManager
 {
 public:
-	/// Get a component by its handle value
+	/// Create an empty pool with the given storage
+	explicit ComponentArray(ComponentStorage::Type storage = ComponentStorage::SparseSet);
+
+	/// Get the storage picked at construction
+	ComponentStorage::Type getStorage() const;
+
+	/// Get a component by its handle value, nullptr if the handle is stale
 	virtual Component* getComponent(const CHandle& handle);
 
+	/// Get a handle to the component of the entity, or a null handle if it has none
+	CHandle getHandleFromEntity(Entity e);
+
 	/// Get the number of components being used (not the amount allocated by the pool)
 	virtual std::size_t size();
 
@@ -30,6 +57,7 @@ public:
 	virtual Component* getComponentFromEntity(Entity e);
 
 	/// Creates a new component mapped to an entity
+	/// If the entity already has one, that one is returned instead
 	virtual Component* createComponentForEntity(Entity e);
 
 	/// Get the entity to which the instance belongs to
@@ -37,53 +65,130 @@ public:
 
 	virtual void removeComponentsFromEntity(Entity e);
 
-	/// Array of components of a single type (Contiguous in memory)
-	std::vector<T> mComponents;
-	std::vector<Entity> mComponentOwners; ///< Every component has a owner entity
+private:
+	/// A stable slot for the handles of the map storage to refer to
+	struct Slot
+	{
+		Uint32 index;      ///< Where the component lives in mComponents
+		Uint32 generation; ///< Bumped every time the slot is released
+	};
+
+	static const Uint32 InvalidIndex = 0xFFFFFFFF;
 
-	/// Maps entity id to its component
-	std::map<Entity, std::size_t> mBinding;
+	ComponentStorage::Type mStorage;
+	ComponentSparseSet<T>  mSparseSet;  ///< Used by ComponentStorage::SparseSet
+
+	// Used by ComponentStorage::Map
+	std::vector<T>                mComponents;      ///< Array of components of a single type (Contiguous in memory)
+	std::vector<Entity>           mComponentOwners; ///< Every component has a owner entity
+	std::vector<Uint32>           mComponentSlots;  ///< Slot of every component, parallel to mComponents
+	std::map<Entity, std::size_t> mBinding;         ///< Maps entity id to its component
+	std::vector<Slot>             mSlots;
+	std::vector<Uint32>           mFreeSlots;
 };
 
+/// Log how long creation, lookup, iteration and removal take with each storage
+NEPHILIM_API void benchmarkComponentStorage(std::size_t components = 10000, std::size_t rounds = 10);
+
+template<typename T>
+const Uint32 ComponentArray<T>::InvalidIndex;
+
+template<typename T>
+ComponentArray<T>::ComponentArray(ComponentStorage::Type storage)
+: mStorage(storage)
+{
+}
+
+template<typename T>
+ComponentStorage::Type ComponentArray<T>::getStorage() const
+{
+	return mStorage;
+}
+
 template<typename T>
 void ComponentArray<T>::removeComponentsFromEntity(Entity e)
 {
-	auto it = mComponents.begin();
-	auto it2 = mComponentOwners.begin();
+	if (mStorage == ComponentStorage::SparseSet)
+	{
+		mSparseSet.removeComponentsFromEntity(e);
+		return;
+	}
 
-	while (it != mComponents.end())
+	std::map<Entity, std::size_t>::iterator binding = mBinding.find(e);
+	if (binding == mBinding.end())
+		return;
+
+	std::size_t index = binding->second;
+
+	// Release the slot, bumping its generation so outstanding handles go stale
+	Slot& slot = mSlots[mComponentSlots[index]];
+	slot.index = InvalidIndex;
+	slot.generation = (slot.generation + 1) & CHandle::GenerationMask;
+	if (slot.generation == 0)
+		slot.generation = 1;
+	mFreeSlots.push_back(mComponentSlots[index]);
+
+	mComponents.erase(mComponents.begin() + index);
+	mComponentOwners.erase(mComponentOwners.begin() + index);
+	mComponentSlots.erase(mComponentSlots.begin() + index);
+	mBinding.erase(binding);
+
+	// Everything after the removed component shifted down by one
+	for (std::map<Entity, std::size_t>::iterator it = mBinding.begin(); it != mBinding.end(); ++it)
 	{
-		if (*it2 == e)
-		{
-			it = mComponents.erase(it);
-			it2 = mComponentOwners.erase(it2);
-		}
-		else
-		{
-			++it;
-			++it2;
-		}
+		if (it->second > index)
+			--it->second;
 	}
 
-	mBinding.erase(e);
+	for (std::size_t i = index; i < mComponentSlots.size(); ++i)
+		mSlots[mComponentSlots[i]].index = static_cast<Uint32>(i);
 }
 
-
 template<typename T>
 Component* ComponentArray<T>::getComponent(const CHandle& handle)
 {
-	return nullptr;
+	if (mStorage == ComponentStorage::SparseSet)
+		return mSparseSet.getComponent(handle);
+
+	if (!handle || handle.getIndex() >= mSlots.size())
+		return nullptr;
+
+	const Slot& slot = mSlots[handle.getIndex()];
+	if (slot.index == InvalidIndex || slot.generation != handle.getGeneration())
+		return nullptr;
+
+	return &mComponents[slot.index];
+}
+
+template<typename T>
+CHandle ComponentArray<T>::getHandleFromEntity(Entity e)
+{
+	if (mStorage == ComponentStorage::SparseSet)
+		return mSparseSet.getHandleFromEntity(e);
+
+	std::map<Entity, std::size_t>::iterator it = mBinding.find(e);
+	if (it == mBinding.end())
+		return CHandle();
+
+	Uint32 slot = mComponentSlots[it->second];
+	return CHandle(slot, mSlots[slot].generation);
 }
 
 template<typename T>
 std::size_t ComponentArray<T>::size()
 {
+	if (mStorage == ComponentStorage::SparseSet)
+		return mSparseSet.size();
+
 	return mComponents.size();
 }
 
 template<typename T>
 Component* ComponentArray<T>::getInstance(std::size_t index)
 {
+	if (mStorage == ComponentStorage::SparseSet)
+		return mSparseSet.getInstance(index);
+
 	return &mComponents[index];
 }
 
@@ -91,23 +196,21 @@ Component* ComponentArray<T>::getInstance(std::size_t index)
 template<typename T>
 Entity ComponentArray<T>::getInstanceEntity(std::size_t index)
 {
-	for (std::map<Entity, std::size_t>::iterator it = mBinding.begin(); it != mBinding.end(); ++it)
-	{
-		if (it->second == index)
-		{
-			return it->first;
-		}
-	}
+	if (mStorage == ComponentStorage::SparseSet)
+		return mSparseSet.getInstanceEntity(index);
 
-	Entity nullEntity;
-	nullEntity.id = 0;
-	return nullEntity;
-}
+	if (index < mComponentOwners.size())
+		return mComponentOwners[index];
 
+	return Entity::Null;
+}
 
 template<typename T>
 Component* ComponentArray<T>::getComponentFromEntity(Entity e)
 {
+	if (mStorage == ComponentStorage::SparseSet)
+		return mSparseSet.getComponentFromEntity(e);
+
 	std::map<Entity, std::size_t>::iterator it = mBinding.find(e);
 	if (it != mBinding.end())
 	{
@@ -122,9 +225,31 @@ Component* ComponentArray<T>::getComponentFromEntity(Entity e)
 template<typename T>
 Component* ComponentArray<T>::createComponentForEntity(Entity e)
 {
-	T component;
-	mComponents.push_back(component);
+	if (mStorage == ComponentStorage::SparseSet)
+		return mSparseSet.createComponentForEntity(e);
+
+	std::map<Entity, std::size_t>::iterator it = mBinding.find(e);
+	if (it != mBinding.end())
+		return &mComponents[it->second];
+
+	Uint32 slot;
+	if (!mFreeSlots.empty())
+	{
+		slot = mFreeSlots.back();
+		mFreeSlots.pop_back();
+	}
+	else
+	{
+		slot = static_cast<Uint32>(mSlots.size());
+		Slot s;
+		s.generation = 1;
+		mSlots.push_back(s);
+	}
+	mSlots[slot].index = static_cast<Uint32>(mComponents.size());
+
+	mComponents.push_back(T());
 	mComponentOwners.push_back(e);
+	mComponentSlots.push_back(slot);
 	mBinding[e] = mComponents.size() - 1;
 	return &mComponents[mComponents.size() - 1];
 }
@@ -0,0 +1,249 @@
+#ifndef NephilimRazerComponentSparseSet_h__
+#define NephilimRazerComponentSparseSet_h__
+
+#include <Nephilim/Platform.h>
+#include <Nephilim/World/ComponentManager.h>
+#include <Nephilim/World/CHandle.h>
+
+#include <vector>
+#include <utility>
+
+NEPHILIM_NS_BEGIN
+
+/**
+	\class ComponentSparseSet
+	\brief Sparse set storage for components of one type
+
+	O(1) creation, lookup and removal. This is what ComponentArray uses with ComponentStorage::SparseSet,
+	and it can be used on its own as a component manager too.
+
+	The components are kept tightly packed in mComponents, so systems can iterate them
+	linearly. A sparse array indexed by entity id points into the packed array,
+	and removing a component moves the last one into the hole instead of shifting the array.
+
+	Because removal reorders the packed array, component handles don't point to it directly.
+	Each component gets a slot, which stays put for its whole life, and the slot is what the handle refers to.
+	Recycled slots get a new generation so old handles to them fail getComponent() instead of aliasing.
+
+	Entity ids are expected to be small and sequential, like the ones EntityManager gives out,
+	as the sparse array grows up to the largest id ever bound.
+*/
+template<typename T>
+class ComponentSparseSet : public ComponentManager
+{
+public:
+	/// Get a component by its handle value, nullptr if the handle is stale
+	virtual Component* getComponent(const CHandle& handle);
+
+	/// Get the number of components being used (not the amount allocated by the pool)
+	virtual std::size_t size();
+
+	virtual Component* getInstance(std::size_t index);
+
+	virtual Component* getComponentFromEntity(Entity e);
+
+	/// Creates a new component mapped to an entity
+	/// If the entity already has one, that one is returned instead
+	virtual Component* createComponentForEntity(Entity e);
+
+	/// Get the entity to which the instance belongs to
+	virtual Entity getInstanceEntity(std::size_t index);
+
+	virtual void removeComponentsFromEntity(Entity e);
+
+	/// Get a handle to the component of the entity, or a null handle if it has none
+	CHandle getHandleFromEntity(Entity e);
+
+	/// Check if the entity has a component in this set
+	bool contains(Entity e);
+
+	/// Reserve room for n components ahead of time
+	void reserve(std::size_t n);
+
+	/// Array of components of a single type (Contiguous in memory)
+	std::vector<T> mComponents;
+	std::vector<Entity> mComponentOwners; ///< Every component has a owner entity
+
+private:
+
+	/// A stable slot for handles to refer to
+	struct Slot
+	{
+		Uint32 dense;      ///< Where the component lives in mComponents
+		Uint32 generation; ///< Bumped every time the slot is released
+	};
+
+	/// Value of the sparse array for entities without a component
+	static const Uint32 InvalidIndex = 0xFFFFFFFF;
+
+	/// Maps entity id to its index in mComponents
+	std::vector<Uint32> mSparse;
+
+	/// Slot owned by each component, parallel to mComponents
+	std::vector<Uint32> mDenseSlots;
+
+	/// All slots ever allocated
+	std::vector<Slot> mSlots;
+
+	/// Released slots ready for reuse
+	std::vector<Uint32> mFreeSlots;
+
+	/// Index of the entity in the packed array or InvalidIndex
+	Uint32 denseIndexOf(Entity e) const;
+};
+
+template<typename T>
+const Uint32 ComponentSparseSet<T>::InvalidIndex;
+
+template<typename T>
+Uint32 ComponentSparseSet<T>::denseIndexOf(Entity e) const
+{
+	if (e.id < mSparse.size())
+		return mSparse[e.id];
+	return InvalidIndex;
+}
+
+template<typename T>
+Component* ComponentSparseSet<T>::getComponent(const CHandle& handle)
+{
+	if (!handle)
+		return nullptr;
+
+	Uint32 index = handle.getIndex();
+	if (index >= mSlots.size())
+		return nullptr;
+
+	const Slot& slot = mSlots[index];
+	if (slot.dense == InvalidIndex || slot.generation != handle.getGeneration())
+		return nullptr;
+
+	return &mComponents[slot.dense];
+}
+
+template<typename T>
+std::size_t ComponentSparseSet<T>::size()
+{
+	return mComponents.size();
+}
+
+template<typename T>
+Component* ComponentSparseSet<T>::getInstance(std::size_t index)
+{
+	return &mComponents[index];
+}
+
+template<typename T>
+Entity ComponentSparseSet<T>::getInstanceEntity(std::size_t index)
+{
+	if (index < mComponentOwners.size())
+		return mComponentOwners[index];
+
+	return Entity::Null;
+}
+
+template<typename T>
+Component* ComponentSparseSet<T>::getComponentFromEntity(Entity e)
+{
+	Uint32 dense = denseIndexOf(e);
+	if (dense == InvalidIndex)
+		return nullptr;
+
+	return &mComponents[dense];
+}
+
+template<typename T>
+CHandle ComponentSparseSet<T>::getHandleFromEntity(Entity e)
+{
+	Uint32 dense = denseIndexOf(e);
+	if (dense == InvalidIndex)
+		return CHandle();
+
+	Uint32 slot = mDenseSlots[dense];
+	return CHandle(slot, mSlots[slot].generation);
+}
+
+template<typename T>
+bool ComponentSparseSet<T>::contains(Entity e)
+{
+	return denseIndexOf(e) != InvalidIndex;
+}
+
+template<typename T>
+void ComponentSparseSet<T>::reserve(std::size_t n)
+{
+	mComponents.reserve(n);
+	mComponentOwners.reserve(n);
+	mDenseSlots.reserve(n);
+	mSlots.reserve(n);
+}
+
+template<typename T>
+Component* ComponentSparseSet<T>::createComponentForEntity(Entity e)
+{
+	Uint32 existing = denseIndexOf(e);
+	if (existing != InvalidIndex)
+		return &mComponents[existing];
+
+	if (e.id >= mSparse.size())
+		mSparse.resize(e.id + 1, InvalidIndex);
+
+	Uint32 dense = static_cast<Uint32>(mComponents.size());
+
+	Uint32 slot;
+	if (!mFreeSlots.empty())
+	{
+		slot = mFreeSlots.back();
+		mFreeSlots.pop_back();
+	}
+	else
+	{
+		slot = static_cast<Uint32>(mSlots.size());
+		Slot s;
+		s.generation = 1;
+		mSlots.push_back(s);
+	}
+	mSlots[slot].dense = dense;
+
+	mComponents.push_back(T());
+	mComponentOwners.push_back(e);
+	mDenseSlots.push_back(slot);
+	mSparse[e.id] = dense;
+
+	return &mComponents[dense];
+}
+
+template<typename T>
+void ComponentSparseSet<T>::removeComponentsFromEntity(Entity e)
+{
+	Uint32 dense = denseIndexOf(e);
+	if (dense == InvalidIndex)
+		return;
+
+	// Release the slot, bumping its generation so outstanding handles go stale
+	Slot& slot = mSlots[mDenseSlots[dense]];
+	slot.dense = InvalidIndex;
+	slot.generation = (slot.generation + 1) & CHandle::GenerationMask;
+	if (slot.generation == 0)
+		slot.generation = 1;
+	mFreeSlots.push_back(mDenseSlots[dense]);
+
+	// Move the last component into the hole
+	Uint32 last = static_cast<Uint32>(mComponents.size() - 1);
+	if (dense != last)
+	{
+		mComponents[dense] = std::move(mComponents[last]);
+		mComponentOwners[dense] = mComponentOwners[last];
+		mDenseSlots[dense] = mDenseSlots[last];
+
+		mSparse[mComponentOwners[dense].id] = dense;
+		mSlots[mDenseSlots[dense]].dense = dense;
+	}
+
+	mComponents.pop_back();
+	mComponentOwners.pop_back();
+	mDenseSlots.pop_back();
+	mSparse[e.id] = InvalidIndex;
+}
+
+NEPHILIM_NS_END
+#endif // NephilimRazerComponentSparseSet_h__
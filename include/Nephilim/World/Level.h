@@ -8,11 +8,15 @@
 #include <Nephilim/World/EntityManager.h>
 #include <Nephilim/World/Actor.h>
 #include <Nephilim/World/ComponentManager.h>
+#include <Nephilim/World/TransformHierarchy.h>
 #include <Nephilim/World/ASpriteComponent.h>
 #include <Nephilim/World/Systems/PhysicsSystem.h>
 
 #include <vector>
+#include <map>
 #include <typeindex>
+#include <typeinfo>
+#include <type_traits>
 
 NEPHILIM_NS_BEGIN
 
@@ -77,6 +81,21 @@ public:
 	/// All the component data this level contains is stored here
 	std::vector<ComponentStoragePool> componentStoragePools;
 
+	/// Every component of one concrete type spawned in this level, along with its owner
+	/// Both arrays are parallel, owners[i] is the object that has components[i]
+	struct ComponentList
+	{
+		std::vector<Component*>  components;
+		std::vector<GameObject*> owners;
+	};
+
+	/// Components indexed by their concrete type, so systems can iterate exactly what they need
+	/// Queries for a base type go through the lists of every type deriving from it
+	std::map<std::type_index, ComponentList> componentLists;
+
+	/// World matrices of every scene component registered in this level
+	TransformHierarchy transforms;
+
 
 	EntityManager entityManager;
 
@@ -102,7 +121,131 @@ public:
 
 	/// Instance a new game object from a prefab
 	GameObject* instance(const Prefab& prefab);
+
+	/// Index a component under its concrete type
+	void registerComponent(Component* component, GameObject* owner);
+
+	/// Index all the components the object has at the moment
+	void registerComponents(GameObject* owner);
+
+	/// Remove a component from the type index
+	void unregisterComponent(Component* component);
+
+	/// Remove all the components of the object from the type index
+	void unregisterComponents(GameObject* owner);
+
+	/// Get the list of components with exactly the type T or nullptr if there is none
+	template<typename T>
+	ComponentList* getComponentList();
+
+	/// Collect the lists of T and of every type deriving from it that has components
+	template<typename T>
+	void getComponentLists(std::vector<ComponentList*>& lists);
+
+	/// Call fn(T&) for every component of type T or deriving from it in this level
+	template<typename T, typename Fn>
+	void each(Fn fn);
+
+	/// Call fn(T1&, T2&) for every object that has both a T1 and a T2, subclasses included
+	/// T2 is either a base of T1, in which case the same component is passed twice,
+	/// or the type of another component in the same object
+	template<typename T1, typename T2, typename Fn>
+	void each(Fn fn);
+
+private:
+
+	/// T2 is a base of T1, the component itself is the match
+	template<typename T2, typename T1>
+	static T2* findSibling(T1* component, GameObject* owner, std::true_type);
+
+	/// Look for a component with type T2 in the owner
+	template<typename T2, typename T1>
+	static T2* findSibling(T1* component, GameObject* owner, std::false_type);
 };
 
+/// Get the list of components with exactly the type T or nullptr if there is none
+template<typename T>
+Level::ComponentList* Level::getComponentList()
+{
+	std::map<std::type_index, ComponentList>::iterator it = componentLists.find(std::type_index(typeid(T)));
+	if (it != componentLists.end())
+		return &it->second;
+
+	return nullptr;
+}
+
+/// Collect the lists of T and of every type deriving from it that has components
+template<typename T>
+void Level::getComponentLists(std::vector<ComponentList*>& lists)
+{
+	// Every component of a list has the same concrete type, so checking the first one tells for the whole list
+	for (std::map<std::type_index, ComponentList>::iterator it = componentLists.begin(); it != componentLists.end(); ++it)
+	{
+		if (!it->second.components.empty() && dynamic_cast<T*>(it->second.components[0]))
+			lists.push_back(&it->second);
+	}
+}
+
+/// Call fn(T&) for every component of type T or deriving from it in this level
+template<typename T, typename Fn>
+void Level::each(Fn fn)
+{
+	std::vector<ComponentList*> lists;
+	getComponentLists<T>(lists);
+
+	for (std::size_t j = 0; j < lists.size(); ++j)
+	{
+		for (std::size_t i = 0; i < lists[j]->components.size(); ++i)
+		{
+			fn(*static_cast<T*>(lists[j]->components[i]));
+		}
+	}
+}
+
+/// Call fn(T1&, T2&) for every object that has both a T1 and a T2, subclasses included
+template<typename T1, typename T2, typename Fn>
+void Level::each(Fn fn)
+{
+	std::vector<ComponentList*> lists;
+	getComponentLists<T1>(lists);
+
+	for (std::size_t j = 0; j < lists.size(); ++j)
+	{
+		ComponentList* list = lists[j];
+		for (std::size_t i = 0; i < list->components.size(); ++i)
+		{
+			T1* component = static_cast<T1*>(list->components[i]);
+			T2* sibling = findSibling<T2>(component, list->owners[i], std::is_base_of<T2, T1>());
+			if (sibling)
+			{
+				fn(*component, *sibling);
+			}
+		}
+	}
+}
+
+/// T2 is a base of T1, the component itself is the match
+template<typename T2, typename T1>
+T2* Level::findSibling(T1* component, GameObject* owner, std::true_type)
+{
+	return component;
+}
+
+/// Look for a component with type T2 in the owner
+template<typename T2, typename T1>
+T2* Level::findSibling(T1* component, GameObject* owner, std::false_type)
+{
+	if (!owner)
+		return nullptr;
+
+	for (std::size_t i = 0; i < owner->components.size(); ++i)
+	{
+		if (T2* sibling = dynamic_cast<T2*>(owner->components[i]))
+			return sibling;
+	}
+
+	return nullptr;
+}
+
 NEPHILIM_NS_END
 #endif // NephilimLevel_h__
@@ -0,0 +1,29 @@
+#ifndef NephilimWorldAnimationSystem_h__
+#define NephilimWorldAnimationSystem_h__
+
+#include <Nephilim/Platform.h>
+#include <Nephilim/World/Systems/System.h>
+
+NEPHILIM_NS_BEGIN
+
+/**
+	\class AnimationSystem
+	\brief Steps the animated components forward, ahead of rendering
+
+	Skeletal meshes, flip books and particle emitters only change their own data
+	when they step, so each type is stepped in parallel over the world's job system.
+	The system declares that it writes exactly those component types, which lets the
+	World run it alongside other systems that don't touch them.
+*/
+class NEPHILIM_API AnimationSystem : public System
+{
+public:
+	/// Declares the component types stepped by update()
+	AnimationSystem();
+
+	/// Step every skeletal mesh, flip book and particle emitter
+	virtual void update(const Time& deltaTime);
+};
+
+NEPHILIM_NS_END
+#endif // NephilimWorldAnimationSystem_h__
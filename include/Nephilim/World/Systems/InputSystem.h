@@ -62,7 +62,10 @@ public:
 
 /**
 	\class InputSystem
-	\brief 
+	\brief Turns the key bindings into actions fired on the AInputComponent of the world
+
+	The actions run gameplay callbacks that can touch anything,
+	so this system declares no component access and always updates alone on the main thread.
 */
 class NEPHILIM_API InputSystem : public System
 {
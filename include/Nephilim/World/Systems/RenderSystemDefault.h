@@ -12,6 +12,7 @@
 #include <Nephilim/Graphics/GraphicsDevice.h>
 #include <Nephilim/Graphics/Framebuffer.h>
 #include <Nephilim/Graphics/Texture2D.h>
+#include <Nephilim/Graphics/SpriteBatch.h>
 
 #include <Nephilim/Game/GameContent.h>
 
@@ -19,6 +20,7 @@ NEPHILIM_NS_BEGIN
 
 class Entity;
 class AStaticMeshComponent;
+class ATilemapComponent;
 
 /**
 	\class SystemRenderer
@@ -53,6 +55,12 @@ public:
 	/// Current world framebuffer resolution
 	int mTargetHeight;
 
+	/// Collects all the sprites of a frame to draw them in as few calls as possible
+	SpriteBatch mSpriteBatch;
+
+	/// Scratch list of the tilemap chunks that passed culling
+	std::vector<std::size_t> mVisibleChunks;
+
 public:
 
 
@@ -61,6 +69,9 @@ public:
 	/// Draw a static mesh component
 	void Render(AStaticMeshComponent* mesh);
 
+	/// Draw the chunks of a tilemap that are inside the camera frustum
+	void Render(ATilemapComponent* tilemap);
+
 	/// This function will initialize the frame buffer and other things in order to produce a new frame out of the scene
 	void startFrame();
 
@@ -80,8 +91,13 @@ public:
 
 	void renderAllSprites();
 
+	/// Queue a sprite into the frame's sprite batch, placed by its world matrix
 	void renderSprite(ASpriteComponent* sprite);
 
+	/// Attach a sprite to a parent, move the parent and check the sprite is drawn where it went
+	/// Needs no device or level, logs the outcome and returns whether the sprite followed
+	static bool verifySpriteHierarchy();
+
 
 };
 
@@ -7,15 +7,30 @@
 
 #include <Nephilim/Scripting/IScript.h>
 
+#include <vector>
+#include <map>
+
 NEPHILIM_NS_BEGIN
 
 /**
 	\class ScriptSystem
-	\brief
+	\brief Compiles scripts and ticks the scripted behaviors of the world
+
+	Every update calls "void Tick()" on the enabled AScriptComponent of the world.
+	The components are grouped by script, so each script gets a single callOnObjects()
+	with all of its instances instead of one call per component.
+
+	Scripts can reach any component or actor of the world, so this system declares
+	no component access on purpose and the World keeps it on the main thread, alone.
 */
 class NEPHILIM_API ScriptSystem : public System
 {
 public:
+	/// Tick every enabled scripted behavior of the world
+	virtual void update(const Time& deltaTime);
+
+	/// Call "void Tick()" on every enabled AScriptComponent, one batch per script
+	void tickScripts();
 	virtual void testFunction() = 0;
 
 	virtual IScript* compile(const String& filename){ return nullptr; }
@@ -23,6 +38,9 @@ public:
 	virtual void execute(const String& source){}
 
 	virtual void registerFunction(const String& signature, void* funcPtr){}
+
+private:
+	std::map<IScript*, std::vector<void*> > mTickBatches; ///< Instances to tick per script, kept to reuse the memory
 };
 
 NEPHILIM_NS_END
@@ -3,6 +3,7 @@
 
 #include <Nephilim/Foundation/Object.h>
 #include <Nephilim/Foundation/Time.h>
+#include <Nephilim/Foundation/Profiler.h>
 
 #include <typeindex>
 
@@ -29,6 +30,12 @@ class World;
 	- Render system ( produce an image from the world data )
 	- Audio system ( keep the audio playing )
 	- Script system ( call methods on scripts and fetch data from them )
+
+	A system can declare which component types its update() reads and writes,
+	with reads<T>() and writes<T>(), usually in its constructor. The World then runs
+	it on a worker thread, at the same time as the other declared systems that don't
+	write what it reads or read what it writes. Systems that declare nothing are assumed
+	to touch anything, and keep running alone on the main thread, in registration order.
 */
 class NEPHILIM_API System : public ReferencedObject
 {
@@ -55,7 +62,49 @@ public:
 	/// Get the world this system is attached to
 	/// Any plugged system has exactly one World attached to it
 	World* getWorld();
+
+	/// Check if the system declared the components it accesses, so it can run in parallel
+	bool declaresAccess() const;
+
+	/// Check if this system and the other can't update at the same time
+	/// That is when either writes a component type the other reads or writes, or either declared nothing
+	bool conflictsWith(const System& other) const;
+
+	/// Get the profiler zone its updates are timed as, named after the system's type
+	const ProfileZone* getProfileZone();
+
+protected:
+
+	/// Declare that update() reads the components of type T
+	template<typename T>
+	void reads();
+
+	/// Declare that update() modifies the components of type T
+	template<typename T>
+	void writes();
+
+private:
+	std::vector<std::type_index> mReads;          ///< Component types read by update()
+	std::vector<std::type_index> mWrites;         ///< Component types modified by update()
+	bool                         mDeclaresAccess;
+	const ProfileZone*           mProfileZone;    ///< Made on first use, the type isn't known in the constructor
 };
 
+/// Declare that update() reads the components of type T
+template<typename T>
+void System::reads()
+{
+	mReads.push_back(std::type_index(typeid(T)));
+	mDeclaresAccess = true;
+}
+
+/// Declare that update() modifies the components of type T
+template<typename T>
+void System::writes()
+{
+	mWrites.push_back(std::type_index(typeid(T)));
+	mDeclaresAccess = true;
+}
+
 NEPHILIM_NS_END
 #endif // NephilimWorldSystem_h__
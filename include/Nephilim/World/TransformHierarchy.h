@@ -0,0 +1,97 @@
+#ifndef NephilimWorldTransformHierarchy_h__
+#define NephilimWorldTransformHierarchy_h__
+
+#include <Nephilim/Platform.h>
+#include <Nephilim/Foundation/Matrix.h>
+
+#include <vector>
+
+NEPHILIM_NS_BEGIN
+
+class ASceneComponent;
+
+/**
+	\class TransformHierarchy
+	\brief Level wide storage of the world matrices of scene components
+
+	Every scene component of a level has its world matrix in one contiguous array,
+	laid out breadth first: all the roots, then all their children, and so on.
+	Parents always come before their children, and the children of one component
+	are next to each other.
+
+	Components flag themselves dirty when they move, which also flags their subtree,
+	and only the topmost moved component is queued here. update() then recomputes
+	just the queued subtrees, so the cost follows what moved instead of the level size.
+
+	Attaching, detaching, adding or removing components only flags the layout as stale,
+	it gets rebuilt once on the next update().
+*/
+class NEPHILIM_API TransformHierarchy
+{
+public:
+
+	/// Creates an empty hierarchy
+	TransformHierarchy();
+
+	/// Releases all components still in it
+	~TransformHierarchy();
+
+	/// Start tracking a scene component, its parent and children are linked on the next update()
+	void add(ASceneComponent* component);
+
+	/// Stop tracking a scene component
+	void remove(ASceneComponent* component);
+
+	/// Get the number of components tracked
+	std::size_t size() const;
+
+	/// Bring every world matrix up to date, recomputing only the subtrees that moved
+	void update();
+
+	/// Get the world matrix of a component by its index in the hierarchy
+	/// Only valid after update() and while the layout doesn't change
+	/// While update() runs, the matrices it didn't reach yet are still the ones of the previous update
+	const mat4& getWorldMatrix(std::size_t index) const;
+
+	/// Get the whole array of world matrices, in breadth first order
+	const std::vector<mat4>& getWorldMatrices() const;
+
+	/// Get the component at a given index in the breadth first order
+	ASceneComponent* getComponent(std::size_t index) const;
+
+	/// Get how many world matrices were recomputed by the last update()
+	std::size_t getLastUpdateCount() const;
+
+private:
+	friend class ASceneComponent;
+
+	/// A component moved, its subtree must be recomputed
+	void queueDirty(ASceneComponent* component);
+
+	/// The parent/child links changed, the order must be rebuilt
+	void invalidateLayout();
+
+	/// Rebuild the breadth first order from the components' links
+	void rebuildLayout();
+
+	/// Recompute the world matrix of the node and all its descendants
+	void updateSubtree(Uint32 index);
+
+	/// Recompute the world matrix of a single node, its parent is up to date
+	void updateNode(Uint32 index);
+
+	std::vector<ASceneComponent*> mMembers;      ///< Components tracked, in no particular order
+	std::vector<ASceneComponent*> mNodes;        ///< Components in breadth first order
+	std::vector<Int32>            mParents;      ///< Index of the parent node or -1
+	std::vector<Uint32>           mFirstChild;   ///< Index of the first child node
+	std::vector<Uint32>           mChildCount;   ///< Number of child nodes, they follow mFirstChild
+	std::vector<mat4>             mWorldMatrices;
+	std::vector<Uint32>           mDirty;        ///< Topmost nodes that moved since the last update
+	std::vector<Uint32>           mStack;        ///< Scratch for walking subtrees
+	bool                          mLayoutDirty;
+	bool                          mUpdating;     ///< Guards against reentry through parents outside the hierarchy
+	std::size_t                   mLastUpdateCount;
+};
+
+NEPHILIM_NS_END
+#endif // NephilimWorldTransformHierarchy_h__
@@ -5,6 +5,7 @@
 #include <Nephilim/Foundation/Object.h>
 #include <Nephilim/Foundation/String.h>
 #include <Nephilim/Foundation/Time.h>
+#include <Nephilim/Foundation/JobSystem.h>
 
 #include <Nephilim/World/GameObject.h>
 #include <Nephilim/World/Actor.h>
@@ -99,6 +100,10 @@ public:
 	/// The content manager that provides assets for this world
 	GameContent* contentManager = nullptr;
 
+	/// Runs the systems that declared their component access in parallel, when set
+	/// Without it, or with no workers started, every system updates on the calling thread
+	JobSystem* jobSystem = nullptr;
+
 	/// Array of levels in this world
 	std::vector<Level*> levels;
 
@@ -186,6 +191,21 @@ public:
 	/// Get the total numbers of spawned actors
 	int getActorCount();
 
+	/// Call fn(T&) for every component of type T in all levels
+	/// Only components created through Actor::createComponent or level prefabs are visited
+	template<typename T, typename Fn>
+	void each(Fn fn);
+
+	/// Call fn(T1&, T2&) for every object that has both a T1 and a T2, in all levels
+	/// See Level::each for the matching rules
+	template<typename T1, typename T2, typename Fn>
+	void each(Fn fn);
+
+	/// Call fn(T&) for every component of type T in all levels, in chunks of up to grainSize spread over the job system
+	/// fn runs on several threads at once, so it must only touch the component it is given
+	template<typename T, typename Fn>
+	void parallelEach(Fn fn, std::size_t grainSize = 0);
+
 	/// Registers a system to this scene
 	void attachSystem(System* system);
 
@@ -215,6 +235,10 @@ public:
 
 	Entity getEntityByIndex(std::size_t index);
 
+private:
+
+	/// Update the systems as jobs, each one waiting only for the earlier systems it conflicts with
+	void updateSystemsInParallel(const Time& deltaTime);
 };
 
 /// The template definitions are stored elsewhere
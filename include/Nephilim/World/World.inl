@@ -66,6 +66,7 @@ T* World::spawnActor()
 	myObj->_world = this;
 
 	mPersistentLevel->actors.push_back(myObj);
+	mPersistentLevel->registerComponents(myObj);
 	myObj->uuid = _IDGIVER++;
 	return myObj;
 }
@@ -78,4 +79,50 @@ T* World::spawnActor(Vector3D location, Quat orientation)
 	actor->setActorLocation(location);
 	actor->uuid = _IDGIVER++;
 	return actor;
-}
\ No newline at end of file
+}
+
+/// Call fn(T&) for every component of type T in all levels
+template<typename T, typename Fn>
+void World::each(Fn fn)
+{
+	for (std::size_t i = 0; i < levels.size(); ++i)
+	{
+		levels[i]->each<T>(fn);
+	}
+}
+
+/// Call fn(T1&, T2&) for every object that has both a T1 and a T2, in all levels
+template<typename T1, typename T2, typename Fn>
+void World::each(Fn fn)
+{
+	for (std::size_t i = 0; i < levels.size(); ++i)
+	{
+		levels[i]->each<T1, T2>(fn);
+	}
+}
+
+/// Call fn(T&) for every component of type T in all levels, spreading them over the job system
+template<typename T, typename Fn>
+void World::parallelEach(Fn fn, std::size_t grainSize)
+{
+	for (std::size_t i = 0; i < levels.size(); ++i)
+	{
+		Level::ComponentList* list = levels[i]->getComponentList<T>();
+		if (!list)
+			continue;
+
+		std::vector<Component*>& components = list->components;
+		if (!jobSystem)
+		{
+			for (std::size_t j = 0; j < components.size(); ++j)
+				fn(*static_cast<T*>(components[j]));
+			continue;
+		}
+
+		jobSystem->parallelFor(0, components.size(), grainSize, [&components, &fn](std::size_t first, std::size_t last)
+		{
+			for (std::size_t j = first; j < last; ++j)
+				fn(*static_cast<T*>(components[j]));
+		});
+	}
+}
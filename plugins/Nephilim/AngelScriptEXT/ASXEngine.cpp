@@ -1,5 +1,6 @@
 #include <Nephilim/AngelScriptEXT/ASXEngine.h>
 #include <Nephilim/Foundation/Logging.h>
+#include <Nephilim/Foundation/Lock.h>
 #include <string.h>
 
 // #include <AS/angelscript.h>
@@ -54,6 +55,12 @@ ASXEngine::ASXEngine()
 
 ASXEngine::~ASXEngine()
 {
+	for(std::map<std::thread::id, ContextPool>::iterator it = m_contextPools.begin(); it != m_contextPools.end(); ++it)
+	{
+		for(std::size_t i = 0; i < it->second.size(); ++i)
+			it->second[i]->Release();
+	}
+
 	if(m_engine) m_engine->Release();
 }
 
@@ -68,6 +75,63 @@ ASXModule ASXEngine::getModule(const String& name)
 	return ASXModule(m_engine->GetModule(name.c_str()));
 }
 
+/// Take an idle context from the calling thread's pool, creating one if there is none
+asIScriptContext* ASXEngine::requestContext()
+{
+	if(!m_engine)
+		return NULL;
+
+	{
+		Lock lock(m_cacheMutex);
+		ContextPool& pool = m_contextPools[std::this_thread::get_id()];
+		if(!pool.empty())
+		{
+			asIScriptContext* context = pool.back();
+			pool.pop_back();
+			return context;
+		}
+	}
+
+	return m_engine->CreateContext();
+}
+
+/// Give a context from requestContext() back to the calling thread's pool
+void ASXEngine::returnContext(asIScriptContext* context)
+{
+	if(!context)
+		return;
+
+	// Drop the references the last call may still hold, like its object and return value
+	context->Unprepare();
+
+	Lock lock(m_cacheMutex);
+	m_contextPools[std::this_thread::get_id()].push_back(context);
+}
+
+/// Get a method of a script class by its declaration, resolving it only the first time
+asIScriptFunction* ASXEngine::getMethod(asIObjectType* type, const String& declaration)
+{
+	if(!type)
+		return NULL;
+
+	Lock lock(m_cacheMutex);
+	MethodKey key(type, declaration);
+	std::map<MethodKey, asIScriptFunction*>::iterator it = m_methods.find(key);
+	if(it != m_methods.end())
+		return it->second;
+
+	asIScriptFunction* method = type->GetMethodByDecl(declaration.c_str());
+	m_methods[key] = method;
+	return method;
+}
+
+/// Forget every resolved method, must be called before discarding or rebuilding modules
+void ASXEngine::clearMethodCache()
+{
+	Lock lock(m_cacheMutex);
+	m_methods.clear();
+}
+
 
 /*
 /// Returns true if AngelScript is in the maximum compatibility mode - generic calls
@@ -1,24 +1,394 @@
 #include <Nephilim/AngelScriptEXT/ASXModuleBuilder.h>
 #include <Nephilim/AngelScriptEXT/ASXEngine.h>
 #include <Nephilim/Foundation/Logging.h>
+#include <Nephilim/Foundation/Clock.h>
+#include <Nephilim/Foundation/File.h>
 
 #include <AS/add_on/scriptbuilder/scriptbuilder.h>
 
+#include <algorithm>
+#include <string.h>
+
 NEPHILIM_NS_BEGIN
 
+namespace
+{
+	/// Identifies a bytecode cache file and the version of its layout
+	const char CacheMagic[8] = { 'N', 'X', 'A', 'S', 'B', 'C', '0', '1' };
+
+	/// 64 bit FNV-1a, folding more bytes into an existing hash
+	void hashBytes(Uint64& hash, const void* data, std::size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (std::size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+	}
+
+	/// Hash a string along with its length, so consecutive strings can't run into each other
+	void hashString(Uint64& hash, const char* str)
+	{
+		Uint32 length = str ? static_cast<Uint32>(strlen(str)) : 0;
+		hashBytes(hash, &length, sizeof(length));
+		hashBytes(hash, str, length);
+	}
+
+	void hashInt(Uint64& hash, Int64 value)
+	{
+		hashBytes(hash, &value, sizeof(value));
+	}
+
+	/// Reads the whole contents of a file, returns false if it can't be opened
+	bool readFile(const String& filename, std::vector<char>& contents)
+	{
+		File file(filename, IODevice::BinaryRead);
+		if (!file)
+			return false;
+
+		contents.resize(static_cast<std::size_t>(file.getSize()));
+		if (contents.empty())
+			return true;
+
+		return file.read(&contents[0], contents.size()) == static_cast<Int64>(contents.size());
+	}
+
+	/// Bytecode stream that appends to a buffer in memory
+	class ByteCodeWriter : public asIBinaryStream
+	{
+	public:
+		std::vector<char> data;
+
+		void Write(const void* ptr, asUINT size)
+		{
+			const char* bytes = static_cast<const char*>(ptr);
+			data.insert(data.end(), bytes, bytes + size);
+		}
+
+		void Read(void*, asUINT)
+		{
+		}
+	};
+
+	/// Bytecode stream that reads from a buffer in memory, failing instead of reading past its end
+	class ByteCodeReader : public asIBinaryStream
+	{
+	public:
+		ByteCodeReader(const std::vector<char>& buffer)
+		: data(buffer)
+		, position(0)
+		, failed(false)
+		{
+		}
+
+		void Read(void* ptr, asUINT size)
+		{
+			if (position + size > data.size())
+			{
+				memset(ptr, 0, size);
+				position = data.size();
+				failed = true;
+				return;
+			}
+
+			if (size > 0)
+				memcpy(ptr, &data[position], size);
+			position += size;
+		}
+
+		void Write(const void*, asUINT)
+		{
+		}
+
+		String readString()
+		{
+			Uint32 length = 0;
+			Read(&length, sizeof(length));
+			if (failed || position + length > data.size())
+			{
+				failed = true;
+				return String();
+			}
+
+			String str(std::string(&data[0] + position, length));
+			position += length;
+			return str;
+		}
+
+		const std::vector<char>& data;
+		std::size_t              position;
+		bool                     failed;
+	};
+
+	void writeString(ByteCodeWriter& writer, const String& str)
+	{
+		Uint32 length = static_cast<Uint32>(str.size());
+		writer.Write(&length, sizeof(length));
+		writer.Write(str.c_str(), length);
+	}
+}
+
+/// Creates a builder with the cache enabled
+ASXModuleBuilder::ASXModuleBuilder()
+: mCacheEnabled(true)
+, mLoadedFromCache(false)
+{
+}
+
+/// Add code to compile into the module along with the file, before it
+void ASXModuleBuilder::addSectionFromMemory(const String& name, const String& code)
+{
+	mMemoryNames.push_back(name);
+	mMemoryCode.push_back(code);
+}
+
+/// Enable or disable saving and loading the bytecode cache
+void ASXModuleBuilder::setCacheEnabled(bool enable)
+{
+	mCacheEnabled = enable;
+}
+
+/// Build a module from a script file and everything it includes, or load it from the bytecode cache if up to date
 bool ASXModuleBuilder::load(ASXEngine& engine, const String& filename, const String& module)
 {
+	Clock clock;
+	mLoadedFromCache = false;
+
+	if (mCacheEnabled && loadFromCache(engine, filename, module))
+	{
+		mLoadedFromCache = true;
+		mLoadTime = clock.getElapsedTime();
+		Log("Scripts: loaded '%s' from bytecode in %.2f ms", filename.c_str(), mLoadTime.microseconds() / 1000.f);
+		return true;
+	}
+
 	CScriptBuilder builder;
 	builder.StartNewModule(engine.get(), module.c_str());
+	for (std::size_t i = 0; i < mMemoryNames.size(); ++i)
+	{
+		builder.AddSectionFromMemory(mMemoryNames[i].c_str(), mMemoryCode[i].c_str(), static_cast<unsigned int>(mMemoryCode[i].size()));
+	}
 	builder.AddSectionFromFile(filename.c_str());
-	if(builder.BuildModule() > 0)
+
+	bool built = builder.BuildModule() >= 0;
+	if (built && mCacheEnabled)
 	{
-		return true;
+		// Every section that isn't from memory is a file, the main one or an #include
+		std::vector<String> files;
+		for (unsigned int i = 0; i < builder.GetSectionCount(); ++i)
+		{
+			String section = builder.GetSectionName(i);
+			if (std::find(mMemoryNames.begin(), mMemoryNames.end(), section) == mMemoryNames.end())
+				files.push_back(section);
+		}
+
+		saveToCache(engine, filename, module, files);
+	}
+
+	mLoadTime = clock.getElapsedTime();
+	Log("Scripts: compiled '%s' from source in %.2f ms", filename.c_str(), mLoadTime.microseconds() / 1000.f);
+	return built;
+}
+
+/// Check if the last load() came from the bytecode cache instead of the compiler
+bool ASXModuleBuilder::wasLoadedFromCache() const
+{
+	return mLoadedFromCache;
+}
+
+/// Get how long the last load() took
+Time ASXModuleBuilder::getLoadTime() const
+{
+	return mLoadTime;
+}
+
+/// Get the path of the bytecode cache for a script file
+String ASXModuleBuilder::getCachePath(const String& filename)
+{
+	return filename + "c";
+}
+
+/// Hash every declaration registered in the engine, bytecode only loads back with the same API
+Uint64 ASXModuleBuilder::hashRegisteredApi(asIScriptEngine* engine)
+{
+	Uint64 hash = 14695981039346656037ULL;
+	if (!engine)
+		return hash;
+
+	for (asUINT i = 0; i < engine->GetGlobalFunctionCount(); ++i)
+	{
+		hashString(hash, engine->GetGlobalFunctionByIndex(i)->GetDeclaration(true, true));
+	}
+
+	for (asUINT i = 0; i < engine->GetGlobalPropertyCount(); ++i)
+	{
+		const char* name = nullptr;
+		const char* nameSpace = nullptr;
+		int typeId = 0;
+		bool isConst = false;
+		engine->GetGlobalPropertyByIndex(i, &name, &nameSpace, &typeId, &isConst);
+		hashString(hash, nameSpace);
+		hashString(hash, name);
+		hashInt(hash, typeId);
+		hashInt(hash, isConst);
 	}
-	else
+
+	for (asUINT i = 0; i < engine->GetObjectTypeCount(); ++i)
 	{
+		asIObjectType* type = engine->GetObjectTypeByIndex(i);
+		hashString(hash, type->GetNamespace());
+		hashString(hash, type->GetName());
+		hashInt(hash, type->GetSize());
+		hashInt(hash, type->GetFlags());
+
+		for (asUINT j = 0; j < type->GetFactoryCount(); ++j)
+			hashString(hash, type->GetFactoryByIndex(j)->GetDeclaration());
+
+		for (asUINT j = 0; j < type->GetBehaviourCount(); ++j)
+		{
+			asEBehaviours behaviour;
+			asIScriptFunction* function = type->GetBehaviourByIndex(j, &behaviour);
+			hashInt(hash, behaviour);
+			hashString(hash, function->GetDeclaration());
+		}
+
+		for (asUINT j = 0; j < type->GetMethodCount(); ++j)
+			hashString(hash, type->GetMethodByIndex(j)->GetDeclaration());
+
+		for (asUINT j = 0; j < type->GetPropertyCount(); ++j)
+		{
+			int offset = 0;
+			type->GetProperty(j, nullptr, nullptr, nullptr, &offset);
+			hashString(hash, type->GetPropertyDeclaration(j));
+			hashInt(hash, offset);
+		}
+	}
+
+	for (asUINT i = 0; i < engine->GetEnumCount(); ++i)
+	{
+		int typeId = 0;
+		const char* nameSpace = nullptr;
+		hashString(hash, engine->GetEnumByIndex(i, &typeId, &nameSpace));
+		hashString(hash, nameSpace);
+
+		for (int j = 0; j < engine->GetEnumValueCount(typeId); ++j)
+		{
+			int value = 0;
+			hashString(hash, engine->GetEnumValueByIndex(typeId, j, &value));
+			hashInt(hash, value);
+		}
+	}
+
+	for (asUINT i = 0; i < engine->GetFuncdefCount(); ++i)
+	{
+		hashString(hash, engine->GetFuncdefByIndex(i)->GetDeclaration(true, true));
+	}
+
+	for (asUINT i = 0; i < engine->GetTypedefCount(); ++i)
+	{
+		int typeId = 0;
+		hashString(hash, engine->GetTypedefByIndex(i, &typeId));
+		hashInt(hash, typeId);
+	}
+
+	return hash;
+}
+
+/// Hash everything the module is built from, returns false if a file can't be read
+bool ASXModuleBuilder::hashSources(asIScriptEngine* engine, const std::vector<String>& files, Uint64& key) const
+{
+	key = hashRegisteredApi(engine);
+	hashString(key, ANGELSCRIPT_VERSION_STRING);
+	hashInt(key, sizeof(void*));
+
+	for (std::size_t i = 0; i < mMemoryNames.size(); ++i)
+	{
+		hashString(key, mMemoryNames[i].c_str());
+		hashString(key, mMemoryCode[i].c_str());
+	}
+
+	std::vector<char> contents;
+	for (std::size_t i = 0; i < files.size(); ++i)
+	{
+		if (!readFile(files[i], contents))
+			return false;
+
+		hashString(key, files[i].c_str());
+		hashInt(key, static_cast<Int64>(contents.size()));
+		if (!contents.empty())
+			hashBytes(key, &contents[0], contents.size());
+	}
+
+	return true;
+}
+
+/// Try to load the module from the cache file, leaving it empty on failure
+bool ASXModuleBuilder::loadFromCache(ASXEngine& engine, const String& filename, const String& module)
+{
+	std::vector<char> buffer;
+	if (!readFile(getCachePath(filename), buffer))
+		return false;
+
+	ByteCodeReader reader(buffer);
+
+	char magic[sizeof(CacheMagic)];
+	Uint64 storedKey = 0;
+	Uint32 fileCount = 0;
+	reader.Read(magic, sizeof(magic));
+	reader.Read(&storedKey, sizeof(storedKey));
+	reader.Read(&fileCount, sizeof(fileCount));
+	if (reader.failed || memcmp(magic, CacheMagic, sizeof(CacheMagic)) != 0)
+		return false;
+
+	std::vector<String> files;
+	for (Uint32 i = 0; i < fileCount && !reader.failed; ++i)
+		files.push_back(reader.readString());
+
+	// Any change to the sources, includes or registered API invalidates the bytecode
+	Uint64 key = 0;
+	if (reader.failed || !hashSources(engine.get(), files, key) || key != storedKey)
+		return false;
+
+	asIScriptModule* scriptModule = engine.get()->GetModule(module.c_str(), asGM_ALWAYS_CREATE);
+	if (!scriptModule)
+		return false;
+
+	if (scriptModule->LoadByteCode(&reader) < 0 || reader.failed)
+	{
+		Log("Scripts: the bytecode cache of '%s' is unusable, compiling instead", filename.c_str());
+		scriptModule->Discard();
 		return false;
 	}
+
+	return true;
+}
+
+/// Save the module bytecode along with the files it was built from
+void ASXModuleBuilder::saveToCache(ASXEngine& engine, const String& filename, const String& module, const std::vector<String>& files)
+{
+	asIScriptModule* scriptModule = engine.get()->GetModule(module.c_str(), asGM_ONLY_IF_EXISTS);
+	Uint64 key = 0;
+	if (!scriptModule || !hashSources(engine.get(), files, key))
+		return;
+
+	ByteCodeWriter writer;
+	Uint32 fileCount = static_cast<Uint32>(files.size());
+	writer.Write(CacheMagic, sizeof(CacheMagic));
+	writer.Write(&key, sizeof(key));
+	writer.Write(&fileCount, sizeof(fileCount));
+	for (std::size_t i = 0; i < files.size(); ++i)
+		writeString(writer, files[i]);
+
+	if (scriptModule->SaveByteCode(&writer) < 0)
+		return;
+
+	// Scripts may live somewhere read only, like packaged assets, the next launch just compiles again
+	File cacheFile(getCachePath(filename), IODevice::BinaryWrite);
+	if (!cacheFile || cacheFile.write(&writer.data[0], writer.data.size()) != static_cast<Int64>(writer.data.size()))
+	{
+		Log("Scripts: couldn't write the bytecode cache of '%s'", filename.c_str());
+	}
 }
 
 NEPHILIM_NS_END
@@ -3,16 +3,68 @@
 
 #include <Nephilim/Platform.h>
 #include <Nephilim/Foundation/String.h>
+#include <Nephilim/Foundation/Time.h>
+
+#include <vector>
+
+class asIScriptEngine;
 
 NEPHILIM_NS_BEGIN
 
 class ASXEngine;
 
+/**
+	\class ASXModuleBuilder
+	\brief Builds script modules, reusing their bytecode from a previous launch when possible
+
+	After compiling a script, its bytecode is saved next to it, in the file given by getCachePath().
+	The cache remembers every file that went into the module, including the ones brought in with #include,
+	and is keyed by a hash of their contents, of the sections added from memory and of the whole API
+	registered in the engine. When any of those changes, the key no longer matches and the module
+	is compiled from source again, refreshing the cache.
+*/
 class NEPHILIM_API ASXModuleBuilder
 {
 public:
+	/// Creates a builder with the cache enabled
+	ASXModuleBuilder();
+
+	/// Add code to compile into the module along with the file, before it
+	void addSectionFromMemory(const String& name, const String& code);
 
+	/// Enable or disable saving and loading the bytecode cache
+	void setCacheEnabled(bool enable);
+
+	/// Build a module from a script file and everything it includes, or load it from the bytecode cache if up to date
 	bool load(ASXEngine& engine, const String& filename, const String& module);
+
+	/// Check if the last load() came from the bytecode cache instead of the compiler
+	bool wasLoadedFromCache() const;
+
+	/// Get how long the last load() took
+	Time getLoadTime() const;
+
+	/// Get the path of the bytecode cache for a script file
+	static String getCachePath(const String& filename);
+
+	/// Hash every declaration registered in the engine, bytecode only loads back with the same API
+	static Uint64 hashRegisteredApi(asIScriptEngine* engine);
+
+private:
+	/// Hash everything the module is built from, returns false if a file can't be read
+	bool hashSources(asIScriptEngine* engine, const std::vector<String>& files, Uint64& key) const;
+
+	/// Try to load the module from the cache file, leaving it empty on failure
+	bool loadFromCache(ASXEngine& engine, const String& filename, const String& module);
+
+	/// Save the module bytecode along with the files it was built from
+	void saveToCache(ASXEngine& engine, const String& filename, const String& module, const std::vector<String>& files);
+
+	std::vector<String> mMemoryNames;
+	std::vector<String> mMemoryCode;
+	bool                mCacheEnabled;
+	bool                mLoadedFromCache;
+	Time                mLoadTime;
 };
 
 NEPHILIM_NS_END
@@ -7,18 +7,30 @@ NEPHILIM_NS_BEGIN
 
 ASXRuntime::ASXRuntime()
 : m_context(NULL)
+, m_engine(NULL)
 {
 
 }
 
+/// Borrow a context from the engine's pool
 ASXRuntime::ASXRuntime(ASXEngine& engine)
+: m_context(NULL)
+, m_engine(NULL)
 {
-	m_context = engine.get()->CreateContext();
+	set(engine);
 }
 
+/// Give the context back to the pool
 ASXRuntime::~ASXRuntime()
 {
-	if(m_context) m_context->Release();
+	release();
+}
+
+/// Give the current context back, if any
+void ASXRuntime::release()
+{
+	if(m_context && m_engine) m_engine->returnContext(m_context);
+	m_context = NULL;
 }
 
 asIScriptContext* ASXRuntime::get()
@@ -38,7 +50,9 @@ void ASXRuntime::popState()
 
 void ASXRuntime::set(ASXEngine& engine)
 {
-	m_context = engine.get()->CreateContext();
+	release();
+	m_engine = &engine;
+	m_context = engine.requestContext();
 }
 
 void ASXRuntime::reset(ASXModule& module)
@@ -10,13 +10,22 @@ NEPHILIM_NS_BEGIN
 class ASXEngine;
 class ASXModule;
 
+/**
+	\class ASXRuntime
+	\brief Holds a script context for the duration of one or more calls
+
+	The context is borrowed from the engine's pool of the calling thread
+	and given back on destruction, so making a runtime per call is cheap.
+*/
 class NEPHILIM_API ASXRuntime
 {
 public:
 	ASXRuntime();
 
+	/// Borrow a context from the engine's pool
 	ASXRuntime(ASXEngine& engine);
 
+	/// Give the context back to the pool
 	~ASXRuntime();
 
 	asIScriptContext* get();
@@ -30,7 +39,11 @@ public:
 	void reset(ASXModule& module);
 
 private:
+	/// Give the current context back, if any
+	void release();
+
 	asIScriptContext* m_context;
+	ASXEngine*        m_engine;  ///< Pool the context came from
 };
 
 NEPHILIM_NS_END
@@ -4,6 +4,7 @@
 #include <Nephilim/AngelScriptEXT/ASXRegistrationKeyboard.h>
 
 #include <Nephilim/Foundation/Logging.h>
+#include <Nephilim/Foundation/Clock.h>
 #include <Nephilim/World/Actor.h>
 #include <Nephilim/Game/GameMessage.h>
 
@@ -203,27 +204,119 @@ void ScriptSystem_AS::testFunction()
 	}
 }
 
+/// Measure script method calls per second, logging the result for each way of calling
+void ScriptSystem_AS::benchmarkCalls(const String& filename, const String& className, int instanceCount, int rounds)
+{
+	// Built into a module of its own, so a live module compiled from the same file is left alone
+	static int benchmarkCount = 0;
+	const String moduleName = String("__benchmark") + String::number(benchmarkCount++);
+
+	ScriptModuleASX* script = build(filename, moduleName);
+	if (!script->myModule || instanceCount <= 0 || rounds <= 0)
+	{
+		Log("Benchmark: '%s' failed to build", filename.c_str());
+		discardBenchmark(script, moduleName);
+		return;
+	}
+
+	std::vector<void*> objects;
+	for (int i = 0; i < instanceCount; ++i)
+	{
+		void* object = script->createClassInstance(className);
+		if (object)
+			objects.push_back(object);
+	}
+
+	if (objects.empty())
+	{
+		Log("Benchmark: no instances of '%s'", className.c_str());
+		discardBenchmark(script, moduleName);
+		return;
+	}
+
+	const String method = "void Tick()";
+	const double callCount = static_cast<double>(objects.size()) * rounds;
+	Clock clock;
+
+	// The way calls were made before the pool, a new context and a method lookup each time
+	clock.reset();
+	for (int r = 0; r < rounds; ++r)
+	{
+		for (std::size_t i = 0; i < objects.size(); ++i)
+		{
+			asIScriptObject* object = static_cast<asIScriptObject*>(objects[i]);
+			asIScriptContext* context = _env->engine.get()->CreateContext();
+			context->Prepare(object->GetObjectType()->GetMethodByDecl(method.c_str()));
+			context->SetObject(object);
+			context->Execute();
+			context->Release();
+		}
+	}
+	double unpooledSeconds = clock.getElapsedTime().microseconds() / 1000000.0;
+
+	clock.reset();
+	for (int r = 0; r < rounds; ++r)
+	{
+		for (std::size_t i = 0; i < objects.size(); ++i)
+			script->callOnObject(method, objects[i]);
+	}
+	double pooledSeconds = clock.getElapsedTime().microseconds() / 1000000.0;
+
+	clock.reset();
+	for (int r = 0; r < rounds; ++r)
+	{
+		script->callOnObjects(method, &objects[0], objects.size());
+	}
+	double batchedSeconds = clock.getElapsedTime().microseconds() / 1000000.0;
+
+	Log("Benchmark: %d x %d calls of '%s' on %s", static_cast<int>(objects.size()), rounds, method.c_str(), className.c_str());
+	Log("  new context per call: %.0f calls/s", unpooledSeconds > 0.0 ? callCount / unpooledSeconds : 0.0);
+	Log("  pooled context:       %.0f calls/s", pooledSeconds > 0.0 ? callCount / pooledSeconds : 0.0);
+	Log("  batched:              %.0f calls/s", batchedSeconds > 0.0 ? callCount / batchedSeconds : 0.0);
+
+	for (std::size_t i = 0; i < objects.size(); ++i)
+		static_cast<asIScriptObject*>(objects[i])->Release();
+
+	discardBenchmark(script, moduleName);
+}
+
+/// Delete the script of a benchmark along with its scratch module
+void ScriptSystem_AS::discardBenchmark(ScriptModuleASX* script, const String& moduleName)
+{
+	delete script;
+
+	// Its types go away with the module, so do the methods resolved from them
+	_env->engine.clearMethodCache();
+	_env->engine.get()->DiscardModule(moduleName.c_str());
+}
+
 void ScriptSystem_AS::registerFunction(const String& signature, void* funcPtr)
 {
 	_env->engine.get()->RegisterGlobalFunction(signature.c_str(), asFUNCTION(funcPtr), asCALL_CDECL);
 }
 
-#include <AS/add_on/scriptbuilder/scriptbuilder.h>
-
 IScript* ScriptSystem_AS::compile(const String& filename)
+{
+	return build(filename, filename);
+}
+
+/// Build a script file into the module with the given name, replacing it if it exists
+ScriptModuleASX* ScriptSystem_AS::build(const String& filename, const String& moduleName)
 {
 	ScriptModuleASX* script = new ScriptModuleASX;
 	
 	String actorInjectionCode = "class ActorBehavior{ Actor@ _actor = null; Actor@ GetActor(){ return @_actor;} }";
 	actorInjectionCode += "class GameBehavior{ }";
 
-	CScriptBuilder as_builder;
-	as_builder.StartNewModule(_env->engine.get(), filename.c_str());
-	as_builder.AddSectionFromMemory("actorinjection", actorInjectionCode.c_str());
-	as_builder.AddSectionFromFile(filename.c_str());
-	as_builder.BuildModule();
+	// Rebuilding a module frees its types, methods resolved from them would dangle
+	_env->engine.clearMethodCache();
 
-	script->myModule = _env->engine.getModule(filename.c_str());
+	// Loads the bytecode saved by a previous launch when nothing changed since
+	ASXModuleBuilder builder;
+	builder.addSectionFromMemory("actorinjection", actorInjectionCode);
+	builder.load(_env->engine, filename, moduleName);
+
+	script->myModule = _env->engine.getModule(moduleName);
 	script->_engine = &_env->engine;
 
 	return script;
@@ -245,7 +338,7 @@ void ScriptModuleASX::call(const String& funcName)
 		ASXRuntime myRuntime(*_engine);
 
 		ASXFunction func;
-		func.mFunction = myModule.get()->GetFunctionByDecl(funcName.c_str());
+		func.mFunction = getFunction(funcName);
 		func.mRuntime = &myRuntime;
 		func.call();
 	}
@@ -253,21 +346,64 @@ void ScriptModuleASX::call(const String& funcName)
 
 void ScriptModuleASX::callOnObject(const String& function_name, void* obj)
 {
-	if (myModule && obj)
+	callOnObjects(function_name, &obj, 1);
+
+	//Log("Calling method '%s' on obj %x", function_name.c_str(), obj);
+}
+
+/// Call the same method on many objects with one context, resolving it once per object type
+void ScriptModuleASX::callOnObjects(const String& function_name, void* const* objects, std::size_t count)
+{
+	if (!myModule || count == 0)
+		return;
+
+	ASXRuntime myRuntime(*_engine);
+	asIScriptContext* context = myRuntime.get();
+	if (!context)
+		return;
+
+	// Behaviors of one kind usually come together, so the method is looked up again only when the type changes
+	asIObjectType* currentType = nullptr;
+	asIScriptFunction* method = nullptr;
+
+	for (std::size_t i = 0; i < count; ++i)
 	{
-		ASXRuntime myRuntime(*_engine);
+		asIScriptObject* object = static_cast<asIScriptObject*>(objects[i]);
+		if (!object)
+			continue;
 
-		asIObjectType* ObjectType = static_cast<asIScriptObject*>(obj)->GetObjectType();
+		asIObjectType* objectType = object->GetObjectType();
+		if (objectType != currentType)
+		{
+			currentType = objectType;
+			method = _engine->getMethod(objectType, function_name);
+		}
 
-		ASXFunction func;
-		func.mFunction = ObjectType->GetMethodByDecl(function_name.c_str());
-		func.mRuntime = &myRuntime;
-		func.callOnObject(obj);
+		if (!method)
+			continue;
 
-		//Log("Calling method '%s' on obj %x", function_name.c_str(), obj);
+		// Preparing the function the context already has only resets it
+		context->Prepare(method);
+		context->SetObject(object);
+		if (context->Execute() == asEXECUTION_EXCEPTION)
+		{
+			Log("Script exception in '%s': %s", function_name.c_str(), context->GetExceptionString());
+		}
 	}
 }
 
+/// Get a global function of the module by its declaration, resolving it only the first time
+asIScriptFunction* ScriptModuleASX::getFunction(const String& declaration)
+{
+	std::map<String, asIScriptFunction*>::iterator it = mFunctions.find(declaration);
+	if (it != mFunctions.end())
+		return it->second;
+
+	asIScriptFunction* function = myModule.get()->GetFunctionByDecl(declaration.c_str());
+	mFunctions[declaration] = function;
+	return function;
+}
+
 void ScriptModuleASX::setMemberRef(const String& identifier, void* obj, void* ref)
 {
 	Actor* actorPtr = static_cast<Actor*>(ref);
@@ -304,13 +440,29 @@ void ScriptModuleASX::setMemberRef(const String& identifier, void* obj, void* re
 
 void* ScriptModuleASX::createClassInstance(const String& className)
 {
-	// Get the object type
-	asIScriptModule *module = myModule.get();
+	asIScriptFunction *factory = nullptr;
+
+	std::map<String, asIScriptFunction*>::iterator it = mFactories.find(className);
+	if (it != mFactories.end())
+	{
+		factory = it->second;
+	}
+	else
+	{
+		// Get the object type
+		asIScriptModule *module = myModule.get();
+
+		asIObjectType *type = _engine->get()->GetObjectTypeById(module->GetTypeIdByDecl(className.c_str()));
 
-	asIObjectType *type = _engine->get()->GetObjectTypeById(module->GetTypeIdByDecl(className.c_str()));
+		// Get the factory function from the object type
+		if (type)
+			factory = type->GetFactoryByDecl((className + " @" + className + "()").c_str());
 
-	// Get the factory function from the object type
-	asIScriptFunction *factory = type->GetFactoryByDecl((className + " @" + className + "()").c_str());
+		mFactories[className] = factory;
+	}
+
+	if (!factory)
+		return nullptr;
 
 	ASXRuntime myRuntime(*_engine);
 
@@ -325,7 +477,8 @@ void* ScriptModuleASX::createClassInstance(const String& className)
 
 	// If you're going to store the object you must increase the reference,
 	// otherwise it will be destroyed when the context is reused or destroyed.
-	obj->AddRef();
+	if (obj)
+		obj->AddRef();
 
 	return obj;
-}
\ No newline at end of file
+}
@@ -11,7 +11,10 @@ using namespace nx;
 #include <Nephilim/AngelScriptEXT/ASXRuntime.h>
 #include <Nephilim/AngelScriptEXT/ASXModuleBuilder.h>
 
+#include <map>
+
 class ScriptingEnvironment_AS;
+class ScriptModuleASX;
 
 class ScriptSystem_AS : public ScriptSystem
 {
@@ -28,9 +31,20 @@ public:
 
 	void testFunction();
 
+	/// Measure script method calls per second, logging the result for each way of calling
+	/// Creates instanceCount objects of className from the script and calls "void Tick()" on all of them rounds times
+	void benchmarkCalls(const String& filename, const String& className, int instanceCount, int rounds);
+
 	IScript* compile(const String& filename);
 
 	void execute(const String& source);
+
+private:
+	/// Build a script file into the module with the given name, replacing it if it exists
+	ScriptModuleASX* build(const String& filename, const String& moduleName);
+
+	/// Delete the script of a benchmark along with its scratch module
+	void discardBenchmark(ScriptModuleASX* script, const String& moduleName);
 };
 
 class ScriptModuleASX : public IScript
@@ -44,9 +58,19 @@ public:
 
 	virtual void callOnObject(const String& func, void* obj);
 
+	/// Call the same method on many objects with one context, resolving it once per object type
+	virtual void callOnObjects(const String& func, void* const* objects, std::size_t count);
+
 	virtual void* createClassInstance(const String& className);
 
 	virtual void setMemberRef(const String& identifier, void* obj, void* ref);
+
+private:
+	/// Get a global function of the module by its declaration, resolving it only the first time
+	asIScriptFunction* getFunction(const String& declaration);
+
+	std::map<String, asIScriptFunction*> mFunctions; ///< Global functions already resolved
+	std::map<String, asIScriptFunction*> mFactories; ///< Default factories of the classes already instanced
 };
 
 #endif // CorePluginScriptEngineASX_h__
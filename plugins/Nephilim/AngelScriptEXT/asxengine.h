@@ -6,8 +6,14 @@
 #include <Nephilim/AngelScriptEXT/ASXModule.h>
 #include <Nephilim/AngelScriptEXT/ASXRefCount.h>
 
+#include <Nephilim/Foundation/Mutex.h>
+
 #include <angelscript.h>
 
+#include <map>
+#include <vector>
+#include <thread>
+
 
 struct asSMessageInfo;
 class asIScriptEngine;
@@ -35,6 +41,20 @@ public:
 	template<class T>
 	void registerClassRef(const String& name);
 
+	/// Take an idle context from the calling thread's pool, creating one if there is none
+	/// Nested calls simply take another one, so contexts are never shared by two calls at once
+	asIScriptContext* requestContext();
+
+	/// Give a context from requestContext() back to the calling thread's pool
+	void returnContext(asIScriptContext* context);
+
+	/// Get a method of a script class by its declaration, resolving it only the first time
+	/// Returns NULL if the type has no such method
+	asIScriptFunction* getMethod(asIObjectType* type, const String& declaration);
+
+	/// Forget every resolved method, must be called before discarding or rebuilding modules
+	void clearMethodCache();
+
 	/// Load a script
 //	bool load(const String& path);
 	
@@ -43,8 +63,15 @@ private:
 	//void messageLogger(const asSMessageInfo *msg, void *param);
 
 private:
+	typedef std::vector<asIScriptContext*> ContextPool;
+	typedef std::pair<asIObjectType*, String> MethodKey;
+
 	asIScriptEngine* m_engine;   ///< The AngelScript engine
 	bool			 m_generics; ///< Whether the engine is using generics or native calls
+
+	std::map<std::thread::id, ContextPool>  m_contextPools; ///< Idle contexts of each thread
+	std::map<MethodKey, asIScriptFunction*> m_methods;      ///< Methods already resolved, NULL for missing ones
+	Mutex                                   m_cacheMutex;   ///< Guards the pools and the method cache
 };
 
 
@@ -1,34 +1,18 @@
-// The actual worker
-#include "AssimpModelLoader.h"
-
-// Engine interfaces
-#include <Nephilim/VertexArray.h>
-#include <Nephilim/IndexArray.h>
+#include <Nephilim/Graphics/GraphicsDevice.h>
+#include <Nephilim/Extensions/PluginSDK.h>
 using namespace nx;
 
-#include <assimp/Importer.hpp>      // C++ importer interface
-#include <assimp/scene.h>           // Output data structure
-#include <assimp/postprocess.h>     // Post processing flags
-
-#include <stdio.h>
+#include "GraphicsDeviceSoftware.h"
 
 extern "C"
 {
-	void __declspec(dllexport) dll_hello()
+	__declspec(dllexport) GraphicsDevice *createGraphicsDevice()
 	{
-		printf("Hello world\n\n\n");
+		return new GraphicsDeviceSoftware();
 	}
 
-	void __declspec(dllexport) sup()
+	__declspec(dllexport) PluginSDK::Types getPluginType()
 	{
-
+		return PluginSDK::Graphics;
 	}
-
-void __declspec(dllexport) loadModel(const char* filename, VertexArray& vertexArray, IndexArray& indexArray)
-{
-
-	AssimpModelLoader loader;
-	loader.open(filename,vertexArray, indexArray);
-}
-
 }
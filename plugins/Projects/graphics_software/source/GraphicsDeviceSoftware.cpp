@@ -0,0 +1,1184 @@
+#include "GraphicsDeviceSoftware.h"
+
+#include <Nephilim/Graphics/VertexArray.h>
+#include <Nephilim/Graphics/IndexArray.h>
+#include <Nephilim/Graphics/VertexBuffer.h>
+#include <Nephilim/Graphics/IndexBuffer.h>
+#include <Nephilim/Graphics/GL/GLHelpers.h>
+#include <Nephilim/Foundation/Logging.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	/// Vertices are snapped to 1/SubpixelSteps of a pixel before rasterizing
+	const int SubpixelBits = 4;
+	const int SubpixelSteps = 1 << SubpixelBits;
+
+	/// Triangles are clipped to pixel coordinates within this distance of the origin,
+	/// so the fixed point edge functions can't overflow while clipping stays rare
+	const float GuardBand = 16384.f;
+
+	/// Most corners a triangle can have after clipping, one more for each of the five planes
+	const int MaxClippedCorners = 8;
+
+	/// Intersection of two rectangles, empty rectangles have no width or height
+	IntRect intersectRects(const IntRect& a, const IntRect& b)
+	{
+		int left = std::max(a.left, b.left);
+		int top = std::max(a.top, b.top);
+		int right = std::min(a.left + a.width, b.left + b.width);
+		int bottom = std::min(a.top + a.height, b.top + b.height);
+		return IntRect(left, top, std::max(right - left, 0), std::max(bottom - top, 0));
+	}
+
+	/// Convert a normalized value to a byte, clamping it
+	Uint8 toByte(float value)
+	{
+		value = std::min(std::max(value, 0.f), 1.f);
+		return static_cast<Uint8>(value * 255.f + 0.5f);
+	}
+
+	/// Value of an attribute plane at a pixel center
+	inline float evaluatePlane(const float* plane, float x, float y)
+	{
+		return plane[0] * x + plane[1] * y + plane[2];
+	}
+}
+
+// -- SoftwareTexture2D
+
+/// Creates an empty texture, sampled by device if given
+SoftwareTexture2D::SoftwareTexture2D(GraphicsDeviceSoftware* device)
+: mDevice(device)
+, mWidth(0)
+, mHeight(0)
+, mSmooth(false)
+, mRepeated(false)
+{
+	if (mDevice)
+		mDevice->mTextures.push_back(this);
+}
+
+/// Lets the device finish the draws that sample it
+SoftwareTexture2D::~SoftwareTexture2D()
+{
+	if (mDevice)
+		mDevice->textureDestroyed(this);
+}
+
+/// Have the device draw what it queued with this texture before it changes
+void SoftwareTexture2D::beforeChange()
+{
+	if (mDevice)
+		mDevice->textureChanging(this);
+}
+
+/// Create or recreate the texture with a given size, filled with transparent black
+bool SoftwareTexture2D::create(unsigned int width, unsigned int height)
+{
+	beforeChange();
+
+	mWidth = static_cast<int>(width);
+	mHeight = static_cast<int>(height);
+	mPixels.assign(width * height * 4, 0);
+	return true;
+}
+
+/// Copy the pixels into an image
+bool SoftwareTexture2D::copyToImage(Image& image) const
+{
+	if (mPixels.empty())
+		return false;
+
+	image.create(mWidth, mHeight, &mPixels[0]);
+	return true;
+}
+
+/// Get the texture rectangle size
+Vector2<int> SoftwareTexture2D::getSize() const
+{
+	return Vector2<int>(mWidth, mHeight);
+}
+
+/// Loads the texture from disk
+bool SoftwareTexture2D::loadFromFile(const String& filename)
+{
+	Image image;
+	if (!image.loadFromFile(filename))
+		return false;
+
+	return loadFromImage(image);
+}
+
+/// Loads the texture from a image buffer
+bool SoftwareTexture2D::loadFromImage(const Image& image)
+{
+	Vec2i size = image.getSize();
+	if (size.x <= 0 || size.y <= 0 || !image.getPixelsPtr())
+		return false;
+
+	create(size.x, size.y);
+	update(image.getPixelsPtr());
+	return true;
+}
+
+/// Sets the texture repeat mode
+void SoftwareTexture2D::setRepeated(bool repeated)
+{
+	beforeChange();
+	mRepeated = repeated;
+}
+
+/// Set the texture filtering mode, bilinear when smooth
+void SoftwareTexture2D::setSmooth(bool smooth)
+{
+	beforeChange();
+	mSmooth = smooth;
+}
+
+/// Updates a given region inside the texture with an array of pixels
+void SoftwareTexture2D::update(const Uint8* pixels, unsigned int width, unsigned int height, unsigned int x, unsigned int y)
+{
+	if (!pixels || x + width > static_cast<unsigned int>(mWidth) || y + height > static_cast<unsigned int>(mHeight))
+		return;
+
+	beforeChange();
+
+	for (unsigned int row = 0; row < height; ++row)
+	{
+		std::memcpy(&mPixels[((y + row) * mWidth + x) * 4], pixels + row * width * 4, width * 4);
+	}
+}
+
+/// Update the whole texture with an array of pixels
+void SoftwareTexture2D::update(const Uint8* pixels)
+{
+	update(pixels, mWidth, mHeight, 0, 0);
+}
+
+/// Update the whole texture from an image
+void SoftwareTexture2D::update(const Image& image)
+{
+	update(image.getPixelsPtr());
+}
+
+/// Fetch one texel, applying the wrap mode to its coordinates
+const Uint8* SoftwareTexture2D::fetch(int x, int y) const
+{
+	if (mRepeated)
+	{
+		x %= mWidth;
+		y %= mHeight;
+		if (x < 0) x += mWidth;
+		if (y < 0) y += mHeight;
+	}
+	else
+	{
+		x = std::min(std::max(x, 0), mWidth - 1);
+		y = std::min(std::max(y, 0), mHeight - 1);
+	}
+
+	return &mPixels[(y * mWidth + x) * 4];
+}
+
+/// Sample the texture at the coordinates u, v into a normalized color
+void SoftwareTexture2D::sample(float u, float v, float* rgba) const
+{
+	if (mPixels.empty())
+	{
+		rgba[0] = rgba[1] = rgba[2] = rgba[3] = 1.f;
+		return;
+	}
+
+	float x = u * mWidth;
+	float y = v * mHeight;
+
+	if (!mSmooth)
+	{
+		const Uint8* texel = fetch(static_cast<int>(std::floor(x)), static_cast<int>(std::floor(y)));
+		for (int k = 0; k < 4; ++k)
+			rgba[k] = texel[k] / 255.f;
+		return;
+	}
+
+	// Bilinear, between the four texel centers around the sample
+	x -= 0.5f;
+	y -= 0.5f;
+	float x0 = std::floor(x);
+	float y0 = std::floor(y);
+	float fx = x - x0;
+	float fy = y - y0;
+
+	const Uint8* t00 = fetch(static_cast<int>(x0), static_cast<int>(y0));
+	const Uint8* t10 = fetch(static_cast<int>(x0) + 1, static_cast<int>(y0));
+	const Uint8* t01 = fetch(static_cast<int>(x0), static_cast<int>(y0) + 1);
+	const Uint8* t11 = fetch(static_cast<int>(x0) + 1, static_cast<int>(y0) + 1);
+
+	for (int k = 0; k < 4; ++k)
+	{
+		float top = t00[k] + (t10[k] - t00[k]) * fx;
+		float bottom = t01[k] + (t11[k] - t01[k]) * fx;
+		rgba[k] = (top + (bottom - top) * fy) / 255.f;
+	}
+}
+
+// -- SoftwareVertexBuffer
+
+/// Allocate size bytes, zeroed
+void SoftwareVertexBuffer::allocate(std::size_t size, bool)
+{
+	mData.assign(size, 0);
+}
+
+/// Overwrite size bytes starting at offset, clamped to the allocated size
+void SoftwareVertexBuffer::write(const void* data, std::size_t size, std::size_t offset)
+{
+	if (offset >= mData.size())
+		return;
+
+	std::memcpy(&mData[offset], data, std::min(size, mData.size() - offset));
+}
+
+/// Get the contents, nullptr while nothing is allocated
+const char* SoftwareVertexBuffer::getData() const
+{
+	return mData.empty() ? nullptr : &mData[0];
+}
+
+/// Get the allocated size in bytes
+std::size_t SoftwareVertexBuffer::getSize() const
+{
+	return mData.size();
+}
+
+// -- GraphicsDeviceSoftware
+
+/// Creates the device with a width x height target
+GraphicsDeviceSoftware::GraphicsDeviceSoftware(int width, int height)
+: GraphicsDevice()
+, mWidth(0)
+, mHeight(0)
+, mTilesX(0)
+, mTilesY(0)
+, mVertexBuffer(nullptr)
+, mGpuVertexBufferBound(false)
+, mIndexBuffer(nullptr)
+, mWarnedBuffers(false)
+, mTexture(nullptr)
+, mBlendMode(Render::Blend::Alpha)
+, mBlending(false)
+, mDepthTest(false)
+, mClipping(false)
+{
+	m_name = "Software";
+
+	for (int i = 0; i < 3; ++i)
+	{
+		AttributePointer attribute = { false, 4, GL_FLOAT, false, 0, nullptr, nullptr };
+		mAttributes[i] = attribute;
+	}
+
+	// The base made its default texture before this device could make software ones
+	delete m_defaultTexture._impl;
+	m_defaultTexture._impl = createTexture2D();
+	Image whiteTexture;
+	whiteTexture.create(1, 1, Color::White);
+	m_defaultTexture.loadFromImage(whiteTexture);
+
+	create(width, height);
+	setDefaultTexture();
+	setThreadCount(4);
+}
+
+/// Textures it made outlive it as plain images, no longer tied to a device
+GraphicsDeviceSoftware::~GraphicsDeviceSoftware()
+{
+	// The default texture and any other still alive would otherwise call back into a dead device
+	clearQueue();
+	for (std::size_t i = 0; i < mTextures.size(); ++i)
+		mTextures[i]->mDevice = nullptr;
+}
+
+/// Resize the color and depth buffers, discarding their contents and anything queued
+void GraphicsDeviceSoftware::create(int width, int height)
+{
+	clearQueue();
+
+	mWidth = std::max(width, 1);
+	mHeight = std::max(height, 1);
+	mTilesX = (mWidth + TileSize - 1) / TileSize;
+	mTilesY = (mHeight + TileSize - 1) / TileSize;
+
+	mColorBuffer.assign(mWidth * mHeight * 4, 0);
+	mDepthBuffer.assign(mWidth * mHeight, 1.f);
+	mTileBins.clear();
+	mTileBins.resize(mTilesX * mTilesY);
+
+	mViewport = IntRect(0, 0, mWidth, mHeight);
+	mClippingRect = mViewport;
+}
+
+/// Get the size of the target in pixels
+Vector2<int> GraphicsDeviceSoftware::getSize() const
+{
+	return Vector2<int>(mWidth, mHeight);
+}
+
+/// Set how many threads rasterize the tiles, 1 draws on the calling thread
+void GraphicsDeviceSoftware::setThreadCount(int count)
+{
+	mJobs.stop();
+	if (count > 1)
+		mJobs.start(static_cast<std::size_t>(count - 1));
+}
+
+/// Rasterize everything queued since the last flush
+void GraphicsDeviceSoftware::flush()
+{
+	if (mTriangles.empty())
+		return;
+
+	// Tiles only write their own pixels, so they can be drawn in any order on any thread
+	mJobs.parallelFor(0, mTileBins.size(), 1, [this](std::size_t first, std::size_t last)
+	{
+		for (std::size_t i = first; i < last; ++i)
+			rasterizeTile(i);
+	});
+
+	clearQueue();
+}
+
+/// Drop everything queued
+void GraphicsDeviceSoftware::clearQueue()
+{
+	mTriangles.clear();
+	mStates.clear();
+	for (std::size_t i = 0; i < mTileBins.size(); ++i)
+		mTileBins[i].clear();
+}
+
+/// Create the implementation of a new Texture2D for this device
+GDI_Texture2D* GraphicsDeviceSoftware::createTexture2D()
+{
+	return new SoftwareTexture2D(this);
+}
+
+/// A texture is about to change, rasterize the queued draws that sample it first
+void GraphicsDeviceSoftware::textureChanging(const SoftwareTexture2D* texture)
+{
+	// States are merged while equal, so there are few of them to look through
+	for (std::size_t i = 0; i < mStates.size(); ++i)
+	{
+		if (mStates[i].texture == texture)
+		{
+			flush();
+			return;
+		}
+	}
+}
+
+/// A texture is being destroyed, rasterize its queued draws and stop sampling it
+void GraphicsDeviceSoftware::textureDestroyed(SoftwareTexture2D* texture)
+{
+	textureChanging(texture);
+
+	// Later draws go untextured, like with textures of another device
+	if (mTexture == texture)
+		mTexture = nullptr;
+
+	mTextures.erase(std::remove(mTextures.begin(), mTextures.end(), texture), mTextures.end());
+}
+
+/// Create a vertex buffer in system memory
+GDI_VertexBuffer* GraphicsDeviceSoftware::createVertexBuffer()
+{
+	return new SoftwareVertexBuffer;
+}
+
+/// Keep a copy of the indices in the buffer itself, there is no GPU to upload them to
+void GraphicsDeviceSoftware::uploadIndexBuffer(IndexBuffer* indexBuffer, const IndexArray& indices)
+{
+	indexBuffer->clientIndices = indices.indices;
+}
+
+/// Draw the vertices as a list of triangles, reading attributes by their hint
+void GraphicsDeviceSoftware::draw(const VertexArray& vertexData)
+{
+	fetchVertices(vertexData);
+	submit(Render::Primitive::Triangles, nullptr, mVertices.size());
+}
+
+/// Draw indexed triangles, reading attributes by their hint
+void GraphicsDeviceSoftware::draw(const VertexArray& vertexArray, const IndexArray& indexArray)
+{
+	if (indexArray.indices.empty())
+		return;
+
+	fetchVertices(vertexArray);
+	submit(Render::Primitive::Triangles, &indexArray.indices[0], indexArray.indices.size());
+}
+
+/// Draw a vertex array
+void GraphicsDeviceSoftware::draw(const VertexArray2D& varray, const RenderState& state)
+{
+	const mat4 transform = m_projection * m_view * m_model * state.m_transform;
+
+	mVertices.resize(varray.m_vertices.size());
+	for (std::size_t i = 0; i < varray.m_vertices.size(); ++i)
+	{
+		const VertexArray2D::Vertex& v = varray.m_vertices[i];
+		mVertices[i].position = transform * vec4(v.position.x, v.position.y, 0.f, 1.f);
+		mVertices[i].color = vec4(v.color.r / 255.f, v.color.g / 255.f, v.color.b / 255.f, v.color.a / 255.f);
+		mVertices[i].uv = vec2(v.texCoords.x, v.texCoords.y);
+	}
+
+	submit(varray.geometryType, nullptr, mVertices.size());
+}
+
+/// Draw from the enabled attribute pointers
+void GraphicsDeviceSoftware::drawArrays(Render::Primitive::Type primitiveType, int start, int count)
+{
+	if (count <= 0 || usesGpuBuffers(false))
+		return;
+
+	fetchVertices(start, count);
+	submit(primitiveType, nullptr, mVertices.size());
+}
+
+/// Draw from the enabled attribute pointers with 16 bit indices
+void GraphicsDeviceSoftware::drawElements(Render::Primitive::Type primitiveType, int count, const void* indices)
+{
+	if (count <= 0 || usesGpuBuffers(true))
+		return;
+
+	const Uint16* indexData = static_cast<const Uint16*>(indices);
+	if (mIndexBuffer)
+	{
+		// Like OpenGL, indices is a byte offset into the bound buffer
+		std::size_t first = reinterpret_cast<std::size_t>(indices) / sizeof(Uint16);
+		if (first + static_cast<std::size_t>(count) > mIndexBuffer->clientIndices.size())
+			return;
+
+		indexData = &mIndexBuffer->clientIndices[first];
+	}
+	else if (!indexData)
+	{
+		return;
+	}
+
+	Uint16 highest = *std::max_element(indexData, indexData + count);
+
+	fetchVertices(0, static_cast<std::size_t>(highest) + 1);
+	submit(primitiveType, indexData, count);
+}
+
+/// Enable reading an attribute location
+void GraphicsDeviceSoftware::enableVertexAttribArray(unsigned int index)
+{
+	if (index < 3)
+		mAttributes[index].enabled = true;
+}
+
+/// Disable reading an attribute location, its default value is used instead
+void GraphicsDeviceSoftware::disableVertexAttribArray(unsigned int index)
+{
+	if (index < 3)
+		mAttributes[index].enabled = false;
+}
+
+/// Point an attribute location to client memory
+void GraphicsDeviceSoftware::setVertexAttribPointer(unsigned int index, int numComponents, int componentType, bool normalized, int stride, const void* ptr)
+{
+	if (index >= 3)
+		return;
+
+	AttributePointer& attribute = mAttributes[index];
+	attribute.numComponents = std::min(numComponents, 4);
+	attribute.componentType = componentType;
+	attribute.normalized = normalized;
+	attribute.data = static_cast<const char*>(ptr);
+	attribute.buffer = mVertexBuffer;
+
+	// Like OpenGL, a stride of 0 means tightly packed
+	int componentSize = (componentType == GL_UNSIGNED_BYTE) ? 1 : 4;
+	attribute.stride = stride ? stride : numComponents * componentSize;
+}
+
+/// Read the attribute of vertex index into out, leaving the components it doesn't have
+void GraphicsDeviceSoftware::AttributePointer::read(std::size_t index, float* out) const
+{
+	if (!enabled || (!data && !buffer))
+		return;
+
+	const char* vertex;
+	if (buffer)
+	{
+		// Reads past the end of the buffer leave the defaults, as they would be undefined on the GPU
+		std::size_t offset = reinterpret_cast<std::size_t>(data) + index * stride;
+		std::size_t size = numComponents * ((componentType == GL_UNSIGNED_BYTE) ? 1 : 4);
+		if (!buffer->getData() || offset + size > buffer->getSize())
+			return;
+
+		vertex = buffer->getData() + offset;
+	}
+	else
+	{
+		vertex = data + index * stride;
+	}
+
+	if (componentType == GL_UNSIGNED_BYTE)
+	{
+		const Uint8* values = reinterpret_cast<const Uint8*>(vertex);
+		for (int k = 0; k < numComponents; ++k)
+			out[k] = normalized ? values[k] / 255.f : static_cast<float>(values[k]);
+	}
+	else if (componentType == GL_FLOAT)
+	{
+		std::memcpy(out, vertex, numComponents * sizeof(float));
+	}
+}
+
+/// Read the next attribute pointers from this buffer, draws are skipped if it wasn't made by this device
+void GraphicsDeviceSoftware::setVertexBuffer(VertexBuffer* vertexBuffer)
+{
+	mVertexBuffer = vertexBuffer ? dynamic_cast<const SoftwareVertexBuffer*>(vertexBuffer->_impl) : nullptr;
+	mGpuVertexBufferBound = (vertexBuffer && !mVertexBuffer);
+}
+
+/// Read the next indices from this buffer, indexed draws are skipped if it wasn't filled by this device
+void GraphicsDeviceSoftware::setIndexBuffer(IndexBuffer* indexBuffer)
+{
+	mIndexBuffer = indexBuffer;
+}
+
+/// Check if buffers this device can't read are set, reporting once that the draw is skipped
+bool GraphicsDeviceSoftware::usesGpuBuffers(bool indexed)
+{
+	bool gpuIndices = indexed && mIndexBuffer && mIndexBuffer->clientIndices.empty();
+	if (!mGpuVertexBufferBound && !gpuIndices)
+		return false;
+
+	if (!mWarnedBuffers)
+	{
+		Log("GraphicsDeviceSoftware: draws from vertex or index buffers made by another device are not supported, skipping them");
+		mWarnedBuffers = true;
+	}
+	return true;
+}
+
+/// Read vertex i from the attribute pointers into the scratch array
+void GraphicsDeviceSoftware::fetchVertices(std::size_t first, std::size_t count)
+{
+	const mat4 transform = m_projection * m_view * m_model;
+
+	mVertices.resize(count);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		float position[4] = { 0.f, 0.f, 0.f, 1.f };
+		float color[4] = { 1.f, 1.f, 1.f, 1.f };
+		float uv[2] = { 0.f, 0.f };
+
+		mAttributes[0].read(first + i, position);
+		mAttributes[1].read(first + i, color);
+		if (mAttributes[2].numComponents <= 2)
+			mAttributes[2].read(first + i, uv);
+
+		mVertices[i].position = transform * vec4(position[0], position[1], position[2], position[3]);
+		mVertices[i].color = vec4(color[0], color[1], color[2], color[3]);
+		mVertices[i].uv = vec2(uv[0], uv[1]);
+	}
+}
+
+/// Read the vertices of a VertexArray into the scratch array
+void GraphicsDeviceSoftware::fetchVertices(const VertexArray& vertexArray)
+{
+	const mat4 transform = m_projection * m_view * m_model;
+	const std::size_t stride = vertexArray.stride();
+
+	mVertices.resize(vertexArray._data.empty() ? 0 : vertexArray.count);
+	for (std::size_t i = 0; i < mVertices.size(); ++i)
+	{
+		float position[4] = { 0.f, 0.f, 0.f, 1.f };
+		float color[4] = { 1.f, 1.f, 1.f, 1.f };
+		float uv[4] = { 0.f, 0.f, 0.f, 0.f };
+
+		const char* vertex = &vertexArray._data[0] + i * stride;
+		for (std::size_t a = 0; a < vertexArray.format.attributes.size(); ++a)
+		{
+			const VertexFormat::Attribute& attribute = vertexArray.format.attributes[a];
+			if (attribute.size != sizeof(float))
+				continue;
+
+			const char* value = vertex + vertexArray.getAttributeOffset(static_cast<Int32>(a));
+			std::size_t components = static_cast<std::size_t>(std::min(attribute.numComponents, 4));
+			switch (attribute.hint)
+			{
+				case VertexFormat::Position: std::memcpy(position, value, components * sizeof(float)); break;
+				case VertexFormat::Color:    std::memcpy(color, value, components * sizeof(float));    break;
+				case VertexFormat::TexCoord: std::memcpy(uv, value, components * sizeof(float));       break;
+			}
+		}
+
+		mVertices[i].position = transform * vec4(position[0], position[1], position[2], position[3]);
+		mVertices[i].color = vec4(color[0], color[1], color[2], color[3]);
+		mVertices[i].uv = vec2(uv[0], uv[1]);
+	}
+}
+
+/// Capture the current render state for the next triangles, reusing the last one when equal
+Uint32 GraphicsDeviceSoftware::captureState()
+{
+	DrawState state;
+	state.texture = mTexture;
+	state.blendMode = mBlending ? mBlendMode : -1;
+	state.depthTest = mDepthTest;
+	state.bounds = intersectRects(mViewport, IntRect(0, 0, mWidth, mHeight));
+	if (mClipping)
+		state.bounds = intersectRects(state.bounds, mClippingRect);
+
+	if (!mStates.empty())
+	{
+		const DrawState& last = mStates.back();
+		if (last.texture == state.texture && last.blendMode == state.blendMode && last.depthTest == state.depthTest &&
+			last.bounds.left == state.bounds.left && last.bounds.top == state.bounds.top &&
+			last.bounds.width == state.bounds.width && last.bounds.height == state.bounds.height)
+		{
+			return static_cast<Uint32>(mStates.size() - 1);
+		}
+	}
+
+	mStates.push_back(state);
+	return static_cast<Uint32>(mStates.size() - 1);
+}
+
+/// Assemble the scratch vertices into triangles and queue them, indices are optional
+void GraphicsDeviceSoftware::submit(Render::Primitive::Type primitiveType, const Uint16* indices, std::size_t count)
+{
+	if (count < 3)
+		return;
+
+	const Uint32 state = captureState();
+	const std::size_t vertexCount = mVertices.size();
+
+	// Corners of the n-th triangle, as positions in the index stream
+	std::size_t triangleCount = 0;
+	switch (primitiveType)
+	{
+		case Render::Primitive::Triangles:     triangleCount = count / 3; break;
+		case Render::Primitive::TriangleStrip:
+		case Render::Primitive::TriangleFan:   triangleCount = count - 2; break;
+		default:                               return; // Lines and points aren't rasterized
+	}
+
+	for (std::size_t t = 0; t < triangleCount; ++t)
+	{
+		std::size_t corners[3];
+		if (primitiveType == Render::Primitive::Triangles)
+		{
+			corners[0] = t * 3;
+			corners[1] = t * 3 + 1;
+			corners[2] = t * 3 + 2;
+		}
+		else if (primitiveType == Render::Primitive::TriangleStrip)
+		{
+			// Every other strip triangle is flipped to keep the winding of the first
+			corners[0] = (t % 2 == 0) ? t : t + 1;
+			corners[1] = (t % 2 == 0) ? t + 1 : t;
+			corners[2] = t + 2;
+		}
+		else
+		{
+			corners[0] = 0;
+			corners[1] = t + 1;
+			corners[2] = t + 2;
+		}
+
+		bool valid = true;
+		for (int k = 0; k < 3; ++k)
+		{
+			if (indices)
+				corners[k] = indices[corners[k]];
+			valid = valid && corners[k] < vertexCount;
+		}
+
+		if (valid)
+			clipAndQueue(mVertices[corners[0]], mVertices[corners[1]], mVertices[corners[2]], state);
+	}
+}
+
+/// Interpolate every attribute between two clip space vertices
+GraphicsDeviceSoftware::ClipVertex GraphicsDeviceSoftware::interpolate(const ClipVertex& a, const ClipVertex& b, float t)
+{
+	ClipVertex result;
+	result.position = vec4(a.position.x + (b.position.x - a.position.x) * t,
+	                       a.position.y + (b.position.y - a.position.y) * t,
+	                       a.position.z + (b.position.z - a.position.z) * t,
+	                       a.position.w + (b.position.w - a.position.w) * t);
+	result.color = vec4(a.color.x + (b.color.x - a.color.x) * t,
+	                    a.color.y + (b.color.y - a.color.y) * t,
+	                    a.color.z + (b.color.z - a.color.z) * t,
+	                    a.color.w + (b.color.w - a.color.w) * t);
+	result.uv = vec2(a.uv.x + (b.uv.x - a.uv.x) * t, a.uv.y + (b.uv.y - a.uv.y) * t);
+	return result;
+}
+
+/// Clip a triangle against the near plane and the guard band, and queue what remains
+void GraphicsDeviceSoftware::clipAndQueue(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, Uint32 state)
+{
+	// How far from the center the guard band is, in normalized device coordinates
+	const float halfWidth = std::max(mViewport.width * 0.5f, 0.5f);
+	const float halfHeight = std::max(mViewport.height * 0.5f, 0.5f);
+	const float guardX = std::max((GuardBand - std::abs(mViewport.left) - halfWidth) / halfWidth, 1.f);
+	const float guardY = std::max((GuardBand - std::abs(mViewport.top) - halfHeight) / halfHeight, 1.f);
+
+	// Planes as x, y, z and w factors, a vertex is inside where the sum of the products is positive
+	const float planes[5][4] =
+	{
+		{ 0.f, 0.f, 1.f, 1.f },      // Same near plane as OpenGL, -w <= z
+		{ -1.f, 0.f, 0.f, guardX },  // x <= guardX * w
+		{ 1.f, 0.f, 0.f, guardX },   // -guardX * w <= x
+		{ 0.f, -1.f, 0.f, guardY },
+		{ 0.f, 1.f, 0.f, guardY }
+	};
+
+	ClipVertex polygons[2][MaxClippedCorners];
+	polygons[0][0] = a;
+	polygons[0][1] = b;
+	polygons[0][2] = c;
+	int current = 0;
+	int count = 3;
+
+	for (int p = 0; p < 5; ++p)
+	{
+		const float* plane = planes[p];
+		const ClipVertex* input = polygons[current];
+
+		float distances[MaxClippedCorners];
+		int inside = 0;
+		for (int k = 0; k < count; ++k)
+		{
+			const vec4& position = input[k].position;
+			distances[k] = plane[0] * position.x + plane[1] * position.y + plane[2] * position.z + plane[3] * position.w;
+			if (distances[k] >= 0.f)
+				++inside;
+		}
+
+		if (inside == 0)
+			return;
+
+		// Nearly every triangle is entirely inside, skip the copy then
+		if (inside == count)
+			continue;
+
+		// Cutting one plane off a convex polygon adds at most one corner
+		ClipVertex* output = polygons[1 - current];
+		int outputCount = 0;
+		for (int k = 0; k < count; ++k)
+		{
+			int next = (k + 1) % count;
+			if (distances[k] >= 0.f)
+				output[outputCount++] = input[k];
+
+			if ((distances[k] >= 0.f) != (distances[next] >= 0.f))
+				output[outputCount++] = interpolate(input[k], input[next], distances[k] / (distances[k] - distances[next]));
+		}
+
+		current = 1 - current;
+		count = outputCount;
+	}
+
+	const ClipVertex* polygon = polygons[current];
+	for (int k = 1; k + 1 < count; ++k)
+	{
+		setupTriangle(polygon[0], polygon[k], polygon[k + 1], state);
+	}
+}
+
+/// Project, set up and bin one triangle that is entirely inside the near plane and guard band
+void GraphicsDeviceSoftware::setupTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, Uint32 state)
+{
+	const ClipVertex* corners[3] = { &a, &b, &c };
+	const IntRect& bounds = mStates[state].bounds;
+
+	Int64 fixedX[3], fixedY[3];
+	float screenX[3], screenY[3], values[3][8];
+	for (int k = 0; k < 3; ++k)
+	{
+		const ClipVertex& v = *corners[k];
+		if (v.position.w <= 1e-6f)
+			return;
+
+		const float invW = 1.f / v.position.w;
+		const float x = mViewport.left + (v.position.x * invW * 0.5f + 0.5f) * mViewport.width;
+		const float y = mViewport.top + (0.5f - v.position.y * invW * 0.5f) * mViewport.height;
+
+		// Clipping keeps the corners within the guard band, this only catches rounding at its edge
+		if (std::fabs(x) > GuardBand * 2.f || std::fabs(y) > GuardBand * 2.f)
+			return;
+
+		fixedX[k] = static_cast<Int64>(std::floor(x * SubpixelSteps + 0.5f));
+		fixedY[k] = static_cast<Int64>(std::floor(y * SubpixelSteps + 0.5f));
+		screenX[k] = static_cast<float>(fixedX[k]) / SubpixelSteps;
+		screenY[k] = static_cast<float>(fixedY[k]) / SubpixelSteps;
+
+		values[k][0] = v.position.z * invW * 0.5f + 0.5f;
+		values[k][1] = invW;
+		values[k][2] = v.color.x * invW;
+		values[k][3] = v.color.y * invW;
+		values[k][4] = v.color.z * invW;
+		values[k][5] = v.color.w * invW;
+		values[k][6] = v.uv.x * invW;
+		values[k][7] = v.uv.y * invW;
+	}
+
+	// Make the winding positive, so the inside of every edge is positive as well
+	Int64 area = (fixedX[1] - fixedX[0]) * (fixedY[2] - fixedY[0]) - (fixedX[2] - fixedX[0]) * (fixedY[1] - fixedY[0]);
+	if (area == 0)
+		return;
+
+	int order[3] = { 0, 1, 2 };
+	if (area < 0)
+	{
+		std::swap(order[1], order[2]);
+		area = -area;
+	}
+
+	Triangle triangle;
+	triangle.state = state;
+
+	// Pixels whose center is inside the bounding box, clamped to where the draw may write
+	float minX = std::min(screenX[0], std::min(screenX[1], screenX[2]));
+	float maxX = std::max(screenX[0], std::max(screenX[1], screenX[2]));
+	float minY = std::min(screenY[0], std::min(screenY[1], screenY[2]));
+	float maxY = std::max(screenY[0], std::max(screenY[1], screenY[2]));
+	triangle.minX = std::max(static_cast<int>(std::ceil(minX - 0.5f)), bounds.left);
+	triangle.maxX = std::min(static_cast<int>(std::floor(maxX - 0.5f)), bounds.left + bounds.width - 1);
+	triangle.minY = std::max(static_cast<int>(std::ceil(minY - 0.5f)), bounds.top);
+	triangle.maxY = std::min(static_cast<int>(std::floor(maxY - 0.5f)), bounds.top + bounds.height - 1);
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+		return;
+
+	for (int e = 0; e < 3; ++e)
+	{
+		const int i = order[e];
+		const int j = order[(e + 1) % 3];
+		const Int64 edgeA = fixedY[i] - fixedY[j];
+		const Int64 edgeB = fixedX[j] - fixedX[i];
+		triangle.edges[e][0] = edgeA;
+		triangle.edges[e][1] = edgeB;
+		triangle.edges[e][2] = fixedX[i] * fixedY[j] - fixedX[j] * fixedY[i];
+
+		// Top and left edges own the pixels exactly on them, so neighbours never draw a pixel twice
+		triangle.bias[e] = (edgeA > 0 || (edgeA == 0 && edgeB > 0)) ? 0 : -1;
+	}
+
+	// Attributes as planes over the screen, from the values at the three corners
+	const int v0 = order[0], v1 = order[1], v2 = order[2];
+	const float dx1 = screenX[v1] - screenX[v0], dy1 = screenY[v1] - screenY[v0];
+	const float dx2 = screenX[v2] - screenX[v0], dy2 = screenY[v2] - screenY[v0];
+	const float invArea = 1.f / (dx1 * dy2 - dx2 * dy1);
+	for (int p = 0; p < 8; ++p)
+	{
+		const float df1 = values[v1][p] - values[v0][p];
+		const float df2 = values[v2][p] - values[v0][p];
+		const float ddx = (df1 * dy2 - df2 * dy1) * invArea;
+		const float ddy = (df2 * dx1 - df1 * dx2) * invArea;
+		triangle.planes[p][0] = ddx;
+		triangle.planes[p][1] = ddy;
+		triangle.planes[p][2] = values[v0][p] - ddx * screenX[v0] - ddy * screenY[v0];
+	}
+
+	const Uint32 triangleIndex = static_cast<Uint32>(mTriangles.size());
+	mTriangles.push_back(triangle);
+
+	for (int ty = triangle.minY / TileSize; ty <= triangle.maxY / TileSize; ++ty)
+	{
+		for (int tx = triangle.minX / TileSize; tx <= triangle.maxX / TileSize; ++tx)
+		{
+			mTileBins[ty * mTilesX + tx].push_back(triangleIndex);
+		}
+	}
+}
+
+/// Rasterize every triangle binned into a tile, safe to run for different tiles in parallel
+void GraphicsDeviceSoftware::rasterizeTile(std::size_t tileIndex)
+{
+	const std::vector<Uint32>& bin = mTileBins[tileIndex];
+	if (bin.empty())
+		return;
+
+	const int tileX = static_cast<int>(tileIndex % mTilesX) * TileSize;
+	const int tileY = static_cast<int>(tileIndex / mTilesX) * TileSize;
+
+	for (std::size_t i = 0; i < bin.size(); ++i)
+	{
+		const Triangle& triangle = mTriangles[bin[i]];
+		const DrawState& state = mStates[triangle.state];
+
+		const int minX = std::max(triangle.minX, tileX);
+		const int maxX = std::min(triangle.maxX, tileX + TileSize - 1);
+		const int minY = std::max(triangle.minY, tileY);
+		const int maxY = std::min(triangle.maxY, tileY + TileSize - 1);
+
+		// Edge functions step by a whole pixel in subpixel units
+		Int64 stepX[3];
+		for (int e = 0; e < 3; ++e)
+			stepX[e] = triangle.edges[e][0] * SubpixelSteps;
+
+		for (int y = minY; y <= maxY; ++y)
+		{
+			const Int64 centerY = static_cast<Int64>(y) * SubpixelSteps + SubpixelSteps / 2;
+			const Int64 centerX = static_cast<Int64>(minX) * SubpixelSteps + SubpixelSteps / 2;
+
+			Int64 rowStart[3];
+			for (int e = 0; e < 3; ++e)
+				rowStart[e] = triangle.edges[e][0] * centerX + triangle.edges[e][1] * centerY + triangle.edges[e][2] + triangle.bias[e];
+
+			// Coverage of four pixels at a time, the lanes are independent so the compiler can vectorize them
+			for (int x = minX; x <= maxX; x += 4)
+			{
+				const Int64 offset = x - minX;
+				int mask = 0;
+				for (int lane = 0; lane < 4; ++lane)
+				{
+					const Int64 step = offset + lane;
+					const bool inside = (rowStart[0] + stepX[0] * step >= 0) &
+					                    (rowStart[1] + stepX[1] * step >= 0) &
+					                    (rowStart[2] + stepX[2] * step >= 0) &
+					                    (x + lane <= maxX);
+					mask |= static_cast<int>(inside) << lane;
+				}
+
+				for (int lane = 0; mask != 0; ++lane, mask >>= 1)
+				{
+					if (mask & 1)
+						shadePixel(triangle, state, x + lane, y);
+				}
+			}
+		}
+	}
+}
+
+/// Shade and blend one covered pixel
+void GraphicsDeviceSoftware::shadePixel(const Triangle& triangle, const DrawState& state, int x, int y)
+{
+	const float px = x + 0.5f;
+	const float py = y + 0.5f;
+	const std::size_t pixel = static_cast<std::size_t>(y) * mWidth + x;
+
+	const float depth = evaluatePlane(triangle.planes[0], px, py);
+	if (state.depthTest)
+	{
+		// Same as the GL default, GL_LESS with depth writes on
+		if (!(depth < mDepthBuffer[pixel]))
+			return;
+
+		mDepthBuffer[pixel] = depth;
+	}
+
+	// Undo the division by w to get perspective correct attributes
+	const float w = 1.f / evaluatePlane(triangle.planes[1], px, py);
+	float source[4];
+	for (int k = 0; k < 4; ++k)
+		source[k] = evaluatePlane(triangle.planes[2 + k], px, py) * w;
+
+	if (state.texture)
+	{
+		float texel[4];
+		state.texture->sample(evaluatePlane(triangle.planes[6], px, py) * w, evaluatePlane(triangle.planes[7], px, py) * w, texel);
+		for (int k = 0; k < 4; ++k)
+			source[k] *= texel[k];
+	}
+
+	Uint8* destination = &mColorBuffer[pixel * 4];
+	float result[4];
+	float current[4];
+	for (int k = 0; k < 4; ++k)
+		current[k] = destination[k] / 255.f;
+
+	const float alpha = source[3];
+	for (int k = 0; k < 4; ++k)
+	{
+		switch (state.blendMode)
+		{
+			case Render::Blend::Alpha:    result[k] = source[k] * alpha + current[k] * (1.f - alpha); break;
+			case Render::Blend::Add:      result[k] = source[k] + current[k];                         break;
+			case Render::Blend::AddAlpha: result[k] = source[k] * alpha + current[k];                 break;
+			case Render::Blend::Multiply: result[k] = source[k] * current[k];                         break;
+			default:                      result[k] = source[k];                                      break;
+		}
+	}
+
+	for (int k = 0; k < 4; ++k)
+		destination[k] = toByte(result[k]);
+}
+
+/// Clears the depth buffer
+void GraphicsDeviceSoftware::clearDepthBuffer()
+{
+	flush();
+	std::fill(mDepthBuffer.begin(), mDepthBuffer.end(), 1.f);
+}
+
+/// There is no stencil buffer, does nothing
+void GraphicsDeviceSoftware::clearStencilBuffer()
+{
+}
+
+/// Clears the color buffer
+void GraphicsDeviceSoftware::clearColorBuffer()
+{
+	flush();
+
+	const Uint8 color[4] = { m_clearColor.r, m_clearColor.g, m_clearColor.b, m_clearColor.a };
+	for (std::size_t i = 0; i < mColorBuffer.size(); i += 4)
+		std::memcpy(&mColorBuffer[i], color, 4);
+}
+
+/// Clears the color and depth buffers
+void GraphicsDeviceSoftware::clearAllBuffers()
+{
+	clearColorBuffer();
+	clearDepthBuffer();
+}
+
+/// Set the clear color of the render target
+void GraphicsDeviceSoftware::setClearColor(const Color& color)
+{
+	m_clearColor = color;
+}
+
+/// Sample from the texture in the next draws
+void GraphicsDeviceSoftware::setTexture(const Texture2D& texture)
+{
+	// Textures made before this device existed are OpenGL ones, they draw untextured
+	mTexture = dynamic_cast<const SoftwareTexture2D*>(texture._impl);
+}
+
+/// There is only the one target
+void GraphicsDeviceSoftware::setDefaultTarget()
+{
+}
+
+/// There is only the one target
+void GraphicsDeviceSoftware::setTarget(RenderTarget&)
+{
+}
+
+/// Set the viewport in target-relative coordinates
+void GraphicsDeviceSoftware::setViewport(float left, float top, float width, float height)
+{
+	setViewportInPixels(static_cast<int>(left * mWidth + 0.5f), static_cast<int>(top * mHeight + 0.5f),
+	                    static_cast<int>(width * mWidth + 0.5f), static_cast<int>(height * mHeight + 0.5f));
+}
+
+/// Set the viewport in pixels, from the top-left of the target
+void GraphicsDeviceSoftware::setViewportInPixels(int left, int top, int width, int height)
+{
+	mViewport = IntRect(left, top, width, height);
+}
+
+/// Sets depth testing to enabled or not, tested fragments write their depth
+void GraphicsDeviceSoftware::setDepthTestEnabled(bool enable)
+{
+	mDepthTest = enable;
+}
+
+/// Activates blending with the default mode: Alpha
+void GraphicsDeviceSoftware::setDefaultBlending()
+{
+	setBlendMode(Render::Blend::Alpha);
+}
+
+/// Activates blending and a blend mode
+void GraphicsDeviceSoftware::setBlendMode(Render::Blend::Mode mode)
+{
+	mBlending = true;
+	mBlendMode = static_cast<Int32>(mode);
+}
+
+/// Activates or deactivates blending entirely
+void GraphicsDeviceSoftware::setBlendingEnabled(bool enable)
+{
+	mBlending = enable;
+}
+
+/// There are no shaders, the fixed texture times color stage is always used
+void GraphicsDeviceSoftware::setDefaultShader()
+{
+}
+
+/// There are no shaders, does nothing
+void GraphicsDeviceSoftware::reloadDefaultShader()
+{
+}
+
+/// There are no shaders, does nothing
+void GraphicsDeviceSoftware::setShader(Shader&)
+{
+}
+
+/// Activates or deactivates rectangular clipping - scissor test
+void GraphicsDeviceSoftware::setClippingEnabled(bool enable)
+{
+	mClipping = enable;
+}
+
+/// Resets the scissor clipping rectangle to the full target
+void GraphicsDeviceSoftware::resetClippingRect()
+{
+	mClippingRect = IntRect(0, 0, mWidth, mHeight);
+}
+
+/// Set the scissor clipping rectangle, in pixels from the top-left of the target
+void GraphicsDeviceSoftware::setClippingRect(FloatRect rect)
+{
+	mClippingRect = IntRect(static_cast<int>(rect.left), static_cast<int>(rect.top), static_cast<int>(rect.width), static_cast<int>(rect.height));
+}
+
+/// Clip to the intersection of rect and the current clipping rectangle
+void GraphicsDeviceSoftware::pushClippingRect(FloatRect rect, bool isNormalized)
+{
+	setClippingEnabled(true);
+
+	if (isNormalized)
+	{
+		rect.left *= mWidth;
+		rect.width *= mWidth;
+		rect.top *= mHeight;
+		rect.height *= mHeight;
+	}
+
+	FloatRect outer = m_scissorStack.empty() ? FloatRect(0.f, 0.f, static_cast<float>(mWidth), static_cast<float>(mHeight)) : m_scissorStack.top();
+	float left = std::max(rect.left, outer.left);
+	float top = std::max(rect.top, outer.top);
+	float right = std::min(rect.left + rect.width, outer.left + outer.width);
+	float bottom = std::min(rect.top + rect.height, outer.top + outer.height);
+	rect = FloatRect(left, top, std::max(right - left, 0.f), std::max(bottom - top, 0.f));
+
+	m_scissorStack.push(rect);
+	setClippingRect(rect);
+}
+
+/// Go back to the previous clipping rectangle, or stop clipping
+void GraphicsDeviceSoftware::popClippingRect()
+{
+	if (!m_scissorStack.empty())
+		m_scissorStack.pop();
+
+	if (m_scissorStack.empty())
+		setClippingEnabled(false);
+	else
+		setClippingRect(m_scissorStack.top());
+}
+
+/// Flush and copy the color buffer into an image
+bool GraphicsDeviceSoftware::readPixels(Image& image)
+{
+	flush();
+	image.create(mWidth, mHeight, &mColorBuffer[0]);
+	return true;
+}
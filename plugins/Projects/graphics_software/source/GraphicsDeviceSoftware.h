@@ -0,0 +1,381 @@
+#ifndef NephilimPluginGraphicsDeviceSoftware_h__
+#define NephilimPluginGraphicsDeviceSoftware_h__
+
+#include <Nephilim/Graphics/GraphicsDevice.h>
+#include <Nephilim/Graphics/GDI/GDI_Texture2D.h>
+#include <Nephilim/Graphics/GDI/GDI_VertexBuffer.h>
+#include <Nephilim/Foundation/Image.h>
+#include <Nephilim/Foundation/Rect.h>
+#include <Nephilim/Foundation/JobSystem.h>
+using namespace nx;
+
+#include <vector>
+
+class GraphicsDeviceSoftware;
+
+/**
+	\class SoftwareTexture2D
+	\brief Texture kept in system memory, sampled by GraphicsDeviceSoftware
+
+	Before its pixels or sampling settings change, and before it is destroyed,
+	the texture has its device rasterize the queued draws that sample it.
+*/
+class SoftwareTexture2D : public GDI_Texture2D
+{
+public:
+	/// Creates an empty texture, sampled by device if given
+	explicit SoftwareTexture2D(GraphicsDeviceSoftware* device = nullptr);
+
+	/// Lets the device finish the draws that sample it
+	~SoftwareTexture2D();
+
+	/// Create or recreate the texture with a given size, filled with transparent black
+	virtual bool create(unsigned int width, unsigned int height);
+
+	/// Copy the pixels into an image
+	virtual bool copyToImage(Image& image) const;
+
+	/// Get the texture rectangle size
+	virtual Vector2<int> getSize() const;
+
+	/// Loads the texture from disk
+	virtual bool loadFromFile(const String& filename);
+
+	/// Loads the texture from a image buffer
+	virtual bool loadFromImage(const Image& image);
+
+	/// Sets the texture repeat mode
+	virtual void setRepeated(bool repeated);
+
+	/// Set the texture filtering mode, bilinear when smooth
+	virtual void setSmooth(bool smooth);
+
+	/// Updates a given region inside the texture with an array of pixels
+	virtual void update(const Uint8* pixels, unsigned int width, unsigned int height, unsigned int x, unsigned int y);
+
+	/// Update the whole texture with an array of pixels
+	virtual void update(const Uint8* pixels);
+
+	/// Update the whole texture from an image
+	virtual void update(const Image& image);
+
+	/// Sample the texture at the coordinates u, v into a normalized color
+	void sample(float u, float v, float* rgba) const;
+
+private:
+
+	friend class GraphicsDeviceSoftware;
+
+	/// Fetch one texel, applying the wrap mode to its coordinates
+	const Uint8* fetch(int x, int y) const;
+
+	/// Have the device draw what it queued with this texture before it changes
+	void beforeChange();
+
+	GraphicsDeviceSoftware* mDevice; ///< Device that samples it, nullptr once the device is gone
+	std::vector<Uint8> mPixels; ///< RGBA, rows from top to bottom
+	int                mWidth;
+	int                mHeight;
+	bool               mSmooth;
+	bool               mRepeated;
+};
+
+/**
+	\class SoftwareVertexBuffer
+	\brief Vertex buffer kept in system memory, read by GraphicsDeviceSoftware
+*/
+class SoftwareVertexBuffer : public GDI_VertexBuffer
+{
+public:
+	/// Allocate size bytes, zeroed
+	virtual void allocate(std::size_t size, bool dynamic);
+
+	/// Overwrite size bytes starting at offset, clamped to the allocated size
+	virtual void write(const void* data, std::size_t size, std::size_t offset);
+
+	/// Get the contents, nullptr while nothing is allocated
+	const char* getData() const;
+
+	/// Get the allocated size in bytes
+	std::size_t getSize() const;
+
+private:
+	std::vector<char> mData;
+};
+
+/**
+	\class GraphicsDeviceSoftware
+	\brief Tile based software rasterizer, renders into system memory
+
+	A GraphicsDevice that needs no GPU or window, meant for headless tools,
+	automated screenshots and as a deterministic reference for the GPU renderers.
+
+	Draws are transformed, clipped against the near plane and a guard band around the target,
+	set up and queued. The queued triangles are binned into screen tiles, and flush()
+	rasterizes the tiles as jobs of the device's own JobSystem.
+	Every tile is owned by one thread and draws its triangles in submission order,
+	so the result matches drawing them one by one. Coverage is tested four pixels at a time.
+
+	What is supported, following the conventions of the GL renderers:
+	- Triangles, triangle strips and fans; lines and points are ignored
+	- Position, color and texture coordinates at attribute locations 0, 1 and 2
+	- Textures at unit 0, vertex colors, blending, depth testing and scissor clipping
+	- Client side arrays, and vertex and index buffers made by this device; buffers made
+	  by another device live on the GPU and draws from them are skipped
+
+	The queue is flushed on its own when clearing, reading the pixels back, or when
+	a texture made by this device that a queued draw samples is changed or destroyed.
+*/
+class GraphicsDeviceSoftware : public GraphicsDevice
+{
+public:
+	/// Side of the square screen tiles, in pixels
+	static const int TileSize = 64;
+
+	/// Creates the device with a width x height target
+	GraphicsDeviceSoftware(int width = 1024, int height = 768);
+
+	/// Textures it made outlive it as plain images, no longer tied to a device
+	~GraphicsDeviceSoftware();
+
+	/// Resize the color and depth buffers, discarding their contents and anything queued
+	void create(int width, int height);
+
+	/// Get the size of the target in pixels
+	Vector2<int> getSize() const;
+
+	/// Set how many threads rasterize the tiles, 1 draws on the calling thread
+	/// The calling thread takes part, so count - 1 job system workers are started
+	void setThreadCount(int count);
+
+	/// Rasterize everything queued since the last flush
+	void flush();
+
+	/// Create the implementation of a new Texture2D for this device
+	virtual GDI_Texture2D* createTexture2D();
+
+	/// Create a vertex buffer in system memory
+	virtual GDI_VertexBuffer* createVertexBuffer();
+
+	/// Keep a copy of the indices in the buffer itself, there is no GPU to upload them to
+	virtual void uploadIndexBuffer(IndexBuffer* indexBuffer, const IndexArray& indices);
+
+	using GraphicsDevice::draw;
+
+	/// Draw the vertices as a list of triangles, reading attributes by their hint
+	virtual void draw(const VertexArray& vertexData);
+
+	/// Draw indexed triangles, reading attributes by their hint
+	virtual void draw(const VertexArray& vertexArray, const IndexArray& indexArray);
+
+	/// Draw a vertex array, with the transform of state applied after the model matrix
+	virtual void draw(const VertexArray2D& varray, const RenderState& state = RenderState());
+
+	/// Draw from the enabled attribute pointers
+	virtual void drawArrays(Render::Primitive::Type primitiveType, int start, int count);
+
+	/// Draw from the enabled attribute pointers with 16 bit indices
+	/// indices point to client memory, or are a byte offset into the bound index buffer
+	virtual void drawElements(Render::Primitive::Type primitiveType, int count, const void* indices);
+
+	/// Enable reading an attribute location
+	virtual void enableVertexAttribArray(unsigned int index);
+
+	/// Disable reading an attribute location, its default value is used instead
+	virtual void disableVertexAttribArray(unsigned int index);
+
+	/// Point an attribute location to client memory, or to a byte offset into the bound vertex buffer
+	virtual void setVertexAttribPointer(unsigned int index, int numComponents, int componentType, bool normalized, int stride, const void* ptr);
+
+	/// Read the next attribute pointers from this buffer, draws are skipped if it wasn't made by this device
+	virtual void setVertexBuffer(VertexBuffer* vertexBuffer);
+
+	/// Read the next indices from this buffer, indexed draws are skipped if it wasn't filled by this device
+	virtual void setIndexBuffer(IndexBuffer* indexBuffer);
+
+	/// Clears the depth buffer
+	virtual void clearDepthBuffer();
+
+	/// There is no stencil buffer, does nothing
+	virtual void clearStencilBuffer();
+
+	/// Clears the color buffer
+	virtual void clearColorBuffer();
+
+	/// Clears the color and depth buffers
+	virtual void clearAllBuffers();
+
+	/// Set the clear color of the render target
+	virtual void setClearColor(const Color& color);
+
+	/// Sample from the texture in the next draws
+	virtual void setTexture(const Texture2D& texture);
+
+	/// There is only the one target
+	virtual void setDefaultTarget();
+
+	/// There is only the one target
+	virtual void setTarget(RenderTarget& target);
+
+	/// Set the viewport in target-relative coordinates
+	virtual void setViewport(float left, float top, float width, float height);
+
+	/// Set the viewport in pixels, from the top-left of the target
+	virtual void setViewportInPixels(int left, int top, int width, int height);
+
+	/// Sets depth testing to enabled or not, tested fragments write their depth
+	virtual void setDepthTestEnabled(bool enable);
+
+	/// Activates blending with the default mode: Alpha
+	virtual void setDefaultBlending();
+
+	/// Activates blending and a blend mode
+	virtual void setBlendMode(Render::Blend::Mode mode);
+
+	/// Activates or deactivates blending entirely
+	virtual void setBlendingEnabled(bool enable);
+
+	/// There are no shaders, the fixed texture times color stage is always used
+	virtual void setDefaultShader();
+
+	/// There are no shaders, does nothing
+	virtual void reloadDefaultShader();
+
+	/// There are no shaders, does nothing
+	virtual void setShader(Shader& shader);
+
+	/// Activates or deactivates rectangular clipping - scissor test
+	virtual void setClippingEnabled(bool enable);
+
+	/// Resets the scissor clipping rectangle to the full target
+	virtual void resetClippingRect();
+
+	/// Set the scissor clipping rectangle, in pixels from the top-left of the target
+	virtual void setClippingRect(FloatRect rect);
+
+	/// Clip to the intersection of rect and the current clipping rectangle
+	virtual void pushClippingRect(FloatRect rect, bool isNormalized = false);
+
+	/// Go back to the previous clipping rectangle, or stop clipping
+	virtual void popClippingRect();
+
+	/// Flush and copy the color buffer into an image
+	virtual bool readPixels(Image& image);
+
+private:
+	friend class SoftwareTexture2D;
+
+	/// A texture is about to change, rasterize the queued draws that sample it first
+	void textureChanging(const SoftwareTexture2D* texture);
+
+	/// A texture is being destroyed, rasterize its queued draws and stop sampling it
+	void textureDestroyed(SoftwareTexture2D* texture);
+
+	/// Vertex in clip space, before the perspective divide
+	struct ClipVertex
+	{
+		vec4 position;
+		vec4 color;
+		vec2 uv;
+	};
+
+	/// Render state captured for a group of triangles
+	struct DrawState
+	{
+		const SoftwareTexture2D* texture;
+		Int32                    blendMode;   ///< Render::Blend::Mode, or -1 when blending is disabled
+		bool                     depthTest;
+		IntRect                  bounds;      ///< Pixels the draw may touch, viewport and scissor combined
+	};
+
+	/// Triangle set up for rasterization
+	/// Edge functions use vertices snapped to 1/16 of a pixel, so they are exact and shared edges never overlap
+	struct Triangle
+	{
+		Uint32 state;          ///< Index into mStates
+		int    minX, minY;     ///< Pixel bounds, inclusive
+		int    maxX, maxY;
+		Int64  edges[3][3];    ///< a, b, c of each edge function a * x + b * y + c in subpixels, positive inside
+		Int64  bias[3];        ///< -1 for edges that don't own the pixels exactly on them, 0 for top-left edges
+		float  planes[8][3];   ///< d/dx, d/dy and value at the origin of z, 1/w, rgba/w and uv/w
+	};
+
+	/// Attribute location set with setVertexAttribPointer()
+	struct AttributePointer
+	{
+		bool        enabled;
+		int         numComponents;
+		int         componentType;
+		bool        normalized;
+		int         stride;
+		const char* data;     ///< Client pointer, or byte offset into buffer when there is one
+
+		const SoftwareVertexBuffer* buffer;  ///< Vertex buffer bound when the pointer was set
+
+		/// Read the attribute of vertex index into out, leaving the components it doesn't have
+		void read(std::size_t index, float* out) const;
+	};
+
+	/// Interpolate every attribute between two clip space vertices
+	static ClipVertex interpolate(const ClipVertex& a, const ClipVertex& b, float t);
+
+	/// Capture the current render state for the next triangles, reusing the last one when equal
+	Uint32 captureState();
+
+	/// Read vertex i from the attribute pointers into the scratch array
+	void fetchVertices(std::size_t first, std::size_t count);
+
+	/// Read the vertices of a VertexArray into the scratch array
+	void fetchVertices(const VertexArray& vertexArray);
+
+	/// Assemble the scratch vertices into triangles and queue them, indices are optional
+	void submit(Render::Primitive::Type primitiveType, const Uint16* indices, std::size_t count);
+
+	/// Clip a triangle against the near plane and the guard band, and queue what remains
+	void clipAndQueue(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, Uint32 state);
+
+	/// Project, set up and bin one triangle that is entirely inside the near plane and guard band
+	void setupTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, Uint32 state);
+
+	/// Rasterize every triangle binned into a tile, safe to run for different tiles in parallel
+	void rasterizeTile(std::size_t tileIndex);
+
+	/// Shade and blend one covered pixel
+	void shadePixel(const Triangle& triangle, const DrawState& state, int x, int y);
+
+	/// Drop everything queued
+	void clearQueue();
+
+	/// Check if buffers this device can't read are set, reporting once that the draw is skipped
+	bool usesGpuBuffers(bool indexed);
+
+	int                             mWidth;
+	int                             mHeight;
+	int                             mTilesX;
+	int                             mTilesY;
+	JobSystem                       mJobs;         ///< Rasterizes the tiles, no workers when single threaded
+	std::vector<Uint8>              mColorBuffer;  ///< RGBA, rows from top to bottom
+	std::vector<float>              mDepthBuffer;  ///< Window depth in [0, 1]
+
+	std::vector<DrawState>          mStates;
+	std::vector<Triangle>           mTriangles;
+	std::vector<std::vector<Uint32> > mTileBins;   ///< Triangle indices per tile, in submission order
+	std::vector<ClipVertex>         mVertices;     ///< Scratch for the vertices of the current draw
+
+	AttributePointer                mAttributes[3];
+	const SoftwareVertexBuffer*     mVertexBuffer;       ///< Bound vertex buffer made by this device
+	bool                            mGpuVertexBufferBound; ///< A vertex buffer made by another device is bound
+	const IndexBuffer*              mIndexBuffer;
+	bool                            mWarnedBuffers;  ///< Skipped draws from GPU buffers were already reported
+
+	std::vector<SoftwareTexture2D*> mTextures;   ///< Every texture made by this device that still exists
+	const SoftwareTexture2D*        mTexture;
+	Int32                           mBlendMode;
+	bool                            mBlending;
+	bool                            mDepthTest;
+	IntRect                         mViewport;
+	bool                            mClipping;
+	IntRect                         mClippingRect;
+};
+
+#endif // NephilimPluginGraphicsDeviceSoftware_h__
@@ -164,9 +164,7 @@ void PhysicsSystemPhysX::syncActors()
 					PxController* cc = (PxController*)chr->userData;
 					
 
-					chr->t.position.x = cc->getPosition().x;
-					chr->t.position.y = cc->getPosition().y;
-					chr->t.position.z = cc->getPosition().z;
+					chr->setPosition(cc->getPosition().x, cc->getPosition().y, cc->getPosition().z);
 
 					//Log("Updated actor");
 				}
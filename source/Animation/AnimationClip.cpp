@@ -1,20 +1,62 @@
 #include <Nephilim/Animation/AnimationClip.h>
+#include <Nephilim/Animation/AnimationPose.h>
+
+#include <algorithm>
 
 NEPHILIM_NS_BEGIN
 
+namespace
+{
+	bool keyTimeLess(float t, const AnimationClip::KeyFrame& key)
+	{
+		return t < key.time;
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////// TRACK
 
 /// Get the local track transform at time t
 mat4 AnimationClip::Track::getTransformFromTime(float t)
 {
-	Int32 frameIndex = static_cast<Int32>(t);
-	Int32 nextFrameIndex = (frameIndex + 1) % frames.size();
-	float blend = t - frameIndex;
+	vec3 position, scale;
+	Quat orientation;
+	sample(t, position, orientation, scale);
+
+	return mat4::translate(position) * orientation.toMatrix() * mat4::scale(scale.x, scale.y, scale.z);
+}
+
+/// Sample the track at time t, in seconds, without building a matrix
+void AnimationClip::Track::sample(float t, vec3& position, Quat& orientation, vec3& scale) const
+{
+	if (frames.empty())
+	{
+		position = vec3(0.f, 0.f, 0.f);
+		orientation = Quat();
+		scale = vec3(1.f, 1.f, 1.f);
+		return;
+	}
+
+	// First key after t, the one before it is where we blend from
+	std::vector<KeyFrame>::const_iterator next = std::upper_bound(frames.begin(), frames.end(), t, keyTimeLess);
+	if (next == frames.begin() || next == frames.end())
+	{
+		const KeyFrame& key = (next == frames.begin()) ? frames.front() : frames.back();
+		position = key.position;
+		orientation = key.orientation;
+		scale = key.scale;
+		return;
+	}
 
-	vec3 finalPosition = vec3::lerp(frames[frameIndex].position, frames[nextFrameIndex].position, blend);
-	Quat finalOrientation = Quat::slerp(frames[frameIndex].orientation, frames[nextFrameIndex].orientation, blend);
+	const KeyFrame& a = *(next - 1);
+	const KeyFrame& b = *next;
+	float span = b.time - a.time;
+	float blend = span > 0.f ? (t - a.time) / span : 0.f;
 
-	return (mat4::translate(finalPosition) * finalOrientation.toMatrix());
+	Quat qa = a.orientation;
+	Quat qb = b.orientation;
+	position = vec3::lerp(a.position, b.position, blend);
+	orientation = Quat::slerp(qa, qb, blend);
+	scale = vec3::lerp(a.scale, b.scale, blend);
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -27,6 +69,40 @@ void AnimationClip::getTransformsFromTime(float t, std::vector<mat4>& transforms
 	}
 }
 
+/// Sample every track at time t, in seconds, into pose
+void AnimationClip::sample(float t, AnimationPose& pose) const
+{
+	pose.resize(tracks.size());
+	for (std::size_t i = 0; i < tracks.size(); ++i)
+	{
+		tracks[i].sample(t, pose.translations[i], pose.rotations[i], pose.scales[i]);
+	}
+}
+
+/// Get the time of the last key of the clip, in seconds
+float AnimationClip::getDuration() const
+{
+	float duration = 0.f;
+	for (std::size_t i = 0; i < tracks.size(); ++i)
+	{
+		if (!tracks[i].frames.empty())
+			duration = std::max(duration, tracks[i].frames.back().time);
+	}
+	return duration;
+}
+
+/// Get the number of bytes the clip takes in memory
+std::size_t AnimationClip::getMemoryUsage() const
+{
+	std::size_t bytes = sizeof(AnimationClip) + tracks.capacity() * sizeof(Track);
+	for (std::size_t i = 0; i < tracks.size(); ++i)
+	{
+		bytes += tracks[i].frames.capacity() * sizeof(KeyFrame);
+		bytes += tracks[i].name.capacity();
+	}
+	return bytes;
+}
+
 Int32 AnimationClip::getTrackIndexByName(const String& name)
 {
 	for(std::size_t i = 0; i < tracks.size(); ++i)
@@ -44,4 +120,4 @@ void AnimationClip::clear()
 	tracks.clear();
 }
 
-NEPHILIM_NS_END
\ No newline at end of file
+NEPHILIM_NS_END
@@ -0,0 +1,75 @@
+#include <Nephilim/Animation/AnimationPose.h>
+
+#include <algorithm>
+
+NEPHILIM_NS_BEGIN
+
+/// Resize the pose to count tracks, new tracks start at the identity transform
+void AnimationPose::resize(std::size_t count)
+{
+	translations.resize(count, vec3(0.f, 0.f, 0.f));
+	rotations.resize(count, Quat());
+	scales.resize(count, vec3(1.f, 1.f, 1.f));
+}
+
+/// Get the number of tracks in the pose
+std::size_t AnimationPose::size() const
+{
+	return translations.size();
+}
+
+/// Build the local matrix of one track, translation * rotation * scale
+mat4 AnimationPose::getMatrix(std::size_t index) const
+{
+	Quat rotation = rotations[index];
+	mat4 m = rotation.toMatrix();
+
+	// Scaling on the right only scales the basis columns
+	const vec3& s = scales[index];
+	m[0] *= s.x; m[1] *= s.x; m[2]  *= s.x;
+	m[4] *= s.y; m[5] *= s.y; m[6]  *= s.y;
+	m[8] *= s.z; m[9] *= s.z; m[10] *= s.z;
+
+	const vec3& t = translations[index];
+	m[12] = t.x;
+	m[13] = t.y;
+	m[14] = t.z;
+	return m;
+}
+
+/// Build the local matrices of all tracks into out, which must hold size() matrices
+void AnimationPose::toMatrices(mat4* out) const
+{
+	for (std::size_t i = 0; i < translations.size(); ++i)
+	{
+		out[i] = getMatrix(i);
+	}
+}
+
+/// Blend two poses of the same size into out
+void AnimationPose::blend(const AnimationPose& a, const AnimationPose& b, float weight, AnimationPose& out)
+{
+	const std::size_t count = std::min(a.size(), b.size());
+	out.resize(count);
+
+	const float inverse = 1.f - weight;
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		out.translations[i] = vec3::lerp(a.translations[i], b.translations[i], weight);
+		out.scales[i] = vec3::lerp(a.scales[i], b.scales[i], weight);
+	}
+
+	// Normalized lerp, taking the short way around
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const Quat& qa = a.rotations[i];
+		const Quat& qb = b.rotations[i];
+		float wb = (qa.x * qb.x + qa.y * qb.y + qa.z * qb.z + qa.w * qb.w) < 0.f ? -weight : weight;
+
+		Quat r(qa.x * inverse + qb.x * wb, qa.y * inverse + qb.y * wb, qa.z * inverse + qb.z * wb, qa.w * inverse + qb.w * wb);
+		r.normalize();
+		out.rotations[i] = r;
+	}
+}
+
+NEPHILIM_NS_END
@@ -0,0 +1,510 @@
+#include <Nephilim/Animation/CompressedAnimationClip.h>
+#include <Nephilim/Animation/AnimationClip.h>
+#include <Nephilim/Animation/AnimationPose.h>
+#include <Nephilim/Foundation/Clock.h>
+#include <Nephilim/Foundation/Logging.h>
+
+#include <algorithm>
+#include <cmath>
+
+NEPHILIM_NS_BEGIN
+
+namespace
+{
+	const float Sqrt2 = 1.41421356f;
+	const float TimeScale = 65535.f;
+
+	Uint16 quantize(float value, float bits)
+	{
+		value = std::max(0.f, std::min(1.f, value));
+		return static_cast<Uint16>(value * bits + 0.5f);
+	}
+
+	float vectorError(const vec3& a, const vec3& b)
+	{
+		return std::max(std::fabs(a.x - b.x), std::max(std::fabs(a.y - b.y), std::fabs(a.z - b.z)));
+	}
+
+	vec3 vectorLerp(const vec3& a, const vec3& b, float t)
+	{
+		return vec3::lerp(a, b, t);
+	}
+
+	float rotationError(const Quat& a, const Quat& b)
+	{
+		return std::max(std::max(std::fabs(a.x - b.x), std::fabs(a.y - b.y)), std::max(std::fabs(a.z - b.z), std::fabs(a.w - b.w)));
+	}
+
+	/// Normalized lerp, taking the short way around
+	Quat rotationLerp(const Quat& a, const Quat& b, float t)
+	{
+		float tb = (a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w) < 0.f ? -t : t;
+		float ta = 1.f - t;
+
+		Quat r(a.x * ta + b.x * tb, a.y * ta + b.y * tb, a.z * ta + b.z * tb, a.w * ta + b.w * tb);
+		r.normalize();
+		return r;
+	}
+
+	/// Pick the keys to keep so that interpolating them reproduces every original key within tolerance
+	/// A channel that never leaves the tolerance around its first key keeps only that key
+	template<typename T, typename Lerp, typename Error>
+	void reduceKeys(const std::vector<float>& times, const std::vector<T>& values, float tolerance, Lerp lerp, Error error, std::vector<Uint32>& kept)
+	{
+		kept.clear();
+		if (values.empty())
+			return;
+
+		kept.push_back(0);
+
+		bool constant = true;
+		for (std::size_t i = 1; i < values.size() && constant; ++i)
+			constant = error(values[i], values[0]) <= tolerance;
+		if (constant)
+			return;
+
+		// Grow each segment until one of the keys it skips can't be rebuilt anymore
+		std::size_t start = 0;
+		for (std::size_t end = 2; end < values.size(); ++end)
+		{
+			float span = times[end] - times[start];
+			for (std::size_t k = start + 1; k < end; ++k)
+			{
+				float t = span > 0.f ? (times[k] - times[start]) / span : 0.f;
+				if (error(lerp(values[start], values[end], t), values[k]) > tolerance)
+				{
+					start = end - 1;
+					kept.push_back(static_cast<Uint32>(start));
+					break;
+				}
+			}
+		}
+
+		kept.push_back(static_cast<Uint32>(values.size() - 1));
+	}
+
+	/// Smallest three encoding, the index of the dropped component goes in the top bits of the first two values
+	void encodeRotation(Quat q, Uint16* out)
+	{
+		q.normalize();
+		float c[4] = { q.x, q.y, q.z, q.w };
+
+		int largest = 0;
+		for (int i = 1; i < 4; ++i)
+		{
+			if (std::fabs(c[i]) > std::fabs(c[largest]))
+				largest = i;
+		}
+
+		// q and -q are the same rotation, keep the dropped component positive
+		float sign = c[largest] < 0.f ? -1.f : 1.f;
+
+		int written = 0;
+		for (int i = 0; i < 4; ++i)
+		{
+			if (i != largest)
+				out[written++] = quantize(c[i] * sign * Sqrt2 * 0.5f + 0.5f, 32767.f);
+		}
+
+		out[0] |= static_cast<Uint16>((largest & 1) << 15);
+		out[1] |= static_cast<Uint16>((largest >> 1) << 15);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////// SETTINGS
+
+CompressedAnimationClip::Settings::Settings()
+: translationTolerance(0.001f)
+, rotationTolerance(0.0005f)
+, scaleTolerance(0.001f)
+{
+}
+
+////////////////////////////////////////////////////////////////////////// CACHE
+
+/// Forget the cached keys, the next sample searches them from scratch
+void CompressedAnimationClip::SamplingCache::reset()
+{
+	cursors.clear();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+/// Creates an empty clip
+CompressedAnimationClip::CompressedAnimationClip()
+: mDuration(0.f)
+{
+}
+
+/// Compress clip into this one, replacing its contents
+void CompressedAnimationClip::compress(const AnimationClip& clip, const Settings& settings)
+{
+	clear();
+
+	mDuration = clip.getDuration();
+	mTrackNames.reserve(clip.tracks.size());
+	mChannels.resize(clip.tracks.size() * ChannelsPerTrack);
+
+	std::vector<float> times;
+	std::vector<vec3>  positions;
+	std::vector<Quat>  rotations;
+	std::vector<vec3>  scales;
+	std::vector<Uint32> kept;
+
+	for (std::size_t i = 0; i < clip.tracks.size(); ++i)
+	{
+		const AnimationClip::Track& track = clip.tracks[i];
+		mTrackNames.push_back(track.name);
+
+		times.clear();
+		positions.clear();
+		rotations.clear();
+		scales.clear();
+		for (std::size_t k = 0; k < track.frames.size(); ++k)
+		{
+			times.push_back(track.frames[k].time);
+			positions.push_back(track.frames[k].position);
+			scales.push_back(track.frames[k].scale);
+
+			// Keep neighbouring rotations in the same hemisphere so they compare and interpolate sanely
+			Quat q = track.frames[k].orientation;
+			q.normalize();
+			if (!rotations.empty())
+			{
+				const Quat& p = rotations.back();
+				if (p.x * q.x + p.y * q.y + p.z * q.z + p.w * q.w < 0.f)
+					q = Quat(-q.x, -q.y, -q.z, -q.w);
+			}
+			rotations.push_back(q);
+		}
+
+		// Empty tracks still get one identity key per channel, so sampling never needs to check
+		if (times.empty())
+		{
+			times.push_back(0.f);
+			positions.push_back(vec3(0.f, 0.f, 0.f));
+			rotations.push_back(Quat());
+			scales.push_back(vec3(1.f, 1.f, 1.f));
+		}
+
+		for (int kind = 0; kind < ChannelsPerTrack; ++kind)
+		{
+			Channel& channel = mChannels[i * ChannelsPerTrack + kind];
+			const std::vector<vec3>& vectors = (kind == TranslationChannel) ? positions : scales;
+
+			if (kind == RotationChannel)
+				reduceKeys(times, rotations, settings.rotationTolerance, rotationLerp, rotationError, kept);
+			else
+				reduceKeys(times, vectors, kind == TranslationChannel ? settings.translationTolerance : settings.scaleTolerance, vectorLerp, vectorError, kept);
+
+			channel.firstKey = static_cast<Uint32>(mKeyTimes.size());
+			channel.keyCount = static_cast<Uint32>(kept.size());
+			channel.minimum = vec3(0.f, 0.f, 0.f);
+			channel.extent = vec3(0.f, 0.f, 0.f);
+
+			if (kind != RotationChannel)
+			{
+				vec3 lo = vectors[kept[0]];
+				vec3 hi = lo;
+				for (std::size_t k = 1; k < kept.size(); ++k)
+				{
+					const vec3& v = vectors[kept[k]];
+					lo = vec3(std::min(lo.x, v.x), std::min(lo.y, v.y), std::min(lo.z, v.z));
+					hi = vec3(std::max(hi.x, v.x), std::max(hi.y, v.y), std::max(hi.z, v.z));
+				}
+				channel.minimum = lo;
+				channel.extent = vec3(hi.x - lo.x, hi.y - lo.y, hi.z - lo.z);
+			}
+
+			for (std::size_t k = 0; k < kept.size(); ++k)
+			{
+				mKeyTimes.push_back(mDuration > 0.f ? quantize(times[kept[k]] / mDuration, TimeScale) : 0);
+
+				Uint16 values[3];
+				if (kind == RotationChannel)
+				{
+					encodeRotation(rotations[kept[k]], values);
+				}
+				else
+				{
+					const vec3& v = vectors[kept[k]];
+					values[0] = channel.extent.x > 0.f ? quantize((v.x - channel.minimum.x) / channel.extent.x, 65535.f) : 0;
+					values[1] = channel.extent.y > 0.f ? quantize((v.y - channel.minimum.y) / channel.extent.y, 65535.f) : 0;
+					values[2] = channel.extent.z > 0.f ? quantize((v.z - channel.minimum.z) / channel.extent.z, 65535.f) : 0;
+				}
+				mKeyValues.insert(mKeyValues.end(), values, values + 3);
+			}
+		}
+	}
+}
+
+/// Find the key at or before u, a time in 16 bit units, starting from the cached cursor
+Uint32 CompressedAnimationClip::findKey(const Channel& channel, float u, Uint32* cursor) const
+{
+	const Uint16* times = &mKeyTimes[channel.firstKey];
+	Uint32 key = cursor ? *cursor : 0;
+
+	if (!cursor || key >= channel.keyCount || times[key] > u)
+	{
+		// Jumped backwards or no history, search from scratch
+		const Uint16* next = std::upper_bound(times, times + channel.keyCount, static_cast<Uint16>(u));
+		key = (next == times) ? 0 : static_cast<Uint32>(next - times - 1);
+	}
+	else
+	{
+		// Playing forward, the key is almost always the same or the next one
+		while (key + 1 < channel.keyCount && times[key + 1] <= u)
+			++key;
+	}
+
+	if (cursor)
+		*cursor = key;
+	return key;
+}
+
+/// Decode a vec3 key of a channel
+vec3 CompressedAnimationClip::decodeVector(const Channel& channel, Uint32 key) const
+{
+	const Uint16* v = &mKeyValues[(channel.firstKey + key) * 3];
+	return vec3(channel.minimum.x + channel.extent.x * (v[0] / 65535.f),
+	            channel.minimum.y + channel.extent.y * (v[1] / 65535.f),
+	            channel.minimum.z + channel.extent.z * (v[2] / 65535.f));
+}
+
+/// Decode a rotation key
+Quat CompressedAnimationClip::decodeRotation(Uint32 key) const
+{
+	const Uint16* v = &mKeyValues[key * 3];
+	int largest = (v[0] >> 15) | ((v[1] >> 15) << 1);
+
+	float c[4];
+	float sum = 0.f;
+	int read = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		if (i == largest)
+			continue;
+
+		c[i] = ((v[read++] & 0x7FFF) / 32767.f * 2.f - 1.f) / Sqrt2;
+		sum += c[i] * c[i];
+	}
+	c[largest] = std::sqrt(std::max(0.f, 1.f - sum));
+
+	return Quat(c[0], c[1], c[2], c[3]);
+}
+
+/// Sample every track at time t, in seconds, into pose
+void CompressedAnimationClip::sample(float t, AnimationPose& pose, SamplingCache* cache) const
+{
+	pose.resize(mTrackNames.size());
+
+	if (cache && cache->cursors.size() != mChannels.size())
+		cache->cursors.assign(mChannels.size(), 0);
+
+	float u = mDuration > 0.f ? std::max(0.f, std::min(1.f, t / mDuration)) * TimeScale : 0.f;
+
+	for (std::size_t c = 0; c < mChannels.size(); ++c)
+	{
+		const Channel& channel = mChannels[c];
+		const std::size_t track = c / ChannelsPerTrack;
+		const int kind = static_cast<int>(c % ChannelsPerTrack);
+
+		Uint32 key = 0;
+		float blend = 0.f;
+		if (channel.keyCount > 1)
+		{
+			key = findKey(channel, u, cache ? &cache->cursors[c] : nullptr);
+			if (key + 1 < channel.keyCount)
+			{
+				float t0 = mKeyTimes[channel.firstKey + key];
+				float t1 = mKeyTimes[channel.firstKey + key + 1];
+				blend = t1 > t0 ? std::max(0.f, std::min(1.f, (u - t0) / (t1 - t0))) : 0.f;
+			}
+		}
+
+		if (kind == RotationChannel)
+		{
+			Quat rotation = decodeRotation(channel.firstKey + key);
+			if (blend > 0.f)
+				rotation = rotationLerp(rotation, decodeRotation(channel.firstKey + key + 1), blend);
+			pose.rotations[track] = rotation;
+		}
+		else
+		{
+			vec3 value = decodeVector(channel, key);
+			if (blend > 0.f)
+				value = vec3::lerp(value, decodeVector(channel, key + 1), blend);
+
+			if (kind == TranslationChannel)
+				pose.translations[track] = value;
+			else
+				pose.scales[track] = value;
+		}
+	}
+}
+
+/// Get the number of tracks
+std::size_t CompressedAnimationClip::getTrackCount() const
+{
+	return mTrackNames.size();
+}
+
+/// Get the name of a track
+const String& CompressedAnimationClip::getTrackName(std::size_t index) const
+{
+	return mTrackNames[index];
+}
+
+/// Get the index of a track by its name, or -1
+Int32 CompressedAnimationClip::getTrackIndexByName(const String& name) const
+{
+	for (std::size_t i = 0; i < mTrackNames.size(); ++i)
+	{
+		if (mTrackNames[i] == name)
+			return static_cast<Int32>(i);
+	}
+	return -1;
+}
+
+/// Get the time of the last key of the clip, in seconds
+float CompressedAnimationClip::getDuration() const
+{
+	return mDuration;
+}
+
+/// Get the number of keys kept across all channels
+std::size_t CompressedAnimationClip::getKeyCount() const
+{
+	return mKeyTimes.size();
+}
+
+/// Get the number of bytes the clip takes in memory
+std::size_t CompressedAnimationClip::getMemoryUsage() const
+{
+	std::size_t bytes = sizeof(CompressedAnimationClip);
+	bytes += mTrackNames.capacity() * sizeof(String);
+	bytes += mChannels.capacity() * sizeof(Channel);
+	bytes += mKeyTimes.capacity() * sizeof(Uint16);
+	bytes += mKeyValues.capacity() * sizeof(Uint16);
+	for (std::size_t i = 0; i < mTrackNames.size(); ++i)
+		bytes += mTrackNames[i].capacity();
+	return bytes;
+}
+
+/// Release everything
+void CompressedAnimationClip::clear()
+{
+	mTrackNames.clear();
+	mChannels.clear();
+	mKeyTimes.clear();
+	mKeyValues.clear();
+	mDuration = 0.f;
+}
+
+namespace
+{
+	/// A clip with the mix of channels a character rig has: some bones still, most rotating, a few moving
+	void makeBenchmarkClip(AnimationClip& clip, std::size_t trackCount, std::size_t keyCount)
+	{
+		clip.tracks.resize(trackCount);
+		clip.playbackFramesPerSecond = 30;
+		clip.numFrames = static_cast<Int32>(keyCount);
+
+		for (std::size_t i = 0; i < trackCount; ++i)
+		{
+			AnimationClip::Track& track = clip.tracks[i];
+			track.name = "bone" + String::number(static_cast<int>(i));
+			track.frames.resize(keyCount);
+
+			const float phase = static_cast<float>(i) * 0.37f;
+			vec3 axis(std::sin(phase), std::cos(phase), 0.5f);
+			axis.normalize();
+			for (std::size_t k = 0; k < keyCount; ++k)
+			{
+				AnimationClip::KeyFrame& key = track.frames[k];
+				const float t = static_cast<float>(k) / 30.f;
+
+				key.time = t;
+				key.position = vec3(static_cast<float>(i), 0.f, 0.f);
+				if (i % 4 == 0)
+					key.position.y = std::sin(t * 2.f + phase) * 10.f;
+				key.scale = vec3(1.f, 1.f, 1.f);
+				if (i % 3 == 0)
+					key.orientation = Quat();
+				else
+					Quat::fromAxisAngle(key.orientation, axis, std::sin(t * 3.f + phase));
+			}
+		}
+	}
+
+	/// Microseconds per pose, since the clock was reset
+	double perSample(Clock& clock, std::size_t samples)
+	{
+		double elapsed = static_cast<double>(clock.getElapsedTime().microseconds());
+		clock.reset();
+		return elapsed / static_cast<double>(samples > 0 ? samples : 1);
+	}
+}
+
+/// Log the memory of a compressed clip against the raw one, and how long sampling a pose takes with each
+void CompressedAnimationClip::benchmark(std::size_t tracks, std::size_t keys, std::size_t samples)
+{
+	if (tracks == 0 || keys < 2 || samples == 0)
+		return;
+
+	AnimationClip clip;
+	makeBenchmarkClip(clip, tracks, keys);
+
+	Clock clock;
+	CompressedAnimationClip compressed;
+	compressed.compress(clip);
+	const double compressTime = static_cast<double>(clock.getElapsedTime().microseconds()) / 1000.0;
+
+	// Play the clip forward once, as an instance would
+	const float duration = clip.getDuration();
+	AnimationPose rawPose, pose;
+	SamplingCache cache;
+	float sum = 0.f, largestError = 0.f;
+
+	clock.reset();
+	for (std::size_t s = 0; s < samples; ++s)
+	{
+		clip.sample(duration * static_cast<float>(s) / static_cast<float>(samples), rawPose);
+		sum += rawPose.translations[s % tracks].y;
+	}
+	const double rawTime = perSample(clock, samples);
+
+	for (std::size_t s = 0; s < samples; ++s)
+	{
+		compressed.sample(duration * static_cast<float>(s) / static_cast<float>(samples), pose);
+		sum += pose.translations[s % tracks].y;
+	}
+	const double searchTime = perSample(clock, samples);
+
+	for (std::size_t s = 0; s < samples; ++s)
+	{
+		compressed.sample(duration * static_cast<float>(s) / static_cast<float>(samples), pose, &cache);
+		sum += pose.translations[s % tracks].y;
+	}
+	const double cachedTime = perSample(clock, samples);
+
+	// Outside the timed loops, how far the compressed poses drift from the raw ones
+	cache.reset();
+	for (std::size_t s = 0; s < samples; s += std::max<std::size_t>(1, samples / 100))
+	{
+		const float t = duration * static_cast<float>(s) / static_cast<float>(samples);
+		clip.sample(t, rawPose);
+		compressed.sample(t, pose);
+		for (std::size_t i = 0; i < tracks; ++i)
+			largestError = std::max(largestError, vectorError(rawPose.translations[i], pose.translations[i]));
+	}
+
+	Log("CompressedAnimationClip: %u tracks of %u keys, compressed in %.2f ms", static_cast<unsigned int>(tracks), static_cast<unsigned int>(keys), compressTime);
+	Log("  memory: raw %u bytes, compressed %u bytes, %u of %u keys kept",
+		static_cast<unsigned int>(clip.getMemoryUsage()), static_cast<unsigned int>(compressed.getMemoryUsage()),
+		static_cast<unsigned int>(compressed.getKeyCount()), static_cast<unsigned int>(tracks * keys * ChannelsPerTrack));
+	Log("  time per pose: raw %.3f us, compressed %.3f us, compressed with cache %.3f us", rawTime, searchTime, cachedTime);
+	Log("  largest translation error %g (checksum %.0f)", largestError, sum);
+}
+
+NEPHILIM_NS_END
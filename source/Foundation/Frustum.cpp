@@ -0,0 +1,87 @@
+#include <Nephilim/Foundation/Frustum.h>
+
+#include <cmath>
+
+NEPHILIM_NS_BEGIN
+
+/// Creates a frustum that contains everything
+Frustum::Frustum()
+{
+	for (int i = 0; i < PlaneCount; ++i)
+	{
+		planes[i] = vec4(0.f, 0.f, 0.f, 1.f);
+	}
+}
+
+/// Extract the planes of a projection * view (* model) matrix
+Frustum::Frustum(const mat4& clipMatrix)
+{
+	setFromMatrix(clipMatrix);
+}
+
+/// Extract the planes of a projection * view (* model) matrix
+void Frustum::setFromMatrix(const mat4& m)
+{
+	// Rows of the matrix, which is stored by columns
+	vec4 row0(m[0], m[4], m[8],  m[12]);
+	vec4 row1(m[1], m[5], m[9],  m[13]);
+	vec4 row2(m[2], m[6], m[10], m[14]);
+	vec4 row3(m[3], m[7], m[11], m[15]);
+
+	planes[Left]   = vec4(row3.x + row0.x, row3.y + row0.y, row3.z + row0.z, row3.w + row0.w);
+	planes[Right]  = vec4(row3.x - row0.x, row3.y - row0.y, row3.z - row0.z, row3.w - row0.w);
+	planes[Bottom] = vec4(row3.x + row1.x, row3.y + row1.y, row3.z + row1.z, row3.w + row1.w);
+	planes[Top]    = vec4(row3.x - row1.x, row3.y - row1.y, row3.z - row1.z, row3.w - row1.w);
+	planes[Near]   = vec4(row3.x + row2.x, row3.y + row2.y, row3.z + row2.z, row3.w + row2.w);
+	planes[Far]    = vec4(row3.x - row2.x, row3.y - row2.y, row3.z - row2.z, row3.w - row2.w);
+
+	// Normalized planes give real distances, handy for sphere tests later on
+	for (int i = 0; i < PlaneCount; ++i)
+	{
+		float length = std::sqrt(planes[i].x * planes[i].x + planes[i].y * planes[i].y + planes[i].z * planes[i].z);
+		if (length > 0.f)
+		{
+			planes[i].x /= length;
+			planes[i].y /= length;
+			planes[i].z /= length;
+			planes[i].w /= length;
+		}
+	}
+}
+
+/// Check if the point is inside the frustum
+bool Frustum::contains(const vec3& point) const
+{
+	for (int i = 0; i < PlaneCount; ++i)
+	{
+		if (planes[i].x * point.x + planes[i].y * point.y + planes[i].z * point.z + planes[i].w < 0.f)
+			return false;
+	}
+	return true;
+}
+
+/// Check if any part of the axis aligned box between minimum and maximum may be visible
+bool Frustum::intersects(const vec3& minimum, const vec3& maximum) const
+{
+	for (int i = 0; i < PlaneCount; ++i)
+	{
+		const vec4& p = planes[i];
+
+		// The corner furthest along the plane normal, if even that one is behind the plane, the box is out
+		float x = p.x >= 0.f ? maximum.x : minimum.x;
+		float y = p.y >= 0.f ? maximum.y : minimum.y;
+		float z = p.z >= 0.f ? maximum.z : minimum.z;
+
+		if (p.x * x + p.y * y + p.z * z + p.w < 0.f)
+			return false;
+	}
+	return true;
+}
+
+/// Check if any part of the box may be visible
+bool Frustum::intersects(const BBox& box) const
+{
+	return intersects(box.parameters[0], box.parameters[1]);
+}
+
+NEPHILIM_NS_END
@@ -201,6 +201,30 @@ bool Image::loadFromStream(File* stream){
 	return true;
 }
 
+/// Attempts to decode an image file already in memory, like a view into a package
+bool Image::loadFromMemory(const void* data, std::size_t size)
+{
+	m_pixels.clear();
+
+	int width, height, channels;
+	unsigned char* ptr = stbi_load_from_memory(static_cast<const stbi_uc*>(data), static_cast<int>(size), &width, &height, &channels, STBI_rgb_alpha);
+
+	if (ptr && width && height)
+	{
+		m_size.x = width;
+		m_size.y = height;
+
+		m_pixels.resize(width * height * 4);
+		memcpy(&m_pixels[0], ptr, m_pixels.size());
+
+		stbi_image_free(ptr);
+		return true;
+	}
+
+	Log("Failed to load image from memory. Reason : %s", stbi_failure_reason());
+	return false;
+}
+
 void Image::create(unsigned int width, unsigned int height,const Uint8* pixels){
 
 	m_pixels.resize(width*height*4);
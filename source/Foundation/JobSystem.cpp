@@ -0,0 +1,272 @@
+#include <Nephilim/Foundation/JobSystem.h>
+#include <Nephilim/Foundation/Profiler.h>
+
+NEPHILIM_NS_BEGIN
+
+namespace
+{
+	/// The job system and worker index of the calling thread, if it is a worker
+	thread_local const JobSystem* tCurrentSystem = nullptr;
+	thread_local int              tCurrentWorker = -1;
+}
+
+/// Creates the job system with no workers
+JobSystem::JobSystem()
+: mQueued(0)
+, mRunning(false)
+{
+}
+
+/// Stops the workers, running whatever is still queued
+JobSystem::~JobSystem()
+{
+	stop();
+}
+
+/// Launch the workers, by default one per core besides the calling thread
+void JobSystem::start(std::size_t workerCount)
+{
+	if (mRunning)
+		return;
+
+	if (workerCount == 0)
+	{
+		unsigned int cores = std::thread::hardware_concurrency();
+		workerCount = cores > 1 ? cores - 1 : 1;
+	}
+
+	// Every deque exists before any worker may try to steal from it
+	for (std::size_t i = 0; i < workerCount; ++i)
+	{
+		mWorkers.push_back(std::unique_ptr<Worker>(new Worker()));
+	}
+
+	mRunning = true;
+	for (std::size_t i = 0; i < mWorkers.size(); ++i)
+	{
+		mWorkers[i]->thread = std::thread(&JobSystem::workerMain, this, i);
+	}
+}
+
+/// Finish all queued jobs and join the workers
+void JobSystem::stop()
+{
+	if (mRunning)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mSleepMutex);
+			mRunning = false;
+		}
+		mWakeUp.notify_all();
+
+		for (std::size_t i = 0; i < mWorkers.size(); ++i)
+		{
+			mWorkers[i]->thread.join();
+		}
+	}
+
+	// Anything left over still runs, somebody may be waiting for it
+	while (JobHandle job = takeJob(-1))
+	{
+		execute(job);
+	}
+
+	mWorkers.clear();
+}
+
+/// Check if there are workers running
+bool JobSystem::isRunning() const
+{
+	return mRunning;
+}
+
+/// Get the number of worker threads
+std::size_t JobSystem::getWorkerCount() const
+{
+	return mWorkers.size();
+}
+
+/// Create a job without scheduling it, so dependencies can be added before submit()
+JobSystem::JobHandle JobSystem::createJob(const Task& task)
+{
+	JobHandle job = std::make_shared<Job>();
+	job->task = task;
+	job->blockers = 1;
+	job->finished = false;
+	return job;
+}
+
+/// Make job wait for prerequisite to finish, must be called before job is submitted
+void JobSystem::addDependency(const JobHandle& job, const JobHandle& prerequisite)
+{
+	std::lock_guard<std::mutex> lock(prerequisite->mutex);
+	if (!prerequisite->finished)
+	{
+		++job->blockers;
+		prerequisite->dependents.push_back(job);
+	}
+}
+
+/// Schedule a job, it runs as soon as its prerequisites are done
+void JobSystem::submit(const JobHandle& job)
+{
+	if (--job->blockers == 0)
+	{
+		enqueue(job);
+	}
+}
+
+/// Create and schedule a job with no dependencies
+JobSystem::JobHandle JobSystem::run(const Task& task)
+{
+	JobHandle job = createJob(task);
+	submit(job);
+	return job;
+}
+
+/// Block until the job finished, running other jobs meanwhile
+void JobSystem::wait(const JobHandle& job)
+{
+	const int worker = currentWorker();
+	while (!job->finished)
+	{
+		JobHandle other = takeJob(worker);
+		if (other)
+			execute(other);
+		else
+			std::this_thread::yield();
+	}
+}
+
+/// Block until all the jobs finished, running other jobs meanwhile
+void JobSystem::wait(const std::vector<JobHandle>& jobs)
+{
+	for (std::size_t i = 0; i < jobs.size(); ++i)
+	{
+		wait(jobs[i]);
+	}
+}
+
+/// Queue a job whose prerequisites are all done
+void JobSystem::enqueue(const JobHandle& job)
+{
+	const int worker = currentWorker();
+	if (worker >= 0)
+	{
+		std::lock_guard<std::mutex> lock(mWorkers[worker]->mutex);
+		mWorkers[worker]->jobs.push_back(job);
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock(mSharedMutex);
+		mShared.push_back(job);
+	}
+
+	++mQueued;
+
+	// Taking the lock orders this against a worker about to sleep, so the wake up isn't lost
+	{
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+	}
+	mWakeUp.notify_one();
+}
+
+/// Get the next job for a worker, or for any other thread with worker -1
+JobSystem::JobHandle JobSystem::takeJob(int worker)
+{
+	JobHandle job;
+
+	if (worker >= 0)
+	{
+		std::lock_guard<std::mutex> lock(mWorkers[worker]->mutex);
+		if (!mWorkers[worker]->jobs.empty())
+		{
+			job = mWorkers[worker]->jobs.back();
+			mWorkers[worker]->jobs.pop_back();
+		}
+	}
+
+	if (!job)
+	{
+		std::lock_guard<std::mutex> lock(mSharedMutex);
+		if (!mShared.empty())
+		{
+			job = mShared.front();
+			mShared.pop_front();
+		}
+	}
+
+	// Steal the oldest job of someone else, starting from the next worker so thieves spread out
+	const std::size_t workerCount = mWorkers.size();
+	for (std::size_t i = 1; !job && i <= workerCount; ++i)
+	{
+		Worker& victim = *mWorkers[(worker + i) % workerCount];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty())
+		{
+			job = victim.jobs.front();
+			victim.jobs.pop_front();
+		}
+	}
+
+	if (job)
+		--mQueued;
+
+	return job;
+}
+
+/// Run a job and release the jobs that were waiting on it
+void JobSystem::execute(const JobHandle& job)
+{
+	if (job->task)
+		job->task();
+
+	std::vector<JobHandle> dependents;
+	{
+		std::lock_guard<std::mutex> lock(job->mutex);
+		job->finished = true;
+		dependents.swap(job->dependents);
+	}
+
+	for (std::size_t i = 0; i < dependents.size(); ++i)
+	{
+		if (--dependents[i]->blockers == 0)
+			enqueue(dependents[i]);
+	}
+}
+
+/// Main loop of the worker threads
+void JobSystem::workerMain(std::size_t index)
+{
+	tCurrentSystem = this;
+	tCurrentWorker = static_cast<int>(index);
+
+	Profiler::setThreadName("Worker " + String::number(static_cast<int>(index)));
+
+	while (true)
+	{
+		JobHandle job = takeJob(tCurrentWorker);
+		if (job)
+		{
+			execute(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(mSleepMutex);
+		if (!mRunning)
+			break;
+
+		mWakeUp.wait(lock, [this]() { return mQueued > 0 || !mRunning; });
+	}
+
+	tCurrentSystem = nullptr;
+	tCurrentWorker = -1;
+}
+
+/// Get the index of the worker running on the calling thread, or -1
+int JobSystem::currentWorker() const
+{
+	return tCurrentSystem == this ? tCurrentWorker : -1;
+}
+
+NEPHILIM_NS_END
@@ -1,8 +1,19 @@
 #include <Nephilim/Foundation/Matrix.h>
+#include <Nephilim/Foundation/Quat.h>
 #include <Nephilim/Foundation/Math.h>
+#include <Nephilim/Foundation/Clock.h>
 #include <Nephilim/Foundation/Logging.h>
 #include <math.h>
 
+#include <algorithm>
+#include <vector>
+
+#if defined NEPHILIM_SIMD_SSE
+	#include <xmmintrin.h>
+#elif defined NEPHILIM_SIMD_NEON
+	#include <arm_neon.h>
+#endif
+
 NEPHILIM_NS_BEGIN
 
 #include <stdio.h>
@@ -16,7 +27,7 @@ void debugPrint(mat4& m)
 
 const mat4 mat4::identity = mat4();
 
-float m3_det( mat3 mat )
+float m3_det( const mat3& mat )
 {
 	float det;
 
@@ -27,7 +38,7 @@ float m3_det( mat3 mat )
 	return( det );
 }
 
-void m4_submat( mat4 mr, mat3& mb, int i, int j )
+void m4_submat( const mat4& mr, mat3& mb, int i, int j )
 {
 	int ti, tj, idst, jdst;
 
@@ -53,7 +64,7 @@ void m4_submat( mat4 mr, mat3& mb, int i, int j )
 	}
 }
 
-float m4_det( mat4 mr )
+float m4_det( const mat4& mr )
 {
 	// test this det now
 	/*float det2 = mr[0] * (mr[15] * mr[5] - mr[7] * mr[13]) -
@@ -76,7 +87,7 @@ float m4_det( mat4 mr )
 	return( result );
 }
 
-int m4_inverse( mat4& mr, mat4 ma )
+int m4_inverse( mat4& mr, const mat4& ma )
 {
 	mr = mat4::identity; // start as identity then store the inversion
 
@@ -171,7 +182,7 @@ const float* mat4::get() const
 }
 
 /// Get the determinant of the 4x4 matrix
-float mat4::determinant()
+float mat4::determinant() const
 {
 	return m4_det(*this);
 }
@@ -251,13 +262,111 @@ mat4 mat4::operator*(float scalar)
 				 m_matrix[3] * scalar, m_matrix[7] * scalar, m_matrix[11] * scalar, m_matrix[15] * scalar);
 }
 
+namespace
+{
+	/// out = a * b on raw column arrays, the plain C++ the kernels are checked against
+	void multiplyMatricesScalar(const float* a, const float* b, float* out)
+	{
+		float r[16];
+		for (int j = 0; j < 4; ++j)
+		{
+			for (int i = 0; i < 4; ++i)
+			{
+				r[j * 4 + i] = a[i] * b[j * 4] + a[4 + i] * b[j * 4 + 1] + a[8 + i] * b[j * 4 + 2] + a[12 + i] * b[j * 4 + 3];
+			}
+		}
+		for (int i = 0; i < 16; ++i)
+			out[i] = r[i];
+	}
+
+	/// out = m * v on raw arrays, the plain C++ the kernels are checked against
+	void transformVectorScalar(const float* m, const float* v, float* out)
+	{
+		float x = v[0], y = v[1], z = v[2], w = v[3];
+		out[0] = m[0]*x + m[4]*y + m[8]*z + m[12]*w;
+		out[1] = m[1]*x + m[5]*y + m[9]*z + m[13]*w;
+		out[2] = m[2]*x + m[6]*y + m[10]*z + m[14]*w;
+		out[3] = m[3]*x + m[7]*y + m[11]*z + m[15]*w;
+	}
+
+	/// out = a * b, the plain C++ Quat::multiply is checked against
+	void multiplyQuatsScalar(const Quat& a, const Quat& b, Quat& out)
+	{
+		Quat r;
+		r.w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
+		r.x = a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y;
+		r.y = a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x;
+		r.z = a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w;
+		out = r;
+	}
+
+	/// out = a * b on raw column arrays
+	/// out may alias a or b: a is fully read first and each column of b is read before its result column is stored
+	inline void multiplyMatrices(const float* a, const float* b, float* out)
+	{
+#if defined NEPHILIM_SIMD_SSE
+		__m128 c0 = _mm_loadu_ps(a);
+		__m128 c1 = _mm_loadu_ps(a + 4);
+		__m128 c2 = _mm_loadu_ps(a + 8);
+		__m128 c3 = _mm_loadu_ps(a + 12);
+
+		// Each result column is the columns of a weighted by one column of b
+		for (int j = 0; j < 4; ++j)
+		{
+			const float* bj = b + j * 4;
+			__m128 r = _mm_mul_ps(c0, _mm_set1_ps(bj[0]));
+			r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(bj[1])));
+			r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(bj[2])));
+			r = _mm_add_ps(r, _mm_mul_ps(c3, _mm_set1_ps(bj[3])));
+			_mm_storeu_ps(out + j * 4, r);
+		}
+#elif defined NEPHILIM_SIMD_NEON
+		float32x4_t c0 = vld1q_f32(a);
+		float32x4_t c1 = vld1q_f32(a + 4);
+		float32x4_t c2 = vld1q_f32(a + 8);
+		float32x4_t c3 = vld1q_f32(a + 12);
+
+		for (int j = 0; j < 4; ++j)
+		{
+			const float* bj = b + j * 4;
+			float32x4_t r = vmulq_n_f32(c0, bj[0]);
+			r = vmlaq_n_f32(r, c1, bj[1]);
+			r = vmlaq_n_f32(r, c2, bj[2]);
+			r = vmlaq_n_f32(r, c3, bj[3]);
+			vst1q_f32(out + j * 4, r);
+		}
+#else
+		multiplyMatricesScalar(a, b, out);
+#endif
+	}
+
+	/// out = m * v on raw arrays, out may alias v
+	inline void transformVector(const float* m, const float* v, float* out)
+	{
+#if defined NEPHILIM_SIMD_SSE
+		__m128 r = _mm_mul_ps(_mm_loadu_ps(m), _mm_set1_ps(v[0]));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(m + 4), _mm_set1_ps(v[1])));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(m + 8), _mm_set1_ps(v[2])));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(m + 12), _mm_set1_ps(v[3])));
+		_mm_storeu_ps(out, r);
+#elif defined NEPHILIM_SIMD_NEON
+		float32x4_t r = vmulq_n_f32(vld1q_f32(m), v[0]);
+		r = vmlaq_n_f32(r, vld1q_f32(m + 4), v[1]);
+		r = vmlaq_n_f32(r, vld1q_f32(m + 8), v[2]);
+		r = vmlaq_n_f32(r, vld1q_f32(m + 12), v[3]);
+		vst1q_f32(out, r);
+#else
+		transformVectorScalar(m, v, out);
+#endif
+	}
+}
+
 /// Multiply the matrix by a vector
 vec4 mat4::operator*(const vec4& v) const
 {
-	return vec4(	m_matrix[0]*v.x + m_matrix[4]*v.y + m_matrix[8]*v.z + m_matrix[12]*v.w,
-					m_matrix[1]*v.x + m_matrix[5]*v.y + m_matrix[9]*v.z + m_matrix[13]*v.w,
-					m_matrix[2]*v.x + m_matrix[6]*v.y + m_matrix[10]*v.z + m_matrix[14]*v.w,
-					m_matrix[3]*v.x + m_matrix[7]*v.y + m_matrix[11]*v.z + m_matrix[15]*v.w);
+	vec4 r;
+	transformVector(m_matrix, &v.x, &r.x);
+	return r;
 }
 
 /// Multiply the 4x4 matrix by a vec3. W component is assumed to be 1.0
@@ -269,26 +378,78 @@ vec3 mat4::operator*(const vec3& v) const
 
 /// Multiply two 4x4 matrices
 mat4 mat4::operator*(const mat4& m) const
-{	
-	return mat4 ( m_matrix[0]*m[0] + m_matrix[4]*m[1] + m_matrix[8]*m[2] + m_matrix[12]*m[3],
-				  m_matrix[0]*m[4] + m_matrix[4]*m[5] + m_matrix[8]*m[6] + m_matrix[12]*m[7],
-				  m_matrix[0]*m[8] + m_matrix[4]*m[9] + m_matrix[8]*m[10] + m_matrix[12]*m[11],
-				  m_matrix[0]*m[12] + m_matrix[4]*m[13] + m_matrix[8]*m[14] + m_matrix[12]*m[15],
+{
+	mat4 r;
+	multiplyMatrices(m_matrix, m.m_matrix, r.m_matrix);
+	return r;
+}
 
-				  m_matrix[1]*m[0] + m_matrix[5]*m[1] + m_matrix[9]*m[2] + m_matrix[13]*m[3],
-				  m_matrix[1]*m[4] + m_matrix[5]*m[5] + m_matrix[9]*m[6] + m_matrix[13]*m[7],
-				  m_matrix[1]*m[8] + m_matrix[5]*m[9] + m_matrix[9]*m[10] + m_matrix[13]*m[11],
-				  m_matrix[1]*m[12] + m_matrix[5]*m[13] + m_matrix[9]*m[14] + m_matrix[13]*m[15],
+/// Compute out = a * b without temporaries, out may be the same as a or b
+void mat4::multiply(const mat4& a, const mat4& b, mat4& out)
+{
+	multiplyMatrices(a.m_matrix, b.m_matrix, out.m_matrix);
+}
 
-				  m_matrix[2]*m[0] + m_matrix[6]*m[1] + m_matrix[10]*m[2] + m_matrix[14]*m[3],
-				  m_matrix[2]*m[4] + m_matrix[6]*m[5] + m_matrix[10]*m[6] + m_matrix[14]*m[7],
-				  m_matrix[2]*m[8] + m_matrix[6]*m[9] + m_matrix[10]*m[10] + m_matrix[14]*m[11],
-				  m_matrix[2]*m[12] + m_matrix[6]*m[13] + m_matrix[10]*m[14] + m_matrix[14]*m[15],
+/// Compute out[i] = a[i] * b[i] for count pairs of matrices, out may alias a or b
+void mat4::multiply(const mat4* a, const mat4* b, mat4* out, std::size_t count)
+{
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		multiply(a[i], b[i], out[i]);
+	}
+}
 
-				  m_matrix[3]*m[0] + m_matrix[7]*m[1] + m_matrix[11]*m[2] + m_matrix[15]*m[3],
-				  m_matrix[3]*m[4] + m_matrix[7]*m[5] + m_matrix[11]*m[6] + m_matrix[15]*m[7],
-				  m_matrix[3]*m[8] + m_matrix[7]*m[9] + m_matrix[11]*m[10] + m_matrix[15]*m[11],
-				  m_matrix[3]*m[12] + m_matrix[7]*m[13] + m_matrix[11]*m[14] + m_matrix[15]*m[15]  );
+/// Compute out[i] = a * b[i] for count matrices, out may alias b
+void mat4::multiply(const mat4& a, const mat4* b, mat4* out, std::size_t count)
+{
+	// Keep a local copy in case a lives inside the output range
+	mat4 ac = a;
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		multiply(ac, b[i], out[i]);
+	}
+}
+
+/// Compute out[i] = m * in[i] for count vectors, out may alias in
+void mat4::transform(const mat4& m, const vec4* in, vec4* out, std::size_t count)
+{
+#if defined NEPHILIM_SIMD_SSE
+	// Columns stay in registers for the whole batch
+	__m128 c0 = _mm_loadu_ps(m.m_matrix);
+	__m128 c1 = _mm_loadu_ps(m.m_matrix + 4);
+	__m128 c2 = _mm_loadu_ps(m.m_matrix + 8);
+	__m128 c3 = _mm_loadu_ps(m.m_matrix + 12);
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const float* v = &in[i].x;
+		__m128 r = _mm_mul_ps(c0, _mm_set1_ps(v[0]));
+		r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(v[1])));
+		r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(v[2])));
+		r = _mm_add_ps(r, _mm_mul_ps(c3, _mm_set1_ps(v[3])));
+		_mm_storeu_ps(&out[i].x, r);
+	}
+#elif defined NEPHILIM_SIMD_NEON
+	float32x4_t c0 = vld1q_f32(m.m_matrix);
+	float32x4_t c1 = vld1q_f32(m.m_matrix + 4);
+	float32x4_t c2 = vld1q_f32(m.m_matrix + 8);
+	float32x4_t c3 = vld1q_f32(m.m_matrix + 12);
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const float* v = &in[i].x;
+		float32x4_t r = vmulq_n_f32(c0, v[0]);
+		r = vmlaq_n_f32(r, c1, v[1]);
+		r = vmlaq_n_f32(r, c2, v[2]);
+		r = vmlaq_n_f32(r, c3, v[3]);
+		vst1q_f32(&out[i].x, r);
+	}
+#else
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		transformVector(m.m_matrix, &in[i].x, &out[i].x);
+	}
+#endif
 }
 
 /// Invert the matrix
@@ -678,4 +839,190 @@ float& mat3::operator[](unsigned int index)
 	return m_matrix[index];
 }
 
+namespace
+{
+#if defined NEPHILIM_SIMD_SSE
+	const char* const kernelName = "SSE";
+#elif defined NEPHILIM_SIMD_NEON
+	const char* const kernelName = "NEON";
+#else
+	const char* const kernelName = "scalar";
+#endif
+
+	/// Repeatable numbers in [-1, 1], so every run checks the same products
+	float nextUnit(Uint32& state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return static_cast<float>(state & 0xFFFF) / 32767.5f - 1.f;
+	}
+
+	/// Difference between a result and the scalar one, relative to the scalar one past 1
+	float difference(const float* result, const float* expected, int count)
+	{
+		float largest = 0.f;
+		for (int i = 0; i < count; ++i)
+		{
+			float d = fabs(result[i] - expected[i]) / std::max(1.f, static_cast<float>(fabs(expected[i])));
+			largest = std::max(largest, d);
+		}
+		return largest;
+	}
+
+	/// Nanoseconds per operation, since the clock was reset
+	double perOperation(Clock& clock, std::size_t operations)
+	{
+		double elapsed = static_cast<double>(clock.getElapsedTime().microseconds());
+		clock.reset();
+		return elapsed * 1000.0 / static_cast<double>(operations > 0 ? operations : 1);
+	}
+
+	/// Random operands for count products of each kind
+	struct KernelInputs
+	{
+		explicit KernelInputs(std::size_t count)
+		: matrices(count * 2)
+		, vectors(count)
+		, quats(count * 2)
+		{
+			Uint32 state = 0x9E3779B9;
+			for (std::size_t i = 0; i < matrices.size(); ++i)
+				for (int j = 0; j < 16; ++j)
+					matrices[i][j] = nextUnit(state);
+			for (std::size_t i = 0; i < vectors.size(); ++i)
+				vectors[i] = vec4(nextUnit(state), nextUnit(state), nextUnit(state), nextUnit(state));
+			for (std::size_t i = 0; i < quats.size(); ++i)
+			{
+				quats[i] = Quat(nextUnit(state), nextUnit(state), nextUnit(state), nextUnit(state));
+				quats[i].normalize();
+			}
+		}
+
+		std::vector<mat4> matrices;  ///< Left operands first, then right ones
+		std::vector<vec4> vectors;
+		std::vector<Quat> quats;     ///< Left operands first, then right ones
+	};
+}
+
+/// Log how long mat4 and Quat products take with the scalar code and with the kernels in use
+void benchmarkMathKernels(std::size_t count, std::size_t rounds)
+{
+	if (count == 0 || rounds == 0)
+		return;
+
+	KernelInputs inputs(count);
+	const mat4* a = &inputs.matrices[0];
+	const mat4* b = &inputs.matrices[count];
+	const Quat* qa = &inputs.quats[0];
+	const Quat* qb = &inputs.quats[count];
+	std::vector<mat4> matrices(count);
+	std::vector<vec4> vectors(count);
+	std::vector<Quat> quats(count);
+
+	double scalarMatrices = 0.0, kernelMatrices = 0.0;
+	double scalarVectors = 0.0, kernelVectors = 0.0;
+	double scalarQuats = 0.0, kernelQuats = 0.0;
+	float sum = 0.f;
+
+	for (std::size_t round = 0; round < rounds; ++round)
+	{
+		Clock clock;
+		for (std::size_t i = 0; i < count; ++i)
+			multiplyMatricesScalar(a[i].get(), b[i].get(), &matrices[i][0]);
+		scalarMatrices += perOperation(clock, count);
+		sum += matrices[round % count][0];
+
+		mat4::multiply(a, b, &matrices[0], count);
+		kernelMatrices += perOperation(clock, count);
+		sum += matrices[round % count][0];
+
+		for (std::size_t i = 0; i < count; ++i)
+			transformVectorScalar(a[0].get(), &inputs.vectors[i].x, &vectors[i].x);
+		scalarVectors += perOperation(clock, count);
+		sum += vectors[round % count].x;
+
+		mat4::transform(a[0], &inputs.vectors[0], &vectors[0], count);
+		kernelVectors += perOperation(clock, count);
+		sum += vectors[round % count].x;
+
+		for (std::size_t i = 0; i < count; ++i)
+			multiplyQuatsScalar(qa[i], qb[i], quats[i]);
+		scalarQuats += perOperation(clock, count);
+		sum += quats[round % count].w;
+
+		Quat::multiply(qa, qb, &quats[0], count);
+		kernelQuats += perOperation(clock, count);
+		sum += quats[round % count].w;
+	}
+
+	const double n = static_cast<double>(rounds);
+	Log("Math kernels (%s): %u products, %u rounds, time per product", kernelName, static_cast<unsigned int>(count), static_cast<unsigned int>(rounds));
+	Log("  mat4 * mat4: scalar %.2f ns, kernel %.2f ns", scalarMatrices / n, kernelMatrices / n);
+	Log("  mat4 * vec4: scalar %.2f ns, kernel %.2f ns", scalarVectors / n, kernelVectors / n);
+	Log("  Quat * Quat: scalar %.2f ns, kernel %.2f ns (checksum %.0f)", scalarQuats / n, kernelQuats / n, sum);
+}
+
+/// Check that the kernels in use give the same products as the scalar code, within epsilon
+bool verifyMathKernels(float epsilon)
+{
+	const std::size_t count = 1000;
+	KernelInputs inputs(count);
+	float matrixError = 0.f, vectorError = 0.f, quatError = 0.f;
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const mat4& a = inputs.matrices[i];
+		const mat4& b = inputs.matrices[count + i];
+
+		mat4 expected, result;
+		multiplyMatricesScalar(a.get(), b.get(), &expected[0]);
+		result = a * b;
+		matrixError = std::max(matrixError, difference(result.get(), expected.get(), 16));
+
+		vec4 expectedVector, resultVector;
+		transformVectorScalar(a.get(), &inputs.vectors[i].x, &expectedVector.x);
+		resultVector = a * inputs.vectors[i];
+		vectorError = std::max(vectorError, difference(&resultVector.x, &expectedVector.x, 4));
+
+		Quat expectedQuat, resultQuat;
+		multiplyQuatsScalar(inputs.quats[i], inputs.quats[count + i], expectedQuat);
+		resultQuat = inputs.quats[i] * inputs.quats[count + i];
+		quatError = std::max(quatError, difference(&resultQuat.x, &expectedQuat.x, 4));
+	}
+
+	// The batch functions must agree with the operators they loop on
+	std::vector<mat4> matrices(count);
+	mat4::multiply(&inputs.matrices[0], &inputs.matrices[count], &matrices[0], count);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		mat4 expected;
+		multiplyMatricesScalar(inputs.matrices[i].get(), inputs.matrices[count + i].get(), &expected[0]);
+		matrixError = std::max(matrixError, difference(matrices[i].get(), expected.get(), 16));
+	}
+
+	std::vector<vec4> vectors(count);
+	mat4::transform(inputs.matrices[0], &inputs.vectors[0], &vectors[0], count);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		vec4 expected;
+		transformVectorScalar(inputs.matrices[0].get(), &inputs.vectors[i].x, &expected.x);
+		vectorError = std::max(vectorError, difference(&vectors[i].x, &expected.x, 4));
+	}
+
+	std::vector<Quat> quats(count);
+	Quat::multiply(&inputs.quats[0], &inputs.quats[count], &quats[0], count);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		Quat expected;
+		multiplyQuatsScalar(inputs.quats[i], inputs.quats[count + i], expected);
+		quatError = std::max(quatError, difference(&quats[i].x, &expected.x, 4));
+	}
+
+	const bool passed = matrixError <= epsilon && vectorError <= epsilon && quatError <= epsilon;
+	Log("Math kernels (%s): largest difference from scalar, mat4 %g, vec4 %g, Quat %g, epsilon %g: %s",
+		kernelName, matrixError, vectorError, quatError, epsilon, passed ? "passed" : "FAILED");
+	return passed;
+}
+
 NEPHILIM_NS_END
\ No newline at end of file
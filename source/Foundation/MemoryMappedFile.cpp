@@ -0,0 +1,146 @@
+#include <Nephilim/Foundation/MemoryMappedFile.h>
+#include <Nephilim/Foundation/File.h>
+
+#ifdef NEPHILIM_WINDOWS
+#include <windows.h>
+#elif defined NEPHILIM_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+NEPHILIM_NS_BEGIN
+
+/// Constructs an unopened mapping
+MemoryMappedFile::MemoryMappedFile()
+: m_data(nullptr)
+, m_size(0)
+, m_mapped(false)
+#ifdef NEPHILIM_WINDOWS
+, m_fileHandle(INVALID_HANDLE_VALUE)
+, m_mappingHandle(nullptr)
+#endif
+{
+}
+
+/// Unmaps the file
+MemoryMappedFile::~MemoryMappedFile()
+{
+	close();
+}
+
+/// Map a file, closing the previous one
+bool MemoryMappedFile::open(const String& path)
+{
+	close();
+
+#ifdef NEPHILIM_WINDOWS
+	m_fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (m_fileHandle != INVALID_HANDLE_VALUE)
+	{
+		LARGE_INTEGER size;
+		if (GetFileSizeEx(m_fileHandle, &size) && size.QuadPart > 0)
+		{
+			m_mappingHandle = CreateFileMappingA(m_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (m_mappingHandle)
+			{
+				m_data = static_cast<const char*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+				if (m_data)
+				{
+					m_size = size.QuadPart;
+					m_mapped = true;
+					return true;
+				}
+			}
+		}
+		close();
+	}
+#elif defined NEPHILIM_UNIX
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd >= 0)
+	{
+		struct stat info;
+		if (fstat(fd, &info) == 0 && info.st_size > 0)
+		{
+			void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data != MAP_FAILED)
+			{
+				// Reads jump around the file, there is no point reading ahead much
+				madvise(data, static_cast<size_t>(info.st_size), MADV_RANDOM);
+
+				m_data = static_cast<const char*>(data);
+				m_size = info.st_size;
+				m_mapped = true;
+			}
+		}
+		::close(fd);
+
+		if (m_mapped)
+			return true;
+	}
+#endif
+
+	// Not mappable, the File layer still knows how to read it
+	File file(path, IODevice::BinaryRead);
+	if (!file)
+		return false;
+
+	m_buffer.resize(static_cast<std::size_t>(file.getSize()));
+	if (!m_buffer.empty() && file.read(&m_buffer[0], file.getSize()) != file.getSize())
+	{
+		m_buffer.clear();
+		return false;
+	}
+
+	m_data = m_buffer.empty() ? nullptr : &m_buffer[0];
+	m_size = static_cast<Int64>(m_buffer.size());
+	return true;
+}
+
+/// Unmap the file
+void MemoryMappedFile::close()
+{
+	if (m_mapped)
+	{
+#ifdef NEPHILIM_WINDOWS
+		UnmapViewOfFile(m_data);
+#elif defined NEPHILIM_UNIX
+		munmap(const_cast<char*>(m_data), static_cast<size_t>(m_size));
+#endif
+	}
+
+#ifdef NEPHILIM_WINDOWS
+	if (m_mappingHandle)
+		CloseHandle(m_mappingHandle);
+	if (m_fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(m_fileHandle);
+	m_mappingHandle = nullptr;
+	m_fileHandle = INVALID_HANDLE_VALUE;
+#endif
+
+	std::vector<char>().swap(m_buffer);
+	m_data = nullptr;
+	m_size = 0;
+	m_mapped = false;
+}
+
+/// Check if a file is mapped
+bool MemoryMappedFile::isOpen() const
+{
+	return m_data != nullptr;
+}
+
+/// Get the start of the file contents
+const char* MemoryMappedFile::getData() const
+{
+	return m_data;
+}
+
+/// Get the size of the file in bytes
+Int64 MemoryMappedFile::getSize() const
+{
+	return m_size;
+}
+
+NEPHILIM_NS_END
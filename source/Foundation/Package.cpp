@@ -1,14 +1,52 @@
 #include <Nephilim/Foundation/Package.h>
 #include <Nephilim/Foundation/File.h>
 #include <Nephilim/Foundation/DataStream.h>
+#include <Nephilim/Foundation/Logging.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+// Only the declarations, stb_image is compiled along with Image
+#define STBI_HEADER_FILE_ONLY
+#include "stb_image/stb_image.h"
+
+// Defined with the stb_image_write implementation in Image.cpp
+unsigned char* stbi_zlib_compress(unsigned char* data, int data_len, int* out_len, int quality);
 
 #include <iostream>
 using namespace std;
 
 NEPHILIM_NS_BEGIN
 
+namespace
+{
+	/// Entry names are relative, "/textures/a.png" and "textures/a.png" are the same entry
+	const char* entryName(const String& name, std::size_t& length)
+	{
+		std::size_t start = 0;
+		while (start < name.size() && name[start] == '/')
+			++start;
+
+		length = name.size() - start;
+		return name.c_str() + start;
+	}
+
+	/// Round offset up to a multiple of alignment, a power of two
+	Uint64 alignUp(Uint64 offset, Uint32 alignment)
+	{
+		return (offset + alignment - 1) & ~static_cast<Uint64>(alignment - 1);
+	}
+}
+
+const Uint32 Package::Version;
+const Uint32 Package::EmptyBucket;
+
 /// Constructs an uninitialized package reader
 Package::Package()
+: m_header(nullptr)
+, m_entries(nullptr)
+, m_buckets(nullptr)
+, m_names(nullptr)
 {
 
 }
@@ -16,97 +54,422 @@ Package::Package()
 /// Constructs directly from a package file
 Package::Package(const String& source)
 : m_file(source)
+, m_header(nullptr)
+, m_entries(nullptr)
+, m_buckets(nullptr)
+, m_names(nullptr)
+{
+	open(source);
+}
+
+/// Map a package file and validate its table of contents
+bool Package::open(const String& source)
+{
+	close();
+	m_file = source;
+
+	if (!m_mapping.open(source))
+		return false;
+
+	const Uint64 fileSize = static_cast<Uint64>(m_mapping.getSize());
+	const pHeader* header = reinterpret_cast<const pHeader*>(m_mapping.getData());
+
+	if (fileSize < sizeof(pHeader) || memcmp(header->m_magic, "NXPK", 4) != 0 || header->m_version != Version)
+	{
+		// Version 1 packages have no magic, they can only be extracted
+		m_mapping.close();
+		return false;
+	}
+
+	const Uint32 buckets = header->m_bucketCount;
+	if (buckets == 0 || (buckets & (buckets - 1)) != 0 || header->m_entryCount >= buckets
+		|| header->m_entriesOffset + Uint64(header->m_entryCount) * sizeof(pEntry) > fileSize
+		|| header->m_bucketsOffset + Uint64(buckets) * sizeof(Uint32) > fileSize
+		|| header->m_namesOffset > fileSize)
+	{
+		Log("Package: Corrupt table of contents in %s", source.c_str());
+		m_mapping.close();
+		return false;
+	}
+
+	m_header  = header;
+	m_entries = reinterpret_cast<const pEntry*>(m_mapping.getData() + header->m_entriesOffset);
+	m_buckets = reinterpret_cast<const Uint32*>(m_mapping.getData() + header->m_bucketsOffset);
+	m_names   = m_mapping.getData() + header->m_namesOffset;
+
+	// Every entry must lie within the file, after that lookups need no checks
+	for (Uint32 i = 0; i < header->m_entryCount; ++i)
+	{
+		const pEntry& entry = m_entries[i];
+		if (header->m_namesOffset + entry.m_nameOffset + entry.m_nameLength > fileSize
+			|| entry.m_offset + entry.m_storedSize > fileSize)
+		{
+			Log("Package: Entry %u out of bounds in %s", i, source.c_str());
+			close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/// Unmap the package, invalidating every view
+void Package::close()
 {
+	m_mapping.close();
+	m_header = nullptr;
+	m_entries = nullptr;
+	m_buckets = nullptr;
+	m_names = nullptr;
+}
+
+/// Check if the package is open
+bool Package::isOpen() const
+{
+	return m_header != nullptr;
+}
+
+/// Get the package source file
+const String& Package::getSource() const
+{
+	return m_file;
+}
+
+/// Get the number of entries
+std::size_t Package::getEntryCount() const
+{
+	return m_header ? m_header->m_entryCount : 0;
+}
 
+/// Get the name of the entry at index
+String Package::getEntryName(std::size_t index) const
+{
+	const pEntry& entry = m_entries[index];
+	return String(std::string(m_names + entry.m_nameOffset, entry.m_nameLength));
+}
+
+/// Find the entry of a name, nullptr if there is none
+const Package::pEntry* Package::find(const String& name) const
+{
+	if (!m_header)
+		return nullptr;
+
+	std::size_t length = 0;
+	const char* key = entryName(name, length);
+	const Uint64 keyHash = hash(key, length);
+
+	// Linear probing, the table is at most half full so chains stay short
+	const Uint32 mask = m_header->m_bucketCount - 1;
+	for (Uint32 slot = static_cast<Uint32>(keyHash) & mask; m_buckets[slot] != EmptyBucket; slot = (slot + 1) & mask)
+	{
+		const Uint32 index = m_buckets[slot];
+		if (index >= m_header->m_entryCount)
+			return nullptr;
+
+		const pEntry& entry = m_entries[index];
+		if (entry.m_nameHash == keyHash && entry.m_nameLength == length && memcmp(m_names + entry.m_nameOffset, key, length) == 0)
+			return &entry;
+	}
+
+	return nullptr;
+}
+
+/// Check if there is an entry with the given name
+bool Package::contains(const String& name) const
+{
+	return find(name) != nullptr;
+}
+
+/// Get the original size of an entry, or -1 if there is no such entry
+Int64 Package::getEntrySize(const String& name) const
+{
+	const pEntry* entry = find(name);
+	return entry ? static_cast<Int64>(entry->m_size) : -1;
+}
+
+/// Check if an entry is stored compressed, and so can't be mapped
+bool Package::isCompressed(const String& name) const
+{
+	const pEntry* entry = find(name);
+	return entry && (entry->m_flags & Compressed);
+}
+
+/// Get a zero-copy view of an entry stored uncompressed
+bool Package::map(const String& name, View& view) const
+{
+	const pEntry* entry = find(name);
+	if (!entry || (entry->m_flags & Compressed))
+		return false;
+
+	view.data = m_mapping.getData() + entry->m_offset;
+	view.size = static_cast<Int64>(entry->m_size);
+	return true;
+}
+
+/// Read the contents of an entry, decompressing if needed
+bool Package::read(const String& name, std::vector<char>& data) const
+{
+	const pEntry* entry = find(name);
+	if (!entry)
+		return false;
+
+	const char* stored = m_mapping.getData() + entry->m_offset;
+	data.resize(static_cast<std::size_t>(entry->m_size));
+	if (data.empty())
+		return true;
+
+	if (entry->m_flags & Compressed)
+	{
+		int length = stbi_zlib_decode_buffer(&data[0], static_cast<int>(data.size()), stored, static_cast<int>(entry->m_storedSize));
+		if (length != static_cast<int>(entry->m_size))
+		{
+			Log("Package: Failed to decompress %s from %s", name.c_str(), m_file.c_str());
+			data.clear();
+			return false;
+		}
+	}
+	else
+	{
+		memcpy(&data[0], stored, data.size());
+	}
+
+	return true;
+}
+
+/// Check the contents of an entry against the hash recorded when building
+bool Package::verify(const String& name) const
+{
+	const pEntry* entry = find(name);
+	if (!entry)
+		return false;
+
+	if (entry->m_flags & Compressed)
+	{
+		std::vector<char> data;
+		return read(name, data) && hash(data.empty() ? nullptr : &data[0], data.size()) == entry->m_contentHash;
+	}
+
+	return hash(m_mapping.getData() + entry->m_offset, static_cast<std::size_t>(entry->m_size)) == entry->m_contentHash;
 }
 
 /// Attempts to extract the package contents to a directory
 bool Package::extract(const String& directory)
 {
+	if (!isOpen() && !open(m_file))
+		return extractLegacy(directory);
+
+	bool success = true;
+	std::vector<char> data;
+	for (std::size_t i = 0; i < getEntryCount(); ++i)
+	{
+		String name = getEntryName(i);
+		File dstFile(directory + "/" + name, IODevice::BinaryWrite);
+		cout << "Extracting("<< m_entries[i].m_size << "): " << directory + "/" + name << endl;
+
+		if (dstFile.isReady() && read(name, data))
+		{
+			if (!data.empty())
+				dstFile.write(&data[0], static_cast<Int64>(data.size()));
+		}
+		else
+		{
+			success = false;
+		}
+	}
+
+	return success;
+}
+
+/// Extract a version 1 package
+bool Package::extractLegacy(const String& directory)
+{
+	struct pLegacyFile
+	{
+		Int64 m_offset;
+		Int64 m_length;
+		String m_name;
+	};
+
 	File file(m_file, IODevice::BinaryRead);
 	if(file.isReady())
 	{
 		DataStream in(file);
 		Int64 fileCount = 0;
 		in >> fileCount;
-		m_header.m_files.resize(fileCount);
-		for(std::size_t i = 0; i < m_header.m_files.size(); i++)
+
+		std::vector<pLegacyFile> files(static_cast<std::size_t>(fileCount));
+		for(std::size_t i = 0; i < files.size(); i++)
 		{
-			in >> m_header.m_files[i].m_name >>  m_header.m_files[i].m_offset >>  m_header.m_files[i].m_length;
+			in >> files[i].m_name >> files[i].m_offset >> files[i].m_length;
 		}
 
-		for(std::size_t i = 0; i < m_header.m_files.size(); i++)
+		for(std::size_t i = 0; i < files.size(); i++)
 		{
-			File srcFile(file.getHandle(), m_header.m_files[i].m_offset, m_header.m_files[i].m_length);
-			File dstFile(directory + "/" + m_header.m_files[i].m_name, IODevice::BinaryWrite);
-			cout << "Extracting("<< m_header.m_files[i].m_length  << "): " << directory + "/" + m_header.m_files[i].m_name << endl;
+			File srcFile(file.getHandle(), files[i].m_offset, files[i].m_length);
+			File dstFile(directory + "/" + files[i].m_name, IODevice::BinaryWrite);
+			cout << "Extracting("<< files[i].m_length  << "): " << directory + "/" + files[i].m_name << endl;
 			if(srcFile.isReady() && dstFile.isReady())
 				FileOps::copy(srcFile, dstFile);
 		}
 	}
 
+	return true;
+}
 
+/// Hash used for entry names and contents, 64 bit FNV-1a
+Uint64 Package::hash(const char* data, std::size_t size, Uint64 seed)
+{
+	Uint64 h = seed;
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		h ^= static_cast<unsigned char>(data[i]);
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+/// Creates a builder aligning entries to 16 bytes
+PackageBuilder::PackageBuilder()
+: m_alignment(16)
+{
 
-	return true;
 }
 
-/// Adds a file to the package builder
-void PackageBuilder::addFile(const String& source, const String& destination)
+/// Adds a file to the package builder, compressed entries are smaller but can't be mapped
+void PackageBuilder::addFile(const String& source, const String& destination, bool compress)
 {
-	m_files.push_back(std::make_pair(source, destination));
+	pSource file;
+	file.m_source = source;
+	file.m_destination = destination;
+	file.m_compress = compress;
+	m_files.push_back(file);
+}
 
-	Package::pFile file;
-	file.m_length = FileOps::size(source);
-	file.m_name = destination;
-	m_header.m_files.push_back(file);
+/// Set the boundary entries start at, must be a power of two
+void PackageBuilder::setAlignment(Uint32 alignment)
+{
+	if (alignment > 0 && (alignment & (alignment - 1)) == 0)
+		m_alignment = alignment;
+	else
+		Log("PackageBuilder: Alignment %u is not a power of two", alignment);
 }
 
 /// Generates the final package
-bool PackageBuilder::build()
+bool PackageBuilder::build(const String& filename)
 {
-	bool success = false;
+	// Names and the hash table are known upfront, only the data offsets depend on compression
+	std::vector<Package::pEntry> entries(m_files.size());
+	String names;
+	for (std::size_t i = 0; i < m_files.size(); ++i)
+	{
+		std::size_t length = 0;
+		const char* name = entryName(m_files[i].m_destination, length);
 
-	File file("package.pkg", IODevice::BinaryWrite);
-	if(file.isReady())
+		memset(&entries[i], 0, sizeof(Package::pEntry));
+		entries[i].m_nameHash = Package::hash(name, length);
+		entries[i].m_nameOffset = static_cast<Uint32>(names.size());
+		entries[i].m_nameLength = static_cast<Uint32>(length);
+		names.append(name, length);
+	}
+
+	Uint32 bucketCount = 16;
+	while (bucketCount < entries.size() * 2)
+		bucketCount *= 2;
+
+	std::vector<Uint32> buckets(bucketCount, Package::EmptyBucket);
+	for (std::size_t i = 0; i < entries.size(); ++i)
 	{
-		Int64 headerSize = sizeof(Int64);
-		for(unsigned int i = 0; i < m_header.m_files.size(); i++)
-		{
-			headerSize += sizeof(Int64) * 3 + sizeof(char) * m_header.m_files[i].m_name.length();
-		}
+		Uint32 slot = static_cast<Uint32>(entries[i].m_nameHash) & (bucketCount - 1);
+		while (buckets[slot] != Package::EmptyBucket)
+			slot = (slot + 1) & (bucketCount - 1);
+		buckets[slot] = static_cast<Uint32>(i);
+	}
 
-		// Calculate offsets
-		Int64 relOffset = headerSize;
-		for(unsigned int i = 0; i < m_header.m_files.size(); i++)
-		{
-			m_header.m_files[i].m_offset = relOffset;
-			relOffset += m_header.m_files[i].m_length;
-		}
+	Package::pHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.m_magic, "NXPK", 4);
+	header.m_version = Package::Version;
+	header.m_entryCount = static_cast<Uint32>(entries.size());
+	header.m_bucketCount = bucketCount;
+	header.m_alignment = m_alignment;
+	header.m_entriesOffset = sizeof(Package::pHeader);
+	header.m_bucketsOffset = header.m_entriesOffset + entries.size() * sizeof(Package::pEntry);
+	header.m_namesOffset = header.m_bucketsOffset + buckets.size() * sizeof(Uint32);
 
-		// Write the header
-		DataStream out(file);
-		out << static_cast<Int64>(m_header.m_files.size());
-		for(unsigned int i = 0; i < m_header.m_files.size(); i++)
+	File file(filename, IODevice::BinaryWrite);
+	if (!file.isReady())
+	{
+		Log("PackageBuilder: Can't write %s", filename.c_str());
+		return false;
+	}
+
+	// The table of contents is written again once the offsets are known
+	const Uint64 tocEnd = header.m_namesOffset + names.size();
+	std::vector<char> padding(static_cast<std::size_t>(alignUp(tocEnd, m_alignment)), 0);
+	file.write(&padding[0], static_cast<Int64>(padding.size()));
+	Uint64 offset = padding.size();
+
+	bool success = true;
+	std::vector<char> contents;
+	for (std::size_t i = 0; i < m_files.size(); ++i)
+	{
+		File in(m_files[i].m_source, IODevice::BinaryRead);
+		if (!in.isReady())
 		{
-			out << m_header.m_files[i].m_name << m_header.m_files[i].m_offset << m_header.m_files[i].m_length;
+			Log("PackageBuilder: Can't read %s", m_files[i].m_source.c_str());
+			success = false;
+			continue;
 		}
 
-		for(std::vector<std::pair<String,String> >::iterator it = m_files.begin(); it != m_files.end(); ++it)
+		contents.resize(static_cast<std::size_t>(in.getSize()));
+		if (!contents.empty())
+			in.read(&contents[0], static_cast<Int64>(contents.size()));
+
+		Package::pEntry& entry = entries[i];
+		entry.m_size = contents.size();
+		entry.m_contentHash = Package::hash(contents.empty() ? nullptr : &contents[0], contents.size());
+
+		const char* stored = contents.empty() ? nullptr : &contents[0];
+		Uint64 storedSize = contents.size();
+		unsigned char* compressed = nullptr;
+
+		if (m_files[i].m_compress && !contents.empty())
 		{
-			String source = it->first;
-			String dest   = it->second;
+			int compressedSize = 0;
+			compressed = stbi_zlib_compress(reinterpret_cast<unsigned char*>(&contents[0]), static_cast<int>(contents.size()), &compressedSize, 8);
 
-			File in(source, IODevice::BinaryRead);
-			if(in.isReady())
+			// Keep it raw when compression doesn't pay off, so it can still be mapped
+			if (compressed && static_cast<Uint64>(compressedSize) < storedSize)
 			{
-				/// Writes in contents to out
-				FileOps::copy(in, file);
+				stored = reinterpret_cast<const char*>(compressed);
+				storedSize = static_cast<Uint64>(compressedSize);
+				entry.m_flags |= Package::Compressed;
 			}
 		}
 
-		success = true;
+		const Uint64 aligned = alignUp(offset, m_alignment);
+		if (aligned > offset)
+		{
+			padding.assign(static_cast<std::size_t>(aligned - offset), 0);
+			file.write(&padding[0], static_cast<Int64>(padding.size()));
+		}
+
+		entry.m_offset = aligned;
+		entry.m_storedSize = storedSize;
+		if (storedSize > 0)
+			file.write(stored, static_cast<Int64>(storedSize));
+		offset = aligned + storedSize;
+
+		free(compressed);
 	}
 
+	file.seek(0);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	if (!entries.empty())
+		file.write(reinterpret_cast<const char*>(&entries[0]), static_cast<Int64>(entries.size() * sizeof(Package::pEntry)));
+	file.write(reinterpret_cast<const char*>(&buckets[0]), static_cast<Int64>(buckets.size() * sizeof(Uint32)));
+	file.write(names.c_str(), static_cast<Int64>(names.size()));
+
 	return success;
 }
 
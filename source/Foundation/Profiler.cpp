@@ -1,7 +1,339 @@
 #include <Nephilim/Foundation/Profiler.h>
+#include <Nephilim/Foundation/Logging.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
 
 NEPHILIM_NS_BEGIN
 
-std::map<String, ProfileStatistics::fnTrack> ProfileStatistics::m_functions;
+namespace
+{
+	/// Events one thread can have waiting for endFrame(), a power of two
+	const Uint32 BufferCapacity = 1 << 13;
+
+	/// Finished zones of one thread, written by it and drained by endFrame()
+	struct ThreadBuffer
+	{
+		ThreadBuffer(Uint32 threadIndex)
+		: events(BufferCapacity)
+		, head(0)
+		, tail(0)
+		, dropped(0)
+		, depth(0)
+		, thread(threadIndex)
+		{
+		}
+
+		std::vector<Profiler::Event> events;
+		std::atomic<Uint32>          head;     ///< Next slot to write, only advanced by the owner
+		std::atomic<Uint32>          tail;     ///< Next slot to read, only advanced by endFrame()
+		std::atomic<Uint32>          dropped;
+		Uint32                       depth;    ///< Zones currently open, owner only
+		Uint32                       thread;
+		String                       name;
+	};
+
+	/// State shared by every thread
+	struct ProfilerState
+	{
+		ProfilerState()
+		: enabled(true)
+		, capturing(false)
+		, captureLimit(0)
+		, epoch(std::chrono::steady_clock::now())
+		, frameStart(0)
+		{
+			lastFrame.frame = 0;
+			lastFrame.milliseconds = 0.0;
+			lastFrame.dropped = 0;
+		}
+
+		std::atomic<bool>                          enabled;
+		std::mutex                                 threadsMutex;  ///< Guards threads, only taken once per thread and per frame
+		std::vector<std::unique_ptr<ThreadBuffer> > threads;      ///< Never shrinks, buffers outlive their threads
+
+		bool                                       capturing;
+		std::size_t                                captureLimit;
+		std::vector<Profiler::Event>               capture;
+
+		std::map<String, std::unique_ptr<std::pair<String, ProfileZone> > > internedZones;  ///< Guarded by threadsMutex
+
+		std::chrono::steady_clock::time_point      epoch;
+		Int64                                      frameStart;
+		Profiler::FrameStats                       lastFrame;
+	};
+
+	ProfilerState& state()
+	{
+		static ProfilerState instance;
+		return instance;
+	}
+
+	/// Zone the frames are recorded as in captures
+	const ProfileZone FrameZone = { "Frame", __FILE__, __LINE__ };
+
+	thread_local ThreadBuffer* tBuffer = nullptr;
+
+	/// Get the buffer of the calling thread, registering it on first use
+	ThreadBuffer& threadBuffer()
+	{
+		if (!tBuffer)
+		{
+			ProfilerState& s = state();
+			std::lock_guard<std::mutex> lock(s.threadsMutex);
+			s.threads.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer(static_cast<Uint32>(s.threads.size()))));
+			tBuffer = s.threads.back().get();
+		}
+		return *tBuffer;
+	}
+
+	/// Write a string as a JSON string literal
+	void writeJsonString(FILE* file, const char* text)
+	{
+		fputc('"', file);
+		for (const char* c = text; *c; ++c)
+		{
+			if (*c == '"' || *c == '\\')
+				fputc('\\', file);
+			if (static_cast<unsigned char>(*c) >= 0x20)
+				fputc(*c, file);
+		}
+		fputc('"', file);
+	}
+}
+
+/// Turn collection on or off, zones cost two clock reads when on and a branch when off
+void Profiler::setEnabled(bool enabled)
+{
+	state().enabled = enabled;
+}
+
+/// Check if zones are being collected
+bool Profiler::isEnabled()
+{
+	return state().enabled.load(std::memory_order_relaxed);
+}
+
+/// Get a zone for a name only known at runtime, the same one for every call with that name
+const ProfileZone* Profiler::internZone(const String& name)
+{
+	ProfilerState& s = state();
+	std::lock_guard<std::mutex> lock(s.threadsMutex);
+
+	std::unique_ptr<std::pair<String, ProfileZone> >& interned = s.internedZones[name];
+	if (!interned)
+	{
+		interned.reset(new std::pair<String, ProfileZone>());
+		interned->first = name;
+		interned->second.name = interned->first.c_str();
+		interned->second.file = "";
+		interned->second.line = 0;
+	}
+
+	return &interned->second;
+}
+
+/// Name the calling thread in the exported traces
+void Profiler::setThreadName(const String& name)
+{
+	ThreadBuffer& buffer = threadBuffer();
+	std::lock_guard<std::mutex> lock(state().threadsMutex);
+	buffer.name = name;
+}
+
+/// Get the current time in nanoseconds since the profiler started
+Int64 Profiler::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - state().epoch).count();
+}
+
+/// Increase the nesting depth of the calling thread, returning the depth of the new zone
+Uint32 Profiler::enterZone()
+{
+	return threadBuffer().depth++;
+}
+
+/// Record a finished zone and decrease the nesting depth of the calling thread
+void Profiler::leaveZone(const ProfileZone* zone, Int64 start, Uint32 depth)
+{
+	ThreadBuffer& buffer = threadBuffer();
+	--buffer.depth;
+
+	const Uint32 head = buffer.head.load(std::memory_order_relaxed);
+	if (head - buffer.tail.load(std::memory_order_acquire) >= BufferCapacity)
+	{
+		buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	Event& event = buffer.events[head & (BufferCapacity - 1)];
+	event.zone = zone;
+	event.start = start;
+	event.end = now();
+	event.depth = depth;
+	event.thread = buffer.thread;
+
+	// Publishes the event to endFrame()
+	buffer.head.store(head + 1, std::memory_order_release);
+}
+
+/// Collect the events of every thread into the statistics of the frame that ended
+void Profiler::endFrame()
+{
+	ProfilerState& s = state();
+	const Int64 frameEnd = now();
+	const Uint32 frameThread = threadBuffer().thread;
+
+	FrameStats frame;
+	frame.frame = s.lastFrame.frame + 1;
+	frame.milliseconds = (frameEnd - s.frameStart) / 1000000.0;
+	frame.dropped = 0;
+
+	std::map<std::pair<const ProfileZone*, Uint32>, std::size_t> slots;
+
+	std::lock_guard<std::mutex> lock(s.threadsMutex);
+	for (std::size_t i = 0; i < s.threads.size(); ++i)
+	{
+		ThreadBuffer& buffer = *s.threads[i];
+		const Uint32 head = buffer.head.load(std::memory_order_acquire);
+		Uint32 tail = buffer.tail.load(std::memory_order_relaxed);
+
+		for (; tail != head; ++tail)
+		{
+			const Event& event = buffer.events[tail & (BufferCapacity - 1)];
+			const double milliseconds = (event.end - event.start) / 1000000.0;
+
+			std::pair<std::map<std::pair<const ProfileZone*, Uint32>, std::size_t>::iterator, bool> slot =
+				slots.insert(std::make_pair(std::make_pair(event.zone, event.depth), frame.zones.size()));
+			if (slot.second)
+			{
+				ZoneStats stats;
+				stats.zone = event.zone;
+				stats.depth = event.depth;
+				stats.calls = 0;
+				stats.totalMilliseconds = 0.0;
+				stats.maxMilliseconds = 0.0;
+				stats.firstStart = event.start;
+				frame.zones.push_back(stats);
+			}
+
+			ZoneStats& stats = frame.zones[slot.first->second];
+			++stats.calls;
+			stats.totalMilliseconds += milliseconds;
+			stats.maxMilliseconds = std::max(stats.maxMilliseconds, milliseconds);
+			stats.firstStart = std::min(stats.firstStart, event.start);
+
+			if (s.capturing && s.capture.size() < s.captureLimit)
+				s.capture.push_back(event);
+		}
+
+		buffer.tail.store(head, std::memory_order_release);
+		frame.dropped += buffer.dropped.exchange(0, std::memory_order_relaxed);
+	}
+
+	std::sort(frame.zones.begin(), frame.zones.end(), [](const ZoneStats& a, const ZoneStats& b)
+	{
+		return a.firstStart != b.firstStart ? a.firstStart < b.firstStart : a.depth < b.depth;
+	});
+
+	// The frame itself, on the thread that ends frames
+	if (s.capturing && s.capture.size() < s.captureLimit)
+	{
+		Event event;
+		event.zone = &FrameZone;
+		event.start = s.frameStart;
+		event.end = frameEnd;
+		event.depth = 0;
+		event.thread = frameThread;
+		s.capture.push_back(event);
+	}
+
+	s.frameStart = frameEnd;
+	s.lastFrame.zones.swap(frame.zones);
+	s.lastFrame.frame = frame.frame;
+	s.lastFrame.milliseconds = frame.milliseconds;
+	s.lastFrame.dropped = frame.dropped;
+}
+
+/// Get the statistics of the last finished frame
+const Profiler::FrameStats& Profiler::getLastFrame()
+{
+	return state().lastFrame;
+}
+
+/// Keep every event from now on, up to maxEvents, for exporting
+void Profiler::startCapture(std::size_t maxEvents)
+{
+	ProfilerState& s = state();
+	std::lock_guard<std::mutex> lock(s.threadsMutex);
+	s.capture.clear();
+	s.captureLimit = maxEvents;
+	s.capturing = true;
+}
+
+/// Stop keeping events, what was captured stays until the next capture
+void Profiler::stopCapture()
+{
+	ProfilerState& s = state();
+	std::lock_guard<std::mutex> lock(s.threadsMutex);
+	s.capturing = false;
+}
+
+/// Check if events are being captured
+bool Profiler::isCapturing()
+{
+	return state().capturing;
+}
+
+/// Write the captured events as Chrome trace JSON, readable by Perfetto too
+bool Profiler::exportChromeTrace(const String& filename)
+{
+	ProfilerState& s = state();
+
+	FILE* file = fopen(filename.c_str(), "w");
+	if (!file)
+	{
+		Log("Profiler: Can't write %s", filename.c_str());
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(s.threadsMutex);
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	bool first = true;
+	for (std::size_t i = 0; i < s.threads.size(); ++i)
+	{
+		String name = s.threads[i]->name.empty() ? String("Thread ") + String::number(static_cast<int>(i)) : s.threads[i]->name;
+		fprintf(file, "%s{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":", first ? "" : ",\n", s.threads[i]->thread);
+		writeJsonString(file, name.c_str());
+		fprintf(file, "}}");
+		first = false;
+	}
+
+	// Complete events, timestamps in microseconds
+	for (std::size_t i = 0; i < s.capture.size(); ++i)
+	{
+		const Event& event = s.capture[i];
+		fprintf(file, "%s{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"name\":", first ? "" : ",\n",
+			event.thread, event.start / 1000.0, (event.end - event.start) / 1000.0);
+		writeJsonString(file, event.zone->name);
+		fprintf(file, ",\"args\":{\"file\":");
+		writeJsonString(file, event.zone->file);
+		fprintf(file, ",\"line\":%d}}", event.zone->line);
+		first = false;
+	}
+
+	fprintf(file, "\n]}\n");
+	fclose(file);
+
+	Log("Profiler: Exported %u events to %s", static_cast<unsigned int>(s.capture.size()), filename.c_str());
+	return true;
+}
 
-NEPHILIM_NS_END
\ No newline at end of file
+NEPHILIM_NS_END
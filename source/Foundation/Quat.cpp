@@ -2,6 +2,12 @@
 #include <Nephilim/Foundation/Logging.h>
 #include <Nephilim/Foundation/Math.h>
 
+#if defined NEPHILIM_SIMD_SSE
+#include <xmmintrin.h>
+#elif defined NEPHILIM_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
 NEPHILIM_NS_BEGIN
 
 Quat Quat::identity;
@@ -202,33 +208,62 @@ mat4 Quat::toMatrix()
 	return m;
 }
 
+namespace
+{
+	/// Hamilton product of a and b into out, out may alias either input
+	inline void multiplyQuats(const Quat& a, const Quat& b, Quat& out)
+	{
+#if defined NEPHILIM_SIMD_SSE
+		// Each term of the product is one lane of a scalar of a times a shuffled, sign flipped b
+		const __m128 vb = _mm_loadu_ps(&b.x);
+		const __m128 sx = _mm_setr_ps( 1.f, -1.f,  1.f, -1.f);
+		const __m128 sy = _mm_setr_ps( 1.f,  1.f, -1.f, -1.f);
+		const __m128 sz = _mm_setr_ps(-1.f,  1.f,  1.f, -1.f);
+
+		__m128 r = _mm_mul_ps(_mm_set1_ps(a.w), vb);
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a.x), _mm_mul_ps(_mm_shuffle_ps(vb, vb, _MM_SHUFFLE(0, 1, 2, 3)), sx)));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a.y), _mm_mul_ps(_mm_shuffle_ps(vb, vb, _MM_SHUFFLE(1, 0, 3, 2)), sy)));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a.z), _mm_mul_ps(_mm_shuffle_ps(vb, vb, _MM_SHUFFLE(2, 3, 0, 1)), sz)));
+		_mm_storeu_ps(&out.x, r);
+#elif defined NEPHILIM_SIMD_NEON
+		static const float signs[12] = { 1.f, -1.f,  1.f, -1.f,
+		                                 1.f,  1.f, -1.f, -1.f,
+		                                -1.f,  1.f,  1.f, -1.f };
+		const float32x4_t vb = vld1q_f32(&b.x);
+		const float32x4_t zwxy = vextq_f32(vb, vb, 2);
+
+		float32x4_t r = vmulq_n_f32(vb, a.w);
+		r = vmlaq_n_f32(r, vmulq_f32(vrev64q_f32(zwxy), vld1q_f32(signs + 0)), a.x);
+		r = vmlaq_n_f32(r, vmulq_f32(zwxy, vld1q_f32(signs + 4)), a.y);
+		r = vmlaq_n_f32(r, vmulq_f32(vrev64q_f32(vb), vld1q_f32(signs + 8)), a.z);
+		vst1q_f32(&out.x, r);
+#else
+		Quat r;
+		r.w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
+		r.x = a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y;
+		r.y = a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x;
+		r.z = a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w;
+		out = r;
+#endif
+	}
+}
+
 Quat Quat::operator*(const Quat& q2)
 {
 	Quat qr;
-	vec3 va, vb, vc;
-	
-	qr.w = vec3(x,y,z).dot(vec3(q2.x, q2.y, q2.z));
-
-	va = vec3(x,y,z).cross(vec3(q2.x, q2.y, q2.z));
-	vb = vec3(x,y,z) * q2.w;
-	vc = vec3(q2.x, q2.y, q2.z) * w;
-
-	va = va + vb;
-	qr.x = va.x + vc.x;
-	qr.y = va.y + vc.y;
-	qr.z = va.z + vc.z;
-
-	qr.normalize();
-
-	// test 2
-	qr.w = w * q2.w - x * q2.x - y * q2.y - z * q2.z;
-	qr.x = w * q2.x + x * q2.w + y * q2.z - z * q2.y;
-	qr.y = w * q2.y - x * q2.z + y * q2.w + z * q2.x;
-	qr.z = w * q2.z + x * q2.y - y * q2.x + z * q2.w;
-
+	multiplyQuats(*this, q2, qr);
 	return qr;
 }
 
+/// Multiply count pairs of quaternions, out[i] = a[i] * b[i]
+void Quat::multiply(const Quat* a, const Quat* b, Quat* out, std::size_t count)
+{
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		multiplyQuats(a[i], b[i], out[i]);
+	}
+}
+
 
 void Quat::rotateEulerAngles(float ax, float ay, float az)
 {
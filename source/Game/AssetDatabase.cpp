@@ -2,11 +2,24 @@
 
 NEPHILIM_NS_BEGIN
 
+/// Make the assets of a package known, the package must outlive the database
+void AssetDatabase::addPackage(Package* package)
+{
+	if (package)
+		m_packages.push_back(package);
+}
+
 /// Get the package that contains the asset
 /// Returns nullptr if the asset isn't in a known package
-Package* getAssetPackage(const String& asset)
+Package* AssetDatabase::getAssetPackage(const String& asset)
 {
+	for (std::size_t i = m_packages.size(); i-- > 0;)
+	{
+		if (m_packages[i]->contains(asset))
+			return m_packages[i];
+	}
+
 	return nullptr;
 }
 
-NEPHILIM_NS_END
\ No newline at end of file
+NEPHILIM_NS_END
@@ -14,14 +14,62 @@ using namespace std;
 
 NEPHILIM_NS_BEGIN
 
+/// Creates an invalid handle, that refers to no texture
+TextureHandle::TextureHandle()
+: mPlaceholder(nullptr)
+{
+}
+
+/// Check if the handle refers to a requested texture
+bool TextureHandle::isValid() const
+{
+	return mTexture != nullptr;
+}
+
+/// Check if the texture is still loading
+bool TextureHandle::isPending() const
+{
+	return mTexture && mTexture->state == StreamedTexture::Pending;
+}
+
+/// Check if the texture is uploaded and usable
+bool TextureHandle::isReady() const
+{
+	return mTexture && mTexture->state == StreamedTexture::Ready;
+}
+
+/// Check if the texture couldn't be loaded
+bool TextureHandle::hasFailed() const
+{
+	return mTexture && mTexture->state == StreamedTexture::Failed;
+}
+
+/// Get the texture if ready, otherwise the placeholder, or nullptr for an invalid handle
+Texture2D* TextureHandle::get() const
+{
+	if (!mTexture)
+		return nullptr;
+
+	return isReady() ? &mTexture->texture : mPlaceholder;
+}
+
 GameContent::GameContent()
+: mBytesLoaded(0)
+, mBytesAtLastSample(0)
+, mBytesPerSecond(0.f)
 {
+	// Only registered here, the working directory is scanned on the first lookup
 	virtualfs.indexSearchPath("./", "/");
 }
 
 GameContent::~GameContent()
 {
-
+	// Loaders still running write into our queues
+	for (std::size_t i = 0; i < mLoadJobs.size(); ++i)
+	{
+		if (!mLoadJobs[i]->finished)
+			jobSystem->wait(mLoadJobs[i]);
+	}
 }
 
 /// Load a font
@@ -112,38 +160,257 @@ bool GameContent::load(const String& filename)
 
 	if(extension == "png" || extension == "jpg")
 	{
-		bool r = false;
+		return !requestTexture(filename).hasFailed();
+	}
+	else if(extension == "ttf" || extension == "otf")
+	{
+		//Log("Loading font: %s", filename.c_str());
+		//return targetGroup->mFonts.load(filename);
+	}
+
+	return false;
+}
+
+/// Get a streamed texture if it is ready, nullptr while it is loading or if it was never requested
+Texture2D* GameContent::getTexture(const String& name)
+{
+	std::map<String, StreamedTexturePtr>::iterator it = mStreamedTextures.find(name);
+	if (it != mStreamedTextures.end() && it->second->state == StreamedTexture::Ready)
+		return &it->second->texture;
+
+	return nullptr;
+}
+
+/// Start streaming a texture in, or raise the priority of a pending request for it
+TextureHandle GameContent::requestTexture(const String& name, int priority, TextureData::Type data)
+{
+	TextureHandle handle;
+	handle.mPlaceholder = getPlaceholderTexture();
+
+	std::map<String, StreamedTexturePtr>::iterator it = mStreamedTextures.find(name);
+	if (it != mStreamedTextures.end())
+	{
+		handle.mTexture = it->second;
+
+		std::lock_guard<std::mutex> lock(mLoadQueueMutex);
+		if (handle.mTexture->priority < priority)
+			handle.mTexture->priority = priority;
+
+		return handle;
+	}
+
+	// The texture object is made here, the workers only ever touch the image
+	StreamedTexturePtr texture = std::make_shared<StreamedTexture>();
+	texture->name = name;
+	texture->state = StreamedTexture::Pending;
+	texture->priority = priority;
+	texture->data = data;
+	mStreamedTextures[name] = texture;
+	handle.mTexture = texture;
+
+	{
+		std::lock_guard<std::mutex> lock(mLoadQueueMutex);
+		mLoadQueue.push_back(texture);
+	}
+
+	// One job per request, each takes whatever is most urgent when it gets to run
+	if (jobSystem)
+	{
+		pruneLoadJobs();
+		mLoadJobs.push_back(jobSystem->run([this]() { loadNextTexture(); }));
+	}
+	else
+	{
+		loadNextTexture();
+	}
+
+	return handle;
+}
+
+/// Read and decode the highest priority request, runs on the job system
+void GameContent::loadNextTexture()
+{
+	StreamedTexturePtr texture;
+	{
+		std::lock_guard<std::mutex> lock(mLoadQueueMutex);
+		if (mLoadQueue.empty())
+			return;
+
+		std::size_t best = 0;
+		for (std::size_t i = 1; i < mLoadQueue.size(); ++i)
+		{
+			if (mLoadQueue[i]->priority > mLoadQueue[best]->priority)
+				best = i;
+		}
+
+		texture = mLoadQueue[best];
+		mLoadQueue.erase(mLoadQueue.begin() + best);
+	}
+
+	// Packaged textures decode straight out of the mapping, compressed ones and loose files are read whole
+	bool loaded = false;
+	Package::View view;
+	if (virtualfs.mapFile(texture->name, view))
+	{
+		loaded = texture->image.loadFromMemory(view.data, static_cast<std::size_t>(view.size));
+		mBytesLoaded += static_cast<Uint64>(view.size);
+	}
+	else
+	{
+		std::vector<char> data;
+		if (virtualfs.readFile(texture->name, data) && !data.empty())
+		{
+			loaded = texture->image.loadFromMemory(&data[0], data.size());
+			mBytesLoaded += static_cast<Uint64>(data.size());
+		}
+	}
+
+	if (loaded && mipmapTextures)
+	{
+		// The chain holds level 0 too, the decoded image isn't needed anymore
+		texture->mips.build(texture->image, texture->data == TextureData::Color, jobSystem);
+		texture->image = Image();
+	}
+
+	if (loaded)
+	{
+		std::lock_guard<std::mutex> lock(mUploadQueueMutex);
+		mUploadQueue.push_back(texture);
+	}
+	else
+	{
+		Log("GameContent: Failed to load texture %s", texture->name.c_str());
+		texture->state = StreamedTexture::Failed;
+	}
+}
+
+/// Drop the bookkeeping of load jobs that already ran
+void GameContent::pruneLoadJobs()
+{
+	std::size_t kept = 0;
+	for (std::size_t i = 0; i < mLoadJobs.size(); ++i)
+	{
+		if (!mLoadJobs[i]->finished)
+			mLoadJobs[kept++] = mLoadJobs[i];
+	}
+	mLoadJobs.resize(kept);
+}
 
-		String realPath = virtualfs.translate(filename);
+/// Upload decoded textures to the GPU, for up to uploadBudget, must be called from the rendering thread
+void GameContent::processUploads()
+{
+	pruneLoadJobs();
 
-		if(1/*filesystems->exists(filename)*/)
+	Clock clock;
+	while (true)
+	{
+		StreamedTexturePtr texture;
 		{
-			Log("Going to load texture %s at real path: %s", filename.c_str(), realPath.c_str());
+			std::lock_guard<std::mutex> lock(mUploadQueueMutex);
+			if (mUploadQueue.empty())
+				break;
+
+			texture = mUploadQueue.front();
+			mUploadQueue.pop_front();
+		}
 
-		/*	targetGroup->mTextures[filename] = new Texture();
-			r = targetGroup->mTextures[filename]->loadFromFile(filename);
-			targetGroup->mTextures[filename]->setSmooth(false);
-			targetGroup->mTextures[filename]->setRepeated(false);*/
+		bool uploaded = texture->mips.isEmpty() ? texture->texture.loadFromImage(texture->image) : texture->texture.loadFromMipChain(texture->mips);
+		if (uploaded)
+		{
+			texture->state = StreamedTexture::Ready;
 		}
 		else
 		{
-			Log("Failed to load image, file not found");
+			Log("GameContent: Failed to upload texture %s", texture->name.c_str());
+			texture->state = StreamedTexture::Failed;
 		}
-	
-		return r;
+
+		// The pixels live on the GPU now
+		texture->image = Image();
+		texture->mips.clear();
+
+		if (clock.getElapsedTime() >= uploadBudget)
+			break;
 	}
-	else if(extension == "ttf" || extension == "otf")
+
+	// Throughput is sampled about once a second, so it reads steadily
+	const float elapsed = mThroughputClock.getElapsedTime().seconds();
+	if (elapsed >= 1.f)
 	{
-		//Log("Loading font: %s", filename.c_str());
-		//return targetGroup->mFonts.load(filename);
+		const Uint64 bytes = mBytesLoaded;
+		mBytesPerSecond = static_cast<float>(bytes - mBytesAtLastSample) / elapsed;
+		mBytesAtLastSample = bytes;
+		mThroughputClock.reset();
 	}
+}
 
-	return false;
+/// Block until every requested texture is loaded and uploaded, for loading screens and tools
+void GameContent::finishLoading()
+{
+	if (jobSystem)
+	{
+		jobSystem->wait(mLoadJobs);
+	}
+
+	while (true)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mUploadQueueMutex);
+			if (mUploadQueue.empty())
+				break;
+		}
+
+		processUploads();
+	}
 }
 
-Texture2D* GameContent::getTexture(const String& name)
+/// Get the texture drawn in place of the ones still loading
+Texture2D* GameContent::getPlaceholderTexture()
 {
-	return nullptr;
+	if (!mPlaceholder)
+	{
+		// Small grey checkerboard, noticeable when it stays around but not distracting for a frame or two
+		Image image;
+		image.create(2, 2, Color(96, 96, 96));
+		image.setPixel(1, 0, Color(160, 160, 160));
+		image.setPixel(0, 1, Color(160, 160, 160));
+
+		mPlaceholder.reset(new Texture2D);
+		mPlaceholder->loadFromImage(image);
+		mPlaceholder->setSmooth(false);
+		mPlaceholder->setRepeated(true);
+	}
+
+	return mPlaceholder.get();
+}
+
+/// Get the current streaming statistics
+GameContent::StreamingStats GameContent::getStreamingStats()
+{
+	StreamingStats stats;
+	stats.bytesLoaded = mBytesLoaded;
+	stats.bytesPerSecond = mBytesPerSecond;
+	stats.texturesReady = 0;
+	stats.texturesFailed = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(mLoadQueueMutex);
+		stats.loadQueueDepth = mLoadQueue.size();
+	}
+	{
+		std::lock_guard<std::mutex> lock(mUploadQueueMutex);
+		stats.uploadQueueDepth = mUploadQueue.size();
+	}
+
+	for (std::map<String, StreamedTexturePtr>::iterator it = mStreamedTextures.begin(); it != mStreamedTextures.end(); ++it)
+	{
+		if (it->second->state == StreamedTexture::Ready)
+			++stats.texturesReady;
+		else if (it->second->state == StreamedTexture::Failed)
+			++stats.texturesFailed;
+	}
+
+	return stats;
 }
 
 Texture2D* GameContent::createTexture(const String& filename)
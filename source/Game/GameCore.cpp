@@ -4,6 +4,9 @@
 #include <Nephilim/Foundation/StringList.h>
 #include <Nephilim/Foundation/FileSystem.h>
 #include <Nephilim/Foundation/Logging.h>
+#include <Nephilim/Foundation/Profiler.h>
+#include <Nephilim/Graphics/DebugDraw.h>
+#include <Nephilim/UI/UIPainter.h>
 
 // UI integration
 #include <Nephilim/UI/UICanvas.h>
@@ -15,6 +18,8 @@
 
 NEPHILIM_NS_BEGIN
 
+extern GraphicsDevice* gGlobalGraphicsDevice;
+
 /// Construct the game, its mandatory to call this base constructor when implementing GameCore
 GameCore::GameCore()
 : m_stackedTime(0.f)
@@ -29,7 +34,10 @@ GameCore::GameCore()
 /// Ensure every game resource is destroyed in order
 GameCore::~GameCore()
 {
+	gameThreads.stop();
 
+	for (std::size_t i = 0; i < graphicsDevices.size(); ++i)
+		delete graphicsDevices[i];
 }
 
 /// Get the root of the screen UX hierarchy
@@ -52,6 +60,7 @@ void GameCore::loadPlugins()
 	typedef PluginSDK::Types(*getPluginTypeFunc)();
 	typedef ExtensionScripting*(*createScriptEnvironmentFunc)(GameCore*);
 	typedef ExtensionAudio*(*createAudioEnvironmentFunc)(GameCore*);
+	typedef GraphicsDevice*(*createGraphicsDeviceFunc)();
 
 	StringList dll_list = FileSystem::scanDirectory("Plugins", "dll", false);
 	for (auto& dll_name : dll_list)
@@ -99,8 +108,29 @@ void GameCore::loadPlugins()
 						 }
 					}
 					break;
-
-
+				case PluginSDK::Graphics:
+					{
+						 Log("THIS IS A GRAPHICS PLUGIN");
+						 createGraphicsDeviceFunc funptr = (createGraphicsDeviceFunc)plugin->getFunctionAddress("createGraphicsDevice");
+						 if (funptr)
+						 {
+							 // A new device claims the global slot, the window's renderer keeps it
+							 GraphicsDevice* previousDevice = gGlobalGraphicsDevice;
+							 GraphicsDevice* graphicsDevice = funptr();
+							 gGlobalGraphicsDevice = previousDevice;
+							 if (graphicsDevice)
+							 {
+								 Log("Got the graphics device, Registered.");
+								 graphicsDevices.push_back(graphicsDevice);
+							 }
+						 }
+					}
+					break;
+				case PluginSDK::Physics:
+					{
+						 Log("Physics plugins are not supported yet, ignored.");
+					}
+					break;
 				}
 			}
 		}
@@ -116,6 +146,7 @@ World* GameCore::createWorld(const String& name)
 	world->graphicsDevice = getRenderer();
 	world->contentManager = &contentManager;
 	world->_game = this;
+	world->jobSystem = &gameThreads.jobs;
 
 	return world;
 }
@@ -360,6 +391,9 @@ void GameCore::PrimaryCreate()
 	uxScreen->width  = getWindow()->width();
 	uxScreen->height = getWindow()->height();
 
+	// Workers are up before anything gets to schedule jobs
+	gameThreads.start();
+	contentManager.jobSystem = &gameThreads.jobs;
 
 	// Plugins are ready when the game starts to construct
 	loadPlugins();
@@ -370,8 +404,13 @@ void GameCore::PrimaryCreate()
 /// Internal update handling
 void GameCore::PrimaryUpdate(Time time)
 {
+	PROFILE_ZONE("GameCore::PrimaryUpdate");
+
 	gameInput.update(time);
 
+	// Picks up assets added or removed on disk, when watching is enabled
+	contentManager.virtualfs.pollChanges();
+
 	stateManager.update(time);
 
 	onUpdate(time);
@@ -422,6 +461,8 @@ void GameCore::PrimaryEventHandling(const Event& event)
 /// Callbacks to onRender()
 void GameCore::PrimaryRender()
 {
+	// Textures streamed in since the last frame go to the GPU before anything draws
+	contentManager.processUploads();
 
 	//uxScreen->render();
 
@@ -430,6 +471,24 @@ void GameCore::PrimaryRender()
 	// Give the user the opportunity to render something
 	onRender();
 
+	if (showProfiler)
+	{
+		GraphicsDevice* graphics = getRenderer();
+		graphics->setProjectionMatrix(mat4::ortho(0.f, getWindow()->width(), getWindow()->height(), 0.f, 1.f, 1000.f));
+		graphics->setViewMatrix(mat4::identity);
+		graphics->setDefaultShader();
+		graphics->setDefaultBlending();
+
+		UIPainter painter;
+		painter.graphicsDevice = graphics;
+		painter.activeFont = &contentManager.font;
+
+		DebugDraw debugDraw(graphics);
+		debugDraw.drawProfiler(painter, 10.f, 10.f);
+	}
+
+	// Everything the threads timed since the last frame is collected here
+	Profiler::endFrame();
 }
 
 NEPHILIM_NS_END
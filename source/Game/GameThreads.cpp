@@ -1,12 +1,20 @@
 #include <Nephilim/Game/GameThreads.h>
+#include <Nephilim/Foundation/Logging.h>
 
 NEPHILIM_NS_BEGIN
 
-/// This is the thread function for every game thread
-/// your custom thread code will be called somewhere within this
-void GameThreads::GameThread::launcher()
+/// Launch the worker threads, by default one per core besides the main thread
+void GameThreads::start(std::size_t workerCount)
 {
+	jobs.start(workerCount);
 
+	Log("GameThreads: %d worker threads running", static_cast<int>(jobs.getWorkerCount()));
 }
 
-NEPHILIM_NS_END
\ No newline at end of file
+/// Finish the queued jobs and join the worker threads
+void GameThreads::stop()
+{
+	jobs.stop();
+}
+
+NEPHILIM_NS_END
@@ -1,9 +1,14 @@
 #include <Nephilim/Graphics/DebugDraw.h>
 #include <Nephilim/Graphics/GraphicsDevice.h>
+#include <Nephilim/Graphics/GlyphRunCache.h>
 #include <Nephilim/Graphics/GL/GLHelpers.h>
 #include <Nephilim/Foundation/Logging.h>
 #include <Nephilim/Graphics/Geometry.h>
 #include <Nephilim/Foundation/Math.h>
+#include <Nephilim/Foundation/Profiler.h>
+#include <Nephilim/UI/UIPainter.h>
+
+#include <cstdio>
 
 NEPHILIM_NS_BEGIN
 
@@ -31,4 +36,36 @@ void DebugDraw::drawBox(float x, float y, float z, float size, Color a)
 	_graphics->draw(box);*/
 }
 
+/// Draw the profiler statistics of the last frame as a text panel, with its top-left corner at x, y
+void DebugDraw::drawProfiler(UIPainter& painter, float x, float y)
+{
+	const Profiler::FrameStats& frame = Profiler::getLastFrame();
+
+	const float lineHeight = painter.currentTextSize + 4.f;
+	const float width = 420.f;
+	const float height = lineHeight * (frame.zones.size() + 2) + 8.f;
+
+	painter.setFillColor(Color(0, 0, 0, 180));
+	painter.drawRect(FloatRect(x, y, width, height));
+
+	char line[256];
+	snprintf(line, sizeof(line), "Frame %llu  %.2f ms%s", static_cast<unsigned long long>(frame.frame), frame.milliseconds, frame.dropped ? "  (events dropped)" : "");
+	painter.setTextFillColor(Color::White);
+	painter.drawText(Vector2D(x + 4.f, y + 4.f), line);
+
+	const GlyphRunCache::Statistics text = GlyphRunCache::instance().getStatistics();
+	snprintf(line, sizeof(line), "Text runs %u  %u vertices  %.1f%% hits", static_cast<unsigned int>(text.runs), static_cast<unsigned int>(text.vertices), text.getHitRate() * 100.f);
+	painter.drawText(Vector2D(x + 4.f, y + 4.f + lineHeight), line);
+
+	for (std::size_t i = 0; i < frame.zones.size(); ++i)
+	{
+		const Profiler::ZoneStats& zone = frame.zones[i];
+		snprintf(line, sizeof(line), "%-40s %8.3f ms  x%u", zone.zone->name, zone.totalMilliseconds, zone.calls);
+
+		// Zones that take a good part of the frame stand out
+		painter.setTextFillColor(zone.totalMilliseconds > frame.milliseconds * 0.25 ? Color(255, 200, 80) : Color(220, 220, 220));
+		painter.drawText(Vector2D(x + 4.f + zone.depth * 12.f, y + 4.f + lineHeight * (i + 2)), line);
+	}
+}
+
 NEPHILIM_NS_END
\ No newline at end of file
@@ -8,6 +8,9 @@
 #include FT_GLYPH_H
 #include FT_OUTLINE_H
 #include FT_BITMAP_H
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <cstdlib>
 #include <cstring>
 
@@ -36,6 +39,95 @@ namespace
 	void close(FT_Stream)
 	{
 	}
+
+	/// Distance transform of one row or column, squared distances in f to squared distances in d
+	/// From Felzenszwalb and Huttenlocher, "Distance Transforms of Sampled Functions"
+	void distanceTransform1D(const float* f, float* d, int n, std::vector<int>& v, std::vector<float>& z)
+	{
+		const float infinity = 1e20f;
+		int k = 0;
+		v[0] = 0;
+		z[0] = -infinity;
+		z[1] = infinity;
+
+		for (int q = 1; q < n; ++q)
+		{
+			float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+			while (s <= z[k])
+			{
+				--k;
+				s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+			}
+			++k;
+			v[k] = q;
+			z[k] = s;
+			z[k + 1] = infinity;
+		}
+
+		k = 0;
+		for (int q = 0; q < n; ++q)
+		{
+			while (z[k + 1] < q)
+				++k;
+			d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+		}
+	}
+
+	/// Squared distance from every cell to the nearest cell that was 0 in the grid
+	void distanceTransform(std::vector<float>& grid, int width, int height)
+	{
+		const int n = std::max(width, height);
+		std::vector<float> f(n), d(n), z(n + 1);
+		std::vector<int> v(n);
+
+		for (int x = 0; x < width; ++x)
+		{
+			for (int y = 0; y < height; ++y)
+				f[y] = grid[x + y * width];
+			distanceTransform1D(&f[0], &d[0], height, v, z);
+			for (int y = 0; y < height; ++y)
+				grid[x + y * width] = d[y];
+		}
+
+		for (int y = 0; y < height; ++y)
+		{
+			distanceTransform1D(&grid[y * width], &d[0], width, v, z);
+			std::copy(d.begin(), d.begin() + width, grid.begin() + y * width);
+		}
+	}
+
+	/// Header of a baked distance field atlas
+	struct AtlasHeader
+	{
+		char   magic[4];
+		Uint32 version;
+		Uint32 baseSize;
+		Uint32 spread;
+		Int32  lineSpacing;
+		Uint32 width;
+		Uint32 height;
+		Uint32 nextRow;
+		Uint32 rowCount;
+		Uint32 glyphCount;
+	};
+
+	/// A glyph of a baked atlas, metrics at the base size
+	struct AtlasGlyph
+	{
+		Uint32 key;
+		Int32  advance;
+		Int32  bounds[4];
+		Int32  textureRect[4];
+	};
+
+	const Uint32 AtlasVersion = 1;
+
+	/// Generations come from one counter, so fonts never share one
+	Uint64 nextGeneration()
+	{
+		static std::atomic<Uint64> counter(0);
+		return ++counter;
+	}
 }
 
 ////////////////////////////////////////////////////////////
@@ -43,7 +135,13 @@ Font::Font() :
 m_library  (NULL),
 m_face     (NULL),
 m_streamRec(NULL),
-m_refCount (NULL)
+m_refCount (NULL),
+m_distanceField(false),
+m_distanceFieldSize(48),
+m_distanceFieldSpread(6),
+m_distanceFieldSpacing(0),
+m_distanceFieldPage(NULL),
+m_generation(nextGeneration())
 {
 
 }
@@ -55,11 +153,19 @@ m_library    (copy.m_library),
 m_face       (copy.m_face),
 m_streamRec  (copy.m_streamRec),
 m_refCount   (copy.m_refCount),
-m_pages      (copy.m_pages),
-m_pixelBuffer(copy.m_pixelBuffer)
+m_pixelBuffer(copy.m_pixelBuffer),
+m_distanceField       (copy.m_distanceField),
+m_distanceFieldSize   (copy.m_distanceFieldSize),
+m_distanceFieldSpread (copy.m_distanceFieldSpread),
+m_distanceFieldSpacing(copy.m_distanceFieldSpacing),
+m_distanceFieldPage   (copy.m_distanceFieldPage ? new Page(*copy.m_distanceFieldPage) : NULL),
+m_generation          (nextGeneration())
 {
     // Note: as FreeType doesn't provide functions for copying/cloning,
     // we must share all the FreeType pointers
+    // The pages aren't shared, each font deletes its own, so the copy gets its own textures
+    for (PageTable::const_iterator it = copy.m_pages.begin(); it != copy.m_pages.end(); ++it)
+        m_pages[it->first] = new Page(*it->second);
 
     if (m_refCount)
         (*m_refCount)++;
@@ -229,6 +335,9 @@ bool Font::loadFromStream(File& stream)
 ////////////////////////////////////////////////////////////
 const Glyph& Font::getGlyph(Uint32 codePoint, unsigned int characterSize, bool bold) const
 {
+	if (m_distanceField)
+		return getDistanceFieldGlyph(codePoint, characterSize, bold);
+
 	// Ensure page existence
 	if(m_pages.find(characterSize) == m_pages.end())
 	{
@@ -267,7 +376,10 @@ int Font::getKerning(Uint32 first, Uint32 second, unsigned int characterSize) co
 
     FT_Face face = static_cast<FT_Face>(m_face);
 
-    if (face && FT_HAS_KERNING(face) && setCurrentSize(characterSize))
+    // Distance fields stay at their base size and scale, instead of resizing the face back and forth
+    unsigned int faceSize = m_distanceField ? m_distanceFieldSize : characterSize;
+
+    if (face && FT_HAS_KERNING(face) && setCurrentSize(faceSize))
     {
         // Convert the characters to indices
         FT_UInt index1 = FT_Get_Char_Index(face, first);
@@ -278,6 +390,8 @@ int Font::getKerning(Uint32 first, Uint32 second, unsigned int characterSize) co
         FT_Get_Kerning(face, index1, index2, FT_KERNING_DEFAULT, &kerning);
 
         // Return the X advance
+        if (m_distanceField)
+            return static_cast<int>(kerning.x) * static_cast<int>(characterSize) / static_cast<int>(faceSize) / 64;
         return kerning.x >> 6;
     }
     else
@@ -293,7 +407,15 @@ int Font::getLineSpacing(unsigned int characterSize) const
 {
     FT_Face face = static_cast<FT_Face>(m_face);
 
-    if (face && setCurrentSize(characterSize))
+    if (m_distanceField)
+    {
+        // Taken at the base size and scaled, from the face or else the baked atlas
+        int spacing = m_distanceFieldSpacing;
+        if (face && setCurrentSize(m_distanceFieldSize))
+            spacing = face->size->metrics.height >> 6;
+        return spacing * static_cast<int>(characterSize) / static_cast<int>(m_distanceFieldSize);
+    }
+    else if (face && setCurrentSize(characterSize))
     {
         return (face->size->metrics.height >> 6);
     }
@@ -307,13 +429,25 @@ int Font::getLineSpacing(unsigned int characterSize) const
 ////////////////////////////////////////////////////////////
 const Texture2D& Font::getTexture(unsigned int characterSize) const
 {
+	if (m_distanceField)
+	{
+		if (!m_distanceFieldPage)
+			m_distanceFieldPage = new Page();
+
+		m_distanceFieldPage->flush();
+		return m_distanceFieldPage->texture;
+	}
+
 	if(m_pages.find(characterSize) == m_pages.end())
 	{
 		m_pages[characterSize] = new Page();
 	}
-	const Texture2D& page = m_pages[characterSize]->texture;
-	
-    return page;
+
+	// Glyphs loaded since the last draw go up in one upload
+	Page& page = *m_pages[characterSize];
+	page.flush();
+
+    return page.texture;
 }
 
 
@@ -327,11 +461,224 @@ Font& Font::operator =(const Font& right)
     std::swap(m_pages,       temp.m_pages);
     std::swap(m_pixelBuffer, temp.m_pixelBuffer);
     std::swap(m_refCount,    temp.m_refCount);
+    std::swap(m_distanceField,        temp.m_distanceField);
+    std::swap(m_distanceFieldSize,    temp.m_distanceFieldSize);
+    std::swap(m_distanceFieldSpread,  temp.m_distanceFieldSpread);
+    std::swap(m_distanceFieldSpacing, temp.m_distanceFieldSpacing);
+    std::swap(m_distanceFieldPage,    temp.m_distanceFieldPage);
+    std::swap(m_scaledGlyphs,         temp.m_scaledGlyphs);
+    m_generation = nextGeneration();
 
     return *this;
 }
 
 
+////////////////////////////////////////////////////////////
+Uint64 Font::getGeneration() const
+{
+	return m_generation;
+}
+
+
+////////////////////////////////////////////////////////////
+void Font::enableDistanceField(unsigned int baseSize, unsigned int spread)
+{
+	delete m_distanceFieldPage;
+	m_distanceFieldPage = NULL;
+	m_scaledGlyphs.clear();
+
+	m_distanceField = true;
+	m_generation = nextGeneration();
+	m_distanceFieldSize = std::max(baseSize, 1u);
+	m_distanceFieldSpread = std::max(spread, 1u);
+
+	FT_Face face = static_cast<FT_Face>(m_face);
+	if (face && setCurrentSize(m_distanceFieldSize))
+		m_distanceFieldSpacing = face->size->metrics.height >> 6;
+}
+
+
+////////////////////////////////////////////////////////////
+bool Font::isDistanceField() const
+{
+	return m_distanceField;
+}
+
+
+////////////////////////////////////////////////////////////
+float Font::getDistanceFieldSmoothing(unsigned int characterSize) const
+{
+	// The field goes from 0 to 1 over twice the spread, in pixels of the base size
+	const float basePixelsPerScreenPixel = static_cast<float>(m_distanceFieldSize) / std::max(characterSize, 1u);
+	return std::min(0.5f, 0.7f * basePixelsPerScreenPixel / (2.f * m_distanceFieldSpread));
+}
+
+
+////////////////////////////////////////////////////////////
+void Font::preloadGlyphs(Uint32 first, Uint32 last, unsigned int characterSize, bool bold) const
+{
+	for (Uint32 codePoint = first; codePoint <= last && codePoint >= first; ++codePoint)
+		getGlyph(codePoint, characterSize, bold);
+}
+
+
+////////////////////////////////////////////////////////////
+bool Font::saveDistanceFieldAtlas(const String& filename) const
+{
+	if (!m_distanceField || !m_distanceFieldPage)
+	{
+		Log("Font: No distance field atlas to save to %s", filename.c_str());
+		return false;
+	}
+
+	const Page& page = *m_distanceFieldPage;
+
+	File file(filename, IODevice::BinaryWrite);
+	if (!file)
+	{
+		Log("Font: Can't write %s", filename.c_str());
+		return false;
+	}
+
+	AtlasHeader header;
+	std::memcpy(header.magic, "NXSD", 4);
+	header.version = AtlasVersion;
+	header.baseSize = m_distanceFieldSize;
+	header.spread = m_distanceFieldSpread;
+	header.lineSpacing = m_distanceFieldSpacing;
+	header.width = page.width;
+	header.height = page.height;
+	header.nextRow = page.nextRow;
+	header.rowCount = static_cast<Uint32>(page.rows.size());
+	header.glyphCount = static_cast<Uint32>(page.glyphs.size());
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	for (std::size_t i = 0; i < page.rows.size(); ++i)
+	{
+		Uint32 row[3] = { page.rows[i].width, page.rows[i].top, page.rows[i].height };
+		file.write(reinterpret_cast<const char*>(row), sizeof(row));
+	}
+
+	for (GlyphTable::const_iterator it = page.glyphs.begin(); it != page.glyphs.end(); ++it)
+	{
+		const Glyph& glyph = it->second;
+		AtlasGlyph record = { it->first, glyph.advance,
+			{ glyph.bounds.left, glyph.bounds.top, glyph.bounds.width, glyph.bounds.height },
+			{ glyph.textureRect.left, glyph.textureRect.top, glyph.textureRect.width, glyph.textureRect.height } };
+		file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+	}
+
+	// Only the alpha channel holds anything
+	std::vector<char> alpha(page.width * page.height);
+	for (std::size_t i = 0; i < alpha.size(); ++i)
+		alpha[i] = static_cast<char>(page.pixels[i * 4 + 3]);
+	file.write(&alpha[0], static_cast<Int64>(alpha.size()));
+
+	return true;
+}
+
+
+////////////////////////////////////////////////////////////
+bool Font::loadDistanceFieldAtlas(const String& filename)
+{
+	File file(filename, IODevice::BinaryRead);
+	if (!file)
+	{
+		Log("Font: Can't open distance field atlas %s", filename.c_str());
+		return false;
+	}
+
+	AtlasHeader header;
+	if (file.read(reinterpret_cast<char*>(&header), sizeof(header)) != sizeof(header) ||
+		std::memcmp(header.magic, "NXSD", 4) != 0 || header.version != AtlasVersion ||
+		header.width == 0 || header.height == 0 || header.width > Texture2D::getMaximumSize() || header.height > Texture2D::getMaximumSize() ||
+		header.nextRow > header.height)
+	{
+		Log("Font: %s is not a distance field atlas", filename.c_str());
+		return false;
+	}
+
+	// The counts size the allocations below, so they must add up to the file exactly
+	const Uint64 expectedSize = sizeof(AtlasHeader) + static_cast<Uint64>(header.rowCount) * 3 * sizeof(Uint32) +
+		static_cast<Uint64>(header.glyphCount) * sizeof(AtlasGlyph) + static_cast<Uint64>(header.width) * header.height;
+	if (file.getSize() < 0 || static_cast<Uint64>(file.getSize()) != expectedSize)
+	{
+		Log("Font: Distance field atlas %s doesn't match its header", filename.c_str());
+		return false;
+	}
+
+	std::vector<Uint32> rows(header.rowCount * 3);
+	std::vector<AtlasGlyph> glyphs(header.glyphCount);
+	std::vector<char> alpha(header.width * header.height);
+	if ((!rows.empty() && file.read(reinterpret_cast<char*>(&rows[0]), rows.size() * sizeof(Uint32)) != static_cast<Int64>(rows.size() * sizeof(Uint32))) ||
+		(!glyphs.empty() && file.read(reinterpret_cast<char*>(&glyphs[0]), glyphs.size() * sizeof(AtlasGlyph)) != static_cast<Int64>(glyphs.size() * sizeof(AtlasGlyph))) ||
+		file.read(&alpha[0], static_cast<Int64>(alpha.size())) != static_cast<Int64>(alpha.size()))
+	{
+		Log("Font: Distance field atlas %s is truncated", filename.c_str());
+		return false;
+	}
+
+	// Rows and glyphs must lie within the page, they are written into and drawn from it
+	for (Uint32 i = 0; i < header.rowCount; ++i)
+	{
+		const Uint64 width = rows[i * 3], top = rows[i * 3 + 1], height = rows[i * 3 + 2];
+		if (width > header.width || top + height > header.nextRow)
+		{
+			Log("Font: Distance field atlas %s has a row outside the page", filename.c_str());
+			return false;
+		}
+	}
+
+	for (Uint32 i = 0; i < header.glyphCount; ++i)
+	{
+		const Int32* rect = glyphs[i].textureRect;
+		if (rect[0] < 0 || rect[1] < 0 || rect[2] < 0 || rect[3] < 0 ||
+			static_cast<Uint64>(rect[0]) + static_cast<Uint64>(rect[2]) > header.width ||
+			static_cast<Uint64>(rect[1]) + static_cast<Uint64>(rect[3]) > header.height)
+		{
+			Log("Font: Distance field atlas %s has a glyph outside the page", filename.c_str());
+			return false;
+		}
+	}
+
+	enableDistanceField(header.baseSize, header.spread);
+	if (!m_face)
+		m_distanceFieldSpacing = header.lineSpacing;
+
+	Page* page = new Page();
+	page->width = header.width;
+	page->height = header.height;
+	page->nextRow = header.nextRow;
+	page->pixels.assign(header.width * header.height * 4, 255);
+	for (std::size_t i = 0; i < alpha.size(); ++i)
+		page->pixels[i * 4 + 3] = static_cast<Uint8>(alpha[i]);
+
+	for (Uint32 i = 0; i < header.rowCount; ++i)
+	{
+		page->rows.push_back(Row(rows[i * 3 + 1], rows[i * 3 + 2]));
+		page->rows.back().width = rows[i * 3];
+	}
+
+	for (Uint32 i = 0; i < header.glyphCount; ++i)
+	{
+		Glyph glyph;
+		glyph.advance = glyphs[i].advance;
+		glyph.bounds = IntRect(glyphs[i].bounds[0], glyphs[i].bounds[1], glyphs[i].bounds[2], glyphs[i].bounds[3]);
+		glyph.textureRect = IntRect(glyphs[i].textureRect[0], glyphs[i].textureRect[1], glyphs[i].textureRect[2], glyphs[i].textureRect[3]);
+		page->glyphs[glyphs[i].key] = glyph;
+	}
+
+	page->texture.create(page->width, page->height);
+	page->texture.update(&page->pixels[0]);
+	page->texture.setSmooth(true);
+	page->dirtyTop = page->dirtyBottom = 0;
+
+	m_distanceFieldPage = page;
+	m_generation = nextGeneration();
+	return true;
+}
+
+
 ////////////////////////////////////////////////////////////
 const Font& Font::getDefaultFont()
 {
@@ -364,6 +711,7 @@ void Font::cleanup()
 	{
 		delete it->second;
 	}
+	delete m_distanceFieldPage;
 
     // Check if we must destroy the FreeType pointers
     if (m_refCount)
@@ -398,6 +746,9 @@ void Font::cleanup()
     m_refCount  = NULL;
     m_pages.clear();
     m_pixelBuffer.clear();
+    m_distanceFieldPage = NULL;
+    m_scaledGlyphs.clear();
+    m_generation = nextGeneration();
 }
 
 ////////////////////////////////////////////////////////////
@@ -476,8 +827,8 @@ Glyph Font::loadGlyph(Uint32 codePoint, unsigned int characterSize, bool bold) c
         glyph.bounds.width  = width + 2 * padding;
         glyph.bounds.height = height + 2 * padding;
 
-        // Extract the glyph's pixels from the bitmap
-        m_pixelBuffer.resize(width * height * 4, 255);
+        // Extract the glyph's coverage from the bitmap
+        m_pixelBuffer.resize(width * height);
         const Uint8* pixels = bitmap.buffer;
         if (bitmap.pixel_mode == FT_PIXEL_MODE_MONO)
         {
@@ -486,8 +837,7 @@ Glyph Font::loadGlyph(Uint32 codePoint, unsigned int characterSize, bool bold) c
             {
                 for (int x = 0; x < width; ++x)
                 {
-                    // The color channels remain white, just fill the alpha channel
-                    std::size_t index = (x + y * width) * 4 + 3;
+                    std::size_t index = x + y * width;
                     m_pixelBuffer[index] = ((pixels[x / 8]) & (1 << (7 - (x % 8)))) ? 255 : 0;
                 }
                 pixels += bitmap.pitch;
@@ -500,20 +850,19 @@ Glyph Font::loadGlyph(Uint32 codePoint, unsigned int characterSize, bool bold) c
             {
                 for (int x = 0; x < width; ++x)
                 {
-                    // The color channels remain white, just fill the alpha channel
-                    std::size_t index = (x + y * width) * 4 + 3;
+                    std::size_t index = x + y * width;
                     m_pixelBuffer[index] = pixels[x];
                 }
                 pixels += bitmap.pitch;
             }
         }
 
-        // Write the pixels to the texture
+        // Write the pixels to the page, they are uploaded with the next getTexture()
         unsigned int x = glyph.textureRect.left + padding;
         unsigned int y = glyph.textureRect.top + padding;
         unsigned int w = glyph.textureRect.width - 2 * padding;
         unsigned int h = glyph.textureRect.height - 2 * padding;
-        page.texture.update(&m_pixelBuffer[0], w, h, x, y);
+        page.write(&m_pixelBuffer[0], w, h, x, y);
     }
 
     // Delete the FT glyph
@@ -539,7 +888,7 @@ IntRect Font::findGlyphRect(Page& page, unsigned int width, unsigned int height)
             continue;
 
         // Check if there's enough horizontal space left in the row
-        if (width > page.texture.getSize().x - it->width)
+        if (width > page.width - it->width)
             continue;
 
         // Make sure that this new row is the best found so far
@@ -555,25 +904,32 @@ IntRect Font::findGlyphRect(Page& page, unsigned int width, unsigned int height)
     if (!row)
     {
         int rowHeight = height + height / 10;
-        if (page.nextRow + rowHeight >= page.texture.getSize().y)
+        while (page.nextRow + rowHeight >= page.height || width > page.width)
         {
             // Not enough space: resize the texture if possible
-            unsigned int textureWidth  = page.texture.getSize().x;
-            unsigned int textureHeight = page.texture.getSize().y;
+            unsigned int textureWidth  = page.width;
+            unsigned int textureHeight = page.height;
             if ((textureWidth * 2 <= Texture2D::getMaximumSize()) && (textureHeight * 2 <= Texture2D::getMaximumSize()))
             {
-                // Make the texture 2 times bigger
-				Image pixels;
-				page.texture.copyToImage(pixels);
-				cout<<"CALL TO COPY TO IMAGE. BUG FOUND"<<endl;
-                page.texture.create(textureWidth * 2, textureHeight * 2);
-                page.texture.update(pixels);
+                // Make the texture 2 times bigger, from the copy kept in memory
+                std::vector<Uint8> pixels(textureWidth * 2 * textureHeight * 2 * 4, 255);
+                for (std::size_t i = 3; i < pixels.size(); i += 4)
+                    pixels[i] = 0;
+                for (unsigned int y = 0; y < textureHeight; ++y)
+                    std::memcpy(&pixels[y * textureWidth * 2 * 4], &page.pixels[y * textureWidth * 4], textureWidth * 4);
+
+                page.pixels.swap(pixels);
+                page.width = textureWidth * 2;
+                page.height = textureHeight * 2;
+                page.texture.create(page.width, page.height);
+                page.texture.update(&page.pixels[0]);
+                page.dirtyTop = page.dirtyBottom = 0;
+                m_generation = nextGeneration();
             }
             else
             {
                 // Oops, we've reached the maximum texture size...
-               // err() << "Failed to add a new character to the font: the maximum texture size has been reached" << std::endl;
-				cout<<" Failed to add a new character."<<endl;
+                Log("Font: Failed to add a new character, the maximum texture size has been reached");
                 return IntRect(0, 0, 2, 2);
             }
         }
@@ -594,6 +950,138 @@ IntRect Font::findGlyphRect(Page& page, unsigned int width, unsigned int height)
 }
 
 
+////////////////////////////////////////////////////////////
+const Glyph& Font::getDistanceFieldGlyph(Uint32 codePoint, unsigned int characterSize, bool bold) const
+{
+    Uint32 key = ((bold ? 1 : 0) << 31) | codePoint;
+
+    // Metrics already scaled to this size
+    GlyphTable& scaled = m_scaledGlyphs[characterSize];
+    GlyphTable::const_iterator it = scaled.find(key);
+    if (it != scaled.end())
+        return it->second;
+
+    if (!m_distanceFieldPage)
+        m_distanceFieldPage = new Page();
+
+    // Rasterized once at the base size, whatever size asked first
+    GlyphTable& baseGlyphs = m_distanceFieldPage->glyphs;
+    GlyphTable::const_iterator base = baseGlyphs.find(key);
+    if (base == baseGlyphs.end())
+        base = baseGlyphs.insert(std::make_pair(key, loadDistanceFieldGlyph(codePoint, bold))).first;
+
+    // Same place in the atlas, scaled quad
+    const float scale = static_cast<float>(characterSize) / m_distanceFieldSize;
+    const IntRect& bounds = base->second.bounds;
+    Glyph glyph;
+    glyph.advance = static_cast<int>(std::floor(base->second.advance * scale + 0.5f));
+    glyph.bounds.left = static_cast<int>(std::floor(bounds.left * scale + 0.5f));
+    glyph.bounds.top = static_cast<int>(std::floor(bounds.top * scale + 0.5f));
+    glyph.bounds.width = static_cast<int>(std::floor((bounds.left + bounds.width) * scale + 0.5f)) - glyph.bounds.left;
+    glyph.bounds.height = static_cast<int>(std::floor((bounds.top + bounds.height) * scale + 0.5f)) - glyph.bounds.top;
+    glyph.textureRect = base->second.textureRect;
+
+    return scaled.insert(std::make_pair(key, glyph)).first->second;
+}
+
+
+////////////////////////////////////////////////////////////
+Glyph Font::loadDistanceFieldGlyph(Uint32 codePoint, bool bold) const
+{
+    Glyph glyph;
+
+    FT_Face face = static_cast<FT_Face>(m_face);
+    if (!face || !setCurrentSize(m_distanceFieldSize))
+        return glyph;
+
+    // Hinting is for one size, the field is for all of them
+    if (FT_Load_Char(face, codePoint, FT_LOAD_TARGET_NORMAL | FT_LOAD_NO_HINTING) != 0)
+        return glyph;
+
+    FT_Glyph glyphDesc;
+    if (FT_Get_Glyph(face->glyph, &glyphDesc) != 0)
+        return glyph;
+
+    FT_Pos weight = 1 << 6;
+    bool outline = (glyphDesc->format == FT_GLYPH_FORMAT_OUTLINE);
+    if (bold && outline)
+    {
+        FT_OutlineGlyph outlineGlyph = (FT_OutlineGlyph)glyphDesc;
+        FT_Outline_Embolden(&outlineGlyph->outline, weight);
+    }
+
+    FT_Glyph_To_Bitmap(&glyphDesc, FT_RENDER_MODE_NORMAL, 0, 1);
+    FT_BitmapGlyph bitmapGlyph = (FT_BitmapGlyph)glyphDesc;
+    FT_Bitmap& bitmap = bitmapGlyph->bitmap;
+
+    if (bold && !outline)
+    {
+        FT_Bitmap_Embolden(static_cast<FT_Library>(m_library), &bitmap, weight, weight);
+    }
+
+    glyph.advance = glyphDesc->advance.x >> 16;
+    if (bold)
+        glyph.advance += weight >> 6;
+
+    const int bitmapWidth  = bitmap.width;
+    const int bitmapHeight = bitmap.rows;
+    if ((bitmapWidth > 0) && (bitmapHeight > 0))
+    {
+        // The field reaches spread pixels out of the outline, filtering needs one more
+        const int spread = static_cast<int>(m_distanceFieldSpread);
+        const int padding = spread + 1;
+        const int width = bitmapWidth + 2 * padding;
+        const int height = bitmapHeight + 2 * padding;
+
+        // Inside where the coverage is at least half
+        const float infinity = 1e20f;
+        std::vector<float> toInside(width * height, infinity);
+        std::vector<float> toOutside(width * height, 0.f);
+        const Uint8* pixels = bitmap.buffer;
+        for (int y = 0; y < bitmapHeight; ++y)
+        {
+            for (int x = 0; x < bitmapWidth; ++x)
+            {
+                bool inside = (bitmap.pixel_mode == FT_PIXEL_MODE_MONO) ? ((pixels[x / 8] & (1 << (7 - (x % 8)))) != 0) : (pixels[x] >= 128);
+                if (inside)
+                {
+                    std::size_t index = (x + padding) + (y + padding) * width;
+                    toInside[index] = 0.f;
+                    toOutside[index] = infinity;
+                }
+            }
+            pixels += bitmap.pitch;
+        }
+
+        distanceTransform(toInside, width, height);
+        distanceTransform(toOutside, width, height);
+
+        // 0.5 on the outline, 1 at spread pixels inside and 0 at spread pixels outside
+        m_pixelBuffer.resize(width * height);
+        for (int i = 0; i < width * height; ++i)
+        {
+            float distance = (toOutside[i] > 0.f) ? std::sqrt(toOutside[i]) - 0.5f : 0.5f - std::sqrt(toInside[i]);
+            float value = 0.5f + distance / (2.f * spread);
+            m_pixelBuffer[i] = static_cast<Uint8>(std::max(0.f, std::min(1.f, value)) * 255.f + 0.5f);
+        }
+
+        Page& page = *m_distanceFieldPage;
+        glyph.textureRect = findGlyphRect(page, width, height);
+        glyph.bounds.left   = bitmapGlyph->left - padding;
+        glyph.bounds.top    = -bitmapGlyph->top - padding;
+        glyph.bounds.width  = width;
+        glyph.bounds.height = height;
+
+        if (glyph.textureRect.width == width && glyph.textureRect.height == height)
+            page.write(&m_pixelBuffer[0], width, height, glyph.textureRect.left, glyph.textureRect.top);
+    }
+
+    FT_Done_Glyph(glyphDesc);
+
+    return glyph;
+}
+
+
 ////////////////////////////////////////////////////////////
 bool Font::setCurrentSize(unsigned int characterSize) const
 {
@@ -617,24 +1105,80 @@ bool Font::setCurrentSize(unsigned int characterSize) const
 ////////////////////////////////////////////////////////////
 Font::Page::Page()
 : nextRow(3)
+, width(512)
+, height(512)
+, dirtyTop(0)
+, dirtyBottom(0)
 {
     // Make sure that the texture is initialized by default
-    Image image;
-    image.create(512, 512, Color(255, 255, 255, 0));
+    pixels.assign(width * height * 4, 255);
+    for (std::size_t i = 3; i < pixels.size(); i += 4)
+        pixels[i] = 0;
 
     // Reserve a 2x2 white square for texturing underlines
-    for (int x = 0; x < 2; ++x)
-        for (int y = 0; y < 2; ++y)
-            image.setPixel(x, y, Color(255, 255, 255, 255));
+    for (unsigned int x = 0; x < 2; ++x)
+        for (unsigned int y = 0; y < 2; ++y)
+            pixels[(x + y * width) * 4 + 3] = 255;
 
     // Create the texture
-    texture.loadFromImage(image);
+    texture.create(width, height);
+    texture.update(&pixels[0]);
     texture.setSmooth(true);
+}
 
+////////////////////////////////////////////////////////////
+Font::Page::Page(const Page& copy)
+: glyphs(copy.glyphs)
+, nextRow(copy.nextRow)
+, rows(copy.rows)
+, pixels(copy.pixels)
+, width(copy.width)
+, height(copy.height)
+, dirtyTop(0)
+, dirtyBottom(0)
+{
+    // The copy gets a texture of its own, with everything written so far
+    texture.create(width, height);
+    texture.update(&pixels[0]);
+    texture.setSmooth(true);
 }
 
 Font::Page::~Page()
 {
 }
 
+////////////////////////////////////////////////////////////
+void Font::Page::write(const Uint8* alpha, unsigned int w, unsigned int h, unsigned int x, unsigned int y)
+{
+    // The color channels remain white, just fill the alpha channel
+    for (unsigned int row = 0; row < h; ++row)
+    {
+        Uint8* destination = &pixels[((y + row) * width + x) * 4 + 3];
+        for (unsigned int column = 0; column < w; ++column)
+            destination[column * 4] = alpha[row * w + column];
+    }
+
+    if (dirtyTop >= dirtyBottom)
+    {
+        dirtyTop = y;
+        dirtyBottom = y + h;
+    }
+    else
+    {
+        dirtyTop = std::min(dirtyTop, y);
+        dirtyBottom = std::max(dirtyBottom, y + h);
+    }
+}
+
+////////////////////////////////////////////////////////////
+void Font::Page::flush()
+{
+    if (dirtyTop >= dirtyBottom)
+        return;
+
+    // Whole rows are contiguous in the copy, so the band goes up without repacking
+    texture.update(&pixels[dirtyTop * width * 4], width, dirtyBottom - dirtyTop, 0, dirtyTop);
+    dirtyTop = dirtyBottom = 0;
+}
+
 NEPHILIM_NS_END
\ No newline at end of file
@@ -2,6 +2,12 @@
 
 NEPHILIM_NS_BEGIN
 
+/// Implementations release their resource when the owning Texture2D deletes them
+GDI_Texture2D::~GDI_Texture2D()
+{
+
+}
+
 /// Retrieve the texture from the GPU and into an image
 /// Does not work in OpenGL ES platforms. An warning is logged in such platforms.
 /// Returns false if the operation fails
@@ -41,6 +47,18 @@ bool GDI_Texture2D::loadFromImage(const Image& image)
 	return false;
 }
 
+/// Loads every level of a mipmap chain
+bool GDI_Texture2D::loadFromMipChain(const MipChain&)
+{
+	return false;
+}
+
+/// Build mipmaps for the images loaded from now on
+void GDI_Texture2D::setMipmapped(bool)
+{
+
+}
+
 
 /// Updates a given region inside the texture with an array of pixels
 void GDI_Texture2D::update(const Uint8* pixels, unsigned int width, unsigned int height, unsigned int x, unsigned int y)
@@ -2,4 +2,19 @@
 
 NEPHILIM_NS_BEGIN
 
-NEPHILIM_NS_END
\ No newline at end of file
+/// Implementations release their resource when deleted
+GDI_VertexBuffer::~GDI_VertexBuffer()
+{
+}
+
+/// Allocate size bytes, dropping the previous contents
+void GDI_VertexBuffer::allocate(std::size_t, bool)
+{
+}
+
+/// Overwrite size bytes starting at offset, without reallocating
+void GDI_VertexBuffer::write(const void*, std::size_t, std::size_t)
+{
+}
+
+NEPHILIM_NS_END
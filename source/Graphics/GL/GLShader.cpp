@@ -6,6 +6,15 @@
 
 NEPHILIM_NS_BEGIN
 
+namespace
+{
+	/// Marks the binding as unknown, it can't be a program name OpenGL hands out
+	const unsigned int UnknownProgram = 0xFFFFFFFF;
+
+	/// Program last bound through GLShader
+	unsigned int gBoundProgram = UnknownProgram;
+}
+
 /// Constructs an uninitialized shader
 /// The program identifier is initialized at 0.
 /// This means an invalid shader, which causes, not guaranteed, that the fixed-pipeline is activated
@@ -33,8 +42,13 @@ void GLShader::release()
 
 		glDeleteProgram(m_id);
 
+		// A new program may reuse the name, the binding can't be trusted anymore
+		if (gBoundProgram == m_id)
+			gBoundProgram = UnknownProgram;
+
 		m_shaders.clear();
 		m_attribs.clear();
+		m_uniforms.clear();
 		m_id = 0;
 	}
 }
@@ -161,7 +175,67 @@ bool GLShader::loadShader(ShaderTypes type, const char* source)
 /// Binds the shader to the GPU
 void GLShader::bind() const
 {
-	glUseProgram(static_cast<GLuint>(m_id));
+	if (gBoundProgram != m_id)
+	{
+		glUseProgram(static_cast<GLuint>(m_id));
+		gBoundProgram = m_id;
+	}
+}
+
+/// Check if this program is the one last bound through bind(), without querying OpenGL
+bool GLShader::isBound() const
+{
+	return m_id != 0 && gBoundProgram == m_id;
+}
+
+/// Forget which program is bound, the next bind() always reaches OpenGL
+void GLShader::forgetBoundProgram()
+{
+	gBoundProgram = UnknownProgram;
+}
+
+/// Get the location of an active uniform, or -1 if the program doesn't use it
+int GLShader::getUniformLocation(const String& uniform) const
+{
+	std::map<String, int>::const_iterator it = m_uniforms.find(uniform);
+	if (it != m_uniforms.end())
+		return it->second;
+
+	return -1;
+}
+
+/// Fill the uniform table from the active uniforms of the linked program
+void GLShader::reflectUniforms()
+{
+	m_uniforms.clear();
+
+	GLint uniformCount = 0;
+	GLint maxNameLength = 0;
+	glGetProgramiv(m_id, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(m_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+	if (uniformCount <= 0 || maxNameLength <= 0)
+		return;
+
+	std::vector<GLchar> nameBuffer(maxNameLength + 1);
+	for (GLint i = 0; i < uniformCount; ++i)
+	{
+		GLsizei nameLength = 0;
+		GLint arraySize = 0;
+		GLenum type = 0;
+		glGetActiveUniform(m_id, static_cast<GLuint>(i), maxNameLength, &nameLength, &arraySize, &type, &nameBuffer[0]);
+
+		String name(&nameBuffer[0], static_cast<std::size_t>(nameLength));
+		GLint location = glGetUniformLocation(m_id, name.c_str());
+		if (location == -1)
+			continue; // Built-in uniforms have no location
+
+		m_uniforms[name] = location;
+
+		// Arrays are reported as name[0], make them reachable by their plain name too
+		std::size_t bracket = name.find('[');
+		if (bracket != std::string::npos)
+			m_uniforms[String(name.substr(0, bracket))] = location;
+	}
 }
 
 unsigned int GLShader::getIdentifier()
@@ -224,13 +298,17 @@ bool GLShader::create()
 		else success = true;
 	}
 	m_id = static_cast<unsigned int>(id);
+
+	if (success)
+		reflectUniforms();
+
 	return success;
 }
 
 void GLShader::setUniformi(const String& uniform, int value)
 {
 	bind();
-	GLint uniform_id = glGetUniformLocation(m_id, uniform.c_str());
+	GLint uniform_id = getUniformLocation(uniform);
 	if(uniform_id != -1)
 	{
 		glUniform1i(uniform_id, value);
@@ -240,7 +318,7 @@ void GLShader::setUniformi(const String& uniform, int value)
 bool GLShader::setUniformMatrix(const String& uniform, const float* values)
 {
 	bind();
-	GLint uniform_id = glGetUniformLocation(m_id, uniform.c_str());
+	GLint uniform_id = getUniformLocation(uniform);
 	if(uniform_id != -1)
 	{
 		glUniformMatrix4fv(uniform_id, 1, GL_FALSE, values);
@@ -252,7 +330,7 @@ bool GLShader::setUniformMatrix(const String& uniform, const float* values)
 bool GLShader::setUniformVec4(const String& uniform, const float* values)
 {
 	bind();
-	GLint uniform_id = glGetUniformLocation(m_id, uniform.c_str());
+	GLint uniform_id = getUniformLocation(uniform);
 	if(uniform_id != -1)
 	{
 		glUniform4fv(uniform_id, 1, values);
@@ -264,7 +342,7 @@ bool GLShader::setUniformVec4(const String& uniform, const float* values)
 bool GLShader::setUniformVec3(const String& uniform, const float* values)
 {
 	bind();
-	GLint uniform_id = glGetUniformLocation(m_id, uniform.c_str());
+	GLint uniform_id = getUniformLocation(uniform);
 	if(uniform_id != -1)
 	{
 		glUniform3fv(uniform_id, 1, values);
@@ -276,7 +354,7 @@ bool GLShader::setUniformVec3(const String& uniform, const float* values)
 bool GLShader::setUniformFloat(const String& uniform, float value)
 {
 	bind();
-	GLint uniform_id = glGetUniformLocation(m_id, uniform.c_str());
+	GLint uniform_id = getUniformLocation(uniform);
 	if(uniform_id != -1)
 	{
 		glUniform1f(uniform_id, value);
@@ -288,7 +366,7 @@ bool GLShader::setUniformFloat(const String& uniform, float value)
 bool GLShader::setUniformTexture(const String& uniform, int textureUnit)
 {
 	bind();
-	GLint uniform_id = glGetUniformLocation(m_id, uniform.c_str());
+	GLint uniform_id = getUniformLocation(uniform);
 	if(uniform_id != -1)
 	{
 		glUniform1i(uniform_id, textureUnit);
@@ -1,13 +1,49 @@
 #include <Nephilim/Graphics/GL/GLTexture.h>
 #include <Nephilim/Graphics/GL/GLHelpers.h>
+#include <Nephilim/Graphics/MipChain.h>
 
 #include <Nephilim/Foundation/Image.h>
 #include <Nephilim/Foundation/Logging.h>
+#include <Nephilim/Foundation/Profiler.h>
 
 #include <string.h>
 
 NEPHILIM_NS_BEGIN
 
+namespace
+{
+	/// Marks the binding as unknown, it can't be a texture name OpenGL hands out
+	const unsigned int UnknownTexture = 0xFFFFFFFF;
+
+	/// Texture last bound through GLTexture2D at the active unit
+	unsigned int gBoundTexture = UnknownTexture;
+
+	/// Minification filter for the smoothing of a texture, sampling between levels when it has them
+	GLint getMinFilter(bool smooth, bool mipmaps)
+	{
+		if (mipmaps)
+			return smooth ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST_MIPMAP_NEAREST;
+
+		return smooth ? GL_LINEAR : GL_NEAREST;
+	}
+
+	/// Check if a texture of this size can have mipmaps
+	/// OpenGL ES 2 only allows them on non power of two textures with OES_texture_npot
+	bool canMipmap(const Vec2i& size)
+	{
+#ifdef NEPHILIM_GLES
+		if ((size.x & (size.x - 1)) == 0 && (size.y & (size.y - 1)) == 0)
+			return true;
+
+		static const bool npot = glGetString(GL_EXTENSIONS) && strstr(reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS)), "GL_OES_texture_npot") != NULL;
+		return npot;
+#else
+		(void)size;
+		return true;
+#endif
+	}
+}
+
 GLTexture2D::GLTexture2D()
 : m_size(0,0)
 , m_actualSize(0,0)
@@ -15,6 +51,8 @@ GLTexture2D::GLTexture2D()
 , m_pixelsFlipped(false)
 , m_isSmooth(false)
 , m_isRepeated(false)
+, m_isMipmapped(false)
+, m_hasMipmaps(false)
 {
 
 }
@@ -26,7 +64,11 @@ GLTexture2D::GLTexture2D(const GLTexture2D& other)
 , m_pixelsFlipped(false)
 , m_isSmooth(false)
 , m_isRepeated(false)
+, m_isMipmapped(false)
+, m_hasMipmaps(false)
 {
+	m_isMipmapped = other.m_isMipmapped;
+
 	if (other.m_texture)
 	{
 		Image img = other.copyToImage();
@@ -46,6 +88,11 @@ void GLTexture2D::unload()
 	{
 		GLuint tt = m_texture;
 		glDeleteTextures(1, &tt);
+
+		// OpenGL reverts the binding to 0 when deleting the bound texture
+		if (gBoundTexture == m_texture)
+			gBoundTexture = 0;
+
 		m_texture = 0;
 	}
 }
@@ -83,6 +130,7 @@ bool GLTexture2D::create(unsigned int width, unsigned int height)
 	m_size.y        = height;
 	m_actualSize    = actualSize;
 	m_pixelsFlipped = false;
+	m_hasMipmaps    = false;
 
 	//ensureGlContext();
 
@@ -99,7 +147,7 @@ bool GLTexture2D::create(unsigned int width, unsigned int height)
 	//priv::TextureSaver save;
 
 	// Initialize the texture
-	glBindTexture(GL_TEXTURE_2D, m_texture);
+	bind();
 
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_actualSize.x, m_actualSize.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, m_isRepeated ? GL_REPEAT : GL_CLAMP_TO_EDGE);
@@ -115,11 +163,24 @@ void GLTexture2D::generateMipMaps()
 #ifdef NEPHILIM_DESKTOP
 	bind();
 	glGenerateMipmapEXT(GL_TEXTURE_2D);
-	Log("Generated Mipmaps");
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	LOG_DEBUG(LogGraphics, "Generated mipmaps");
+	m_hasMipmaps = true;
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, getMinFilter(m_isSmooth, true));
 #endif
 }
 
+/// Build mipmaps for the images loaded from now on, gamma correct, with MipChain
+void GLTexture2D::setMipmapped(bool mipmapped)
+{
+	m_isMipmapped = mipmapped;
+}
+
+/// Check if images loaded from now on get mipmaps
+bool GLTexture2D::isMipmapped() const
+{
+	return m_isMipmapped;
+}
+
 ////////////////////////////////////////////////////////////
 void GLTexture2D::update(const Image& image)
 {
@@ -168,68 +229,81 @@ bool GLTexture2D::loadFromImage(const Image &image)
 		return false;
 	}
 
+	if (m_isMipmapped)
+	{
+		// Both halves show up in the profiler, MipChain::benchmark() compares the builds
+		MipChain chain;
+		{
+			PROFILE_ZONE("GLTexture2D::buildMipChain");
+			chain.build(image);
+		}
+
+		PROFILE_ZONE("GLTexture2D::uploadMipChain");
+		return loadFromMipChain(chain);
+	}
+
 	// Make sure the previous texture ceases to exist
 	// might need to optimize later by reusing
 	unload();
 
 	m_size = image.getSize();
 	m_actualSize = m_size;
+	m_hasMipmaps = false;
 	GLuint tt = 0;
 	glGenTextures(1, &tt);
 	m_texture = tt;
 
-	glBindTexture(GL_TEXTURE_2D, m_texture);
+	bind();
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.getSize().x, image.getSize().y, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.getPixelsPtr());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, m_isRepeated ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, m_isRepeated ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+
+	// The texture was just loaded, restore the server-side texture states
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, m_isSmooth ? GL_LINEAR : GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, m_isSmooth ? GL_LINEAR : GL_NEAREST);
+
+	return true;
+}
 
-	bool generateMipMaps = false;
-	if(!generateMipMaps)
+/// Load every level of a chain built beforehand, like on a loader thread
+bool GLTexture2D::loadFromMipChain(const MipChain& chain)
+{
+	if (chain.isEmpty())
 	{
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.getSize().x, image.getSize().y, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.getPixelsPtr());
-/*#ifdef NEPHILIM_DESKTOP
-		glGenerateMipmapEXT(GL_TEXTURE_2D);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-#else*/
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-//#endif
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, m_isRepeated ? GL_REPEAT : GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, m_isRepeated ? GL_REPEAT : GL_CLAMP_TO_EDGE);
-
-		// The texture was just loaded, restore the server-side texture states
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, m_isSmooth ? GL_LINEAR : GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, m_isSmooth ? GL_LINEAR : GL_NEAREST);
+		return false;
 	}
-	else
-	{
 
-		Vec2i currentSize = image.getSize();
-		Image scaledDown = image;
-		int i = 0;
-		bool done = false;
-		while(!done)
-		{
-			glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA, scaledDown.getSize().x, scaledDown.getSize().y, 0, GL_RGBA, GL_UNSIGNED_BYTE, scaledDown.getPixelsPtr());
-			if(scaledDown.getSize() == Vec2i(1,1))
-			{
-				// done
-				done = true;
-			}
-			else
-			{
-				scaledDown = scaledDown.scale(scaledDown.getSize().x  / 2, scaledDown.getSize().y / 2);
-				//scaledDown.saveToFile("wood" + String::number(i) + ".png");
-				currentSize = scaledDown.getSize();
-				i++;
-			}
-			Log("Uploaded mipmap level %d. Size(%d,%d)", i, scaledDown.getSize().x, scaledDown.getSize().y);			
-		}
-		Log("%d Mipmaps until reached %dx%d", i, currentSize.x, currentSize.y);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, m_isRepeated ? GL_REPEAT : GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, m_isRepeated ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+	unload();
+
+	m_size = chain.getLevelSize(0);
+	m_actualSize = m_size;
+	GLuint tt = 0;
+	glGenTextures(1, &tt);
+	m_texture = tt;
+
+	bind();
+
+	// Without mipmap support for this size, the texture would be incomplete with the lower levels
+	const int levelCount = canMipmap(m_size) ? chain.getLevelCount() : 1;
+	if (levelCount < chain.getLevelCount())
+		LOG_DEBUG(LogGraphics, "Only level 0 of the %dx%d texture was uploaded, mipmaps need power of two sizes here", m_size.x, m_size.y);
+
+	// Rows of RGBA pixels are always 4 byte aligned, every level goes straight from the chain
+	for (int i = 0; i < levelCount; ++i)
+	{
+		Vec2i size = chain.getLevelSize(i);
+		glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, chain.getLevelPixels(i));
 	}
 
+	// A chain goes down to 1x1, so it is complete even with a single level
+	m_hasMipmaps = levelCount > 1 || chain.getLevelCount() == 1;
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, m_isRepeated ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, m_isRepeated ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, m_isSmooth ? GL_LINEAR : GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, getMinFilter(m_isSmooth, m_hasMipmaps));
+
 	return true;
 }
 
@@ -275,7 +349,7 @@ Image GLTexture2D::copyToImage() const
 	if ((m_size == m_actualSize) && !m_pixelsFlipped)
 	{
 		// Texture is not padded nor flipped, we can use a direct copy
-		glBindTexture(GL_TEXTURE_2D, m_texture);
+		bind();
 #ifndef NEPHILIM_ANDROID
 		glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
 #else
@@ -288,7 +362,7 @@ Image GLTexture2D::copyToImage() const
 
 		// All the pixels will first be copied to a temporary array
 		std::vector<Uint8> allPixels(m_actualSize.x * m_actualSize.y * 4);
-		glBindTexture(GL_TEXTURE_2D, m_texture);
+		bind();
 		
 #ifndef NEPHILIM_ANDROID
 		glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, &allPixels[0]);
@@ -344,9 +418,9 @@ void GLTexture2D::setSmooth(bool smooth)
 			// Make sure that the current texture binding will be preserved
 			//priv::TextureSaver save;
 
-			glBindTexture(GL_TEXTURE_2D, m_texture);
+			bind();
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, m_isSmooth ? GL_LINEAR : GL_NEAREST);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, m_isSmooth ? GL_LINEAR : GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, getMinFilter(m_isSmooth, m_hasMipmaps));
 		}
 	}
 }
@@ -365,9 +439,16 @@ void GLTexture2D::update(const Uint8* pixels, unsigned int width, unsigned int h
 		//priv::TextureSaver save;
 
 		// Copy pixels from the given array to the texture
-		glBindTexture(GL_TEXTURE_2D, m_texture);
+		bind();
 		glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
 		m_pixelsFlipped = false;
+
+		// The lower levels still hold the old pixels, stop sampling them
+		if (m_hasMipmaps)
+		{
+			m_hasMipmaps = false;
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, getMinFilter(m_isSmooth, false));
+		}
 		//m_cacheId = getUniqueId();
 	}
 }
@@ -385,8 +466,24 @@ unsigned int GLTexture2D::getMaximumSize()
 
 void GLTexture2D::bind() const
 {
-	glBindTexture(GL_TEXTURE_2D, m_texture);
-};
+	if (gBoundTexture != m_texture)
+	{
+		glBindTexture(GL_TEXTURE_2D, m_texture);
+		gBoundTexture = m_texture;
+	}
+}
+
+/// Check if this texture is the one last bound through bind(), without querying OpenGL
+bool GLTexture2D::isBound() const
+{
+	return m_texture != 0 && gBoundTexture == m_texture;
+}
+
+/// Forget which texture is bound, the next bind() always reaches OpenGL
+void GLTexture2D::forgetBoundTexture()
+{
+	gBoundTexture = UnknownTexture;
+}
 
 /// Get the id of the currently bound texture for the currently set texture unit
 unsigned int GLTexture2D::getCurrentBoundTexture()
@@ -43,6 +43,21 @@ GLVertexBuffer::~GLVertexBuffer()
 	destroy();
 }
 
+/// Create the buffer if needed and allocate size bytes, streamed when dynamic
+void GLVertexBuffer::allocate(std::size_t size, bool dynamic)
+{
+	create();
+	bind();
+	resize(static_cast<Int32>(size), dynamic ? StreamDraw : StaticDraw);
+}
+
+/// Overwrite size bytes starting at offset, the buffer gets bound
+void GLVertexBuffer::write(const void* data, std::size_t size, std::size_t offset)
+{
+	bind();
+	update(data, static_cast<Int32>(size), static_cast<Int32>(offset));
+}
+
 /// Initializes the vertex buffer to a valid state
 void GLVertexBuffer::create()
 {
@@ -89,6 +104,15 @@ void GLVertexBuffer::upload(const VertexArray& vertexArray, StorageMode mode)
 	}
 }
 
+/// Overwrite <size> bytes of the buffer starting at <offset>, without reallocating it
+void GLVertexBuffer::update(const void* data, Int32 size, Int32 offset)
+{
+	if (mObject)
+	{
+		glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+	}
+}
+
 /// Initializes GPU memory with <size> bytes and the desired access mode
 void GLVertexBuffer::resize(Int32 size, StorageMode mode)
 {
@@ -47,8 +47,13 @@ RendererGLES2::RendererGLES2()
 /// This will cancel all shader-related settings and activate the default shader/fixed pipeline
 void RendererGLES2::setDefaultShader()
 {
-	m_defaultShader.bind();
-	m_activeShader = &m_defaultShader;
+	activateShader(&m_defaultShader);
+}
+
+/// Activates the shader for the next drawing calls
+void RendererGLES2::setShader(Shader& shader)
+{
+	activateShader(static_cast<GLShader*>(shader.shaderImpl));
 }
 
 void RendererGLES2::reloadDefaultShader()
@@ -70,7 +75,13 @@ void RendererGLES2::reloadDefaultShader()
 /// Draw a vertex array
 void RendererGLES2::draw(const VertexArray2D& varray, const RenderState& state)
 { 
-	if(!m_activeShader)
+	drawRange(varray, 0, varray.m_vertices.size());
+}
+
+/// Draw count vertices of a vertex array, starting at first
+void RendererGLES2::drawRange(const VertexArray2D& varray, std::size_t first, std::size_t count)
+{
+	if(!m_activeShader || count == 0 || first + count > varray.m_vertices.size())
 	{
 		return;
 	}
@@ -87,7 +98,7 @@ void RendererGLES2::draw(const VertexArray2D& varray, const RenderState& state)
 	setVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, true, sizeof(VertexArray2D::Vertex), data + 8);
 	setVertexAttribPointer(2, 2, GL_FLOAT, false, sizeof(VertexArray2D::Vertex), data + 12);
 
-	drawArrays(varray.geometryType, 0, varray.m_vertices.size());
+	drawArrays(varray.geometryType, static_cast<int>(first), static_cast<int>(count));
 
 	disableVertexAttribArray(0);
 	disableVertexAttribArray(1);
@@ -97,22 +108,22 @@ void RendererGLES2::draw(const VertexArray2D& varray, const RenderState& state)
 /// Set the current projection matrix
 void RendererGLES2::setProjectionMatrix(const mat4& projection)
 {
-	GraphicsDevice::setProjectionMatrix(projection);
-	if(m_activeShader) m_activeShader->setUniformMatrix("projection", projection.get());
+	if(changeMatrix(m_projection, projection) && m_activeShader)
+		m_activeShader->setUniformMatrix("projection", projection.get());
 }
 
 /// Set the current view matrix
 void RendererGLES2::setViewMatrix(const mat4& view)
 {
-	GraphicsDevice::setViewMatrix(view);
-	if(m_activeShader) m_activeShader->setUniformMatrix("view", view.get());
+	if(changeMatrix(m_view, view) && m_activeShader)
+		m_activeShader->setUniformMatrix("view", view.get());
 }
 
 /// Set the current model matrix
 void RendererGLES2::setModelMatrix(const mat4& model)
 {
-	GraphicsDevice::setModelMatrix(model);
-	if(m_activeShader) m_activeShader->setUniformMatrix("model", model.get());
+	if(changeMatrix(m_model, model) && m_activeShader)
+		m_activeShader->setUniformMatrix("model", model.get());
 }
 
 void RendererGLES2::applyView(const View &view)
@@ -132,6 +132,15 @@ void RendererOpenGL::draw(const VertexArray& vertexData)
 /// Draw a vertex array
 void RendererOpenGL::draw(const VertexArray2D& varray, const RenderState& state)
 {
+	drawRange(varray, 0, varray.m_vertices.size());
+}
+
+/// Draw count vertices of a vertex array, starting at first
+void RendererOpenGL::drawRange(const VertexArray2D& varray, std::size_t first, std::size_t count)
+{
+	if (count == 0 || first + count > varray.m_vertices.size())
+		return;
+
 	const char* data  = reinterpret_cast<const char*>(&varray.m_vertices[0]);
 
 	if(m_activeShader)
@@ -144,7 +153,7 @@ void RendererOpenGL::draw(const VertexArray2D& varray, const RenderState& state)
 		setVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, true, sizeof(VertexArray2D::Vertex), data + 8);
 		setVertexAttribPointer(2, 2, GL_FLOAT, false, sizeof(VertexArray2D::Vertex), data + 12);
 
-		drawArrays(varray.geometryType, 0, varray.m_vertices.size());
+		drawArrays(varray.geometryType, static_cast<int>(first), static_cast<int>(count));
 
 		disableVertexAttribArray(0);
 		disableVertexAttribArray(1);
@@ -160,7 +169,7 @@ void RendererOpenGL::draw(const VertexArray2D& varray, const RenderState& state)
 		glColorPointer(4, GL_UNSIGNED_BYTE,sizeof(VertexArray2D::Vertex), data + 8);
 		glTexCoordPointer(2, GL_FLOAT, sizeof(VertexArray2D::Vertex), data + 12);
 
-		drawArrays(varray.geometryType, 0, varray.m_vertices.size());
+		drawArrays(varray.geometryType, static_cast<int>(first), static_cast<int>(count));
 
 		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 		glDisableClientState(GL_COLOR_ARRAY);
@@ -173,39 +182,38 @@ void RendererOpenGL::setDefaultShader()
 {
 	if(m_shaderUsageHint)
 	{
-		m_activeShader = &m_defaultShader;
-		m_defaultShader.bind();
+		activateShader(&m_defaultShader);
 	}
 	else
 	{
 		m_activeShader = NULL;
 		glUseProgram(0);
+		GLShader::forgetBoundProgram();
 	}
 }
 
 /// Activates the shader for the next drawing calls
 void RendererOpenGL::setShader(Shader& shader)
 {
-	m_activeShader = (GLShader*)shader.shaderImpl;
-	static_cast<GLShader*>(shader.shaderImpl)->bind();
+	activateShader(static_cast<GLShader*>(shader.shaderImpl));
 }
 
 void RendererOpenGL::setProjectionMatrix(const mat4& projection)
 {
-	GraphicsDevice::setProjectionMatrix(projection);
-	if(m_activeShader) m_activeShader->setUniformMatrix("projection", projection.get());
+	if(changeMatrix(m_projection, projection) && m_activeShader)
+		m_activeShader->setUniformMatrix("projection", projection.get());
 }
 
 void RendererOpenGL::setViewMatrix(const mat4& view)
 {
-	GraphicsDevice::setViewMatrix(view);
-	if(m_activeShader) m_activeShader->setUniformMatrix("view", view.get());
+	if(changeMatrix(m_view, view) && m_activeShader)
+		m_activeShader->setUniformMatrix("view", view.get());
 }
 
 void RendererOpenGL::setModelMatrix(const mat4& model)
 {
-	GraphicsDevice::setModelMatrix(model);
-	if(m_activeShader) m_activeShader->setUniformMatrix("model", model.get());
+	if(changeMatrix(m_model, model) && m_activeShader)
+		m_activeShader->setUniformMatrix("model", model.get());
 }
 /*
 void RendererOpenGL::applyView(const View &view){
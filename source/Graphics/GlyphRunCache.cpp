@@ -0,0 +1,164 @@
+#include <Nephilim/Graphics/GlyphRunCache.h>
+#include <Nephilim/Graphics/Text.h>
+#include <Nephilim/Graphics/Font.h>
+
+#include <cstring>
+
+NEPHILIM_NS_BEGIN
+
+/// Fraction of the lookups that found their run, 0 without lookups
+float GlyphRunCache::Statistics::getHitRate() const
+{
+	return (hits + misses) > 0 ? static_cast<float>(hits) / static_cast<float>(hits + misses) : 0.f;
+}
+
+/// Creates a cache keeping up to capacity runs
+GlyphRunCache::GlyphRunCache(std::size_t capacity)
+: m_capacity(capacity > 0 ? capacity : 1)
+, m_vertexCount(0)
+, m_hits(0)
+, m_misses(0)
+, m_evictions(0)
+{
+}
+
+/// Get the run of a string, laying it out if it isn't kept or is stale
+const GlyphRunCache::Run& GlyphRunCache::get(const String& string, const Font& font, unsigned int characterSize, Uint32 style, const Color& color)
+{
+	makeKey(m_keyBuffer, string, font, characterSize, style, color);
+
+	std::unordered_map<std::string, EntryList::iterator>::iterator it = m_index.find(m_keyBuffer);
+	if (it != m_index.end())
+	{
+		// Most recently used goes first
+		m_entries.splice(m_entries.begin(), m_entries, it->second);
+
+		Run& run = it->second->run;
+		if (run.generation == font.getGeneration())
+		{
+			++m_hits;
+			return run;
+		}
+
+		// The glyph texture changed under it, lay it out again in place
+		++m_misses;
+		m_vertexCount -= run.vertices.m_vertices.size();
+		run.bounds = Text::buildGeometry(UString(string), font, characterSize, style, color, run.vertices);
+		run.generation = font.getGeneration();
+		m_vertexCount += run.vertices.m_vertices.size();
+		return run;
+	}
+
+	++m_misses;
+
+	m_entries.push_front(Entry());
+	Entry& entry = m_entries.front();
+	entry.key = m_keyBuffer;
+	entry.run.vertices.geometryType = Render::Primitive::Triangles;
+	entry.run.font = &font;
+	entry.run.characterSize = characterSize;
+
+	// Laying out may load glyphs and grow the texture, so the generation is read after
+	entry.run.bounds = Text::buildGeometry(UString(string), font, characterSize, style, color, entry.run.vertices);
+	entry.run.generation = font.getGeneration();
+
+	m_vertexCount += entry.run.vertices.m_vertices.size();
+	m_index[entry.key] = m_entries.begin();
+
+	evict();
+	return entry.run;
+}
+
+/// Draw a run with the current model matrix
+void GlyphRunCache::draw(GraphicsDevice* renderer, const Run& run)
+{
+	if (run.font && !run.vertices.m_vertices.empty())
+		Text::drawGeometry(renderer, *run.font, run.characterSize, run.vertices);
+}
+
+/// Change how many runs are kept, evicting the oldest if needed
+void GlyphRunCache::setCapacity(std::size_t capacity)
+{
+	m_capacity = capacity > 0 ? capacity : 1;
+	evict();
+}
+
+/// Get how many runs are kept at most
+std::size_t GlyphRunCache::getCapacity() const
+{
+	return m_capacity;
+}
+
+/// Forget every run
+void GlyphRunCache::clear()
+{
+	m_entries.clear();
+	m_index.clear();
+	m_vertexCount = 0;
+}
+
+/// Get the hit rate and size of the cache
+GlyphRunCache::Statistics GlyphRunCache::getStatistics() const
+{
+	Statistics statistics;
+	statistics.hits = m_hits;
+	statistics.misses = m_misses;
+	statistics.evictions = m_evictions;
+	statistics.runs = m_index.size();
+	statistics.vertices = m_vertexCount;
+	return statistics;
+}
+
+/// Start counting hits and misses from zero
+void GlyphRunCache::resetStatistics()
+{
+	m_hits = 0;
+	m_misses = 0;
+	m_evictions = 0;
+}
+
+/// Get the cache shared by the painters and the renderer
+GlyphRunCache& GlyphRunCache::instance()
+{
+	static GlyphRunCache cache;
+	return cache;
+}
+
+/// Pack everything a run depends on into one string
+void GlyphRunCache::makeKey(std::string& key, const String& string, const Font& font, unsigned int characterSize, Uint32 style, const Color& color)
+{
+	struct
+	{
+		const Font*  font;
+		Uint32       characterSize;
+		Uint32       style;
+		Uint8        color[4];
+	} fields;
+
+	std::memset(&fields, 0, sizeof(fields));
+	fields.font = &font;
+	fields.characterSize = characterSize;
+	fields.style = style;
+	fields.color[0] = color.r;
+	fields.color[1] = color.g;
+	fields.color[2] = color.b;
+	fields.color[3] = color.a;
+
+	key.assign(reinterpret_cast<const char*>(&fields), sizeof(fields));
+	key.append(string);
+}
+
+/// Drop the least recently used runs down to the capacity
+void GlyphRunCache::evict()
+{
+	while (m_index.size() > m_capacity)
+	{
+		Entry& oldest = m_entries.back();
+		m_vertexCount -= oldest.run.vertices.m_vertices.size();
+		m_index.erase(oldest.key);
+		m_entries.pop_back();
+		++m_evictions;
+	}
+}
+
+NEPHILIM_NS_END
@@ -12,9 +12,12 @@
 #include <Nephilim/Graphics/VertexArray.h>
 
 #include <Nephilim/Graphics/VertexBuffer.h>
+#include <Nephilim/Graphics/IndexBuffer.h>
 
 #include <Nephilim/Graphics/GL/GLTexture.h>
 
+#include <cstring>
+
 NEPHILIM_NS_BEGIN
 
 /// Global instance of graphics device, for the global calls
@@ -22,8 +25,15 @@ GraphicsDevice* gGlobalGraphicsDevice = nullptr;
 
 GraphicsDevice::GraphicsDevice()
 : m_type(Other)
+, m_activeShader(nullptr)
 , m_shaderUsageHint(true)
+, m_drawCallCount(0)
 {
+	m_stateStatistics.issued = 0;
+	m_stateStatistics.skipped = 0;
+	m_lastStateStatistics = m_stateStatistics;
+	invalidateStateCache();
+
 	m_primitiveTable[Render::Primitive::Triangles] = static_cast<int>(GL_TRIANGLES);
 	m_primitiveTable[Render::Primitive::TriangleFan] = static_cast<int>(GL_TRIANGLE_FAN);
 	m_primitiveTable[Render::Primitive::TriangleStrip] = static_cast<int>(GL_TRIANGLE_STRIP);
@@ -45,7 +55,28 @@ GraphicsDevice::GraphicsDevice()
 /// Ensure the graphics device releases its resources
 GraphicsDevice::~GraphicsDevice()
 {
+	if (gGlobalGraphicsDevice == this)
+		gGlobalGraphicsDevice = nullptr;
+}
+
+/// Create the implementation of a new Texture2D for this device
+GDI_Texture2D* GraphicsDevice::createTexture2D()
+{
+	return new GLTexture2D;
+}
 
+/// Create the implementation of a new VertexBuffer for this device
+GDI_VertexBuffer* GraphicsDevice::createVertexBuffer()
+{
+	return new GLVertexBuffer;
+}
+
+/// Create the index buffer if needed and fill it with the indices, replacing what it held
+void GraphicsDevice::uploadIndexBuffer(IndexBuffer* indexBuffer, const IndexArray& indices)
+{
+	indexBuffer->create();
+	indexBuffer->bind();
+	indexBuffer->upload(indices);
 }
 
 /// Returns the current graphics device
@@ -74,7 +105,22 @@ String GraphicsDevice::getName()
 /// Binds the texture at texture unit 0
 void GraphicsDevice::setTexture(const Texture2D& texture)
 {
-	static_cast<GLTexture2D*>(texture._impl)->bind();
+	GLTexture2D* glTexture = static_cast<GLTexture2D*>(texture._impl);
+
+	if (!m_textureUnitKnown)
+	{
+		glActiveTexture(GL_TEXTURE0);
+		m_textureUnitKnown = true;
+	}
+
+	if (glTexture->isBound())
+	{
+		++m_stateStatistics.skipped;
+		return;
+	}
+
+	glTexture->bind();
+	++m_stateStatistics.issued;
 }
 
 Window* GraphicsDevice::getWindow()
@@ -175,6 +221,15 @@ void GraphicsDevice::setBlendMode(Render::Blend::Mode mode)
 {
 	setBlendingEnabled(true);
 
+	if (m_blendMode == static_cast<int>(mode))
+	{
+		++m_stateStatistics.skipped;
+		return;
+	}
+
+	m_blendMode = static_cast<int>(mode);
+	++m_stateStatistics.issued;
+
 	switch(mode)
 	{
 		case Render::Blend::Add:
@@ -211,6 +266,15 @@ void GraphicsDevice::setBlendMode(Render::Blend::Mode mode)
 
 void GraphicsDevice::setBlendingEnabled(bool enable)
 {
+	if (m_blendingEnabled == static_cast<int>(enable))
+	{
+		++m_stateStatistics.skipped;
+		return;
+	}
+
+	m_blendingEnabled = static_cast<int>(enable);
+	++m_stateStatistics.issued;
+
 	if(enable) glEnable(GL_BLEND);
 	else		glDisable(GL_BLEND);
 }
@@ -234,6 +298,19 @@ void GraphicsDevice::setVertexBuffer(VertexBuffer* vertexBuffer)
 	}
 }
 
+/// Activates a given index buffer for any subsequent indexed draw calls
+void GraphicsDevice::setIndexBuffer(IndexBuffer* indexBuffer)
+{
+	if (indexBuffer)
+	{
+		indexBuffer->bind();
+	}
+	else
+	{
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+}
+
 void GraphicsDevice::setClippingEnabled(bool enable)
 {
 	if(enable) glEnable (GL_SCISSOR_TEST);
@@ -317,6 +394,15 @@ void GraphicsDevice::popClippingRect()
 
 void GraphicsDevice::setDepthTestEnabled(bool enable)
 {
+	if (m_depthTestEnabled == static_cast<int>(enable))
+	{
+		++m_stateStatistics.skipped;
+		return;
+	}
+
+	m_depthTestEnabled = static_cast<int>(enable);
+	++m_stateStatistics.issued;
+
 	if(enable) glEnable(GL_DEPTH_TEST);
 	else       glDisable(GL_DEPTH_TEST);
 }
@@ -350,7 +436,6 @@ void GraphicsDevice::setDefaultDepthTesting()
 /// Binds the default 1x1 full white texture at texture unit 0
 void GraphicsDevice::setDefaultTexture()
 {
-	glActiveTexture(GL_TEXTURE0);
 	setTexture(m_defaultTexture);
 }
 
@@ -459,9 +544,16 @@ void GraphicsDevice::drawDebugCircle(Vec2f center, float radius, Vec2f axis, Col
 
 void GraphicsDevice::drawArrays(Render::Primitive::Type primitiveType, int start, int count)
 {
+	++m_drawCallCount;
 	glDrawArrays(static_cast<GLenum>(m_primitiveTable[primitiveType]), static_cast<GLint>(start), static_cast<GLsizei>(count));
 }
 
+void GraphicsDevice::drawElements(Render::Primitive::Type primitiveType, int count, const void* indices)
+{
+	++m_drawCallCount;
+	glDrawElements(static_cast<GLenum>(m_primitiveTable[primitiveType]), static_cast<GLsizei>(count), GL_UNSIGNED_SHORT, static_cast<const GLvoid*>(indices));
+}
+
 void GraphicsDevice::enableVertexAttribArray(unsigned int index)
 {
 	glEnableVertexAttribArray(static_cast<GLuint>(index));
@@ -484,6 +576,24 @@ void GraphicsDevice::draw(const VertexArray2D& varray, const RenderState& state)
 	Log("Why are you calling draw on an abstract base class?");
 }
 
+/// Draw count vertices of a vertex array, starting at first
+void GraphicsDevice::drawRange(const VertexArray2D& varray, std::size_t first, std::size_t count)
+{
+	if (count == 0 || first + count > varray.m_vertices.size())
+		return;
+
+	if (first == 0 && count == varray.m_vertices.size())
+	{
+		draw(varray);
+		return;
+	}
+
+	VertexArray2D range(varray.geometryType, 0);
+	range.m_vertices.assign(varray.m_vertices.begin() + first, varray.m_vertices.begin() + first + count);
+	range.m_textured = varray.m_textured;
+	draw(range);
+}
+
 /// Draw a client-side vertex array with a index array
 void GraphicsDevice::draw(const VertexArray& vertexArray, const IndexArray& indexArray)
 {
@@ -526,6 +636,77 @@ void GraphicsDevice::setModelMatrix(const mat4& model)
 	m_model = model;
 }
 
+/// Make a shader the active program, its matrix uniforms are brought up to date when it changes
+void GraphicsDevice::activateShader(GLShader* shader)
+{
+	if (shader == m_activeShader && shader->isBound())
+	{
+		++m_stateStatistics.skipped;
+		return;
+	}
+
+	shader->bind();
+	++m_stateStatistics.issued;
+
+	// The matrices may have changed since this program was last active
+	if (shader != m_activeShader)
+	{
+		m_activeShader = shader;
+		m_activeShader->setUniformMatrix("projection", m_projection.get());
+		m_activeShader->setUniformMatrix("view", m_view.get());
+		m_activeShader->setUniformMatrix("model", m_model.get());
+		m_stateStatistics.issued += 3;
+	}
+}
+
+/// Store a new value for one of the matrices, returns false when it already held it
+bool GraphicsDevice::changeMatrix(mat4& current, const mat4& value)
+{
+	if (std::memcmp(current.get(), value.get(), sizeof(float) * 16) == 0)
+	{
+		++m_stateStatistics.skipped;
+		return false;
+	}
+
+	current = value;
+	++m_stateStatistics.issued;
+	return true;
+}
+
+/// Start counting state changes for a new frame and forget the shadowed state
+void GraphicsDevice::beginFrame()
+{
+	m_lastStateStatistics = m_stateStatistics;
+	m_stateStatistics.issued = 0;
+	m_stateStatistics.skipped = 0;
+
+	invalidateStateCache();
+}
+
+/// Forget the shadowed render state, so the next change of each kind reaches OpenGL
+void GraphicsDevice::invalidateStateCache()
+{
+	GLShader::forgetBoundProgram();
+	GLTexture2D::forgetBoundTexture();
+
+	m_blendMode = -1;
+	m_blendingEnabled = -1;
+	m_depthTestEnabled = -1;
+	m_textureUnitKnown = false;
+}
+
+/// Get the counters of state changes of the last finished frame
+GraphicsDevice::StateStatistics GraphicsDevice::getStateStatistics() const
+{
+	return m_lastStateStatistics;
+}
+
+/// Get how many draw calls were made through drawArrays() and drawElements() since the device was created
+Uint64 GraphicsDevice::getDrawCallCount() const
+{
+	return m_drawCallCount;
+}
+
 /// The renderer always has a target resolution to operate
 /// On windowed mode, its the size of the window's client area and in fullscreen the native resolution we're running at
 int GraphicsDevice::resolutionWidth()
@@ -1,4 +1,5 @@
 #include <Nephilim/Graphics/IndexBuffer.h>
+#include <Nephilim/Graphics/IndexArray.h>
 #include <Nephilim/Graphics/GL/GLHelpers.h>
 
 NEPHILIM_NS_BEGIN
@@ -44,4 +45,19 @@ void IndexBuffer::bind()
 	}
 }
 
+/// Upload the indices to the GPU memory, the buffer must be bound
+void IndexBuffer::upload(const IndexArray& indexArray)
+{
+	if(mObject > 0)
+	{
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexArray.size() * sizeof(Uint16), indexArray.data(), GL_STATIC_DRAW);
+	}
+}
+
+/// Check if the buffer is valid (initialized)
+IndexBuffer::operator bool() const
+{
+	return (mObject > 0);
+}
+
 NEPHILIM_NS_END
\ No newline at end of file
@@ -0,0 +1,458 @@
+#include <Nephilim/Graphics/MipChain.h>
+#include <Nephilim/Foundation/Image.h>
+#include <Nephilim/Foundation/JobSystem.h>
+#include <Nephilim/Foundation/Clock.h>
+#include <Nephilim/Foundation/Logging.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+#if defined NEPHILIM_SIMD_SSE
+	#include <emmintrin.h>
+#endif
+
+NEPHILIM_NS_BEGIN
+
+namespace
+{
+	/// Levels with fewer pixels than this are built on the calling thread
+	const int parallelPixels = 256 * 256;
+
+	/// Pixels each job of a level builds, about
+	const int pixelsPerJob = 32 * 1024;
+
+	/// Entries of the linear to sRGB table, enough that every sRGB value survives a round trip
+	const int encodeSteps = 16384;
+
+	/// Conversions between 8 bit values and linear floats
+	struct ColorTables
+	{
+		float unorm[256];          ///< Value / 255
+		float srgbToLinear[256];
+		Uint8 linearToSrgb[encodeSteps];
+
+		ColorTables()
+		{
+			for (int i = 0; i < 256; ++i)
+			{
+				float c = static_cast<float>(i) / 255.f;
+				unorm[i] = c;
+				srgbToLinear[i] = (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+
+			for (int i = 0; i < encodeSteps; ++i)
+			{
+				float c = static_cast<float>(i) / static_cast<float>(encodeSteps - 1);
+				float s = (c <= 0.0031308f) ? c * 12.92f : 1.055f * std::pow(c, 1.f / 2.4f) - 0.055f;
+				linearToSrgb[i] = static_cast<Uint8>(std::min(std::max(s * 255.f + 0.5f, 0.f), 255.f));
+			}
+		}
+	};
+
+	const ColorTables& getColorTables()
+	{
+		static const ColorTables tables;
+		return tables;
+	}
+
+	/// Source pixels making one destination pixel along one axis, and how much each counts
+	struct Taps
+	{
+		int   index[3];
+		float weight[3];
+		int   count;
+	};
+
+	/// Compute the taps of every destination position along an axis
+	void computeTaps(int sourceSize, int size, std::vector<Taps>& taps)
+	{
+		taps.resize(size);
+		for (int d = 0; d < size; ++d)
+		{
+			Taps& t = taps[d];
+			if (sourceSize == 1)
+			{
+				t.count = 1;
+				t.index[0] = 0;
+				t.weight[0] = 1.f;
+			}
+			else if (sourceSize % 2 == 0)
+			{
+				t.count = 2;
+				t.index[0] = 2 * d;
+				t.index[1] = 2 * d + 1;
+				t.weight[0] = t.weight[1] = 0.5f;
+			}
+			else
+			{
+				// 2n+1 pixels shrink to n, each destination pixel covers 2+1/n of them
+				float total = static_cast<float>(2 * size + 1);
+				t.count = 3;
+				t.index[0] = 2 * d;
+				t.index[1] = 2 * d + 1;
+				t.index[2] = 2 * d + 2;
+				t.weight[0] = static_cast<float>(size - d) / total;
+				t.weight[1] = static_cast<float>(size) / total;
+				t.weight[2] = static_cast<float>(d + 1) / total;
+			}
+		}
+	}
+
+	/// Everything the rows of a level need
+	struct LevelJob
+	{
+		const Uint8*        source;
+		int                 sourceWidth;
+		Uint8*              destination;
+		int                 width;
+		const Taps*         columns;
+		const Taps*         rows;
+		const float*        decode;      ///< Color channels to linear floats
+		const ColorTables*  tables;
+		bool                gammaCorrect;
+	};
+
+	/// Store a linear RGBA color
+	inline void encodePixel(const LevelJob& job, const float* color, Uint8* out)
+	{
+		if (job.gammaCorrect)
+		{
+			const float scale = static_cast<float>(encodeSteps - 1);
+			out[0] = job.tables->linearToSrgb[static_cast<int>(std::min(color[0], 1.f) * scale + 0.5f)];
+			out[1] = job.tables->linearToSrgb[static_cast<int>(std::min(color[1], 1.f) * scale + 0.5f)];
+			out[2] = job.tables->linearToSrgb[static_cast<int>(std::min(color[2], 1.f) * scale + 0.5f)];
+		}
+		else
+		{
+			out[0] = static_cast<Uint8>(std::min(color[0], 1.f) * 255.f + 0.5f);
+			out[1] = static_cast<Uint8>(std::min(color[1], 1.f) * 255.f + 0.5f);
+			out[2] = static_cast<Uint8>(std::min(color[2], 1.f) * 255.f + 0.5f);
+		}
+		out[3] = static_cast<Uint8>(std::min(color[3], 1.f) * 255.f + 0.5f);
+	}
+
+	/// Filter rows [first, last) of a level through the taps, in linear floats
+	void filterRows(const LevelJob& job, int first, int last)
+	{
+		const std::size_t sourceStride = static_cast<std::size_t>(job.sourceWidth) * 4;
+		const float* decode = job.decode;
+		const float* unorm = job.tables->unorm;
+
+		for (int y = first; y < last; ++y)
+		{
+			const Taps& ty = job.rows[y];
+			Uint8* out = job.destination + static_cast<std::size_t>(y) * job.width * 4;
+
+			for (int x = 0; x < job.width; ++x, out += 4)
+			{
+				const Taps& tx = job.columns[x];
+				float color[4];
+
+#if defined NEPHILIM_SIMD_SSE
+				__m128 sum = _mm_setzero_ps();
+				for (int j = 0; j < ty.count; ++j)
+				{
+					const Uint8* row = job.source + ty.index[j] * sourceStride;
+					for (int i = 0; i < tx.count; ++i)
+					{
+						const Uint8* p = row + tx.index[i] * 4;
+						__m128 value = _mm_set_ps(unorm[p[3]], decode[p[2]], decode[p[1]], decode[p[0]]);
+						sum = _mm_add_ps(sum, _mm_mul_ps(value, _mm_set1_ps(ty.weight[j] * tx.weight[i])));
+					}
+				}
+				_mm_storeu_ps(color, sum);
+#else
+				color[0] = color[1] = color[2] = color[3] = 0.f;
+				for (int j = 0; j < ty.count; ++j)
+				{
+					const Uint8* row = job.source + ty.index[j] * sourceStride;
+					for (int i = 0; i < tx.count; ++i)
+					{
+						const Uint8* p = row + tx.index[i] * 4;
+						const float w = ty.weight[j] * tx.weight[i];
+						color[0] += decode[p[0]] * w;
+						color[1] += decode[p[1]] * w;
+						color[2] += decode[p[2]] * w;
+						color[3] += unorm[p[3]] * w;
+					}
+				}
+#endif
+
+				encodePixel(job, color, out);
+			}
+		}
+	}
+
+	/// Average 2x2 blocks of rows [first, last) in linear space, for gamma correct levels of even size
+	void averageGammaRows(const LevelJob& job, int first, int last)
+	{
+		const std::size_t sourceStride = static_cast<std::size_t>(job.sourceWidth) * 4;
+		const float* decode = job.decode;
+		const Uint8* encode = job.tables->linearToSrgb;
+		const float colorScale = static_cast<float>(encodeSteps - 1) / 4.f;
+
+		for (int y = first; y < last; ++y)
+		{
+			const Uint8* a = job.source + static_cast<std::size_t>(2 * y) * sourceStride;
+			const Uint8* b = a + sourceStride;
+			Uint8* out = job.destination + static_cast<std::size_t>(y) * job.width * 4;
+
+			for (int x = 0; x < job.width; ++x, a += 8, b += 8, out += 4)
+			{
+				for (int c = 0; c < 3; ++c)
+				{
+					float sum = decode[a[c]] + decode[a[c + 4]] + decode[b[c]] + decode[b[c + 4]];
+					out[c] = encode[static_cast<int>(sum * colorScale + 0.5f)];
+				}
+				out[3] = static_cast<Uint8>((a[3] + a[7] + b[3] + b[7] + 2) >> 2);
+			}
+		}
+	}
+
+	/// Average 2x2 blocks of rows [first, last) straight on the bytes, for linear levels of even size
+	void averageRows(const LevelJob& job, int first, int last)
+	{
+		const std::size_t sourceStride = static_cast<std::size_t>(job.sourceWidth) * 4;
+
+		for (int y = first; y < last; ++y)
+		{
+			const Uint8* a = job.source + static_cast<std::size_t>(2 * y) * sourceStride;
+			const Uint8* b = a + sourceStride;
+			Uint8* out = job.destination + static_cast<std::size_t>(y) * job.width * 4;
+			int x = 0;
+
+#if defined NEPHILIM_SIMD_SSE
+			// Four source pixels of each row make two destination pixels
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i two = _mm_set1_epi16(2);
+			for (; x + 2 <= job.width; x += 2, a += 16, b += 16, out += 8)
+			{
+				__m128i top = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+				__m128i bottom = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+
+				// Vertical sums of pixels 0,1 and 2,3 in 16 bits
+				__m128i low = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+				__m128i high = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+
+				// Horizontal sums, pixel 0+1 in the low half of low and 2+3 in the low half of high
+				low = _mm_add_epi16(low, _mm_srli_si128(low, 8));
+				high = _mm_add_epi16(high, _mm_srli_si128(high, 8));
+
+				__m128i sum = _mm_unpacklo_epi64(low, high);
+				sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(sum, sum));
+			}
+#endif
+
+			for (; x < job.width; ++x, a += 8, b += 8, out += 4)
+			{
+				for (int c = 0; c < 4; ++c)
+					out[c] = static_cast<Uint8>((a[c] + a[c + 4] + b[c] + b[c + 4] + 2) >> 2);
+			}
+		}
+	}
+}
+
+/// Creates an empty chain
+MipChain::MipChain()
+{
+}
+
+/// Build the chain of a width x height RGBA image, replacing the previous one
+/// Returns false if the image is empty
+bool MipChain::build(const Uint8* pixels, int width, int height, bool gammaCorrect, JobSystem* jobs)
+{
+	if (!pixels || width <= 0 || height <= 0)
+	{
+		clear();
+		return false;
+	}
+
+	// Lay every level out first, so the buffer is allocated once, or reused from the previous chain
+	int count = getLevelCount(width, height);
+	m_levels.resize(count);
+
+	std::size_t size = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		m_levels[i].width = std::max(width >> i, 1);
+		m_levels[i].height = std::max(height >> i, 1);
+		m_levels[i].offset = size;
+		size += static_cast<std::size_t>(m_levels[i].width) * m_levels[i].height * 4;
+	}
+
+	m_pixels.resize(size);
+	memcpy(&m_pixels[0], pixels, static_cast<std::size_t>(width) * height * 4);
+
+	const ColorTables& tables = getColorTables();
+	std::vector<Taps> columns, rows;
+
+	for (int i = 1; i < count; ++i)
+	{
+		const Level& source = m_levels[i - 1];
+		const Level& level = m_levels[i];
+
+		computeTaps(source.width, level.width, columns);
+		computeTaps(source.height, level.height, rows);
+
+		LevelJob job;
+		job.source = &m_pixels[source.offset];
+		job.sourceWidth = source.width;
+		job.destination = &m_pixels[level.offset];
+		job.width = level.width;
+		job.columns = &columns[0];
+		job.rows = &rows[0];
+		job.decode = gammaCorrect ? tables.srgbToLinear : tables.unorm;
+		job.tables = &tables;
+		job.gammaCorrect = gammaCorrect;
+
+		// Even sizes are plain 2x2 averages, which skip the taps
+		void (*kernel)(const LevelJob&, int, int) = filterRows;
+		if (source.width % 2 == 0 && source.height % 2 == 0)
+			kernel = gammaCorrect ? averageGammaRows : averageRows;
+
+		if (jobs && level.width * level.height >= parallelPixels)
+		{
+			std::size_t grain = static_cast<std::size_t>(std::max(pixelsPerJob / level.width, 1));
+			jobs->parallelFor(0, static_cast<std::size_t>(level.height), grain, [&job, kernel](std::size_t first, std::size_t last)
+			{
+				kernel(job, static_cast<int>(first), static_cast<int>(last));
+			});
+		}
+		else
+		{
+			kernel(job, 0, level.height);
+		}
+	}
+
+	return true;
+}
+
+/// Build the chain of an image, replacing the previous one
+bool MipChain::build(const Image& image, bool gammaCorrect, JobSystem* jobs)
+{
+	return build(image.getPixelsPtr(), image.getSize().x, image.getSize().y, gammaCorrect, jobs);
+}
+
+/// Release the levels
+void MipChain::clear()
+{
+	std::vector<Level>().swap(m_levels);
+	std::vector<Uint8>().swap(m_pixels);
+}
+
+/// Check if there are no levels
+bool MipChain::isEmpty() const
+{
+	return m_levels.empty();
+}
+
+/// Get the number of levels, 0 while empty
+int MipChain::getLevelCount() const
+{
+	return static_cast<int>(m_levels.size());
+}
+
+/// Get the size of a level
+Vec2i MipChain::getLevelSize(int level) const
+{
+	return Vec2i(m_levels[level].width, m_levels[level].height);
+}
+
+/// Get the pixels of a level, tightly packed rows of RGBA
+const Uint8* MipChain::getLevelPixels(int level) const
+{
+	return &m_pixels[m_levels[level].offset];
+}
+
+/// Get the bytes used by every level together
+std::size_t MipChain::getByteSize() const
+{
+	return m_pixels.size();
+}
+
+/// Get how many levels a full chain of a width x height image has
+int MipChain::getLevelCount(int width, int height)
+{
+	int size = std::max(width, height);
+	int count = 1;
+	while (size > 1)
+	{
+		size >>= 1;
+		++count;
+	}
+	return count;
+}
+
+namespace
+{
+	/// Milliseconds per round, since the clock was reset
+	double perRound(Clock& clock, std::size_t rounds)
+	{
+		double elapsed = static_cast<double>(clock.getElapsedTime().microseconds());
+		clock.reset();
+		return elapsed / 1000.0 / static_cast<double>(rounds);
+	}
+}
+
+/// Log how long the chain of a width x height image takes to build, against the old Image::scale levels
+void MipChain::benchmark(int width, int height, std::size_t rounds, JobSystem* jobs)
+{
+	if (width <= 0 || height <= 0 || rounds == 0)
+		return;
+
+	// Noise, so no path gets to skip work on flat areas
+	std::vector<Uint8> pixels(static_cast<std::size_t>(width) * height * 4);
+	Uint32 seed = 2463534242u;
+	for (std::size_t i = 0; i < pixels.size(); ++i)
+	{
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		pixels[i] = static_cast<Uint8>(seed >> 24);
+	}
+
+	Image image;
+	image.create(width, height, &pixels[0]);
+
+	MipChain chain;
+	Clock clock;
+
+	// What mipmapping used to do, a nearest neighbor copy of the image per level
+	for (std::size_t round = 0; round < rounds; ++round)
+	{
+		for (int level = 1; level < getLevelCount(width, height); ++level)
+			image.scale(std::max(width >> level, 1), std::max(height >> level, 1));
+	}
+	const double scaled = perRound(clock, rounds);
+
+	for (std::size_t round = 0; round < rounds; ++round)
+		chain.build(&pixels[0], width, height, true);
+	const double gamma = perRound(clock, rounds);
+
+	for (std::size_t round = 0; round < rounds; ++round)
+		chain.build(&pixels[0], width, height, false);
+	const double linear = perRound(clock, rounds);
+
+	Log("MipChain: %dx%d, %d levels, %u rounds, time per chain", width, height, getLevelCount(width, height), static_cast<unsigned int>(rounds));
+	Log("  Image::scale levels: %.2f ms", scaled);
+	Log("  gamma correct:       %.2f ms", gamma);
+	Log("  linear:              %.2f ms", linear);
+
+	if (jobs)
+	{
+		for (std::size_t round = 0; round < rounds; ++round)
+			chain.build(&pixels[0], width, height, true, jobs);
+		const double gammaJobs = perRound(clock, rounds);
+
+		for (std::size_t round = 0; round < rounds; ++round)
+			chain.build(&pixels[0], width, height, false, jobs);
+		const double linearJobs = perRound(clock, rounds);
+
+		Log("  gamma correct, jobs: %.2f ms", gammaJobs);
+		Log("  linear, jobs:        %.2f ms", linearJobs);
+	}
+}
+
+NEPHILIM_NS_END
@@ -1,5 +1,7 @@
 #include <Nephilim/Graphics/Skeleton.h>
 
+#include <algorithm>
+
 NEPHILIM_NS_BEGIN
 
 Int32 Skeleton::getIndexFromName(const String& name)
@@ -12,29 +14,70 @@ Int32 Skeleton::getIndexFromName(const String& name)
 	return 0;
 }
 
-mat4 makeAbsoluteTransform(std::vector<mat4>& boneTransforms, int bone_id, Skeleton& skeleton)
+/// Prepare the order bones are evaluated in, parents always come before their children
+void Skeleton::compile()
 {
-	mat4 boneTransform = boneTransforms[bone_id];
+	// Depth of each bone in the hierarchy, -1 while unknown
+	std::vector<Int32> depth(bones.size(), -1);
 
-	int parentID = skeleton.bones[bone_id].parentId;
-	if(parentID >= 0)
+	for(std::size_t i = 0; i < bones.size(); ++i)
 	{
-		boneTransform = makeAbsoluteTransform(boneTransforms, parentID, skeleton) * boneTransform;
+		// Walk up until a bone with known depth or the root, bounded in case of broken data
+		Int32 d = 0;
+		Int32 current = static_cast<Int32>(i);
+		while(current >= 0 && current < static_cast<Int32>(bones.size()) && depth[current] < 0 && d <= static_cast<Int32>(bones.size()))
+		{
+			current = bones[current].parentId;
+			++d;
+		}
+
+		Int32 base = (current >= 0 && current < static_cast<Int32>(bones.size())) ? depth[current] + 1 : 0;
+
+		// Fill in the chain we just walked
+		current = static_cast<Int32>(i);
+		for(Int32 k = d - 1; k >= 0; --k)
+		{
+			depth[current] = base + k;
+			current = bones[current].parentId;
+		}
 	}
 
-	return boneTransform;
+	mEvaluationOrder.resize(bones.size());
+	for(std::size_t i = 0; i < bones.size(); ++i)
+		mEvaluationOrder[i] = static_cast<Int32>(i);
+
+	std::stable_sort(mEvaluationOrder.begin(), mEvaluationOrder.end(), [&depth](Int32 a, Int32 b)
+	{
+		return depth[a] < depth[b];
+	});
 }
 
-/// Takes an array of bone transforms in their local spaces and converts them to transformed global space
-void Skeleton::convertToWorldSpace(std::vector<mat4>& localBoneTransforms)
+/// Computes the global transform of every bone from its local transform in a single pass
+void Skeleton::computeWorldPose(const mat4* localBoneTransforms, mat4* worldBoneTransforms)
 {
-	std::vector<mat4> transforms_copy = localBoneTransforms;
+	if(mEvaluationOrder.size() != bones.size())
+		compile();
 
-	// For each bone, compute the global transform of the bone
-	for(std::size_t i = 0; i < bones.size(); ++i)
+	for(std::size_t i = 0; i < mEvaluationOrder.size(); ++i)
 	{
-		localBoneTransforms[i] = makeAbsoluteTransform(transforms_copy, i, *this);
+		Int32 bone = mEvaluationOrder[i];
+		Int32 parentID = bones[bone].parentId;
+
+		// The parent was already evaluated, so its slot holds the global transform
+		if(parentID >= 0)
+			worldBoneTransforms[bone] = worldBoneTransforms[parentID] * localBoneTransforms[bone];
+		else
+			worldBoneTransforms[bone] = localBoneTransforms[bone];
 	}
 }
 
+/// Takes an array of bone transforms in their local spaces and converts them to transformed global space
+void Skeleton::convertToWorldSpace(std::vector<mat4>& localBoneTransforms)
+{
+	if(bones.empty() || localBoneTransforms.size() < bones.size())
+		return;
+
+	computeWorldPose(&localBoneTransforms[0], &localBoneTransforms[0]);
+}
+
 NEPHILIM_NS_END
@@ -0,0 +1,305 @@
+#include <Nephilim/Graphics/SpriteBatch.h>
+#include <Nephilim/Graphics/GraphicsDevice.h>
+#include <Nephilim/Graphics/Texture2D.h>
+#include <Nephilim/Graphics/IndexArray.h>
+#include <Nephilim/Graphics/GDI/GDI_VertexBuffer.h>
+#include <Nephilim/Graphics/GL/GLHelpers.h>
+#include <Nephilim/Foundation/Logging.h>
+
+#include <algorithm>
+#include <cstddef>
+
+NEPHILIM_NS_BEGIN
+
+namespace
+{
+	/// Orders quads by layer, then blend mode, then texture, then depth
+	struct QuadOrder
+	{
+		template<typename QuadType>
+		bool operator()(const QuadType& a, const QuadType& b) const
+		{
+			if (a.layer != b.layer)
+				return a.layer < b.layer;
+			if (a.blendMode != b.blendMode)
+				return a.blendMode < b.blendMode;
+			if (a.texture != b.texture)
+				return a.texture < b.texture;
+			return a.depth < b.depth;
+		}
+	};
+
+	/// Records what a SpriteBatch asks from the device, without drawing anything
+	class RecordingDevice : public GraphicsDevice
+	{
+	public:
+		RecordingDevice()
+		: drawCalls(0)
+		, textureChanges(0)
+		{
+		}
+
+		virtual GDI_VertexBuffer* createVertexBuffer() { return new GDI_VertexBuffer; }
+		virtual void uploadIndexBuffer(IndexBuffer*, const IndexArray&) {}
+		virtual void setVertexBuffer(VertexBuffer*) {}
+		virtual void setIndexBuffer(IndexBuffer*) {}
+		virtual void enableVertexAttribArray(unsigned int) {}
+		virtual void disableVertexAttribArray(unsigned int) {}
+		virtual void setVertexAttribPointer(unsigned int, int, int, bool, int, const void*) {}
+		virtual void setModelMatrix(const mat4&) {}
+		virtual void setTexture(const Texture2D&) { ++textureChanges; }
+		virtual void setDefaultTexture() {}
+		virtual void setBlendMode(Render::Blend::Mode) {}
+		virtual void setDefaultBlending() {}
+		virtual void drawElements(Render::Primitive::Type, int, const void*) { ++drawCalls; }
+
+		int drawCalls;
+		int textureChanges;
+	};
+}
+
+/// The device most recently created, which the recording device would otherwise replace
+extern GraphicsDevice* gGlobalGraphicsDevice;
+
+const int SpriteBatch::MaxQuadsPerDraw;
+
+/// Initialize an empty batch
+SpriteBatch::SpriteBatch()
+: mBufferDevice(nullptr)
+, mVertexCapacity(0)
+{
+	mStatistics.sprites = 0;
+	mStatistics.batches = 0;
+	mStatistics.drawCalls = 0;
+}
+
+/// Release the buffers
+SpriteBatch::~SpriteBatch()
+{
+	delete mVertexBuffer._impl;
+	mVertexBuffer._impl = nullptr;
+}
+
+/// Start collecting quads for a new frame, dropping anything not yet drawn
+void SpriteBatch::begin()
+{
+	mQuads.clear();
+}
+
+/// Queue a quad
+void SpriteBatch::draw(const Texture2D* texture, const mat4& transform, const FloatRect& rect, const FloatRect& texRect, const Color& color, Render::Blend::Mode blendMode, float depth, int layer)
+{
+	Quad quad;
+	quad.texture = texture;
+	quad.blendMode = blendMode;
+	quad.depth = depth;
+	quad.layer = layer;
+
+	const float left = rect.left;
+	const float top = rect.top;
+	const float right = rect.left + rect.width;
+	const float bottom = rect.top + rect.height;
+
+	quad.corners[0] = (transform * vec4(left, top, 0.f, 1.f)).xy();
+	quad.corners[1] = (transform * vec4(right, top, 0.f, 1.f)).xy();
+	quad.corners[2] = (transform * vec4(right, bottom, 0.f, 1.f)).xy();
+	quad.corners[3] = (transform * vec4(left, bottom, 0.f, 1.f)).xy();
+
+	quad.uv[0] = vec2(texRect.left, texRect.top);
+	quad.uv[1] = vec2(texRect.left + texRect.width, texRect.top);
+	quad.uv[2] = vec2(texRect.left + texRect.width, texRect.top + texRect.height);
+	quad.uv[3] = vec2(texRect.left, texRect.top + texRect.height);
+
+	quad.color = vec4(color.r / 255.f, color.g / 255.f, color.b / 255.f, color.a / 255.f);
+
+	mQuads.push_back(quad);
+}
+
+/// Make sure the buffers of the device can hold this many quads
+void SpriteBatch::reserveBuffers(GraphicsDevice* device, std::size_t quadCount)
+{
+	// Buffers belong to the device that made them, start over when drawing on another one
+	if (device != mBufferDevice)
+	{
+		delete mVertexBuffer._impl;
+		mVertexBuffer._impl = device->createVertexBuffer();
+		mVertexCapacity = 0;
+
+		// The quad pattern never changes, one upload covers every draw
+		IndexArray indices;
+		indices.indices.resize(MaxQuadsPerDraw * 6);
+		for (int i = 0; i < MaxQuadsPerDraw; ++i)
+		{
+			Uint16 base = static_cast<Uint16>(i * 4);
+			indices.indices[i * 6 + 0] = base + 0;
+			indices.indices[i * 6 + 1] = base + 1;
+			indices.indices[i * 6 + 2] = base + 2;
+			indices.indices[i * 6 + 3] = base + 2;
+			indices.indices[i * 6 + 4] = base + 3;
+			indices.indices[i * 6 + 5] = base + 0;
+		}
+		device->uploadIndexBuffer(&mIndexBuffer, indices);
+
+		mBufferDevice = device;
+	}
+
+	// Grow geometrically, and reallocate every frame so the driver can orphan the old storage instead of stalling on it
+	if (quadCount > mVertexCapacity)
+	{
+		mVertexCapacity = std::max(quadCount, mVertexCapacity * 2);
+	}
+	mVertexBuffer._impl->allocate(mVertexCapacity * 4 * sizeof(Vertex), true);
+}
+
+/// Sort, upload and draw everything queued since begin()
+void SpriteBatch::end(GraphicsDevice* device)
+{
+	mStatistics.sprites = static_cast<int>(mQuads.size());
+	mStatistics.batches = 0;
+	mStatistics.drawCalls = 0;
+
+	if (mQuads.empty() || !device)
+		return;
+
+	// Sort indices instead of the quads themselves, they are much smaller to move around
+	mOrder.resize(mQuads.size());
+	for (std::size_t i = 0; i < mOrder.size(); ++i)
+		mOrder[i] = i;
+
+	const std::vector<Quad>& quads = mQuads;
+	std::stable_sort(mOrder.begin(), mOrder.end(), [&quads](std::size_t a, std::size_t b)
+	{
+		return QuadOrder()(quads[a], quads[b]);
+	});
+
+	// Write every quad in draw order to the staging buffer
+	mVertices.resize(mQuads.size() * 4);
+	for (std::size_t i = 0; i < mOrder.size(); ++i)
+	{
+		const Quad& quad = mQuads[mOrder[i]];
+		Vertex* v = &mVertices[i * 4];
+		for (int k = 0; k < 4; ++k)
+		{
+			v[k].position = quad.corners[k];
+			v[k].color = quad.color;
+			v[k].uv = quad.uv[k];
+		}
+	}
+
+	reserveBuffers(device, mQuads.size());
+	mVertexBuffer._impl->write(&mVertices[0], mVertices.size() * sizeof(Vertex), 0);
+
+	device->setModelMatrix(mat4::identity);
+	device->setVertexBuffer(&mVertexBuffer);
+	device->setIndexBuffer(&mIndexBuffer);
+
+	device->enableVertexAttribArray(0);
+	device->enableVertexAttribArray(1);
+	device->enableVertexAttribArray(2);
+
+	// Walk the sorted quads, drawing every run of equal layer, texture and blend mode at once
+	std::size_t runStart = 0;
+	for (std::size_t i = 1; i <= mOrder.size(); ++i)
+	{
+		const Quad& first = mQuads[mOrder[runStart]];
+		if (i == mOrder.size() || mQuads[mOrder[i]].layer != first.layer || mQuads[mOrder[i]].texture != first.texture || mQuads[mOrder[i]].blendMode != first.blendMode)
+		{
+			flush(device, first, runStart, i - runStart);
+			runStart = i;
+		}
+	}
+
+	device->disableVertexAttribArray(0);
+	device->disableVertexAttribArray(1);
+	device->disableVertexAttribArray(2);
+
+	device->setIndexBuffer(nullptr);
+	device->setVertexBuffer(nullptr);
+	device->setDefaultBlending();
+	device->setDefaultTexture();
+}
+
+/// Issue the draw calls for quads [first, first + count) already in the vertex buffer
+void SpriteBatch::flush(GraphicsDevice* device, const Quad& state, std::size_t first, std::size_t count)
+{
+	++mStatistics.batches;
+
+	if (state.texture)
+		device->setTexture(*state.texture);
+	else
+		device->setDefaultTexture();
+
+	device->setBlendMode(state.blendMode);
+
+	// The index pattern only addresses MaxQuadsPerDraw quads, rebase the attributes for longer runs
+	while (count > 0)
+	{
+		std::size_t quadsThisDraw = std::min(count, static_cast<std::size_t>(MaxQuadsPerDraw));
+		const char* base = static_cast<const char*>(0) + first * 4 * sizeof(Vertex);
+
+		device->setVertexAttribPointer(0, 2, GL_FLOAT, false, sizeof(Vertex), base + offsetof(Vertex, position));
+		device->setVertexAttribPointer(1, 4, GL_FLOAT, false, sizeof(Vertex), base + offsetof(Vertex, color));
+		device->setVertexAttribPointer(2, 2, GL_FLOAT, false, sizeof(Vertex), base + offsetof(Vertex, uv));
+
+		device->drawElements(Render::Primitive::Triangles, static_cast<int>(quadsThisDraw * 6), 0);
+		++mStatistics.drawCalls;
+
+		first += quadsThisDraw;
+		count -= quadsThisDraw;
+	}
+}
+
+/// Get the counters of the last end()
+SpriteBatch::Statistics SpriteBatch::getStatistics() const
+{
+	return mStatistics;
+}
+
+/// Draw a known set of quads on a recording device and check the batch and draw call counts
+bool SpriteBatch::verifyBatching()
+{
+	GraphicsDevice* previousDevice = gGlobalGraphicsDevice;
+	bool passed = true;
+	{
+		RecordingDevice device;
+		Texture2D textures[3];
+		const FloatRect rect(0.f, 0.f, 16.f, 16.f);
+		const FloatRect texRect(0.f, 0.f, 1.f, 1.f);
+
+		SpriteBatch batch;
+		batch.begin();
+
+		// Layer 0: two textures interleaved at falling depths, grouped into one batch each
+		for (int i = 0; i < 100; ++i)
+			batch.draw(&textures[i % 2], mat4::translate(static_cast<float>(i), 0.f, 0.f), rect, texRect, Color::White, Render::Blend::Alpha, 100.f - i, 0);
+
+		// Layer 1: one texture, split by blend mode
+		for (int i = 0; i < 10; ++i)
+			batch.draw(&textures[0], mat4::identity, rect, texRect, Color::White, Render::Blend::Alpha, 0.f, 1);
+		for (int i = 0; i < 5; ++i)
+			batch.draw(&textures[0], mat4::identity, rect, texRect, Color::White, Render::Blend::Add, 0.f, 1);
+
+		// Layer 2: one run longer than the index pattern, one batch in two draw calls
+		for (int i = 0; i < MaxQuadsPerDraw + 1; ++i)
+			batch.draw(&textures[2], mat4::identity, rect, texRect, Color::White, Render::Blend::Alpha, 0.f, 2);
+
+		batch.end(&device);
+
+		const Statistics statistics = batch.getStatistics();
+		const int expectedSprites = 100 + 15 + MaxQuadsPerDraw + 1;
+		passed = statistics.sprites == expectedSprites
+			&& statistics.batches == 5
+			&& statistics.drawCalls == 6
+			&& device.drawCalls == statistics.drawCalls
+			&& device.textureChanges == statistics.batches;
+
+		Log("SpriteBatch: %d sprites in %d batches and %d draw calls, device saw %d draw calls, expected %d, 5 and 6: %s",
+			statistics.sprites, statistics.batches, statistics.drawCalls, device.drawCalls, expectedSprites, passed ? "passed" : "FAILED");
+	}
+
+	// The recording device made itself the global one while it lived
+	gGlobalGraphicsDevice = previousDevice;
+	return passed;
+}
+
+NEPHILIM_NS_END
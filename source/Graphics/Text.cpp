@@ -2,6 +2,8 @@
 #include <Nephilim/Graphics/GraphicsDevice.h>
 #include <Nephilim/Graphics/RectangleShape.h>
 #include <Nephilim/Graphics/GL/GLHelpers.h>
+#include <Nephilim/Graphics/GL/GLShader.h>
+#include <Nephilim/Graphics/Shader.h>
 
 #include <Nephilim/Foundation/Logging.h>
 #include <Nephilim/Foundation/Image.h>
@@ -13,6 +15,58 @@ using namespace std;
 
 NEPHILIM_NS_BEGIN
 
+namespace
+{
+	const char gDistanceFieldVertexSource[] =
+		"attribute vec4 vertex;\n"
+		"attribute vec4 color;\n"
+		"attribute vec2 texCoord;\n"
+		"uniform mat4 projection;\n"
+		"uniform mat4 model;\n"
+		"uniform mat4 view;\n"
+		"varying vec4 fragColor;\n"
+		"varying vec2 texUV;\n"
+		"void main() {\n"
+		"  gl_Position = projection * view * model * vertex;\n"
+		"  fragColor = color;\n"
+		"  texUV = texCoord;\n"
+		"}\n";
+
+	/// Thresholds the distance in the alpha channel, smoothing over about a screen pixel
+	const char gDistanceFieldFragmentSource[] =
+		"#ifdef GL_ES\n"
+		"precision mediump float;\n"
+		"#endif\n"
+		"uniform sampler2D texture;\n"
+		"uniform float smoothing;\n"
+		"varying vec4 fragColor;\n"
+		"varying vec2 texUV;\n"
+		"void main() {\n"
+		"  float alpha = smoothstep(0.5 - smoothing, 0.5 + smoothing, texture2D(texture, texUV).a);\n"
+		"  gl_FragColor = vec4(fragColor.rgb, fragColor.a * alpha);\n"
+		"}\n";
+
+	/// Program shared by all distance field text, built on first use, null if it didn't build
+	GLShader* distanceFieldShader()
+	{
+		// Never destroyed, the context may be gone by the time statics are
+		static GLShader* shader = new GLShader;
+		static int state = 0;
+		if (state == 0)
+		{
+			shader->loadShader(GLShader::VertexUnit, gDistanceFieldVertexSource);
+			shader->loadShader(GLShader::FragmentUnit, gDistanceFieldFragmentSource);
+			shader->addAttributeLocation(0, "vertex");
+			shader->addAttributeLocation(1, "color");
+			shader->addAttributeLocation(2, "texCoord");
+			state = shader->create() ? 1 : -1;
+			if (state < 0)
+				Log("Text: The distance field shader failed to build, drawing with the default one");
+		}
+		return state > 0 ? shader : nullptr;
+	}
+}
+
 Text::Text()
 : m_string()
 , m_font(&Font::getDefaultFont()),
@@ -41,15 +95,41 @@ void Text::onDraw(GraphicsDevice* renderer)
 {
 	if(!m_font || m_vertices.m_vertices.empty()) return;
 
-	renderer->setTexture(m_font->getTexture(m_characterSize));
-	renderer->setBlendingEnabled(true);
-	renderer->setBlendMode(Render::Blend::Alpha);
 	if (useOwnTransform)
 		renderer->setModelMatrix(mat4(getTransform().getMatrix()));
-	renderer->draw(m_vertices);
+	drawGeometry(renderer, *m_font, m_characterSize, m_vertices);
 	renderer->setModelMatrix(mat4());
 };
 
+/// Draw vertices made by buildGeometry(), with the current model matrix
+void Text::drawGeometry(GraphicsDevice* renderer, const Font& font, unsigned int characterSize, const VertexArray2D& vertices)
+{
+	drawGeometry(renderer, font, characterSize, vertices, 0, vertices.m_vertices.size());
+}
+
+/// Draw count vertices made by buildGeometry(), starting at first, with the current model matrix
+void Text::drawGeometry(GraphicsDevice* renderer, const Font& font, unsigned int characterSize, const VertexArray2D& vertices, std::size_t first, std::size_t count)
+{
+	renderer->setTexture(font.getTexture(characterSize));
+	renderer->setBlendingEnabled(true);
+	renderer->setBlendMode(Render::Blend::Alpha);
+
+	// The glyphs are distances to their outline, not coverage
+	GLShader* distanceField = font.isDistanceField() ? distanceFieldShader() : nullptr;
+	if (distanceField)
+	{
+		Shader shader;
+		shader.shaderImpl = distanceField;
+		renderer->setShader(shader);
+		distanceField->setUniformFloat("smoothing", font.getDistanceFieldSmoothing(characterSize));
+	}
+
+	renderer->drawRange(vertices, first, count);
+
+	if (distanceField)
+		renderer->setDefaultShader();
+}
+
 ////////////////////////////////////////////////////////////
 void Text::setString(const String& string)
 {
@@ -235,33 +315,39 @@ void Text::updateGeometry()
 {
     assert(m_font != NULL);
 
+    m_bounds = buildGeometry(m_string, *m_font, m_characterSize, m_style, m_color, m_vertices);
+}
+
+/// Lay out a string into textured triangles, with the origin at the top left of the first line
+FloatRect Text::buildGeometry(const UString& string, const Font& font, unsigned int characterSize, Uint32 style, const Color& color, VertexArray2D& vertices)
+{
     // Clear the previous geometry
-    m_vertices.clear();
+    vertices.clear();
 
-    if (m_string.empty())
-        return;
+    if (string.empty())
+        return FloatRect(0, 0, 0, 0);
 
     // Compute values related to the text style
-    bool  bold               = (m_style & Bold) != 0;
-    bool  underlined         = (m_style & Underlined) != 0;
-    float italic             = (m_style & Italic) ? 0.208f : 0.f; // 12 degrees
-    float underlineOffset    = m_characterSize * 0.1f;
-    float underlineThickness = m_characterSize * (bold ? 0.1f : 0.07f);
+    bool  bold               = (style & Bold) != 0;
+    bool  underlined         = (style & Underlined) != 0;
+    float italic             = (style & Italic) ? 0.208f : 0.f; // 12 degrees
+    float underlineOffset    = characterSize * 0.1f;
+    float underlineThickness = characterSize * (bold ? 0.1f : 0.07f);
 
     // Precompute the variables needed by the algorithm
-    float hspace = static_cast<float>(m_font->getGlyph(L' ', m_characterSize, bold).advance);
-    float vspace = static_cast<float>(m_font->getLineSpacing(m_characterSize));
+    float hspace = static_cast<float>(font.getGlyph(L' ', characterSize, bold).advance);
+    float vspace = static_cast<float>(font.getLineSpacing(characterSize));
     float x      = 0.f;
-    float y      = static_cast<float>(m_characterSize);
+    float y      = static_cast<float>(characterSize);
 
     // Create one quad for each character
     Uint32 prevChar = 0;
-    for (std::size_t i = 0; i < m_string.getSize(); ++i)
+    for (std::size_t i = 0; i < string.getSize(); ++i)
     {
-        Uint32 curChar = m_string[i];
+        Uint32 curChar = string[i];
 
         // Apply the kerning offset
-        x += static_cast<float>(m_font->getKerning(prevChar, curChar, m_characterSize));
+        x += static_cast<float>(font.getKerning(prevChar, curChar, characterSize));
         prevChar = curChar;
 
         // If we're using the underlined style and there's a new line, draw a line
@@ -270,10 +356,10 @@ void Text::updateGeometry()
             float top = y + underlineOffset;
             float bottom = top + underlineThickness;
 
-            m_vertices.append(VertexArray2D::Vertex(Vec2f(0, top),    m_color, Vec2f(1, 1)));
-            m_vertices.append(VertexArray2D::Vertex(Vec2f(x, top),    m_color, Vec2f(1, 1)));
-            m_vertices.append(VertexArray2D::Vertex(Vec2f(x, bottom), m_color, Vec2f(1, 1)));
-            m_vertices.append(VertexArray2D::Vertex(Vec2f(0, bottom), m_color, Vec2f(1, 1)));
+            vertices.append(VertexArray2D::Vertex(Vec2f(0, top),    color, Vec2f(1, 1)));
+            vertices.append(VertexArray2D::Vertex(Vec2f(x, top),    color, Vec2f(1, 1)));
+            vertices.append(VertexArray2D::Vertex(Vec2f(x, bottom), color, Vec2f(1, 1)));
+            vertices.append(VertexArray2D::Vertex(Vec2f(0, bottom), color, Vec2f(1, 1)));
 
 			cout<<"No."<<endl;
         }
@@ -288,7 +374,7 @@ void Text::updateGeometry()
         }
 
         // Extract the current glyph's description
-        const Glyph& glyph = m_font->getGlyph(curChar, m_characterSize, bold);
+        const Glyph& glyph = font.getGlyph(curChar, characterSize, bold);
 
         int left   = glyph.bounds.left;
         int top    = glyph.bounds.top;
@@ -300,20 +386,13 @@ void Text::updateGeometry()
         float u2 = static_cast<float>(glyph.textureRect.left + glyph.textureRect.width);
         float v2 = static_cast<float>(glyph.textureRect.top  + glyph.textureRect.height);
 
-		Vec2i fontTextureSize = m_font->getTexture(m_characterSize).getSize();
-
-		u1 /= fontTextureSize.x;
-		u2 /= fontTextureSize.x;
-		v1 /= fontTextureSize.y;
-		v2 /= fontTextureSize.y;
+     	vertices.append(VertexArray2D::Vertex(Vec2f(x + right - italic * bottom, y + bottom), color, Vec2f(u2, v2)));
+		vertices.append(VertexArray2D::Vertex(Vec2f(x + left  - italic * top,    y + top),    color, Vec2f(u1, v1)));
+		vertices.append(VertexArray2D::Vertex(Vec2f(x + left  - italic * bottom, y + bottom), color, Vec2f(u1, v2)));
 
-     	m_vertices.append(VertexArray2D::Vertex(Vec2f(x + right - italic * bottom, y + bottom), m_color, Vec2f(u2, v2)));
-		m_vertices.append(VertexArray2D::Vertex(Vec2f(x + left  - italic * top,    y + top),    m_color, Vec2f(u1, v1)));
-		m_vertices.append(VertexArray2D::Vertex(Vec2f(x + left  - italic * bottom, y + bottom), m_color, Vec2f(u1, v2)));
-
-		m_vertices.append(VertexArray2D::Vertex(Vec2f(x + right - italic * bottom, y + bottom), m_color, Vec2f(u2, v2)));
-		m_vertices.append(VertexArray2D::Vertex(Vec2f(x + right - italic * top,    y + top),    m_color, Vec2f(u2, v1)));
-		m_vertices.append(VertexArray2D::Vertex(Vec2f(x + left  - italic * top,    y + top),    m_color, Vec2f(u1, v1)));
+		vertices.append(VertexArray2D::Vertex(Vec2f(x + right - italic * bottom, y + bottom), color, Vec2f(u2, v2)));
+		vertices.append(VertexArray2D::Vertex(Vec2f(x + right - italic * top,    y + top),    color, Vec2f(u2, v1)));
+		vertices.append(VertexArray2D::Vertex(Vec2f(x + left  - italic * top,    y + top),    color, Vec2f(u1, v1)));
 
 	//	cout<< "U ("<<u1<<" "<<u2<<")" << endl;
 
@@ -328,16 +407,25 @@ void Text::updateGeometry()
         float top = y + underlineOffset;
         float bottom = top + underlineThickness;
 
-        m_vertices.append(VertexArray2D::Vertex(Vec2f(0, top),    m_color, Vec2f(1, 1)));
-        m_vertices.append(VertexArray2D::Vertex(Vec2f(x, top),    m_color, Vec2f(1, 1)));
-        m_vertices.append(VertexArray2D::Vertex(Vec2f(x, bottom), m_color, Vec2f(1, 1)));
-        m_vertices.append(VertexArray2D::Vertex(Vec2f(0, bottom), m_color, Vec2f(1, 1)));
+        vertices.append(VertexArray2D::Vertex(Vec2f(0, top),    color, Vec2f(1, 1)));
+        vertices.append(VertexArray2D::Vertex(Vec2f(x, top),    color, Vec2f(1, 1)));
+        vertices.append(VertexArray2D::Vertex(Vec2f(x, bottom), color, Vec2f(1, 1)));
+        vertices.append(VertexArray2D::Vertex(Vec2f(0, bottom), color, Vec2f(1, 1)));
 
 		cout<<"No."<<endl;
     }
 
+    // Texture coordinates were in pixels, the page may have grown while loading glyphs
+    // so they are normalized once its final size is known
+    Vec2i fontTextureSize = font.getTexture(characterSize).getSize();
+    for (std::size_t i = 0; i < vertices.m_vertices.size(); ++i)
+    {
+        vertices.m_vertices[i].texCoords.x /= fontTextureSize.x;
+        vertices.m_vertices[i].texCoords.y /= fontTextureSize.y;
+    }
+
     // Recompute the bounding rectangle
-    m_bounds = m_vertices.getBounds();
+    return vertices.getBounds();
 }
 
 NEPHILIM_NS_END
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include <Nephilim/Graphics/Texture2D.h>
 #include <Nephilim/Graphics/GDI/GDI_Texture2D.h>
+#include <Nephilim/Graphics/GraphicsDevice.h>
 
 // to remove
 #include <Nephilim/Graphics/GL/GLTexture.h>
@@ -10,8 +11,12 @@ NEPHILIM_NS_BEGIN
 Texture2D::Texture2D()
 : _impl(nullptr)
 {
-
-	_impl = new GLTexture2D;
+	// Let the active device pick the implementation, textures made before any device exists are OpenGL ones
+	GraphicsDevice* device = GraphicsDevice::instance();
+	if (device)
+		_impl = device->createTexture2D();
+	else
+		_impl = new GLTexture2D;
 }
 
 /// Ensure destruction of the resource
@@ -58,6 +63,18 @@ bool Texture2D::loadFromImage(const Image& image)
 	return _impl->loadFromImage(image);
 }
 
+/// Loads every level of a mipmap chain, built beforehand like on a loader thread
+bool Texture2D::loadFromMipChain(const MipChain& chain)
+{
+	return _impl->loadFromMipChain(chain);
+}
+
+/// Build gamma correct mipmaps for the images loaded from now on
+void Texture2D::setMipmapped(bool mipmapped)
+{
+	_impl->setMipmapped(mipmapped);
+}
+
 /// Updates a given region inside the texture with an array of pixels
 void Texture2D::update(const Uint8* pixels, unsigned int width, unsigned int height, unsigned int x, unsigned int y)
 {
@@ -86,7 +103,7 @@ void Texture2D::update(const Image& image)
 /// Does not work in OpenGL ES platforms. An warning is logged in such platforms.
 bool Texture2D::copyToImage(Image& image) const
 {
-	return true;
+	return _impl->copyToImage(image);
 }
 
 NEPHILIM_NS_END
\ No newline at end of file
@@ -41,9 +41,36 @@ void CSSLoader::parse(TextStream& stm)
 	{
 		char next = stm.peek();
 
-		if (std::isspace(next))
+		if (_onComment)
+		{
+			// Until the closing */
+			if (stm.readChar() == '*' && !stm.atEnd() && stm.peek() == '/')
+			{
+				stm.readChar();
+				_onComment = false;
+			}
+		}
+		else if (std::isspace(next))
 		{
 			stm.readChar();
+
+			// Whitespace separates values and selector parts, so one space is kept
+			String& raw = _onBlock ? raw_block : raw_selector;
+			if (!raw.empty() && raw[raw.size() - 1] != ' ')
+				raw += ' ';
+		}
+		else if (next == '/')
+		{
+			stm.readChar();
+			if (!stm.atEnd() && stm.peek() == '*')
+			{
+				stm.readChar();
+				_onComment = true;
+			}
+			else
+			{
+				(_onBlock ? raw_block : raw_selector) += next;
+			}
 		}
 		else
 		{
@@ -78,46 +105,29 @@ void CSSLoader::parse(TextStream& stm)
 /// A raw block is the contents between { } (excluded), no comments
 void CSSLoader::parse_raw_block(const String& blk, const String& selector)
 {
-	//Log("Block from %s", selector.c_str());
-	//Log("Block is %s", blk.c_str());
-
-	struct DefinitionPair
-	{
-		String attribute;
-		String value;
-	};
-
-	// definitions in this block
-	std::vector<DefinitionPair> definitions;
-
-	String def_buff;
-	Log("Selector %s", selector.c_str());
-
 	StyleSheet::StyleArray stylesArray;
 
-	for (std::size_t i = 0; i < blk.size(); ++i)
+	// The last declaration may go without a ;
+	StringList definitions = blk.split(';');
+	for (std::size_t i = 0; i < definitions.size(); ++i)
 	{
-		// in a split
-		if (blk[i] == ';')
-		{
-			DefinitionPair pair;
-			StringList pairElements = def_buff.split(':');
-			pair.attribute = pairElements[0];
-			pair.value = pairElements[1];
-			def_buff.clear();
+		std::size_t separator = definitions[i].find(':');
+		if (separator == String::npos)
+			continue;
 
-			stylesArray.entries.push_back(std::make_pair(pair.attribute, pair.value));
+		String attribute(definitions[i], 0, separator);
+		String value(definitions[i], separator + 1);
+		attribute.trim();
+		value.trim();
 
-			Log("Definition: %s: %s", pair.attribute.c_str(), pair.value.c_str());
-		}
-		else
-		{
-			def_buff += blk[i];
-		}
+		if (!attribute.empty())
+			stylesArray.entries.push_back(std::make_pair(attribute, value));
 	}
 
-	_storage->selectorList.push_back(selector);
-	_storage->stylesList.push_back(stylesArray);
+	LOG_DEBUG(LogContent, "Selector %s with %d definitions", selector.c_str(), static_cast<int>(stylesArray.entries.size()));
+
+	// Compiled into the selector tables and typed values as it goes in
+	_storage->addRule(selector, stylesArray);
 }
 
 NEPHILIM_NS_END
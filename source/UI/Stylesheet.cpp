@@ -1,33 +1,548 @@
 #include <Nephilim/UI/Stylesheet.h>
+#include <Nephilim/Foundation/StringList.h>
+#include <Nephilim/Foundation/Logging.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
 
 NEPHILIM_NS_BEGIN
 
-StyleSheet::StyleArray& StyleSheet::getRule(const String& selector)
+namespace
 {
-	for (auto it = selectorList.begin(); it != selectorList.end(); ++it)
+	/// Generations come from one counter, so no two stylesheets ever share one
+	std::atomic<Uint64> nextGeneration(1);
+
+	String trimmed(const String& text)
+	{
+		std::size_t first = 0;
+		std::size_t last = text.size();
+		while (first < last && std::isspace(static_cast<unsigned char>(text[first])))
+			++first;
+		while (last > first && std::isspace(static_cast<unsigned char>(text[last - 1])))
+			--last;
+		return String(text, first, last - first);
+	}
+
+	/// Property names are compared trimmed and in lower case
+	String propertyName(const String& name)
+	{
+		String result = trimmed(name);
+		result.toLowerCase();
+		return result;
+	}
+
+	bool lessById(const ComputedStyle::Property& property, StringID id)
+	{
+		return property.first < id;
+	}
+
+	/// Find a property in a list sorted by id
+	const StyleValue* findProperty(const std::vector<ComputedStyle::Property>& properties, StringID id)
+	{
+		std::vector<ComputedStyle::Property>::const_iterator it = std::lower_bound(properties.begin(), properties.end(), id, lessById);
+		if (it != properties.end() && it->first == id)
+			return &it->second;
+		return nullptr;
+	}
+
+	int hexDigit(char c)
+	{
+		if (c >= '0' && c <= '9') return c - '0';
+		if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+		return -1;
+	}
+
+	/// Parse #rgb, #rrggbb or #rrggbbaa, lower case
+	bool parseHexColor(const String& text, Color& color)
+	{
+		std::size_t digits = text.size() - 1;
+		if (digits != 3 && digits != 6 && digits != 8)
+			return false;
+
+		int values[8];
+		for (std::size_t i = 0; i < digits; ++i)
+		{
+			values[i] = hexDigit(text[i + 1]);
+			if (values[i] < 0)
+				return false;
+		}
+
+		if (digits == 3)
+		{
+			color = Color(values[0] * 17, values[1] * 17, values[2] * 17, 255);
+		}
+		else
+		{
+			color = Color(values[0] * 16 + values[1], values[2] * 16 + values[3], values[4] * 16 + values[5],
+				digits == 8 ? values[6] * 16 + values[7] : 255);
+		}
+		return true;
+	}
+
+	/// Parse rgb(r, g, b) or rgba(r, g, b, a) with alpha from 0 to 1, lower case
+	bool parseFunctionColor(const String& text, Color& color)
+	{
+		std::size_t open = text.find('(');
+		std::size_t close = text.rfind(')');
+		if (open == String::npos || close == String::npos || close < open)
+			return false;
+
+		String name = trimmed(String(text, 0, open));
+		StringList arguments = String(text, open + 1, close - open - 1).split(',');
+		bool alpha = (name == "rgba");
+		if ((name != "rgb" && name != "rgba") || arguments.size() != (alpha ? 4u : 3u))
+			return false;
+
+		float channels[4] = { 0.f, 0.f, 0.f, 1.f };
+		for (std::size_t i = 0; i < arguments.size(); ++i)
+			channels[i] = trimmed(arguments[i]).toFloat();
+
+		color = Color(static_cast<Uint8>(std::min(std::max(channels[0], 0.f), 255.f)),
+		              static_cast<Uint8>(std::min(std::max(channels[1], 0.f), 255.f)),
+		              static_cast<Uint8>(std::min(std::max(channels[2], 0.f), 255.f)),
+		              static_cast<Uint8>(std::min(std::max(channels[3], 0.f), 1.f) * 255.f + 0.5f));
+		return true;
+	}
+
+	/// The names of the built-in colors, lower case
+	bool parseNamedColor(const String& text, Color& color)
 	{
-		if ((*it) == selector)
+		struct NamedColor
 		{
-			return stylesList[it - selectorList.begin()];
+			const char*  name;
+			const Color* color;
+		};
+
+		static const NamedColor names[] = {
+			{ "red", &Color::Red }, { "white", &Color::White }, { "black", &Color::Black },
+			{ "green", &Color::Green }, { "orange", &Color::Orange }, { "blue", &Color::Blue },
+			{ "transparent", &Color::Transparent }, { "grey", &Color::Grey }, { "gray", &Color::Grey },
+			{ "yellow", &Color::Yellow }, { "bittersweet", &Color::Bittersweet }, { "lavender", &Color::Lavender },
+			{ "grass", &Color::Grass }, { "aqua", &Color::Aqua }, { "navyblue", &Color::NavyBlue }
+		};
+
+		for (std::size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+		{
+			if (text == names[i].name)
+			{
+				color = *names[i].color;
+				return true;
+			}
 		}
+		return false;
+	}
+
+	/// Merge sorted properties into sorted result, the new ones win
+	void overlay(std::vector<ComputedStyle::Property>& result, const std::vector<ComputedStyle::Property>& properties, std::vector<ComputedStyle::Property>& scratch)
+	{
+		scratch.clear();
+		scratch.reserve(result.size() + properties.size());
+
+		std::size_t i = 0, j = 0;
+		while (i < result.size() || j < properties.size())
+		{
+			if (j == properties.size() || (i < result.size() && result[i].first < properties[j].first))
+				scratch.push_back(result[i++]);
+			else if (i == result.size() || properties[j].first < result[i].first)
+				scratch.push_back(properties[j++]);
+			else
+			{
+				scratch.push_back(properties[j++]);
+				++i;
+			}
+		}
+
+		result.swap(scratch);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+/// An empty value
+StyleValue::StyleValue()
+: type(NoValue)
+, number(0.f)
+, unit(Pixels)
+, keyword(0)
+{
+}
+
+/// Parse a value as written in CSS
+StyleValue StyleValue::parse(const String& text)
+{
+	StyleValue value;
+	value.text = trimmed(text);
+	if (value.text.empty())
+		return value;
+
+	String lower = value.text;
+	lower.toLowerCase();
+	value.keyword = makeStringID(lower, false);
+
+	if ((lower[0] == '#' && parseHexColor(lower, value.color)) || parseFunctionColor(lower, value.color) || parseNamedColor(lower, value.color))
+	{
+		value.type = ColorValue;
+		return value;
+	}
+
+	const char* begin = lower.c_str();
+	char* end = nullptr;
+	double number = std::strtod(begin, &end);
+	if (end != begin)
+	{
+		String suffix = trimmed(String(end));
+		value.number = static_cast<float>(number);
+
+		if (suffix.empty())
+		{
+			value.type = NumberValue;
+			return value;
+		}
+		if (suffix == "px" || suffix == "%" || suffix == "em")
+		{
+			value.type = LengthValue;
+			value.unit = (suffix == "px") ? Pixels : (suffix == "%") ? Percent : Em;
+			return value;
+		}
+	}
+
+	value.number = 0.f;
+	value.type = KeywordValue;
+	return value;
+}
+
+/// Get the length in pixels, resolving percentages against reference and em against fontSize
+float StyleValue::toPixels(float reference, float fontSize) const
+{
+	if (type == NumberValue || (type == LengthValue && unit == Pixels))
+		return number;
+	if (type == LengthValue && unit == Percent)
+		return number / 100.f * reference;
+	if (type == LengthValue && unit == Em)
+		return number * fontSize;
+	return 0.f;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+/// Get a property, null if no rule set it
+const StyleValue* ComputedStyle::get(StringID property) const
+{
+	return findProperty(properties, property);
+}
+
+/// Get a property, null if no rule set it
+const StyleValue* ComputedStyle::get(const String& property) const
+{
+	return properties.empty() ? nullptr : findProperty(properties, makeStringID(propertyName(property), false));
+}
+
+/// Get a color property, or fallback if it isn't set or isn't a color
+Color ComputedStyle::getColor(const String& property, const Color& fallback) const
+{
+	const StyleValue* value = get(property);
+	return (value && value->type == StyleValue::ColorValue) ? value->color : fallback;
+}
+
+/// Get a length property in pixels, or fallback if it isn't set or isn't a length
+float ComputedStyle::getLength(const String& property, float reference, float fallback) const
+{
+	const StyleValue* value = get(property);
+	if (!value || (value->type != StyleValue::LengthValue && value->type != StyleValue::NumberValue))
+		return fallback;
+	return value->toPixels(reference);
+}
+
+/// Forget every property
+void ComputedStyle::clear()
+{
+	properties.clear();
+}
+
+/// Check if no property was set
+bool ComputedStyle::empty() const
+{
+	return properties.empty();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+/// Find a declaration, empty if there is none
+StyleSheet::StyleEntry StyleSheet::StyleArray::getEntry(const String& entry) const
+{
+	const StyleValue* value = getValue(makeStringID(propertyName(entry), false));
+	if (value)
+		return StyleEntry(value->text, *value);
+
+	return StyleEntry("", StyleValue());
+}
+
+/// Find a parsed declaration, null if there is none
+const StyleValue* StyleSheet::StyleArray::getValue(StringID property) const
+{
+	return findProperty(properties, property);
+}
+
+/// Parse the entries into properties, the last declaration of a property wins
+void StyleSheet::StyleArray::compile()
+{
+	properties.clear();
+	properties.reserve(entries.size());
+
+	for (std::size_t i = 0; i < entries.size(); ++i)
+	{
+		properties.push_back(ComputedStyle::Property(makeStringID(propertyName(entries[i].first)), StyleValue::parse(entries[i].second)));
+	}
+
+	// Stable, so the later of two declarations of a property comes last and is the one kept
+	std::stable_sort(properties.begin(), properties.end(),
+		[](const ComputedStyle::Property& a, const ComputedStyle::Property& b) { return a.first < b.first; });
+
+	std::vector<ComputedStyle::Property> unique;
+	unique.reserve(properties.size());
+	for (std::size_t i = 0; i < properties.size(); ++i)
+	{
+		if (!unique.empty() && unique.back().first == properties[i].first)
+			unique.back() = properties[i];
+		else
+			unique.push_back(properties[i]);
 	}
+	properties.swap(unique);
 }
 
 //////////////////////////////////////////////////////////////////////////
 
 Color StyleSheet::StyleEntry::toColor()
 {
-	Color c;
+	return parsed.type == StyleValue::ColorValue ? parsed.color : Color();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+/// Creates an empty stylesheet
+StyleSheet::StyleSheet()
+: m_generation(nextGeneration++)
+{
+}
+
+/// Add a rule block for a selector, or a comma separated list of them
+void StyleSheet::addRule(const String& selector, const StyleArray& styles)
+{
+	String text = trimmed(selector);
+
+	selectorList.push_back(text);
+	stylesList.push_back(styles);
+	stylesList.back().compile();
+
+	std::size_t rule = stylesList.size() - 1;
+	m_ruleIndex[makeStringID(text)] = rule;
+
+	StringList selectors = text.split(',');
+	for (std::size_t i = 0; i < selectors.size(); ++i)
+	{
+		if (!compileSelector(trimmed(selectors[i]), rule))
+			LOG_WARNING(LogContent, "Ignoring unsupported selector '%s'", selectors[i].c_str());
+	}
+
+	m_generation = nextGeneration++;
+}
 
-	if (value == "red")
-		c = Color::Red;
-	else if (value == "blue")
-		c = Color::Blue;
-	else if (value == "grass")
-		c = Color::Grass;
+/// Get the rule block of a selector, an empty one is added if there is none
+StyleSheet::StyleArray& StyleSheet::getRule(const String& selector)
+{
+	std::unordered_map<StringID, std::size_t>::iterator it = m_ruleIndex.find(makeStringID(trimmed(selector), false));
+	if (it != m_ruleIndex.end())
+		return stylesList[it->second];
 
-	return c;
+	addRule(selector, StyleArray());
+	return stylesList.back();
 }
 
+/// Compile every rule again, after they were changed directly
+void StyleSheet::rebuild()
+{
+	std::vector<String> selectors;
+	std::vector<StyleArray> styles;
+	selectors.swap(selectorList);
+	styles.swap(stylesList);
+
+	clear();
+
+	for (std::size_t i = 0; i < selectors.size(); ++i)
+		addRule(selectors[i], styles[i]);
+}
+
+/// Remove every rule
+void StyleSheet::clear()
+{
+	selectorList.clear();
+	stylesList.clear();
+	m_selectors.clear();
+	m_byName.clear();
+	m_byClass.clear();
+	m_byType.clear();
+	m_universal.clear();
+	m_ruleIndex.clear();
+	m_generation = nextGeneration++;
+}
+
+/// Collect the properties of every rule matching subject into style, by specificity and then order
+void StyleSheet::computeStyle(const Subject& subject, ComputedStyle& style) const
+{
+	style.clear();
+
+	// Every selector is filed once, under the most specific part it has
+	std::vector<std::size_t> matched;
+	SelectorBuckets::const_iterator bucket;
+
+	if (subject.name && (bucket = m_byName.find(subject.name)) != m_byName.end())
+	{
+		for (std::size_t i = 0; i < bucket->second.size(); ++i)
+			if (matches(m_selectors[bucket->second[i]], subject))
+				matched.push_back(bucket->second[i]);
+	}
+
+	if (subject.classes)
+	{
+		for (std::size_t c = 0; c < subject.classes->size(); ++c)
+		{
+			if ((bucket = m_byClass.find((*subject.classes)[c])) == m_byClass.end())
+				continue;
+
+			for (std::size_t i = 0; i < bucket->second.size(); ++i)
+				if (matches(m_selectors[bucket->second[i]], subject))
+					matched.push_back(bucket->second[i]);
+		}
+	}
+
+	if (subject.type && (bucket = m_byType.find(subject.type)) != m_byType.end())
+	{
+		for (std::size_t i = 0; i < bucket->second.size(); ++i)
+			if (matches(m_selectors[bucket->second[i]], subject))
+				matched.push_back(bucket->second[i]);
+	}
+
+	for (std::size_t i = 0; i < m_universal.size(); ++i)
+		if (matches(m_selectors[m_universal[i]], subject))
+			matched.push_back(m_universal[i]);
+
+	if (matched.empty())
+		return;
+
+	// Weakest first, so the stronger rules overwrite them
+	std::sort(matched.begin(), matched.end(), [this](std::size_t a, std::size_t b)
+	{
+		const Selector& left = m_selectors[a];
+		const Selector& right = m_selectors[b];
+		return left.specificity != right.specificity ? left.specificity < right.specificity : left.order < right.order;
+	});
+
+	std::vector<ComputedStyle::Property> scratch;
+	for (std::size_t i = 0; i < matched.size(); ++i)
+	{
+		overlay(style.properties, stylesList[m_selectors[matched[i]].rule].properties, scratch);
+	}
+}
+
+/// Get a number that changes whenever the rules change, to know when computed styles are stale
+Uint64 StyleSheet::getGeneration() const
+{
+	return m_generation;
+}
+
+/// Compile one selector of a rule and file it in a bucket, returns false if it isn't supported
+bool StyleSheet::compileSelector(const String& text, std::size_t rule)
+{
+	Selector selector;
+	if (!parseSelector(text, selector))
+		return false;
+
+	selector.rule = rule;
+	selector.order = m_selectors.size();
+
+	std::size_t index = m_selectors.size();
+	m_selectors.push_back(selector);
+
+	if (selector.name)
+		m_byName[selector.name].push_back(index);
+	else if (!selector.classes.empty())
+		m_byClass[selector.classes[0]].push_back(index);
+	else if (selector.type)
+		m_byType[selector.type].push_back(index);
+	else
+		m_universal.push_back(index);
+
+	return true;
+}
+
+/// Parse one compound selector, returns false if it uses something that isn't supported
+bool StyleSheet::parseSelector(const String& text, Selector& selector)
+{
+	selector.type = 0;
+	selector.name = 0;
+	selector.classes.clear();
+	selector.pseudoClasses.clear();
+	selector.specificity = 0;
+	selector.rule = 0;
+	selector.order = 0;
+
+	if (text.empty())
+		return false;
+
+	// Split into the type and the #, . and : parts
+	std::size_t i = 0;
+	char kind = 0;
+	while (i < text.size())
+	{
+		std::size_t end = i;
+		while (end < text.size() && (std::isalnum(static_cast<unsigned char>(text[end])) || text[end] == '-' || text[end] == '_' || text[end] == '*'))
+			++end;
+
+		// Descendant and sibling combinators, attributes and the like
+		if (end == i && kind != 0)
+			return false;
+
+		String part(text, i, end - i);
+		if (kind == 0 && !part.empty() && part != "*")
+			selector.type = makeStringID(part);
+		else if (kind == '#')
+			selector.name = makeStringID(part);
+		else if (kind == '.')
+			selector.classes.push_back(makeStringID(part));
+		else if (kind == ':')
+			selector.pseudoClasses.push_back(makeStringID(part));
+
+		if (end == text.size())
+			break;
+
+		kind = text[end];
+		if (kind != '#' && kind != '.' && kind != ':')
+			return false;
+		i = end + 1;
+	}
+
+	std::sort(selector.classes.begin(), selector.classes.end());
+	std::sort(selector.pseudoClasses.begin(), selector.pseudoClasses.end());
+	selector.specificity = (selector.name ? 100 : 0) + 10 * static_cast<int>(selector.classes.size() + selector.pseudoClasses.size()) + (selector.type ? 1 : 0);
+	return true;
+}
+
+/// Check if a selector applies to a subject
+bool StyleSheet::matches(const Selector& selector, const Subject& subject)
+{
+	if (selector.type && selector.type != subject.type)
+		return false;
+	if (selector.name && selector.name != subject.name)
+		return false;
+
+	if (!selector.classes.empty() && (!subject.classes || !std::includes(subject.classes->begin(), subject.classes->end(), selector.classes.begin(), selector.classes.end())))
+		return false;
+	if (!selector.pseudoClasses.empty() && (!subject.pseudoClasses || !std::includes(subject.pseudoClasses->begin(), subject.pseudoClasses->end(), selector.pseudoClasses.begin(), selector.pseudoClasses.end())))
+		return false;
+
+	return true;
+}
 
-NEPHILIM_NS_END
\ No newline at end of file
+NEPHILIM_NS_END
@@ -3,11 +3,88 @@
 #include <Nephilim/Graphics/Text.h>
 #include <Nephilim/UI/UILabel.h>
 #include <Nephilim/UI/CSSLoader.h>
+#include <Nephilim/Foundation/StringList.h>
+#include <Nephilim/Foundation/Logging.h>
 
 #include <algorithm>
 
 NEPHILIM_NS_BEGIN
 
+namespace
+{
+	/// A widget under the pointer, with where it is in the hierarchy to dispatch in order
+	struct PointerHit
+	{
+		Widget*          widget;
+		int              surface;  ///< 0 is the top one
+		std::vector<int> path;     ///< Index among the children of each parent, from the surface down
+
+		bool operator<(const PointerHit& other) const
+		{
+			if (surface != other.surface)
+				return surface < other.surface;
+			return path < other.path;
+		}
+	};
+
+	/// Holds the children of the widgets getting a pointer event and of all their parents,
+	/// so what the handlers attach or destroy is only applied after every handler ran
+	class ChildrenLock
+	{
+	public:
+		ChildrenLock(const std::vector<Widget*>& widgets)
+		{
+			for (std::size_t i = 0; i < widgets.size(); ++i)
+			{
+				int depth = 0;
+				for (Widget* parent = widgets[i]->getParent(); parent; parent = parent->getParent())
+					++depth;
+
+				for (Widget* widget = widgets[i]; widget; widget = widget->getParent(), --depth)
+				{
+					// Its parents were locked together with it
+					if (isLocked(widget))
+						break;
+
+					widget->m_childrenLock++;
+					m_locked.push_back(std::make_pair(depth, widget));
+				}
+			}
+
+			// Children apply their pending operations before their parents, like when dispatching recursively
+			std::stable_sort(m_locked.begin(), m_locked.end(), [](const std::pair<int, Widget*>& a, const std::pair<int, Widget*>& b)
+			{
+				return a.first > b.first;
+			});
+		}
+
+		~ChildrenLock()
+		{
+			for (std::size_t i = 0; i < m_locked.size(); ++i)
+			{
+				Widget* widget = m_locked[i].second;
+				widget->m_childrenLock--;
+
+				if (widget->m_childrenLock == 0)
+					widget->applyPendingOperations();
+			}
+		}
+
+	private:
+		bool isLocked(Widget* widget) const
+		{
+			for (std::size_t i = 0; i < m_locked.size(); ++i)
+			{
+				if (m_locked[i].second == widget)
+					return true;
+			}
+			return false;
+		}
+
+		std::vector<std::pair<int, Widget*> > m_locked;
+	};
+}
+
 UICanvas::UICanvas()
 : m_surfaceContainerLock(0)
 , m_backgroundColor(Color::Transparent)
@@ -130,6 +207,69 @@ UICanvas::ControlList UICanvas::selectControls(const String& selector)
 {
 	ControlList list;
 
+	std::vector<StyleSheet::Selector> selectors;
+	bool named = true;
+
+	StringList parts = selector.split(',');
+	for (std::size_t i = 0; i < parts.size(); ++i)
+	{
+		String text = parts[i];
+		text.trim();
+
+		StyleSheet::Selector compiled;
+		if (!StyleSheet::parseSelector(text, compiled))
+		{
+			LOG_WARNING(LogContent, "Selector '%s' isn't supported, only compound selectors are", text.c_str());
+			continue;
+		}
+
+		named = named && compiled.name != 0;
+		selectors.push_back(compiled);
+	}
+
+	if (selectors.empty())
+		return list;
+
+	// Every selector has an #id, so only the widgets with those names can match
+	ControlList candidates;
+	if (named)
+	{
+		for (std::size_t i = 0; i < selectors.size(); ++i)
+			m_state.widgetIndex.findById(selectors[i].name, candidates);
+	}
+	else
+	{
+		// Breadth first through every surface
+		for (std::size_t i = 0; i < m_surfaces.size(); ++i)
+		{
+			std::size_t first = candidates.size();
+			candidates.push_back(m_surfaces[i]);
+
+			for (std::size_t j = first; j < candidates.size(); ++j)
+			{
+				for (int c = 0; c < candidates[j]->getChildCount(); ++c)
+					candidates.push_back(candidates[j]->getChild(c));
+			}
+		}
+	}
+
+	for (std::size_t i = 0; i < candidates.size(); ++i)
+	{
+		Widget* widget = candidates[i];
+		if (std::find(list.begin(), list.end(), widget) != list.end() || !findSurface(widget))
+			continue;
+
+		StyleSheet::Subject subject = widget->getStyleSubject();
+		for (std::size_t j = 0; j < selectors.size(); ++j)
+		{
+			if (StyleSheet::matches(selectors[j], subject))
+			{
+				list.push_back(widget);
+				break;
+			}
+		}
+	}
+
 	return list;
 }
 
@@ -246,16 +386,34 @@ void UICanvas::showMessageBox(const String& message)
 /// Returns a control in the hierarchy with the name, or NULL if not found
 Widget* UICanvas::getControlByName(const String& name)
 {
-	Widget* control = NULL;
-	for(std::vector<UIWindow*>::const_iterator it = m_surfaces.begin(); it != m_surfaces.end(); it++)
+	ControlList named;
+	m_state.widgetIndex.findByName(name, named);
+
+	for (std::size_t i = 0; i < named.size(); ++i)
 	{
-		control = (*it)->findByName(name);
-		if(control != NULL) return control; // the surface returned something
+		if (findSurface(named[i]))
+			return named[i];
 	}
 
 	return NULL; // Nothing found.
 };
 
+/// Get the surface a widget is in, NULL if it isn't in any surface of this canvas
+UIWindow* UICanvas::findSurface(Widget* widget)
+{
+	Widget* root = widget;
+	while (root->getParent())
+		root = root->getParent();
+
+	for (std::size_t i = 0; i < m_surfaces.size(); ++i)
+	{
+		if (m_surfaces[i] == root)
+			return m_surfaces[i];
+	}
+
+	return NULL;
+}
+
 UIWindow* UICanvas::addSurface(const String& name)
 {
 	UIWindow* surface = new UIWindow();
@@ -299,16 +457,25 @@ UIWindow* UICanvas::createWindow(const String& name)
 /// Draw the UI
 void UICanvas::draw(GraphicsDevice* renderer)
 {
+	m_drawList.beginFrame();
+
 	/// Draw surfaces bottom to top
 	for(std::vector<UIWindow*>::iterator it = m_surfaces.begin(); it != m_surfaces.end(); it++)
 	{
 		if ((*it)->m_visible)
 		{
 			//Log("Drawing window: %s", (*it)->getName().c_str());
+
+			// The list holds flat canvas coordinates, 3D and world space windows keep drawing directly
+			bool recorded = !(*it)->_3d && (*it)->mCoordinateSpace == UI::LocalSpace;
+			getCore().drawList = recorded ? &m_drawList : nullptr;
+
 			(*it)->draw(renderer);
+			m_drawList.flush(renderer);
 		}
 	}
 
+	getCore().drawList = &m_drawList;
 
 	if (getCore().dragElement)
 	{
@@ -324,8 +491,17 @@ void UICanvas::draw(GraphicsDevice* renderer)
 	{
 		getCore().menuElementStack[0]->drawItself(renderer, mat4::identity);
 	}
+
+	m_drawList.flush(renderer);
+	getCore().drawList = nullptr;
 };
 
+/// Get the counters of the last drawn frame, like the batches and the widgets painted again
+const UIDrawList::Statistics& UICanvas::getDrawStatistics() const
+{
+	return m_drawList.getStatistics();
+}
+
 /// Destroys a surface from its children
 void UICanvas::destroySurface(UIWindow* surface)
 {
@@ -489,18 +665,17 @@ void UICanvas::setLanguage(const String& shortLanguageName)
 }
 
 /// Process a mouse press event
-bool UICanvas::processMouseButtonPressed(int x, int y, Mouse::Button button)
+bool UICanvas::processMouseButtonPressed(int x, int y, Mouse::Button)
 {
 	m_surfaceContainerLock++;
-	bool canContinue = true;
-	for(std::vector<UIWindow*>::reverse_iterator it = m_surfaces.rbegin(); it != m_surfaces.rend() && canContinue; it++)
 	{
-		(*it)->processMouseButtonPressed(x,y,button);
+		ControlList hits;
+		collectHits(vec2(x, y), hits);
 
-		if((*it)->isModal())
+		ChildrenLock lock(hits);
+		for (std::size_t i = 0; i < hits.size(); ++i)
 		{
-			//eventUsage.clickPassedThrough = false;
-			canContinue = false;
+			hits[i]->m_pointerPressCount++;
 		}
 	}
 	m_surfaceContainerLock--;
@@ -508,20 +683,19 @@ bool UICanvas::processMouseButtonPressed(int x, int y, Mouse::Button button)
 	return false;
 }
 
-void UICanvas::processMouseButtonReleased(int x, int y, Mouse::Button button, UIEventResult& info)
+void UICanvas::processMouseButtonReleased(int x, int y, Mouse::Button, UIEventResult&)
 {
 	m_surfaceContainerLock++;
-	bool canContinue = true;
-	for(std::vector<UIWindow*>::reverse_iterator it = m_surfaces.rbegin(); it != m_surfaces.rend(); ++it)
 	{
-		if(canContinue)
-		{
-			(*it)->processMouseButtonReleased(x, y, button, info);
+		ControlList hits;
+		collectHits(vec2(x, y), hits);
 
-			if((*it)->isModal())
-			{
-				canContinue = false;
-			}
+		ChildrenLock lock(hits);
+		for (std::size_t i = 0; i < hits.size(); ++i)
+		{
+			if (hits[i]->m_pointerPressCount > 0)
+				hits[i]->onClick();
+			hits[i]->m_pointerPressCount = 0;
 		}
 	}
 	m_surfaceContainerLock --;
@@ -534,15 +708,7 @@ void UICanvas::processMouseButtonReleased(int x, int y, Mouse::Button button, UI
 bool UICanvas::processMouseMove(int x, int y)
 {
 	m_surfaceContainerLock++;
-	bool canContinue = true;
-	for(std::vector<UIWindow*>::reverse_iterator it = m_surfaces.rbegin(); it != m_surfaces.rend() && canContinue; it++){
-		(*it)->processMouseMove(x,y);
-
-		if((*it)->isModal())
-		{
-			canContinue = false;
-		}
-	}
+	updateHover(x, y, true);
 	m_surfaceContainerLock--;
 	return false;
 }
@@ -550,18 +716,109 @@ bool UICanvas::processMouseMove(int x, int y)
 void UICanvas::processTouchMove(int x, int y)
 {
 	m_surfaceContainerLock++;
-	bool canContinue = true;
-	for(std::vector<UIWindow*>::reverse_iterator it = m_surfaces.rbegin(); it != m_surfaces.rend() && canContinue; it++){
-		(*it)->processTouchMove(x,y);
+	updateHover(x, y, false);
+	m_surfaceContainerLock--;
+}
 
-		if((*it)->isModal())
+/// Collect the visible widgets under a point that pointer events reach, in the order of the hierarchy
+void UICanvas::collectHits(vec2 point, ControlList& hits)
+{
+	ControlList candidates;
+	m_state.widgetIndex.query(point, candidates);
+
+	std::vector<PointerHit> found;
+	for (std::size_t i = 0; i < candidates.size(); ++i)
+	{
+		Widget* widget = candidates[i];
+		if (!widget->m_visible || !widget->getParent())
+			continue;
+
+		// Walk up to the surface, through visible parents that already hold it as a child
+		PointerHit hit;
+		hit.widget = widget;
+		hit.surface = -1;
+
+		bool reachable = true;
+		Widget* node = widget;
+		for (Widget* parent = widget->getParent(); parent && reachable; node = parent, parent = parent->getParent())
+		{
+			std::vector<UxNode*>::iterator it = std::find(parent->mChildren.begin(), parent->mChildren.end(), node);
+			reachable = parent->m_visible && it != parent->mChildren.end();
+			hit.path.push_back(static_cast<int>(it - parent->mChildren.begin()));
+		}
+
+		if (!reachable)
+			continue;
+
+		// Surfaces below the first modal one don't get pointer events
+		for (int s = static_cast<int>(m_surfaces.size()) - 1, rank = 0; s >= 0; --s, ++rank)
 		{
-			canContinue = false;
+			if (m_surfaces[s] == node)
+			{
+				hit.surface = rank;
+				break;
+			}
+
+			if (m_surfaces[s]->isModal())
+				break;
 		}
+
+		if (hit.surface == -1 || !widget->isHit(point))
+			continue;
+
+		std::reverse(hit.path.begin(), hit.path.end());
+		found.push_back(hit);
+	}
+
+	std::sort(found.begin(), found.end());
+
+	for (std::size_t i = 0; i < found.size(); ++i)
+	{
+		hits.push_back(found[i].widget);
 	}
-	m_surfaceContainerLock--;
 }
 
+/// Hover the widgets under the pointer and leave the ones it moved out of
+void UICanvas::updateHover(int x, int y, bool notifyEnter)
+{
+	ControlList hits;
+	collectHits(vec2(x, y), hits);
+
+	ChildrenLock lock(hits);
+
+	ControlList previous;
+	previous.swap(m_hoveredWidgets);
+
+	for (std::size_t i = 0; i < previous.size(); ++i)
+	{
+		Widget* widget = previous[i];
+
+		// Destroyed widgets left the index, the handlers may destroy more as this goes
+		if (!m_state.widgetIndex.contains(widget) || !widget->m_hovered || std::find(hits.begin(), hits.end(), widget) != hits.end())
+			continue;
+
+		widget->setPseudoClass("hover", false);
+		widget->onMouseLeave();
+		widget->m_hovered = false;
+	}
+
+	for (std::size_t i = 0; i < hits.size(); ++i)
+	{
+		Widget* widget = hits[i];
+		widget->onMouseMove();
+
+		if (!widget->m_hovered)
+		{
+			widget->setPseudoClass("hover", true);
+			widget->m_hovered = true;
+
+			if (notifyEnter)
+				widget->onMouseEnter();
+		}
+	}
+
+	m_hoveredWidgets = hits;
+}
 
 void UICanvas::applyPendingChanges()
 {
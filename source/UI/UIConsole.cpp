@@ -1,10 +1,97 @@
 #include <Nephilim/UI/UIConsole.h>
 
+#include <algorithm>
+
 NEPHILIM_NS_BEGIN
 
+/// Construct an empty console
+UIConsole::UIConsole()
+: UIRowView()
+, InputLineEdit(nullptr)
+, mFirstLine(0)
+, mCapacity(4096)
+{
+}
+
+/// Add a line to the log
+void UIConsole::addLine(const String& line)
+{
+	bool following = isScrolledToBottom();
+
+	if (mLines.size() < mCapacity)
+	{
+		mLines.push_back(line);
+	}
+	else
+	{
+		// Full, the oldest line is overwritten and every line moves up a row
+		mLines[mFirstLine] = line;
+		mFirstLine = (mFirstLine + 1) % mLines.size();
+		refreshRows();
+
+		// Keep the same lines in view when not following
+		if (!following)
+			scrollBy(-getRowHeight());
+	}
+
+	if (following)
+		scrollToBottom();
+}
+
+/// Set how many lines are kept, the oldest go away first
+void UIConsole::setCapacity(std::size_t lines)
+{
+	lines = lines > 0 ? lines : 1;
+
+	// Put the kept lines in order, at the start of the buffer
+	std::vector<String> kept;
+	std::size_t count = std::min(mLines.size(), lines);
+	kept.reserve(count);
+	for (std::size_t i = mLines.size() - count; i < mLines.size(); ++i)
+		kept.push_back(mLines[(mFirstLine + i) % mLines.size()]);
+
+	mLines.swap(kept);
+	mFirstLine = 0;
+	mCapacity = lines;
+	refreshRows();
+}
+
+/// Get how many lines are kept at most
+std::size_t UIConsole::getCapacity() const
+{
+	return mCapacity;
+}
+
+/// Forget every line
+void UIConsole::clearLines()
+{
+	mLines.clear();
+	mFirstLine = 0;
+	scrolling_offset.y = 0.f;
+	refreshRows();
+}
+
+/// Get a line, 0 is the oldest kept
+const String& UIConsole::getLine(int index) const
+{
+	return mLines[(mFirstLine + index) % mLines.size()];
+}
+
+/// Get how many lines are kept
+int UIConsole::getRowCount()
+{
+	return static_cast<int>(mLines.size());
+}
+
+/// Show a line of the log
+void UIConsole::fillRow(Row& widget, int row)
+{
+	widget.text = getLine(row);
+}
+
 void UIConsole::draw(GraphicsDevice* renderer)
 {
 
 }
 
-NEPHILIM_NS_END
\ No newline at end of file
+NEPHILIM_NS_END
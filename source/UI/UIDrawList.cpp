@@ -0,0 +1,360 @@
+#include <Nephilim/UI/UIDrawList.h>
+#include <Nephilim/Graphics/GraphicsDevice.h>
+#include <Nephilim/Graphics/Text.h>
+#include <Nephilim/Graphics/Font.h>
+
+#include <algorithm>
+#include <cstring>
+
+NEPHILIM_NS_BEGIN
+
+namespace
+{
+	/// How many batches back a command may look for one to join
+	const int batchSearchDepth = 8;
+
+	bool overlaps(const FloatRect& a, const FloatRect& b)
+	{
+		return a.left < b.left + b.width && b.left < a.left + a.width &&
+		       a.top < b.top + b.height && b.top < a.top + a.height;
+	}
+
+	FloatRect merge(const FloatRect& a, const FloatRect& b)
+	{
+		float left = std::min(a.left, b.left);
+		float top = std::min(a.top, b.top);
+		float right = std::max(a.left + a.width, b.left + b.width);
+		float bottom = std::max(a.top + a.height, b.top + b.height);
+		return FloatRect(left, top, right - left, bottom - top);
+	}
+
+	bool sameRect(const FloatRect& a, const FloatRect& b)
+	{
+		return a.left == b.left && a.top == b.top && a.width == b.width && a.height == b.height;
+	}
+}
+
+/// Forget the recorded geometry
+void UIDrawList::Chunk::clear()
+{
+	vertices.clear();
+	commands.clear();
+}
+
+/// Check if a font changed its glyph textures since the geometry was recorded
+bool UIDrawList::Chunk::isStale() const
+{
+	for (std::size_t i = 0; i < commands.size(); ++i)
+	{
+		if (commands[i].font && commands[i].font->getGeneration() != commands[i].generation)
+			return true;
+	}
+	return false;
+}
+
+/// Creates an empty list
+UIDrawList::UIDrawList()
+: m_chunk(nullptr)
+, m_vertices(Render::Primitive::Triangles, 0)
+{
+	std::memset(&m_statistics, 0, sizeof(m_statistics));
+	m_lastStatistics = m_statistics;
+}
+
+/// Start counting a new frame, the counters of the last one remain available from getStatistics()
+void UIDrawList::beginFrame()
+{
+	m_lastStatistics = m_statistics;
+	std::memset(&m_statistics, 0, sizeof(m_statistics));
+}
+
+/// Get the counters of the last finished frame
+const UIDrawList::Statistics& UIDrawList::getStatistics() const
+{
+	return m_lastStatistics;
+}
+
+/// Start recording the painting of a widget into chunk, clearing it
+void UIDrawList::beginChunk(Chunk& chunk)
+{
+	chunk.clear();
+	m_chunk = &chunk;
+}
+
+/// Stop recording into the chunk and append it to the frame
+void UIDrawList::endChunk()
+{
+	Chunk* chunk = m_chunk;
+	m_chunk = nullptr;
+
+	if (chunk)
+		append(*chunk);
+}
+
+/// Check if a chunk is being recorded
+bool UIDrawList::isRecording() const
+{
+	return m_chunk != nullptr;
+}
+
+/// Record a rectangle, transformed to canvas coordinates
+void UIDrawList::addRect(const FloatRect& rect, const mat4& transform, const Color& color, const Font* font, unsigned int characterSize)
+{
+	if (!m_chunk)
+		return;
+
+	// The center of the 2x2 white square at the corner of every font page
+	Vec2f white(0.f, 0.f);
+	if (font)
+	{
+		Vector2<int> textureSize = font->getTexture(characterSize).getSize();
+		if (textureSize.x > 0 && textureSize.y > 0)
+			white = Vec2f(1.f / textureSize.x, 1.f / textureSize.y);
+	}
+
+	const Vec2f corners[6] = {
+		Vec2f(rect.left, rect.top), Vec2f(rect.left + rect.width, rect.top), Vec2f(rect.left + rect.width, rect.top + rect.height),
+		Vec2f(rect.left, rect.top), Vec2f(rect.left + rect.width, rect.top + rect.height), Vec2f(rect.left, rect.top + rect.height)
+	};
+
+	Command& command = beginCommand(font, characterSize, 6);
+	const float* m = transform.get();
+	float minX = 0.f, minY = 0.f, maxX = 0.f, maxY = 0.f;
+
+	for (std::size_t i = 0; i < 6; ++i)
+	{
+		VertexArray2D::Vertex& vertex = m_chunk->vertices[command.first + i];
+		vertex.position.x = m[0] * corners[i].x + m[4] * corners[i].y + m[12];
+		vertex.position.y = m[1] * corners[i].x + m[5] * corners[i].y + m[13];
+		vertex.color = color;
+		vertex.texCoords = white;
+
+		minX = (i == 0) ? vertex.position.x : std::min(minX, vertex.position.x);
+		minY = (i == 0) ? vertex.position.y : std::min(minY, vertex.position.y);
+		maxX = (i == 0) ? vertex.position.x : std::max(maxX, vertex.position.x);
+		maxY = (i == 0) ? vertex.position.y : std::max(maxY, vertex.position.y);
+	}
+
+	command.bounds = FloatRect(minX, minY, maxX - minX, maxY - minY);
+}
+
+/// Record vertices laid out with font, transformed to canvas coordinates
+void UIDrawList::addText(const VertexArray2D& vertices, const mat4& transform, const Font& font, unsigned int characterSize)
+{
+	if (!m_chunk || vertices.m_vertices.empty())
+		return;
+
+	Command& command = beginCommand(&font, characterSize, vertices.m_vertices.size());
+	const float* m = transform.get();
+	float minX = 0.f, minY = 0.f, maxX = 0.f, maxY = 0.f;
+
+	for (std::size_t i = 0; i < vertices.m_vertices.size(); ++i)
+	{
+		const VertexArray2D::Vertex& source = vertices.m_vertices[i];
+		VertexArray2D::Vertex& vertex = m_chunk->vertices[command.first + i];
+		vertex.position.x = m[0] * source.position.x + m[4] * source.position.y + m[12];
+		vertex.position.y = m[1] * source.position.x + m[5] * source.position.y + m[13];
+		vertex.color = source.color;
+		vertex.texCoords = source.texCoords;
+
+		minX = (i == 0) ? vertex.position.x : std::min(minX, vertex.position.x);
+		minY = (i == 0) ? vertex.position.y : std::min(minY, vertex.position.y);
+		maxX = (i == 0) ? vertex.position.x : std::max(maxX, vertex.position.x);
+		maxY = (i == 0) ? vertex.position.y : std::max(maxY, vertex.position.y);
+	}
+
+	command.bounds = FloatRect(minX, minY, maxX - minX, maxY - minY);
+}
+
+/// Append what a widget recorded before, clipped by the current clip rectangle
+void UIDrawList::append(const Chunk& chunk)
+{
+	if (chunk.commands.empty())
+		return;
+
+	std::size_t base = m_recorded.size();
+	m_recorded.insert(m_recorded.end(), chunk.vertices.begin(), chunk.vertices.end());
+
+	for (std::size_t i = 0; i < chunk.commands.size(); ++i)
+	{
+		addCommand(chunk.commands[i], base + chunk.commands[i].first);
+	}
+}
+
+/// Clip what is appended from now on to rect, in canvas coordinates, until popClipRect()
+void UIDrawList::pushClipRect(const FloatRect& rect)
+{
+	m_clipStack.push_back(rect);
+}
+
+/// Go back to the clip rectangle before the last pushClipRect()
+void UIDrawList::popClipRect()
+{
+	if (!m_clipStack.empty())
+		m_clipStack.pop_back();
+}
+
+/// Bring the device clipping to the current clip rectangle of the list
+void UIDrawList::applyClipRect(GraphicsDevice* device) const
+{
+	if (m_clipStack.empty())
+	{
+		device->setClippingEnabled(false);
+	}
+	else
+	{
+		device->setClippingEnabled(true);
+		device->setClippingRect(m_clipStack.back());
+	}
+}
+
+/// Draw and forget everything appended so far
+void UIDrawList::flush(GraphicsDevice* device)
+{
+	if (m_batches.empty())
+		return;
+
+	// Lay the batches out one after the other in the shared array
+	m_vertices.m_vertices.resize(m_recorded.size());
+	std::size_t offset = 0;
+
+	for (std::size_t i = 0; i < m_batches.size(); ++i)
+	{
+		Batch& batch = m_batches[i];
+		batch.vertexOffset = offset;
+		for (int c = batch.firstCommand; c != -1; c = m_commands[c].next)
+		{
+			std::memcpy(&m_vertices.m_vertices[offset], &m_recorded[m_commands[c].first], m_commands[c].count * sizeof(VertexArray2D::Vertex));
+			offset += m_commands[c].count;
+		}
+		batch.vertexCount = offset - batch.vertexOffset;
+	}
+
+	// The vertices are in canvas coordinates already
+	device->setModelMatrix(mat4());
+
+	for (std::size_t i = 0; i < m_batches.size(); ++i)
+	{
+		const Batch& batch = m_batches[i];
+
+		if (batch.clipped)
+		{
+			device->setClippingEnabled(true);
+			device->setClippingRect(batch.clip);
+		}
+		else
+		{
+			device->setClippingEnabled(false);
+		}
+
+		if (batch.font)
+		{
+			Text::drawGeometry(device, *batch.font, batch.characterSize, m_vertices, batch.vertexOffset, batch.vertexCount);
+		}
+		else
+		{
+			device->setDefaultTexture();
+			device->setBlendingEnabled(true);
+			device->setBlendMode(Render::Blend::Alpha);
+			device->drawRange(m_vertices, batch.vertexOffset, batch.vertexCount);
+		}
+	}
+
+	m_statistics.batches += static_cast<int>(m_batches.size());
+	m_statistics.commands += static_cast<int>(m_commands.size());
+	m_statistics.vertices += m_recorded.size();
+	++m_statistics.flushes;
+
+	m_recorded.clear();
+	m_commands.clear();
+	m_batches.clear();
+
+	// Leave the clipping how direct drawing after this expects it
+	applyClipRect(device);
+}
+
+/// Count a widget whose onPaint() ran and was recorded this frame
+void UIDrawList::countPainted()
+{
+	++m_statistics.paintedWidgets;
+}
+
+/// Count a widget drawn from its recorded chunk this frame
+void UIDrawList::countReused()
+{
+	++m_statistics.reusedWidgets;
+}
+
+/// Count a widget that draws with the device directly this frame
+void UIDrawList::countImmediate()
+{
+	++m_statistics.immediateWidgets;
+}
+
+/// Add a run of vertices of the frame to a batch, joining an earlier one when the order allows
+void UIDrawList::addCommand(const Command& command, std::size_t first)
+{
+	bool clipped = !m_clipStack.empty();
+	FloatRect clip = clipped ? m_clipStack.back() : FloatRect();
+
+	PendingCommand pending;
+	pending.first = first;
+	pending.count = command.count;
+	pending.next = -1;
+	m_commands.push_back(pending);
+	int index = static_cast<int>(m_commands.size()) - 1;
+
+	// Walk back to a batch with the same state, but never past something drawn over this command's area
+	int target = -1;
+	int last = static_cast<int>(m_batches.size()) - 1;
+	for (int i = last; i >= 0 && i > last - batchSearchDepth; --i)
+	{
+		const Batch& batch = m_batches[i];
+		if (batch.font == command.font && batch.characterSize == command.characterSize &&
+			batch.clipped == clipped && (!clipped || sameRect(batch.clip, clip)))
+		{
+			target = i;
+			break;
+		}
+
+		if (overlaps(batch.bounds, command.bounds))
+			break;
+	}
+
+	if (target == -1)
+	{
+		Batch batch;
+		batch.font = command.font;
+		batch.characterSize = command.characterSize;
+		batch.clipped = clipped;
+		batch.clip = clip;
+		batch.bounds = command.bounds;
+		batch.firstCommand = index;
+		batch.lastCommand = index;
+		m_batches.push_back(batch);
+	}
+	else
+	{
+		Batch& batch = m_batches[target];
+		batch.bounds = merge(batch.bounds, command.bounds);
+		m_commands[batch.lastCommand].next = index;
+		batch.lastCommand = index;
+	}
+}
+
+/// Append the vertices of a new command to the chunk being recorded
+UIDrawList::Command& UIDrawList::beginCommand(const Font* font, unsigned int characterSize, std::size_t vertexCount)
+{
+	Command command;
+	command.font = font;
+	command.characterSize = font ? characterSize : 0;
+	command.generation = font ? font->getGeneration() : 0;
+	command.first = m_chunk->vertices.size();
+	command.count = vertexCount;
+
+	m_chunk->vertices.resize(command.first + vertexCount);
+	m_chunk->commands.push_back(command);
+	return m_chunk->commands.back();
+}
+
+NEPHILIM_NS_END
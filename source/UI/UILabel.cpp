@@ -1,5 +1,7 @@
 #include <Nephilim/UI/UILabel.h>
 #include <Nephilim/Graphics/Text.h>
+#include <Nephilim/Graphics/GlyphRunCache.h>
+#include <Nephilim/Graphics/GraphicsDevice.h>
 
 #include <iostream>
 using namespace std;
@@ -49,12 +51,13 @@ bool UILabel::onEventNotification(Event& event)
 
 void UILabel::draw(GraphicsDevice* renderer)
 {
-	Text t;
-	t.setFont(*_core->m_defaultFont);
-	t.setString(m_label);
-	t.setColor(m_color);
-//	t.setPosition(mRect.left, mRect.top);
-	renderer->draw(t);
+	if (!_core->m_defaultFont)
+		return;
+
+	// The same label costs a lookup after its first frame
+	const GlyphRunCache::Run& run = GlyphRunCache::instance().get(m_label, *_core->m_defaultFont, 30, Text::Regular, m_color);
+	renderer->setModelMatrix(mat4());
+	GlyphRunCache::draw(renderer, run);
 }
 
 NEPHILIM_NS_END
@@ -29,6 +29,7 @@ void UILineEdit::clear()
 {
 	m_pipeIndex = 0;
 	StringBuffer.clear();
+	invalidatePaint();
 }
 
 /// Called on the subclass to have it paint its contents
@@ -60,6 +61,7 @@ void UILineEdit::keyPressEvent(UxKeyEvent* key)
 void UILineEdit::setTextColor(const Color& color)
 {
 	m_textColor = color;
+	invalidatePaint();
 }
 
 bool UILineEdit::onKeyPressed(Keyboard::Key key)
@@ -106,6 +108,7 @@ void UILineEdit::addCharacter(Uint32 charCode)
 	{
 		StringBuffer.insert(StringBuffer.begin() + m_pipeIndex, charCode);
 		m_pipeIndex++;
+		invalidatePaint();
 	}
 }
 
@@ -115,6 +118,7 @@ void UILineEdit::eraseCharacter()
 	{
 		StringBuffer.erase(StringBuffer.begin() + m_pipeIndex - 1);
 		m_pipeIndex--;
+		invalidatePaint();
 	}
 }
 
@@ -122,6 +126,7 @@ void UILineEdit::setText(const String& text)
 {
 	StringBuffer = text;
 	t.setString(StringBuffer);
+	invalidatePaint();
 }
 
 void UILineEdit::setType(UILineEditTypes type)
@@ -1,8 +1,38 @@
 #include <Nephilim/UI/UIListView.h>
 #include <Nephilim/Graphics/Text.h>
+#include <Nephilim/Foundation/DataModel.h>
 
 NEPHILIM_NS_BEGIN
 
+/// Show a column of a model
+void UIListView::setModel(DataModel* model, int column)
+{
+	mModel = model;
+	mColumn = column;
+
+	setSelectedRow(-1);
+	scrolling_offset.y = 0.f;
+	refreshRows();
+}
+
+/// Get the model being shown, null if there is none
+DataModel* UIListView::getModel()
+{
+	return mModel;
+}
+
+/// Get how many rows the model has
+int UIListView::getRowCount()
+{
+	return mModel ? mModel->rows() : 0;
+}
+
+/// Read the text of a row from the model
+void UIListView::fillRow(Row& widget, int row)
+{
+	widget.text = mModel ? mModel->data(row, mColumn).toString() : String();
+}
+
 void UIListView::onRender(GraphicsDevice* renderer, Widget* view)
 {
 	RectangleShape backgroundRect;
@@ -33,6 +33,16 @@ namespace
 			{
 				view->setName(it->as_string());
 			}
+			if (attributeName == "class")
+			{
+				// Space separated, like in HTML
+				StringList classes = String(it->as_string()).split(' ');
+				for (std::size_t i = 0; i < classes.size(); ++i)
+				{
+					if (!classes[i].empty())
+						view->setStyleClass(classes[i], true);
+				}
+			}
 			if (attributeName == "size")
 			{
 				// Its a tuple for width and height
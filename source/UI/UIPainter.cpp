@@ -1,7 +1,9 @@
 #include <Nephilim/UI/UIPainter.h>
+#include <Nephilim/UI/UIDrawList.h>
 #include <Nephilim/Graphics/GraphicsDevice.h>
 #include <Nephilim/Graphics/RectangleShape.h>
 #include <Nephilim/Graphics/Text.h>
+#include <Nephilim/Graphics/GlyphRunCache.h>
 
 NEPHILIM_NS_BEGIN
 
@@ -16,6 +18,12 @@ namespace
 /// Draw a rectangle
 void UIPainter::drawRect(FloatRect rectangle)
 {
+	if (drawList && drawList->isRecording())
+	{
+		drawList->addRect(rectangle, baseMatrix, currentColor, activeFont, currentTextSize);
+		return;
+	}
+
 	RectangleShape rectShape(rectangle, currentColor);
 	rectShape.useOwnTransform = false;
 	graphicsDevice->setModelMatrix(baseMatrix * rectShape.getTransform().getMatrix());
@@ -25,19 +33,7 @@ void UIPainter::drawRect(FloatRect rectangle)
 /// Renders the text at the default position
 void UIPainter::drawText(const String& text)
 {
-	if (activeFont)
-	{
-		Text textObject;
-		textObject.setCharacterSize(currentTextSize);
-		textObject.setString(text);
-		textObject.setColor(currentTextFill);
-		textObject.setOrigin(0.f, 0.f);
-		textObject.setFont(*activeFont);
-
-		graphicsDevice->setModelMatrix(baseMatrix * textObject.getTransform().getMatrix());
-		textObject.useOwnTransform = false;
-		graphicsDevice->draw(textObject);
-	}
+	drawText(Vector2D(0.f, 0.f), text);
 }
 
 /// Renders the text at the current origin
@@ -45,17 +41,17 @@ void UIPainter::drawText(Vector2D point, const String& text)
 {
 	if (activeFont)
 	{
-		Text textObject;
-		textObject.setCharacterSize(currentTextSize);
-		textObject.setString(text);
-		textObject.setColor(currentTextFill);
-		textObject.setOrigin(0.f, 0.f);
-		textObject.setFont(*activeFont);
-		textObject.setPosition(point);
+		const GlyphRunCache::Run& run = GlyphRunCache::instance().get(text, *activeFont, currentTextSize, Text::Regular, currentTextFill);
 
-		graphicsDevice->setModelMatrix(baseMatrix * textObject.getTransform().getMatrix());
-		textObject.useOwnTransform = false;
-		graphicsDevice->draw(textObject);
+		if (drawList && drawList->isRecording())
+		{
+			drawList->addText(run.vertices, baseMatrix * mat4::translate(point.x, point.y, 0.f), *activeFont, currentTextSize);
+			return;
+		}
+
+		graphicsDevice->setModelMatrix(baseMatrix * mat4::translate(point.x, point.y, 0.f));
+		GlyphRunCache::draw(graphicsDevice, run);
+		graphicsDevice->setModelMatrix(mat4());
 	}
 }
 
@@ -64,28 +60,28 @@ void UIPainter::drawText(FloatRect rectangle, int flags, const String& text)
 {
 	if (activeFont)
 	{
-		Text textObject;
-		textObject.setCharacterSize(currentTextSize);
-		textObject.setString(text);
-		textObject.setColor(currentTextFill);
-		textObject.setOrigin(0.f, 0.f);
-		textObject.setFont(*activeFont);
+		const GlyphRunCache::Run& run = GlyphRunCache::instance().get(text, *activeFont, currentTextSize, Text::Regular, currentTextFill);
 
+		// Position minus origin, both on whole pixels like the text was placed before
+		Vector2D position(0.f, 0.f);
 		if ((flags & PainterFlags::AlignCenterH) == PainterFlags::AlignCenterH)
 		{
-			textObject.setOrigin(closestInteger(textObject.getLocalBounds().width / 2.f), closestInteger(textObject.getOrigin().y));
-			textObject.setPosition(closestInteger(rectangle.left + rectangle.width / 2.f), closestInteger(textObject.getPosition().y));
+			position.x = static_cast<float>(closestInteger(rectangle.left + rectangle.width / 2.f) - closestInteger(run.bounds.width / 2.f));
 		}
 		if ((flags & PainterFlags::AlignCenterV) == PainterFlags::AlignCenterV)
 		{
-			textObject.setOrigin(closestInteger(textObject.getOrigin().x), closestInteger(textObject.getLocalBounds().height / 2.f));
-			textObject.setPosition(closestInteger(textObject.getPosition().x), closestInteger(rectangle.top + rectangle.height / 2.f));
+			position.y = static_cast<float>(closestInteger(rectangle.top + rectangle.height / 2.f) - closestInteger(run.bounds.height / 2.f));
+		}
+
+		if (drawList && drawList->isRecording())
+		{
+			drawList->addText(run.vertices, baseMatrix * mat4::translate(position.x, position.y, 0.f), *activeFont, currentTextSize);
+			return;
 		}
-		
 
-		graphicsDevice->setModelMatrix(baseMatrix * textObject.getTransform().getMatrix());
-		textObject.useOwnTransform = false;
-		graphicsDevice->draw(textObject);
+		graphicsDevice->setModelMatrix(baseMatrix * mat4::translate(position.x, position.y, 0.f));
+		GlyphRunCache::draw(graphicsDevice, run);
+		graphicsDevice->setModelMatrix(mat4());
 	}
 }
 
@@ -0,0 +1,241 @@
+#include <Nephilim/UI/UIRowView.h>
+#include <Nephilim/UI/UIPainter.h>
+
+#include <algorithm>
+#include <cmath>
+
+NEPHILIM_NS_BEGIN
+
+/// Paint the selection and the text
+void UIRowView::Row::onPaint(UIPainter& painter)
+{
+	if (selected || m_hovered)
+	{
+		painter.setFillColor(selected ? Color(51, 102, 153) : Color(255, 255, 255, 20));
+		painter.drawRect(FloatRect(0.f, 0.f, size.x, size.y));
+	}
+
+	painter.setTextFillColor(textColor);
+	float y = std::floor((size.y - static_cast<float>(painter.currentTextSize)) / 2.f);
+
+	if (!marker.empty())
+		painter.drawText(Vector2D(indent - 12.f, y), marker);
+
+	painter.drawText(Vector2D(indent, y), text);
+}
+
+/// Construct an empty view
+UIRowView::UIRowView()
+: Widget()
+, mRowHeight(20.f)
+, mSelectedRow(-1)
+, mRowsDirty(true)
+{
+	m_clipChildren = true;
+}
+
+/// Set the height of every row
+void UIRowView::setRowHeight(float height)
+{
+	mRowHeight = std::max(height, 1.f);
+	refreshRows();
+}
+
+/// Get the height of every row
+float UIRowView::getRowHeight() const
+{
+	return mRowHeight;
+}
+
+/// Get how many rows there are
+int UIRowView::getRowCount()
+{
+	return 0;
+}
+
+/// Scroll by pixels, down for positive values, without going past the rows
+void UIRowView::scrollBy(float pixels)
+{
+	float maxScroll = std::max(getContentHeight() - size.y, 0.f);
+	float scroll = std::min(std::max(-scrolling_offset.y + pixels, 0.f), maxScroll);
+	scrolling_offset.y = -scroll;
+}
+
+/// Scroll as little as needed to have a row in view
+void UIRowView::scrollToRow(int row)
+{
+	float top = static_cast<float>(row) * mRowHeight;
+	float scroll = -scrolling_offset.y;
+
+	if (top < scroll)
+		scrollBy(top - scroll);
+	else if (top + mRowHeight > scroll + size.y)
+		scrollBy(top + mRowHeight - (scroll + size.y));
+}
+
+/// Scroll to the last row
+void UIRowView::scrollToBottom()
+{
+	scrollBy(getContentHeight());
+}
+
+/// Check if the last row is in view
+bool UIRowView::isScrolledToBottom()
+{
+	return -scrolling_offset.y + size.y >= getContentHeight() - 0.5f;
+}
+
+/// Select a row, -1 for none
+void UIRowView::setSelectedRow(int row)
+{
+	if (mSelectedRow == row)
+		return;
+
+	mSelectedRow = row;
+	refreshRows();
+}
+
+/// Get the selected row, -1 if there is none
+int UIRowView::getSelectedRow() const
+{
+	return mSelectedRow;
+}
+
+/// Fill the rows in view again at the next draw, after the rows or their content changed
+void UIRowView::refreshRows()
+{
+	mRowsDirty = true;
+}
+
+/// Get how many row widgets were made, which stays about as many as fit in view
+std::size_t UIRowView::getRowWidgetCount() const
+{
+	return mRowWidgets.size();
+}
+
+/// The bounding box of every row, not only of those in view, and of the other children, for the scroll bars
+FloatRect UIRowView::childrenRect()
+{
+	return FloatRect(0.f, 0.f, size.x, std::max(getContentHeight(), size.y));
+}
+
+/// Get the height of every row together, or down to the lowest child that isn't a row widget if that is more
+/// Views built by hand, like a tree made with createTree(), have children and no rows
+float UIRowView::getContentHeight()
+{
+	float height = static_cast<float>(std::max(getRowCount(), 0)) * mRowHeight;
+
+	for (int i = 0; i < getChildCount(); ++i)
+	{
+		Widget* child = getChild(i);
+		if (std::find(mRowWidgets.begin(), mRowWidgets.end(), child) == mRowWidgets.end())
+			height = std::max(height, child->position.y + child->size.y);
+	}
+
+	return height;
+}
+
+/// Fill a row widget with the content of a row, called when it is bound to it
+void UIRowView::fillRow(Row&, int)
+{
+}
+
+/// Called when a row is clicked, after it is selected
+void UIRowView::rowClicked(int)
+{
+}
+
+/// Bind the row widgets to the rows in view before they are drawn
+void UIRowView::preRender(GraphicsDevice*)
+{
+	layoutRows();
+}
+
+/// Scroll with the mouse wheel
+bool UIRowView::onEventNotification(Event& event)
+{
+	if (event.type == Event::MouseWheelMoved && isHit(vec2(event.mouseWheel.x, event.mouseWheel.y)))
+	{
+		scrollBy(-static_cast<float>(event.mouseWheel.delta) * mRowHeight * 3.f);
+	}
+
+	return true;
+}
+
+/// Keep the scrolling within the rows and bind the row widgets to the rows in view
+void UIRowView::layoutRows()
+{
+	int count = std::max(getRowCount(), 0);
+
+	// The rows may have shrunk under the scrolling
+	scrollBy(0.f);
+	float scroll = -scrolling_offset.y;
+
+	std::size_t fit = static_cast<std::size_t>(std::ceil(size.y / mRowHeight)) + 1;
+	int first = static_cast<int>(scroll / mRowHeight);
+	int last = std::min(first + static_cast<int>(fit), count);
+
+	// Grow the pool to what fits in view, every row moves to another widget then
+	if (mRowWidgets.size() < fit)
+	{
+		while (mRowWidgets.size() < fit)
+		{
+			Row* widget = new Row();
+			attach(widget);
+			widget->onClick.connect(sigc::bind(sigc::mem_fun(this, &UIRowView::rowWidgetClicked), widget));
+			mRowWidgets.push_back(widget);
+		}
+
+		for (std::size_t i = 0; i < mRowWidgets.size(); ++i)
+			mRowWidgets[i]->row = -1;
+	}
+
+	std::size_t pool = mRowWidgets.size();
+	for (std::size_t slot = 0; slot < pool; ++slot)
+	{
+		Row* widget = mRowWidgets[slot];
+
+		// The row in view that goes to this widget, if any
+		int row = first + static_cast<int>((slot + pool - static_cast<std::size_t>(first) % pool) % pool);
+		if (row >= last)
+		{
+			widget->row = -1;
+			if (widget->m_visible)
+				widget->hide();
+			continue;
+		}
+
+		if (widget->row != row || mRowsDirty)
+		{
+			widget->row = row;
+			widget->selected = (row == mSelectedRow);
+			fillRow(*widget, row);
+			widget->invalidatePaint();
+		}
+
+		if (!widget->m_visible)
+			widget->show();
+
+		float top = static_cast<float>(row) * mRowHeight;
+		if (widget->position.x != 0.f || widget->position.y != top)
+			widget->setPosition(0.f, top);
+		if (widget->size.x != size.x || widget->size.y != mRowHeight)
+			widget->setSize(size.x, mRowHeight);
+	}
+
+	mRowsDirty = false;
+}
+
+/// A row widget was clicked
+void UIRowView::rowWidgetClicked(Row* widget)
+{
+	if (widget->row < 0)
+		return;
+
+	int row = widget->row;
+	setSelectedRow(row);
+	rowClicked(row);
+	onRowClicked(row);
+}
+
+NEPHILIM_NS_END
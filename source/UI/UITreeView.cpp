@@ -7,72 +7,187 @@
 #include <Nephilim/Foundation/DataModel.h>
 #include <Nephilim/Foundation/Path.h>
 
+#include <algorithm>
+
 NEPHILIM_NS_BEGIN
 
 UITreeView::UITreeView()
-: Widget()
+: UIRowView()
 , mSubTreeView(false)
 , mSubTreeLevel(0)
 , mLineHeight(30.f)
 , collapsed(false)
 , mSpacing(2.f)
+, mFirstRoot(-1)
 {
 
 }
 
-/// Set a new data model to this tree view
+/// Set a new data model to this tree view, with every node collapsed
 void UITreeView::setModel(DataModel* dataModel)
 {
 	_dataModel = dataModel;
 
-	// First thing we want is to put this model under its own root UITreeNode
-	UITreeViewItem* rootItem = createTree("Root", -1);
+	int rows = _dataModel ? _dataModel->rows() : 0;
+	mNodeParents.assign(rows, -1);
+	mFirstChildren.assign(rows, -1);
+	mNextSiblings.assign(rows, -1);
+	mExpanded.assign(rows, 0);
+	mFirstRoot = -1;
+
+	// Only the structure is read now, the names are read as the rows come into view
+	for (int i = 0; i < rows; ++i)
+	{
+		int parentRow = _dataModel->data(i, 3).toInt();
+		if (parentRow >= 0 && parentRow < rows && parentRow != i)
+			mNodeParents[i] = parentRow;
+	}
 
-	// todo: detach from file models, to work with ANY model
-	// For each row (dir or file) in the file system, we will make one TreeViewItem and fill every stuff needed
-	for (int i = 0; i < _dataModel->rows(); ++i)
+	// Linked backwards so the children keep the order of the model
+	for (int i = rows - 1; i >= 0; --i)
 	{
-		bool isFile;
-		Path p;
-		String name;
-		int parentRow;
-
-		name = _dataModel->data(i, 0).toString();
-		isFile = _dataModel->data(i, 1).toBool();
-		p = _dataModel->data(i, 2).toString();
-		parentRow = _dataModel->data(i, 3).toInt();
-
-		// Add a new sub tree
-		if (!isFile)
+		int& first = (mNodeParents[i] == -1) ? mFirstRoot : mFirstChildren[mNodeParents[i]];
+		mNextSiblings[i] = first;
+		first = i;
+	}
+
+	mVisibleRows.clear();
+	mVisibleDepths.clear();
+	collectVisible(-1, -1, mVisibleRows, mVisibleDepths);
+
+	setSelectedRow(-1);
+	scrolling_offset.y = 0.f;
+	refreshRows();
+}
+
+/// Expand or collapse the node of a model row
+void UITreeView::setExpanded(int modelRow, bool expanded)
+{
+	if (modelRow < 0 || modelRow >= static_cast<int>(mExpanded.size()))
+		return;
+
+	std::vector<int>::iterator it = std::find(mVisibleRows.begin(), mVisibleRows.end(), modelRow);
+	if (it != mVisibleRows.end())
+		setRowExpanded(static_cast<int>(it - mVisibleRows.begin()), expanded);
+	else
+		mExpanded[modelRow] = expanded;
+}
+
+/// Check if the node of a model row is expanded
+bool UITreeView::isExpanded(int modelRow) const
+{
+	return modelRow >= 0 && modelRow < static_cast<int>(mExpanded.size()) && mExpanded[modelRow];
+}
+
+/// Get the model row shown in a row of the view, -1 if there is none
+int UITreeView::getModelRow(int row) const
+{
+	return (row >= 0 && row < static_cast<int>(mVisibleRows.size())) ? mVisibleRows[row] : -1;
+}
+
+/// Get how many rows are shown, counting the children of expanded nodes
+int UITreeView::getRowCount()
+{
+	return static_cast<int>(mVisibleRows.size());
+}
+
+/// Read the name of a row from the model
+void UITreeView::fillRow(Row& widget, int row)
+{
+	int modelRow = mVisibleRows[row];
+
+	widget.text = _dataModel->data(modelRow, 0).toString();
+	widget.indent = 16.f * (mVisibleDepths[row] + 1);
+	widget.marker = (mFirstChildren[modelRow] == -1) ? String() : (mExpanded[modelRow] ? "-" : "+");
+}
+
+/// Expand or collapse the clicked node
+void UITreeView::rowClicked(int row)
+{
+	int modelRow = getModelRow(row);
+	if (modelRow != -1 && mFirstChildren[modelRow] != -1)
+		setRowExpanded(row, !mExpanded[modelRow]);
+}
+
+/// Get the first child of a model row, or the first top level row for -1
+int UITreeView::getFirstChild(int modelRow) const
+{
+	return (modelRow == -1) ? mFirstRoot : mFirstChildren[modelRow];
+}
+
+/// Collect the descendants of a model row that are shown when it is expanded, in display order
+void UITreeView::collectVisible(int modelRow, int depth, std::vector<int>& rows, std::vector<int>& depths) const
+{
+	int node = getFirstChild(modelRow);
+	int nodeDepth = depth + 1;
+
+	while (node != -1)
+	{
+		rows.push_back(node);
+		depths.push_back(nodeDepth);
+
+		// Down into expanded nodes, otherwise on to the next sibling, climbing up when there is none
+		if (mExpanded[node] && mFirstChildren[node] != -1)
 		{
-			/// We add our directory to the rootItem with the data model id
-			rootItem->createTree(name, i);
+			node = mFirstChildren[node];
+			++nodeDepth;
+			continue;
 		}
-		else
+
+		while (node != -1 && mNextSiblings[node] == -1)
 		{
-			/// Add an item to a subtree
-			if (parentRow == -1)
-			{
-				/// This entry is a file, which belongs under the root item
-				rootItem->createItem(name, i);
-			}
-			else
-			{
-				/// This entry is a file, and not at top level so we need to find its rightful tree
-				UITreeViewItem* category = rootItem->getItemFromId(parentRow);
-				if (category)
-				{
-					category->createItem(name, i);
-				}
-				else
-				{
-					Log("Failed to insert item %s into row %d ", name.c_str(), parentRow);
-				}
-			}
+			node = mNodeParents[node];
+			--nodeDepth;
+
+			if (node == modelRow)
+				node = -1;
 		}
+
+		if (node != -1)
+			node = mNextSiblings[node];
 	}
 }
 
+/// Expand or collapse the node shown in a row of the view
+void UITreeView::setRowExpanded(int row, bool expanded)
+{
+	int modelRow = mVisibleRows[row];
+	if (static_cast<bool>(mExpanded[modelRow]) == expanded)
+		return;
+
+	mExpanded[modelRow] = expanded;
+
+	// The selection stays on its node, or moves to the node collapsing over it
+	int selected = getSelectedRow();
+
+	if (expanded)
+	{
+		std::vector<int> rows;
+		std::vector<int> depths;
+		collectVisible(modelRow, mVisibleDepths[row], rows, depths);
+
+		mVisibleRows.insert(mVisibleRows.begin() + row + 1, rows.begin(), rows.end());
+		mVisibleDepths.insert(mVisibleDepths.begin() + row + 1, depths.begin(), depths.end());
+
+		if (selected > row)
+			setSelectedRow(selected + static_cast<int>(rows.size()));
+	}
+	else
+	{
+		// The rows that follow and are nested deeper are its descendants
+		std::size_t end = row + 1;
+		while (end < mVisibleDepths.size() && mVisibleDepths[end] > mVisibleDepths[row])
+			++end;
+
+		mVisibleRows.erase(mVisibleRows.begin() + row + 1, mVisibleRows.begin() + end);
+		mVisibleDepths.erase(mVisibleDepths.begin() + row + 1, mVisibleDepths.begin() + end);
+
+		if (selected > row)
+			setSelectedRow(selected < static_cast<int>(end) ? row : selected - static_cast<int>(end - row - 1));
+	}
+
+	refreshRows();
+}
 
 void UITreeView::itemClicked(Widget* node)
 {
@@ -0,0 +1,249 @@
+#include <Nephilim/UI/UIWidgetIndex.h>
+#include <Nephilim/UI/Widget.h>
+
+#include <algorithm>
+#include <cmath>
+
+NEPHILIM_NS_BEGIN
+
+namespace
+{
+	/// Widgets covering more cells than this are checked on every query instead
+	const int maxCellsPerWidget = 64;
+
+	bool containsPoint(const FloatRect& rect, vec2 point)
+	{
+		return point.x >= rect.left && point.x <= rect.left + rect.width &&
+		       point.y >= rect.top && point.y <= rect.top + rect.height;
+	}
+
+	bool sameRect(const FloatRect& a, const FloatRect& b)
+	{
+		return a.left == b.left && a.top == b.top && a.width == b.width && a.height == b.height;
+	}
+
+	/// Far away or broken coordinates don't fit the cell numbers
+	bool isUsable(float coordinate)
+	{
+		return std::isfinite(coordinate) && std::fabs(coordinate) < 1e7f;
+	}
+
+	void eraseFrom(std::vector<Widget*>& list, Widget* widget)
+	{
+		std::vector<Widget*>::iterator it = std::find(list.begin(), list.end(), widget);
+		if (it != list.end())
+			list.erase(it);
+	}
+}
+
+/// Creates an empty index with square cells of cellSize pixels
+UIWidgetIndex::UIWidgetIndex(float cellSize)
+: m_cellSize(cellSize > 1.f ? cellSize : 1.f)
+{
+}
+
+/// File a widget under the bounds it was drawn with, moving it if it was filed elsewhere
+void UIWidgetIndex::update(Widget* widget, const FloatRect& bounds)
+{
+	std::unordered_map<Widget*, Entry>::iterator it = m_entries.find(widget);
+	if (it != m_entries.end())
+	{
+		if (sameRect(it->second.bounds, bounds))
+			return;
+
+		unlink(widget, it->second);
+	}
+
+	Entry entry;
+	entry.bounds = bounds;
+	entry.left = entry.top = entry.right = entry.bottom = 0;
+	entry.large = true;
+
+	if (isUsable(bounds.left) && isUsable(bounds.top) && isUsable(bounds.left + bounds.width) && isUsable(bounds.top + bounds.height))
+	{
+		float columns = std::floor((bounds.left + bounds.width) / m_cellSize) - std::floor(bounds.left / m_cellSize) + 1.f;
+		float rows = std::floor((bounds.top + bounds.height) / m_cellSize) - std::floor(bounds.top / m_cellSize) + 1.f;
+
+		if (columns * rows <= maxCellsPerWidget)
+		{
+			entry.left = toCell(bounds.left);
+			entry.top = toCell(bounds.top);
+			entry.right = toCell(bounds.left + bounds.width);
+			entry.bottom = toCell(bounds.top + bounds.height);
+			entry.large = false;
+		}
+	}
+
+	link(widget, entry);
+	m_entries[widget] = entry;
+}
+
+/// Forget a widget, by position and by name
+void UIWidgetIndex::remove(Widget* widget)
+{
+	std::unordered_map<Widget*, Entry>::iterator it = m_entries.find(widget);
+	if (it != m_entries.end())
+	{
+		unlink(widget, it->second);
+		m_entries.erase(it);
+	}
+
+	if (!widget->m_name.empty())
+	{
+		std::unordered_map<StringID, std::vector<Widget*> >::iterator named = m_names.find(makeStringID(widget->m_name, false));
+		if (named != m_names.end())
+		{
+			eraseFrom(named->second, widget);
+			if (named->second.empty())
+				m_names.erase(named);
+		}
+	}
+}
+
+/// Check if a widget is filed by position, widgets are removed as they are destroyed
+bool UIWidgetIndex::contains(Widget* widget) const
+{
+	return m_entries.find(widget) != m_entries.end();
+}
+
+/// Collect the widgets whose bounds contain point, in no particular order
+void UIWidgetIndex::query(vec2 point, std::vector<Widget*>& results) const
+{
+	std::unordered_map<CellKey, std::vector<Widget*> >::const_iterator cell = m_cells.find(makeKey(toCell(point.x), toCell(point.y)));
+	if (cell != m_cells.end())
+	{
+		for (std::size_t i = 0; i < cell->second.size(); ++i)
+		{
+			if (containsPoint(m_entries.find(cell->second[i])->second.bounds, point))
+				results.push_back(cell->second[i]);
+		}
+	}
+
+	for (std::size_t i = 0; i < m_large.size(); ++i)
+	{
+		if (containsPoint(m_entries.find(m_large[i])->second.bounds, point))
+			results.push_back(m_large[i]);
+	}
+}
+
+/// File a widget under its name, once
+void UIWidgetIndex::addName(Widget* widget)
+{
+	if (widget->m_name.empty())
+		return;
+
+	std::vector<Widget*>& named = m_names[makeStringID(widget->m_name, false)];
+	if (std::find(named.begin(), named.end(), widget) == named.end())
+		named.push_back(widget);
+}
+
+/// Move a widget from the name it had to the one it has now
+void UIWidgetIndex::rename(Widget* widget, const String& previousName)
+{
+	if (!previousName.empty())
+	{
+		std::unordered_map<StringID, std::vector<Widget*> >::iterator named = m_names.find(makeStringID(previousName, false));
+		if (named != m_names.end())
+		{
+			eraseFrom(named->second, widget);
+			if (named->second.empty())
+				m_names.erase(named);
+		}
+	}
+
+	addName(widget);
+}
+
+/// Collect the widgets named name, in the order they were named
+void UIWidgetIndex::findByName(const String& name, std::vector<Widget*>& results) const
+{
+	std::unordered_map<StringID, std::vector<Widget*> >::const_iterator named = m_names.find(makeStringID(name, false));
+	if (named == m_names.end())
+		return;
+
+	// Different names may share an id
+	for (std::size_t i = 0; i < named->second.size(); ++i)
+	{
+		if (named->second[i]->m_name == name)
+			results.push_back(named->second[i]);
+	}
+}
+
+/// Collect the widgets whose name has the id name, like the #id of a selector
+void UIWidgetIndex::findById(StringID name, std::vector<Widget*>& results) const
+{
+	std::unordered_map<StringID, std::vector<Widget*> >::const_iterator named = m_names.find(name);
+	if (named != m_names.end())
+		results.insert(results.end(), named->second.begin(), named->second.end());
+}
+
+/// Get how many widgets are filed by position
+std::size_t UIWidgetIndex::getWidgetCount() const
+{
+	return m_entries.size();
+}
+
+/// Forget every widget
+void UIWidgetIndex::clear()
+{
+	m_entries.clear();
+	m_cells.clear();
+	m_large.clear();
+	m_names.clear();
+}
+
+/// Get the key of the cell at a column and row
+UIWidgetIndex::CellKey UIWidgetIndex::makeKey(int x, int y)
+{
+	return (static_cast<CellKey>(x) << 32) ^ static_cast<CellKey>(static_cast<Uint32>(y));
+}
+
+/// Get the column or row of a coordinate
+int UIWidgetIndex::toCell(float coordinate) const
+{
+	return static_cast<int>(std::floor(coordinate / m_cellSize));
+}
+
+/// Take a widget out of the cells it covers
+void UIWidgetIndex::unlink(Widget* widget, const Entry& entry)
+{
+	if (entry.large)
+	{
+		eraseFrom(m_large, widget);
+		return;
+	}
+
+	for (int y = entry.top; y <= entry.bottom; ++y)
+	{
+		for (int x = entry.left; x <= entry.right; ++x)
+		{
+			std::unordered_map<CellKey, std::vector<Widget*> >::iterator cell = m_cells.find(makeKey(x, y));
+			if (cell == m_cells.end())
+				continue;
+
+			eraseFrom(cell->second, widget);
+			if (cell->second.empty())
+				m_cells.erase(cell);
+		}
+	}
+}
+
+/// Put a widget in the cells it covers
+void UIWidgetIndex::link(Widget* widget, const Entry& entry)
+{
+	if (entry.large)
+	{
+		m_large.push_back(widget);
+		return;
+	}
+
+	for (int y = entry.top; y <= entry.bottom; ++y)
+	{
+		for (int x = entry.left; x <= entry.right; ++x)
+		{
+			m_cells[makeKey(x, y)].push_back(widget);
+		}
+	}
+}
+
+NEPHILIM_NS_END
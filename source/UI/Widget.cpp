@@ -11,6 +11,7 @@
 #include <Nephilim/UI/UILoaderXML.h>
 
 #include <algorithm>
+#include <cstring>
 
 NEPHILIM_NS_BEGIN
 
@@ -47,6 +48,9 @@ Widget::Widget(Widget* parent)
 
 Widget::~Widget()
 {
+	if (_core)
+		_core->widgetIndex.remove(this);
+
 	// Release all components to prevent leaks
 	for (std::size_t i = 0; i < mControllers.size(); ++i)
 	{
@@ -64,6 +68,12 @@ Widget::~Widget()
 /// Called on subclasses to draw custom stuff
 void Widget::onPaint(UIPainter& painter){}
 
+/// Have onPaint() run again at the next draw, instead of drawing what it recorded before
+void Widget::invalidatePaint()
+{
+	mPaintDirty = true;
+}
+
 /// Called when the view receives a mouse/touch related event
 void Widget::onPointerEvent(const UIPointerEvent& event){}
 
@@ -106,12 +116,68 @@ float Widget::height()
 /// Refresh the visual styles on this view
 void Widget::updateStyles()
 {
+	getComputedStyle();
+
 	for (auto it = mControllers.begin(); it != mControllers.end(); ++it)
 	{
 		(*it)->updateStyles();
 	}
 }
 
+/// Get the properties of the stylesheet rules that apply to this widget
+const ComputedStyle& Widget::getComputedStyle()
+{
+	UICore* core = getCore();
+	if (!core)
+		return mComputedStyle;
+
+	const StyleSheet& stylesheet = core->stylesheet;
+	if (mStyleDirty || mStyleGeneration != stylesheet.getGeneration())
+	{
+		stylesheet.computeStyle(getStyleSubject(), mComputedStyle);
+		mStyleGeneration = stylesheet.getGeneration();
+		mStyleDirty = false;
+		invalidatePaint();
+	}
+
+	return mComputedStyle;
+}
+
+/// Add or remove a class the stylesheet selectors can match
+void Widget::setStyleClass(const String& name, bool enabled)
+{
+	StringID id = makeStringID(name, false);
+	std::vector<StringID>::iterator it = std::lower_bound(mStyleClasses.begin(), mStyleClasses.end(), id);
+	bool present = (it != mStyleClasses.end() && *it == id);
+
+	if (enabled == present)
+		return;
+
+	if (enabled)
+		mStyleClasses.insert(it, id);
+	else
+		mStyleClasses.erase(it);
+
+	mStyleDirty = true;
+}
+
+/// Check if the widget has a class
+bool Widget::hasStyleClass(const String& name) const
+{
+	return std::binary_search(mStyleClasses.begin(), mStyleClasses.end(), makeStringID(name, false));
+}
+
+/// Get what the stylesheet selectors are matched against, valid while the widget doesn't change
+StyleSheet::Subject Widget::getStyleSubject()
+{
+	StyleSheet::Subject subject;
+	subject.type = makeStringID(getClassName(), false);
+	subject.name = m_name.empty() ? 0 : makeStringID(m_name, false);
+	subject.classes = &mStyleClasses;
+	subject.pseudoClasses = &mPseudoClasses;
+	return subject;
+}
+
 /// Set styles directly to the view
 void Widget::setStyleSheet(const String& stylesheet)
 {
@@ -145,6 +211,8 @@ void Widget::setProperty(const String& str)
 		{
 			mControllers[i]->onPropertySet(target_object, paramValue);
 		}
+
+		invalidatePaint();
 }	
 }
 
@@ -197,6 +265,10 @@ void Widget::setPosition(float x, float y)
 	// update the correct vars
 	position.x = x;
 	position.y = y;
+
+	// Parents may paint around their children
+	if (getParent())
+		getParent()->invalidatePaint();
 }
 
 void Widget::setPosition(vec2 position)
@@ -535,7 +607,14 @@ bool Widget::hasFocus()
 /// Hierarchicly sets the context to all children
 void Widget::setContext(UICore* states)
 {
+	if (_core && _core != states)
+		_core->widgetIndex.remove(this);
+
 	_core = states;
+	mStyleDirty = true;
+
+	if (_core)
+		_core->widgetIndex.addName(this);
 
 	for(ChildrenIterator it = mChildren.begin(); it != mChildren.end(); ++it)
 	{
@@ -729,7 +808,21 @@ void Widget::processMouseButtonReleased(int x, int y, Mouse::Button button, UIEv
 void Widget::setPseudoClass(const String& name, bool active)
 {
 	//Log("Class enabled %s", name.c_str());
+	std::map<String, bool>::iterator it = m_classInfo.find(name);
+	if (it != m_classInfo.end() && it->second == active)
+		return;
+
 	m_classInfo[name] = active;
+
+	StringID id = makeStringID(name, false);
+	std::vector<StringID>::iterator pseudo = std::lower_bound(mPseudoClasses.begin(), mPseudoClasses.end(), id);
+	if (active && (pseudo == mPseudoClasses.end() || *pseudo != id))
+		mPseudoClasses.insert(pseudo, id);
+	else if (!active && pseudo != mPseudoClasses.end() && *pseudo == id)
+		mPseudoClasses.erase(pseudo);
+
+	mStyleDirty = true;
+	invalidatePaint();
 };
 
 /// Deep clone of the control and its hierarchy
@@ -762,6 +855,27 @@ FloatRect Widget::getGlobalRect()
 	return FloatRect(WorldPos.x, WorldPos.y, size.x, size.y);
 }
 
+/// Get the bounding box of the rectangle as it was last drawn, in canvas coordinates
+FloatRect Widget::getDrawnBounds()
+{
+	const float* m = matrix.get();
+	const Vec2f corners[4] = { Vec2f(0.f, 0.f), Vec2f(size.x, 0.f), Vec2f(size.x, size.y), Vec2f(0.f, size.y) };
+
+	float minX = 0.f, minY = 0.f, maxX = 0.f, maxY = 0.f;
+	for (int i = 0; i < 4; ++i)
+	{
+		float x = m[0] * corners[i].x + m[4] * corners[i].y + m[12];
+		float y = m[1] * corners[i].x + m[5] * corners[i].y + m[13];
+
+		minX = (i == 0) ? x : std::min(minX, x);
+		minY = (i == 0) ? y : std::min(minY, y);
+		maxX = (i == 0) ? x : std::max(maxX, x);
+		maxY = (i == 0) ? y : std::max(maxY, y);
+	}
+
+	return FloatRect(minX, minY, maxX - minX, maxY - minY);
+}
+
 /// Get the position of the exact middle of this UIWindow
 Vec2f Widget::getMiddlePosition()
 {
@@ -865,6 +979,24 @@ Widget* Widget::findByName(const String& name)
 	if(getName() == name)
 		return this;
 
+	// Every widget under a canvas is in its name index, take the first one that is under this
+	if (_core)
+	{
+		std::vector<Widget*> named;
+		_core->widgetIndex.findByName(name, named);
+
+		for (std::size_t i = 0; i < named.size(); ++i)
+		{
+			for (Widget* ancestor = named[i]->getParent(); ancestor; ancestor = ancestor->getParent())
+			{
+				if (ancestor == this)
+					return named[i];
+			}
+		}
+
+		return NULL;
+	}
+
 	// Let's make sure its not in pending attachments
 	for(std::vector<UIControlOperation>::iterator it = m_pendingOperations.begin(); it != m_pendingOperations.end(); ++it)
 	{
@@ -991,6 +1123,10 @@ void Widget::setSize(float width, float height)
 	size.x = width;
 	size.y = height;
 
+	// Parents may paint around their children
+	if (getParent())
+		getParent()->invalidatePaint();
+
 	// Let components know a resize was made
 	for(std::size_t i = 0; i < mControllers.size(); ++i)
 	{
@@ -1019,6 +1155,14 @@ void Widget::drawItself(GraphicsDevice* renderer, const mat4& transform )
 		return;
 	}
 
+	// Drawn as part of a canvas draw list, anything this widget draws directly must go after what was recorded so far
+	UIDrawList* drawList = getCore() ? getCore()->drawList : nullptr;
+	bool watched = drawList && (mPaintMode != PaintRecorded || mDrawsDirectly);
+	if (watched)
+		drawList->flush(renderer);
+
+	Uint64 drawCalls = renderer->getDrawCallCount();
+
 	if(m_clipContents)
 	{
 		renderer->pushClippingRect(FloatRect(position.x, position.y, size.x, size.y));
@@ -1031,6 +1175,10 @@ void Widget::drawItself(GraphicsDevice* renderer, const mat4& transform )
 
 	this->matrix = absoluteTransform;
 
+	// Pointer events find the widget where it was drawn
+	if (getCore())
+		getCore()->widgetIndex.update(this, getDrawnBounds());
+
 	// Tel
 	draw(renderer, absoluteTransform);
 
@@ -1050,6 +1198,8 @@ void Widget::drawItself(GraphicsDevice* renderer, const mat4& transform )
 	// -- Pre Render Step (Before Children)
 	preRender(renderer);
 
+	bool drewDirectly = renderer->getDrawCallCount() != drawCalls;
+
 	localTransform = mat4::translate(scrolling_offset.x, scrolling_offset.y, 0.f) * mat4::translate(position) * mat4::rotatey(rotation_y) * mat4::rotatex(rotation_x) * mat4::rotatez(rotation_z)
 		* mat4::translate(-anchor.x, -anchor.y, 0.f);
 
@@ -1061,7 +1211,48 @@ void Widget::drawItself(GraphicsDevice* renderer, const mat4& transform )
 	painter.baseMatrix = absoluteTransform;
 	if (getCore())
 		painter.activeFont = getCore()->m_defaultFont;
-	onPaint(painter);
+
+	if (drawList && mPaintMode != PaintImmediate)
+	{
+		// What was recorded stays valid until something the painting depends on changes
+		bool valid = !mPaintDirty && mPaintFont == painter.activeFont && mPaintSize == size && mPaintHovered == m_hovered && mPaintFocused == m_hasFocus &&
+			std::memcmp(mPaintMatrix.get(), absoluteTransform.get(), 16 * sizeof(float)) == 0 && !mPaintCache.isStale();
+
+		if (valid)
+		{
+			drawList->append(mPaintCache);
+			drawList->countReused();
+		}
+		else
+		{
+			Uint64 paintDrawCalls = renderer->getDrawCallCount();
+
+			painter.drawList = drawList;
+			drawList->beginChunk(mPaintCache);
+			onPaint(painter);
+			drawList->endChunk();
+			drawList->countPainted();
+
+			mPaintMatrix = absoluteTransform;
+			mPaintSize = size;
+			mPaintFont = painter.activeFont;
+			mPaintHovered = m_hovered;
+			mPaintFocused = m_hasFocus;
+			mPaintDirty = false;
+
+			if (renderer->getDrawCallCount() != paintDrawCalls)
+				mPaintMode = PaintImmediate;
+			else if (mPaintMode == PaintUnknown)
+				mPaintMode = PaintRecorded;
+		}
+	}
+	else
+	{
+		onPaint(painter);
+
+		if (drawList)
+			drawList->countImmediate();
+	}
 
 	// clip the overflowing children
 	if(m_clipChildren)
@@ -1069,6 +1260,9 @@ void Widget::drawItself(GraphicsDevice* renderer, const mat4& transform )
 		renderer->setClippingEnabled(true);
 		renderer->setClippingRect(FloatRect(getWorldPosition().x, getWorldPosition().y, size.x, size.y));
 
+		if (drawList)
+			drawList->pushClipRect(FloatRect(getWorldPosition().x, getWorldPosition().y, size.x, size.y));
+
 		//renderer->pushClippingRect(FloatRect(getWorldPosition().x,getWorldPosition().y, size.x, size.y));
 	}
 
@@ -1081,10 +1275,25 @@ void Widget::drawItself(GraphicsDevice* renderer, const mat4& transform )
 	}
 
 	if(m_clipChildren)
+	{
 		renderer->popClippingRect();
 
+		if (drawList)
+			drawList->popClipRect();
+	}
+
+	// The children may have recorded more
+	if (watched)
+		drawList->flush(renderer);
+
+	drawCalls = renderer->getDrawCallCount();
+
 	// -- Post Render Step (After Children)
 	postRender(renderer);
+
+	// Found drawing by itself outside onPaint(), so the list is flushed around it from now on
+	if (drawList && (drewDirectly || renderer->getDrawCallCount() != drawCalls))
+		mDrawsDirectly = true;
 }
 
 /// Get the current world position
@@ -1123,7 +1332,12 @@ vec2 Widget::getCenter()
 
 /// Define a new name for this control
 void Widget::setName(const String& name){
+	String previousName = m_name;
 	m_name = name;
+	mStyleDirty = true;
+
+	if (_core)
+		_core->widgetIndex.rename(this, previousName);
 };
 
 /// Get the name of the control
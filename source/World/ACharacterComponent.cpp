@@ -9,6 +9,7 @@ void ACharacterComponent::moveTest(Vector3D displacement, Actor* a)
 	if (!userData)
 	{
 		t.position += displacement;
+		markTransformDirty();
 	}
 }
 
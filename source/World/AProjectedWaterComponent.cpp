@@ -1136,6 +1136,9 @@ void AProjectedWaterComponent::init()
 void AProjectedWaterComponent::render2(GraphicsDevice* mRenderer)
 {
 	redisplayFunc();
+
+	// The water binds its own programs and textures straight through OpenGL
+	mRenderer->invalidateStateCache();
 }
 
 NEPHILIM_NS_END
@@ -1,27 +1,169 @@
 #include <Nephilim/World/ASceneComponent.h>
+#include <Nephilim/World/TransformHierarchy.h>
 #include <Nephilim/World/World.h>
 
 #include <Nephilim/Foundation/Logging.h>
 
+#include <algorithm>
+
 NEPHILIM_NS_BEGIN
 
+/// Detaches the component from its parent, children and hierarchy
+ASceneComponent::~ASceneComponent()
+{
+	if (mHierarchy)
+	{
+		mHierarchy->remove(this);
+	}
+
+	detach();
+
+	// Children become roots rather than pointing at a dead parent
+	std::vector<ASceneComponent*> children = attachedComponents;
+	for (std::size_t i = 0; i < children.size(); ++i)
+	{
+		children[i]->detach();
+	}
+}
+
 /// Set this component position, relative to its parent's origin
 void ASceneComponent::setPosition(float x, float y, float z)
 {
 	t.position.x = x;
 	t.position.y = y;
 	t.position.z = z;
+
+	markTransformDirty();
 }
 
-/// Update the subtree of transforms
-void ASceneComponent::updateTransforms()
+/// Set the whole local transform, relative to its parent
+void ASceneComponent::setTransform(const Transform& transform)
+{
+	t = transform;
+
+	markTransformDirty();
+}
+
+/// Attach this component under another one, detaching it from its current parent first
+void ASceneComponent::attachTo(ASceneComponent* parent)
 {
-	absoluteTransform = t.getMatrix();
+	if (parent == mParent)
+		return;
+
+	// Refuse to create a cycle
+	for (ASceneComponent* p = parent; p; p = p->mParent)
+	{
+		if (p == this)
+			return;
+	}
+
+	detach();
+
+	if (parent)
+	{
+		mParent = parent;
+		mParent->attachedComponents.push_back(this);
+
+		if (mParent->mHierarchy)
+			mParent->mHierarchy->invalidateLayout();
+		if (mHierarchy)
+			mHierarchy->invalidateLayout();
+
+		markTransformDirty();
+	}
+}
+
+/// Detach this component from its parent, making it a root
+void ASceneComponent::detach()
+{
+	if (!mParent)
+		return;
+
+	std::vector<ASceneComponent*>& siblings = mParent->attachedComponents;
+	siblings.erase(std::remove(siblings.begin(), siblings.end(), this), siblings.end());
+
+	if (mParent->mHierarchy)
+		mParent->mHierarchy->invalidateLayout();
+	if (mHierarchy)
+		mHierarchy->invalidateLayout();
+
+	mParent = nullptr;
+	markTransformDirty();
+}
 
+/// Get the component this one is attached to, if any
+ASceneComponent* ASceneComponent::getParent() const
+{
+	return mParent;
+}
+
+/// Flag this component and its subtree as moved
+void ASceneComponent::markTransformDirty()
+{
+	// Within a hierarchy, a dirty component always has a dirty subtree already
+	if (mTransformDirty && mHierarchy)
+		return;
+
+	mTransformDirty = true;
+	markChildrenDirty();
+
+	if (mHierarchy)
+	{
+		mHierarchy->queueDirty(this);
+	}
+}
+
+/// Flag the children subtrees, stopping at the ones already flagged
+void ASceneComponent::markChildrenDirty()
+{
 	for (std::size_t i = 0; i < attachedComponents.size(); ++i)
 	{
-		attachedComponents[i]->absoluteTransform = this->absoluteTransform * attachedComponents[i]->t.getMatrix();
+		ASceneComponent* child = attachedComponents[i];
+		if (child->mTransformDirty && child->mHierarchy)
+			continue;
+
+		child->mTransformDirty = true;
+
+		// Children stored elsewhere won't be reached from our subtree, they queue on their own
+		if (child->mHierarchy && child->mHierarchy != mHierarchy)
+			child->mHierarchy->queueDirty(child);
+
+		child->markChildrenDirty();
+	}
+}
+
+/// Check if the world matrix needs to be recomputed
+bool ASceneComponent::isTransformDirty() const
+{
+	return mTransformDirty;
+}
+
+/// Get the transform from this component's space to world space
+mat4 ASceneComponent::getWorldMatrix()
+{
+	// Halfway through an update the stored matrix may still be last frame's, so it's not used then
+	if (mHierarchy && !mHierarchy->mUpdating)
+	{
+		if (mTransformDirty || mHierarchy->mLayoutDirty)
+			mHierarchy->update();
+
+		return mHierarchy->getWorldMatrix(mHierarchyIndex);
+	}
+
+	// Not part of any level, or its level is updating, compute it on the spot
+	if (mParent)
+		return mParent->getWorldMatrix() * t.getMatrix();
+
+	return t.getMatrix();
+}
+
+/// Update the subtree of transforms
+void ASceneComponent::updateTransforms()
+{
+	if (mHierarchy)
+	{
+		mHierarchy->update();
 	}
 }
 
-NEPHILIM_NS_END
\ No newline at end of file
+NEPHILIM_NS_END
@@ -7,10 +7,10 @@ NEPHILIM_NS_BEGIN
 
 void AScriptComponent::tickScript()
 {
-	if (_script)
+	// ScriptSystem::tickScripts() batches every component of the same script instead
+	if (_script && object)
 	{
-		_script->callOnObject("void Tick()", object);
-		//_script->call("void print2()");
+		_script->callOnObjects("void Tick()", &object, 1);
 	}
 }
 
@@ -10,6 +10,9 @@
 #include <lolimporterx/ANMLoader.h>
 #include <lolimporterx/FileWriter.h>
 
+#include <algorithm>
+#include <cmath>
+
 NEPHILIM_NS_BEGIN
 
 void ASkeletalMeshComponent::updateAnimation()
@@ -58,6 +61,33 @@ void ASkeletalMeshComponent::loadAnimation(const String& filename, const String&
 
 	mAnimationTime = 0.f;
 	mAnimationDuration = (float)ax.numFrames / ax.playbackFPS;
+
+	bindClip();
+}
+
+/// Resolve which bone each track of the clip animates and prepare the pose buffers
+void ASkeletalMeshComponent::bindClip()
+{
+	modelSkeleton.compile();
+
+	mCompressedClip.compress(clip);
+	mSamplingCache.reset();
+
+	mTrackToBone.assign(clip.tracks.size(), -1);
+	for (std::size_t i = 0; i < clip.tracks.size(); ++i)
+	{
+		for (std::size_t j = 0; j < modelSkeleton.bones.size(); ++j)
+		{
+			if (modelSkeleton.bones[j].name == clip.tracks[i].name)
+			{
+				mTrackToBone[i] = static_cast<Int32>(j);
+				break;
+			}
+		}
+	}
+
+	mLocalPose.assign(modelSkeleton.bones.size(), mat4::identity);
+	mWorldPose.assign(modelSkeleton.bones.size(), mat4::identity);
 }
 
 vec3 getAbsolutePosition(AnimationClip& animationClip, Skeleton& skeleton, int frame, int bone_index)
@@ -130,38 +160,42 @@ mat4 InterpolateMatrix(mat4 a, mat4 b, float blend)
 
 void ASkeletalMeshComponent::update(const Time& deltaTime)
 {
-	mAnimationTime += deltaTime.seconds() * clip.playbackFramesPerSecond;
-	if (mAnimationTime > clip.numFrames)
+	if (clip.numFrames <= 0 || mAnimationDuration <= 0.f)
+		return;
+
+	mAnimationTime += deltaTime.seconds();
+	if (mAnimationTime > mAnimationDuration)
 	{
-		mAnimationTime -= clip.numFrames;
+		mAnimationTime = std::fmod(mAnimationTime, mAnimationDuration);
+		mSamplingCache.reset();
 	}
 
-	int currentFrame = (int)mAnimationTime;
-	int nextFrame = (currentFrame + 1) % clip.numFrames;
-	float blend = mAnimationTime - currentFrame;
-
-	// I have all the local transforms, interpolated for all bones, just need the absolutes now
-	std::vector<mat4> bone_transforms(128);
-
-	// Fetch the local bone space transforms
-	clip.getTransformsFromTime(mAnimationTime, bone_transforms);
+	if (mTrackToBone.size() != clip.tracks.size() || mLocalPose.size() != modelSkeleton.bones.size())
+	{
+		bindClip();
+	}
 
-	// Convert to world space
-	modelSkeleton.convertToWorldSpace(bone_transforms);
+	if (mLocalPose.empty())
+		return;
 
-	/// This code is correct, it assigns the final bind pose to whatever was in there
-	for (std::size_t i = 0; i < clip.tracks.size(); ++i)
+	// Sample every channel at once, then build the matrices of the bones that have a track
+	mCompressedClip.sample(mAnimationTime, mPose, &mSamplingCache);
+	for (std::size_t i = 0; i < mTrackToBone.size(); ++i)
 	{
-		int bone_index = modelSkeleton.getIndexFromName(clip.tracks[i].name);
-
-		bone_transforms[i] = bone_transforms[i] * modelSkeleton.bones[bone_index].bindPoseMatrix;
+		if (mTrackToBone[i] >= 0)
+		{
+			mLocalPose[mTrackToBone[i]] = mPose.getMatrix(i);
+		}
 	}
 
-	/// This code is correct, it assigns the final matrices just fine
-	for (std::size_t i = 0; i < modelSkeleton.bones.size(); ++i)
+	// One pass over the hierarchy, parents first
+	modelSkeleton.computeWorldPose(&mLocalPose[0], &mWorldPose[0]);
+
+	// Final skinning matrices, relative to the bind pose
+	std::size_t boneCount = std::min(modelSkeleton.bones.size(), sizeof(boneTransforms) / sizeof(boneTransforms[0]));
+	for (std::size_t i = 0; i < boneCount; ++i)
 	{
-		int index = clip.getTrackIndexByName(modelSkeleton.bones[i].name);
-		boneTransforms[i] = bone_transforms[index];
+		boneTransforms[i] = mWorldPose[i] * modelSkeleton.bones[i].bindPoseMatrix;
 	}
 }
 
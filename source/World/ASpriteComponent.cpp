@@ -11,6 +11,7 @@ ASpriteComponent::ASpriteComponent()
 , height(1.f)
 , color(Color::White)
 , scale(1.f, -1.f)
+, layer(0)
 {
 	setPosition(math::randomInt(0, 1000), math::randomInt(0, 1000), 0.f);
 	setSize(300.f, 300.f);
@@ -25,6 +26,7 @@ ASpriteComponent::ASpriteComponent(vec2 size, const String& texture)
 , color(Color::White)
 , tex(texture)
 , scale(1.f, -1.f)
+, layer(0)
 {
 
 }
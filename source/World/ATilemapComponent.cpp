@@ -5,15 +5,133 @@
 #include <Nephilim/Foundation/Vector.h>
 #include <Nephilim/Foundation/Logging.h>
 #include <Nephilim/Foundation/Path.h>
+#include <Nephilim/Graphics/GraphicsDevice.h>
+#include <Nephilim/Graphics/GDI/GDI_VertexBuffer.h>
 
 #include <pugixml/pugixml.hpp>
 
+#include <cmath>
+#include <utility>
+
 NEPHILIM_NS_BEGIN
 
+////////////////////////////////////////////////////////////////////////// LAYER
+
+/// Creates an empty layer
+Tilemap2DLayer::Tilemap2DLayer()
+: mWidth(0)
+, mHeight(0)
+, mDirty(false)
+{
+}
+
+/// Takes over the data and buffers of other, leaving it empty
+Tilemap2DLayer::Tilemap2DLayer(Tilemap2DLayer&& other)
+: mWidth(0)
+, mHeight(0)
+, mDirty(false)
+{
+	*this = std::move(other);
+}
+
+/// Releases the buffers and takes over the data and buffers of other, leaving it empty
+Tilemap2DLayer& Tilemap2DLayer::operator=(Tilemap2DLayer&& other)
+{
+	if (this != &other)
+	{
+		releaseRenderData();
+
+		mName = other.mName;
+		mWidth = other.mWidth;
+		mHeight = other.mHeight;
+		mTileData.swap(other.mTileData);
+		mVertexSets.swap(other.mVertexSets);
+		mIndexSets.swap(other.mIndexSets);
+		mTextureSets.swap(other.mTextureSets);
+		mVertexBuffers.swap(other.mVertexBuffers);
+		mIndexBuffers.swap(other.mIndexBuffers);
+		mIndexCounts.swap(other.mIndexCounts);
+		mDirty = other.mDirty;
+
+		// Whatever this held before was released, so other gets nothing to release twice
+		other.mTileData.clear();
+		other.mVertexSets.clear();
+		other.mIndexSets.clear();
+		other.mTextureSets.clear();
+		other.mDirty = false;
+	}
+	return *this;
+}
+
+/// Releases the buffers
+Tilemap2DLayer::~Tilemap2DLayer()
+{
+	releaseRenderData();
+}
+
+/// Upload the geometry built since the last call to static buffers made by device, then free the CPU copy
+void Tilemap2DLayer::generateRenderData(GraphicsDevice* device)
+{
+	if (!mDirty || !device)
+		return;
+
+	if (mVertexBuffers.size() < mVertexSets.size())
+	{
+		mVertexBuffers.resize(mVertexSets.size());
+		mIndexBuffers.resize(mVertexSets.size(), nullptr);
+		mIndexCounts.resize(mVertexSets.size(), 0);
+	}
+
+	for (std::size_t j = 0; j < mVertexSets.size(); ++j)
+	{
+		mIndexCounts[j] = static_cast<int>(mIndexSets[j].size());
+		if (mIndexCounts[j] == 0)
+			continue;
+
+		if (!mVertexBuffers[j]._impl)
+			mVertexBuffers[j]._impl = device->createVertexBuffer();
+		if (!mIndexBuffers[j])
+			mIndexBuffers[j] = new IndexBuffer();
+
+		std::size_t size = mVertexSets[j].getMemorySize();
+		mVertexBuffers[j]._impl->allocate(size, false);
+		mVertexBuffers[j]._impl->write(&mVertexSets[j]._data[0], size, 0);
+
+		device->uploadIndexBuffer(mIndexBuffers[j], mIndexSets[j]);
+	}
+
+	// The GPU has it now, a full map would otherwise be kept twice
+	for (std::size_t j = 0; j < mVertexSets.size(); ++j)
+	{
+		mVertexSets[j] = VertexArray();
+		mIndexSets[j] = IndexArray();
+	}
+
+	mDirty = false;
+}
+
+/// Destroy the buffers
+void Tilemap2DLayer::releaseRenderData()
+{
+	for (std::size_t j = 0; j < mVertexBuffers.size(); ++j)
+	{
+		delete mVertexBuffers[j]._impl;
+		mVertexBuffers[j]._impl = nullptr;
+		delete mIndexBuffers[j];
+	}
+
+	mVertexBuffers.clear();
+	mIndexBuffers.clear();
+	mIndexCounts.clear();
+}
+
+////////////////////////////////////////////////////////////////////////// COMPONENT
+
 /// Initializes an empty world
 ATilemapComponent::ATilemapComponent()
 : mTileSize(1.f, 1.f, 1.f)
 , mChunkSize(30.f, 30.f)
+, mJobSystem(nullptr)
 {
 
 }
@@ -175,6 +293,12 @@ void ATilemapComponent::prepareLayer(const String& layerName)
 		//generateCubes(td, layerName);
 
 		generateTiles(td, layerName);
+
+		for (std::size_t i = 0; i < mLayers.size(); ++i)
+		{
+			if (mLayers[i].mName == layerName)
+				mLayers[i].mPrepared = true;
+		}
 	}
 	else
 	{
@@ -185,6 +309,14 @@ void ATilemapComponent::prepareLayer(const String& layerName)
 /// Generates a chunk list for culling out for the entire map
 void ATilemapComponent::allocateChunks()
 {
+	// Larger chunks would overflow the 16 bit indices of their geometry
+	if (mChunkSize.x * mChunkSize.y > MaxChunkTiles)
+	{
+		const float side = std::sqrt(static_cast<float>(MaxChunkTiles));
+		Log("Chunks of %d x %d tiles are too large, using %d x %d", static_cast<int>(mChunkSize.x), static_cast<int>(mChunkSize.y), static_cast<int>(side), static_cast<int>(side));
+		mChunkSize = vec2(side, side);
+	}
+
 	int pagesHorizontal = ceilf(mLevelSize.x / (mChunkSize.x * mTileSize.x));
 	int pagesVertical = ceilf(mLevelSize.y / (mChunkSize.y * mTileSize.y));
 
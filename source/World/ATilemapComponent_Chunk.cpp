@@ -6,137 +6,318 @@
 #include <Nephilim/Foundation/Logging.h>
 #include <Nephilim/Foundation/Path.h>
 #include <Nephilim/Foundation/Math.h>
+#include <Nephilim/Foundation/Frustum.h>
+#include <Nephilim/Foundation/JobSystem.h>
+#include <Nephilim/Foundation/Clock.h>
 
 #include <pugixml/pugixml.hpp>
 
+#include <algorithm>
+#include <cstdio>
+
 NEPHILIM_NS_BEGIN
 
+namespace
+{
+	/// Vertex layout of the tile geometry, matches the default shader
+	struct TileVertex
+	{
+		vec2 p;
+		vec4 c;
+		vec2 uv;
+	};
+
+	/// Write a tiles x tiles TMX map with one tile layer over two small tilesets, a quarter of the cells empty
+	bool writeBenchmarkMap(const String& filename, int tiles)
+	{
+		std::FILE* file = std::fopen(filename.c_str(), "wb");
+		if (!file)
+			return false;
+
+		std::fprintf(file, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+		std::fprintf(file, "<map version=\"1.0\" orientation=\"orthogonal\" width=\"%d\" height=\"%d\" tilewidth=\"16\" tileheight=\"16\">\n", tiles, tiles);
+		std::fprintf(file, " <tileset firstgid=\"1\" name=\"ground\" tilewidth=\"16\" tileheight=\"16\"><image source=\"ground.png\" width=\"64\" height=\"64\"/></tileset>\n");
+		std::fprintf(file, " <tileset firstgid=\"17\" name=\"props\" tilewidth=\"16\" tileheight=\"16\"><image source=\"props.png\" width=\"64\" height=\"32\"/></tileset>\n");
+		std::fprintf(file, " <layer name=\"ground\" width=\"%d\" height=\"%d\">\n  <data>\n", tiles, tiles);
+
+		// Gids 1 to 24 cover both tilesets, 0 leaves the cell empty
+		Uint32 state = 0x2545F491;
+		for (int i = 0; i < tiles * tiles; ++i)
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			const int gid = (state & 3) == 0 ? 0 : static_cast<int>(state >> 8) % 24 + 1;
+			std::fprintf(file, "   <tile gid=\"%d\"/>\n", gid);
+		}
+
+		std::fprintf(file, "  </data>\n </layer>\n</map>\n");
+		return std::fclose(file) == 0;
+	}
+
+	/// Milliseconds since the clock was reset
+	double elapsedMilliseconds(Clock& clock)
+	{
+		double elapsed = static_cast<double>(clock.getElapsedTime().microseconds()) / 1000.0;
+		clock.reset();
+		return elapsed;
+	}
+}
+
 void ATilemapComponent::generateTiles(Tilemap::Layer* tileLayer, const String& destLayer)
 {
-	Log("=> Preparing a layer of tiles");
+	LOG_DEBUG(LogWorld, "Preparing a layer of tiles");
+
+	// Chunks only write their own data, so they can be built in any order on any thread
+	if (mJobSystem)
+	{
+		mJobSystem->parallelFor(0, mChunks.size(), 1, [this, tileLayer, &destLayer](std::size_t first, std::size_t last)
+		{
+			for (std::size_t i = first; i < last; ++i)
+				buildChunkLayer(i, tileLayer, destLayer);
+		});
+	}
+	else
+	{
+		for (std::size_t i = 0; i < mChunks.size(); ++i)
+		{
+			buildChunkLayer(i, tileLayer, destLayer);
+		}
+	}
 
-	// Chunk by chunk, generate its data for the specified layer
-	for(std::size_t i = 0; i < mChunks.size(); ++i)
-	{		
-		int tileCount = 0;
-		
-		std::vector<int> tileCounts(mTilemapData.mTilesets.size());
+	LOG_DEBUG(LogWorld, "Built %d chunks", static_cast<int>(mChunks.size()));
+}
+
+/// Build the geometry of one chunk for one layer, safe to call for different chunks in parallel
+void ATilemapComponent::buildChunkLayer(std::size_t chunkIndex, Tilemap::Layer* tileLayer, const String& destLayer)
+{
+	// Range of tiles covered by this chunk, clamped to the layer
+	const int chunkWidth = static_cast<int>(mChunkSize.x);
+	const int chunkHeight = static_cast<int>(mChunkSize.y);
+	const int firstX = static_cast<int>(chunkIndex % mNumChunks.x) * chunkWidth;
+	const int firstY = static_cast<int>(chunkIndex / mNumChunks.x) * chunkHeight;
+	const int endX = std::min(firstX + chunkWidth, tileLayer->mWidth);
+	const int endY = std::min(firstY + chunkHeight, tileLayer->mHeight);
+	const int mapWidth = tileLayer->mWidth;
+
+	const std::size_t tilesetCount = mTilemapData.mTilesets.size();
+	if (tilesetCount == 0)
+		return;
+
+	// allocateChunks() keeps chunks small enough, unless mChunkSize grew after it
+	if ((endX - firstX) * (endY - firstY) > MaxChunkTiles)
+	{
+		Log("Chunk %d has more than %d tiles, its indices would overflow", static_cast<int>(chunkIndex), MaxChunkTiles);
+		return;
+	}
 
-		// Iterate all tiles in this chunk in order to count how many tiles are needed.
-		for(int tx = 0; tx < mChunkSize.x; ++tx)
+	// Count the tiles of each tileset first, so every array is allocated once
+	std::vector<int> tileCounts(tilesetCount, 0);
+	for (int ty = firstY; ty < endY; ++ty)
+	{
+		for (int tx = firstX; tx < endX; ++tx)
 		{
-			for(int ty = 0; ty < mChunkSize.y; ++ty)
+			int gid = tileLayer->mTileData[ty * mapWidth + tx];
+			if (gid > 0)
 			{
-				int tileIndex1D = 0;
+				tileCounts[mTilemapData.getTilesetIndexOfGid(gid)]++;
+			}
+		}
+	}
 
-				vec2i chunkIndex2D = vec2i(i % mNumChunks.x, i / mNumChunks.x);
+	Tilemap2DLayer& dl = mChunks[chunkIndex].getLayer(destLayer);
+	dl.mVertexSets.assign(tilesetCount, VertexArray());
+	dl.mIndexSets.assign(tilesetCount, IndexArray());
+	dl.mTextureSets.resize(tilesetCount);
 
-				vec2i chunkFirstTileIndex2D(chunkIndex2D.x * mChunkSize.x, chunkIndex2D.y * mChunkSize.y);
-				vec2i globalTileIndex2D = chunkFirstTileIndex2D + vec2i(tx,ty);
-				tileIndex1D = globalTileIndex2D.y * (mLevelSizeInTiles.x) + globalTileIndex2D.x;
+	std::vector<TileVertex*> vertexWriters(tilesetCount, nullptr);
+	for (std::size_t j = 0; j < tilesetCount; ++j)
+	{
+		dl.mTextureSets[j] = mTilemapData.mTilesets[j].mPath;
 
-				if(tileLayer->isValidCoordinate2D(globalTileIndex2D) && tileLayer->getTile(tileIndex1D) > 0)
-				{
-					tileCount++;
-					tileCounts[mTilemapData.getTilesetIndexOfGid(tileLayer->getTile(tileIndex1D))]++;
-				}
-			}
+		if (tileCounts[j] > 0)
+		{
+			dl.mVertexSets[j].addAttribute(sizeof(float), 2, VertexFormat::Position);
+			dl.mVertexSets[j].addAttribute(sizeof(float), 4, VertexFormat::Color);
+			dl.mVertexSets[j].addAttribute(sizeof(float), 2, VertexFormat::TexCoord);
+			dl.mVertexSets[j].allocateData(tileCounts[j] * 4);
+			dl.mIndexSets[j].indices.resize(tileCounts[j] * 6);
+
+			vertexWriters[j] = reinterpret_cast<TileVertex*>(&dl.mVertexSets[j]._data[0]);
+		}
+	}
+
+	// Fill in the vertex data, tileCounts now tracks how many tiles were written per set
+	std::fill(tileCounts.begin(), tileCounts.end(), 0);
+	const vec4 white(1.f, 1.f, 1.f, 1.f);
+	for (int ty = firstY; ty < endY; ++ty)
+	{
+		for (int tx = firstX; tx < endX; ++tx)
+		{
+			int gid = tileLayer->mTileData[ty * mapWidth + tx];
+			if (gid <= 0)
+				continue;
+
+			std::size_t j = mTilemapData.getTilesetIndexOfGid(gid);
+			Tilemap::Tileset& tileset = mTilemapData.mTilesets[j];
+			int tc = tileCounts[j]++;
+
+			TileVertex* vbuff = vertexWriters[j] + tc * 4;
+			vbuff[0].p = vec2((tx + 1) * mTileSize.x, -(ty + 0) * mTileSize.y);
+			vbuff[1].p = vec2((tx + 1) * mTileSize.x, -(ty + 1) * mTileSize.y);
+			vbuff[2].p = vec2((tx + 0) * mTileSize.x, -(ty + 1) * mTileSize.y);
+			vbuff[3].p = vec2((tx + 0) * mTileSize.x, -(ty + 0) * mTileSize.y);
+
+			vbuff[0].c = white;
+			vbuff[1].c = white;
+			vbuff[2].c = white;
+			vbuff[3].c = white;
+
+			FloatRect r(0.f, 0.f, 0.f, 0.f);
+			if (tileset.containsGid(gid))
+				r = tileset.getNormalizedCoordinates(gid);
+
+			vbuff[0].uv = vec2(r.width, r.top);
+			vbuff[1].uv = vec2(r.width, r.height);
+			vbuff[2].uv = vec2(r.left, r.height);
+			vbuff[3].uv = vec2(r.left, r.top);
+
+			Uint16* indices = &dl.mIndexSets[j].indices[tc * 6];
+			Uint16 base = static_cast<Uint16>(tc * 4);
+			indices[0] = base + 0;
+			indices[1] = base + 1;
+			indices[2] = base + 2;
+			indices[3] = base + 0;
+			indices[4] = base + 2;
+			indices[5] = base + 3;
 		}
+	}
+
+	dl.mDirty = true;
+}
+
+/// Change a tile of a prepared layer, only the chunk containing it is rebuilt
+void ATilemapComponent::setTile(const String& layerName, int x, int y, Uint16 gid)
+{
+	Tilemap::Layer* tileLayer = mTilemapData.getLayerByName(layerName);
+	if (!tileLayer || x < 0 || y < 0 || x >= tileLayer->mWidth || y >= tileLayer->mHeight)
+		return;
+
+	tileLayer->mTileData[y * tileLayer->mWidth + x] = gid;
 
-		Log("Chunk %d has %d tiles.", i, tileCount);
-		for(std::size_t j = 0; j < tileCounts.size(); ++j)
+	for (std::size_t i = 0; i < mLayers.size(); ++i)
+	{
+		if (mLayers[i].mName == layerName && mLayers[i].mPrepared)
 		{
-			Log("Tileset %d has %d tiles.", j, tileCounts[j]);
+			std::size_t chunkIndex = (y / static_cast<int>(mChunkSize.y)) * mNumChunks.x + (x / static_cast<int>(mChunkSize.x));
+			buildChunkLayer(chunkIndex, tileLayer, layerName);
 		}
+	}
+}
+
+/// Build the chunks over a job system when preparing a layer, nullptr builds them on the calling thread
+void ATilemapComponent::setJobSystem(JobSystem* jobs)
+{
+	mJobSystem = jobs;
+}
+
+/// Get the bounds of a chunk, in the component's local space
+void ATilemapComponent::getChunkBounds(std::size_t chunkIndex, vec3& minimum, vec3& maximum)
+{
+	float chunkWidth = mChunkSize.x * mTileSize.x;
+	float chunkHeight = mChunkSize.y * mTileSize.y;
+	float x = static_cast<float>(chunkIndex % mNumChunks.x) * chunkWidth;
+	float y = static_cast<float>(chunkIndex / mNumChunks.x) * chunkHeight;
+
+	// Tiles grow towards negative y
+	minimum = vec3(x, -y - chunkHeight, 0.f);
+	maximum = vec3(x + chunkWidth, -y, 0.f);
+}
 
-		// Generate the vertex array for this chunk and layer
-		Tilemap2DLayer& dl = mChunks[i].getLayer(destLayer);
-		dl.mVertexSets.resize(tileCounts.size());
-		dl.mTextureSets.resize(tileCounts.size());
-		dl.mIndexSets.resize(tileCounts.size());
-		for(std::size_t j = 0; j < tileCounts.size(); ++j)
+/// Fill visible with the indices of the chunks inside the frustum
+void ATilemapComponent::getVisibleChunks(const Frustum& frustum, std::vector<std::size_t>& visible)
+{
+	visible.clear();
+
+	vec3 minimum, maximum;
+	for (std::size_t i = 0; i < mChunks.size(); ++i)
+	{
+		getChunkBounds(i, minimum, maximum);
+		if (frustum.intersects(minimum, maximum))
 		{
-			if(tileCounts[j] > 0)
-			{
-				dl.mVertexSets[j].addAttribute(sizeof(float), 2, VertexFormat::Position);
-				dl.mVertexSets[j].addAttribute(sizeof(float), 4, VertexFormat::Color);
-				dl.mVertexSets[j].addAttribute(sizeof(float), 2, VertexFormat::TexCoord);
-
-				dl.mVertexSets[j].allocateData(tileCounts[j] * 4);
-
-				dl.mIndexSets[j].indices.resize(tileCounts[j] * 6);
-
-				struct v_format
-				{
-					vec2 p;
-					vec4 c;
-					vec2 uv;
-				};
-
-				v_format* vbuff = reinterpret_cast<v_format*>(&dl.mVertexSets[j]._data[0]);
-
-				int tc = 0;
-
-				// Fill in the vertex data
-				for(int tx = 0; tx < mChunkSize.x; ++tx)
-				{
-					for(int ty = 0; ty < mChunkSize.y; ++ty)
-					{
-						int tileIndex1D = 0;
-
-						vec2i chunkIndex2D = vec2i(i % mNumChunks.x, i / mNumChunks.x);
-						vec2i chunkFirstTileIndex2D(chunkIndex2D.x * mChunkSize.x, chunkIndex2D.y * mChunkSize.y);
-						vec2i globalTileIndex2D = chunkFirstTileIndex2D + vec2i(tx,ty);
-						tileIndex1D = globalTileIndex2D.y * (mLevelSizeInTiles.x) + globalTileIndex2D.x;
-
-						if(tileLayer->isValidCoordinate2D(globalTileIndex2D) && tileLayer->getTile(tileIndex1D) > 0)
-						{
-							// Here we have a valid tile index that needs to be built
-							/*vbuff[tc*4+0].p = vec2(globalTileIndex2D.x * mTileSize.x + mTileSize.x, -globalTileIndex2D.y * mTileSize.y);
-							vbuff[tc*4+1].p = vec2(globalTileIndex2D.x * mTileSize.x + mTileSize.x, -globalTileIndex2D.y * mTileSize.y - mTileSize.y);
-							vbuff[tc*4+2].p = vec2(globalTileIndex2D.x * mTileSize.x              , -globalTileIndex2D.y * mTileSize.y - mTileSize.y);
-							vbuff[tc*4+3].p = vec2(globalTileIndex2D.x * mTileSize.x              , -globalTileIndex2D.y * mTileSize.y);*/
-
-							vbuff[tc*4+0].p = vec2((globalTileIndex2D.x + 1) * mTileSize.x, -(globalTileIndex2D.y + 0) * mTileSize.y);
-							vbuff[tc*4+1].p = vec2((globalTileIndex2D.x + 1) * mTileSize.x, -(globalTileIndex2D.y + 1) * mTileSize.y);
-							vbuff[tc*4+2].p = vec2((globalTileIndex2D.x + 0) * mTileSize.x, -(globalTileIndex2D.y + 1) * mTileSize.y);
-							vbuff[tc*4+3].p = vec2((globalTileIndex2D.x + 0) * mTileSize.x, -(globalTileIndex2D.y + 0) * mTileSize.y);
-
-							Log("Tile %d is at (%f,%f), (%f,%f), (%f,%f), (%f,%f)", tc, vbuff[tc*4+0].p.x, vbuff[tc*4+0].p.y, vbuff[tc*4+1].p.x, vbuff[tc*4+1].p.y, vbuff[tc*4+2].p.x, vbuff[tc*4+2].p.y, vbuff[tc*4+3].p.x, vbuff[tc*4+3].p.y);
-
-							vbuff[tc*4+0].c = vec4(1.f, 1.f, 1.f, 1.f);
-							vbuff[tc*4+1].c = vec4(1.f, 1.f, 1.f, 1.f);
-							vbuff[tc*4+2].c = vec4(1.f, 1.f, 1.f, 1.f);
-							vbuff[tc*4+3].c = vec4(1.f, 1.f, 1.f, 1.f);
-
-							//vec4 rc(math::random(0.f, 1.f), math::random(0.f, 1.f), math::random(0.f, 1.f), 1.f);
-							//vbuff[tc*4+0].c = rc;
-							//vbuff[tc*4+1].c = rc;
-							//vbuff[tc*4+2].c = rc;
-							//vbuff[tc*4+3].c = rc;
-
-							FloatRect r = mTilemapData.getTileUV(destLayer, tileIndex1D);
-							vbuff[tc*4+0].uv = vec2(r.width, r.top);
-							vbuff[tc*4+1].uv = vec2(r.width, r.height);
-							vbuff[tc*4+2].uv = vec2(r.left, r.height);
-							vbuff[tc*4+3].uv = vec2(r.left, r.top);
-
-							dl.mIndexSets[j].indices[tc*6+0] = tc*4+0;
-							dl.mIndexSets[j].indices[tc*6+1] = tc*4+1;
-							dl.mIndexSets[j].indices[tc*6+2] = tc*4+2;
-							dl.mIndexSets[j].indices[tc*6+3] = tc*4+0;
-							dl.mIndexSets[j].indices[tc*6+4] = tc*4+2;
-							dl.mIndexSets[j].indices[tc*6+5] = tc*4+3;
-
-							tc++;
-						}
-					}
-				}
-			}
+			visible.push_back(i);
 		}
 	}
 }
 
+/// Log how long a tiles x tiles TMX map takes to load through Tilemap and to build into chunks
+void ATilemapComponent::benchmark(const String& scratchFile, int tiles, JobSystem* jobs)
+{
+	if (tiles <= 0)
+		return;
+
+	Clock clock;
+	if (!writeBenchmarkMap(scratchFile, tiles))
+	{
+		Log("ATilemapComponent: can't write the benchmark map to %s", scratchFile.c_str());
+		return;
+	}
+	const double writeTime = elapsedMilliseconds(clock);
+
+	double loadTime = 0.0, buildTime = 0.0, jobsTime = 0.0, editTime = 0.0, cullTime = 0.0;
+	std::size_t chunkCount = 0, geometryBytes = 0, visibleChunks = 0;
+	{
+		ATilemapComponent tilemap;
+		tilemap.setTileSize(vec3(16.f, 16.f, 1.f));
+
+		clock.reset();
+		if (!tilemap.load(scratchFile) || !tilemap.mTilemapData.getLayerByName("ground"))
+		{
+			Log("ATilemapComponent: can't load the benchmark map from %s", scratchFile.c_str());
+			std::remove(scratchFile.c_str());
+			return;
+		}
+		loadTime = elapsedMilliseconds(clock);
+
+		tilemap.prepareLayer("ground");
+		buildTime = elapsedMilliseconds(clock);
+
+		if (jobs)
+		{
+			tilemap.setJobSystem(jobs);
+			tilemap.prepareLayer("ground");
+			jobsTime = elapsedMilliseconds(clock);
+		}
+
+		// One edit per chunk row, each rebuilds only its own chunk
+		const int edits = std::max(1, tilemap.mNumChunks.y);
+		for (int i = 0; i < edits; ++i)
+			tilemap.setTile("ground", (i * 37) % tiles, (i * static_cast<int>(tilemap.mChunkSize.y)) % tiles, static_cast<Uint16>(i % 24 + 1));
+		editTime = elapsedMilliseconds(clock) / edits;
+
+		// A 1080p view of 16 pixel tiles, in the middle of the map
+		const float center = tiles * 8.f;
+		Frustum view(mat4::ortho(center - 960.f, center + 960.f, -center - 540.f, -center + 540.f, -1.f, 1.f));
+		std::vector<std::size_t> visible;
+		tilemap.getVisibleChunks(view, visible);
+		cullTime = elapsedMilliseconds(clock);
+		visibleChunks = visible.size();
+
+		chunkCount = tilemap.mChunks.size();
+		for (std::size_t i = 0; i < tilemap.mChunks.size(); ++i)
+		{
+			const Tilemap2DLayer& layer = tilemap.mChunks[i].getLayer("ground");
+			for (std::size_t j = 0; j < layer.mVertexSets.size(); ++j)
+				geometryBytes += layer.mVertexSets[j]._data.size() + layer.mIndexSets[j].indices.size() * sizeof(Uint16);
+		}
+	}
+	std::remove(scratchFile.c_str());
+
+	Log("ATilemapComponent: %d x %d TMX map, written in %.1f ms", tiles, tiles, writeTime);
+	Log("  load %.1f ms, build %u chunks %.1f ms, over the job system %.1f ms", loadTime, static_cast<unsigned int>(chunkCount), buildTime, jobsTime);
+	Log("  single tile edit %.3f ms, culling %.3f ms with %u chunks visible, %u MB of chunk geometry",
+		editTime, cullTime, static_cast<unsigned int>(visibleChunks), static_cast<unsigned int>(geometryBytes / (1024 * 1024)));
+}
 
 /// Takes the input data from tileLayer and generates the geometry for rendering as cubes
 void ATilemapComponent::generateCubes(Tilemap::Layer* tileLayer, const String& destLayer)
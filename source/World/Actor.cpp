@@ -82,7 +82,17 @@ void Actor::setActorTransform(const Transform& transform)
 {
 	if (root)
 	{
-		root->t = transform;
+		root->setTransform(transform);
+	}
+}
+
+/// Index a freshly created component in the level, so it can be found by type queries
+void Actor::registerComponent(Component* component)
+{
+	// Actors not yet spawned get their components indexed by World::spawnActor
+	if (_world && _world->mPersistentLevel)
+	{
+		_world->mPersistentLevel->registerComponent(component, this);
 	}
 }
 
@@ -98,6 +108,7 @@ void Actor::setActorLocation(Vector3D location)
 	if (root)
 	{
 		root->t.position = location;
+		root->markTransformDirty();
 	}
 }
 
@@ -1,5 +1,69 @@
 #include <Nephilim/World/ComponentArray.h>
+#include <Nephilim/World/Component.h>
+#include <Nephilim/Foundation/Clock.h>
+#include <Nephilim/Foundation/Logging.h>
 
 NEPHILIM_NS_BEGIN
 
-NEPHILIM_NS_END
\ No newline at end of file
+namespace
+{
+	/// Something about the size of a small gameplay component
+	class BenchmarkComponent : public Component
+	{
+	public:
+		float value[4];
+	};
+
+	/// Microseconds per operation, since the clock was reset
+	double perOperation(Clock& clock, std::size_t operations)
+	{
+		double elapsed = static_cast<double>(clock.getElapsedTime().microseconds());
+		clock.reset();
+		return elapsed / static_cast<double>(operations > 0 ? operations : 1);
+	}
+
+	/// Run one storage through spawning, lookups, iteration and despawning every other entity
+	void benchmarkStorage(const char* name, ComponentStorage::Type storage, std::size_t components, std::size_t rounds)
+	{
+		double create = 0.0, lookup = 0.0, iterate = 0.0, remove = 0.0;
+		float sum = 0.f;
+
+		for (std::size_t round = 0; round < rounds; ++round)
+		{
+			ComponentArray<BenchmarkComponent> pool(storage);
+
+			Clock clock;
+			for (std::size_t i = 0; i < components; ++i)
+				static_cast<BenchmarkComponent*>(pool.createComponentForEntity(Entity(static_cast<uint32_t>(i + 1))))->value[0] = 1.f;
+			create += perOperation(clock, components);
+
+			for (std::size_t i = 0; i < components; ++i)
+				sum += static_cast<BenchmarkComponent*>(pool.getComponentFromEntity(Entity(static_cast<uint32_t>(i + 1))))->value[0];
+			lookup += perOperation(clock, components);
+
+			for (std::size_t i = 0; i < pool.size(); ++i)
+				sum += static_cast<BenchmarkComponent*>(pool.getInstance(i))->value[0] + static_cast<float>(pool.getInstanceEntity(i).id);
+			iterate += perOperation(clock, components);
+
+			for (std::size_t i = 0; i < components; i += 2)
+				pool.removeComponentsFromEntity(Entity(static_cast<uint32_t>(i + 1)));
+			remove += perOperation(clock, components / 2);
+		}
+
+		const double n = static_cast<double>(rounds);
+		Log("  %s: create %.3f us, lookup %.3f us, iterate %.3f us, remove %.3f us (checksum %.0f)", name, create / n, lookup / n, iterate / n, remove / n, sum);
+	}
+}
+
+/// Log how long creation, lookup, iteration and removal take with each storage
+void benchmarkComponentStorage(std::size_t components, std::size_t rounds)
+{
+	if (components == 0 || rounds == 0)
+		return;
+
+	Log("ComponentArray: %u components, %u rounds, time per component", static_cast<unsigned int>(components), static_cast<unsigned int>(rounds));
+	benchmarkStorage("sparse set", ComponentStorage::SparseSet, components, rounds);
+	benchmarkStorage("map       ", ComponentStorage::Map, components, rounds);
+}
+
+NEPHILIM_NS_END
@@ -88,10 +88,75 @@ GameObject* Level::instance(const Prefab& prefab)
 			
 			go->components.push_back(Component_);
 		}
+
+		registerComponents(go);
 	}
 
 	return go;
 }
 
+/// Index a component under its concrete type
+void Level::registerComponent(Component* component, GameObject* owner)
+{
+	if (!component)
+		return;
+
+	ComponentList& list = componentLists[std::type_index(typeid(*component))];
+	component->mLevelListIndex = list.components.size();
+	list.components.push_back(component);
+	list.owners.push_back(owner);
+
+	if (ASceneComponent* sceneComponent = dynamic_cast<ASceneComponent*>(component))
+	{
+		transforms.add(sceneComponent);
+	}
+}
+
+/// Index all the components the object has at the moment
+void Level::registerComponents(GameObject* owner)
+{
+	for (std::size_t i = 0; i < owner->components.size(); ++i)
+	{
+		registerComponent(owner->components[i], owner);
+	}
+}
+
+/// Remove a component from the type index
+void Level::unregisterComponent(Component* component)
+{
+	if (!component)
+		return;
+
+	if (ASceneComponent* sceneComponent = dynamic_cast<ASceneComponent*>(component))
+	{
+		transforms.remove(sceneComponent);
+	}
+
+	std::map<std::type_index, ComponentList>::iterator it = componentLists.find(std::type_index(typeid(*component)));
+	if (it == componentLists.end())
+		return;
+
+	ComponentList& list = it->second;
+	std::size_t index = component->mLevelListIndex;
+	if (index >= list.components.size() || list.components[index] != component)
+		return;
+
+	// Order doesn't matter, move the last one into the hole
+	list.components[index] = list.components.back();
+	list.owners[index] = list.owners.back();
+	list.components[index]->mLevelListIndex = index;
+	list.components.pop_back();
+	list.owners.pop_back();
+}
+
+/// Remove all the components of the object from the type index
+void Level::unregisterComponents(GameObject* owner)
+{
+	for (std::size_t i = 0; i < owner->components.size(); ++i)
+	{
+		unregisterComponent(owner->components[i]);
+	}
+}
+
 
 NEPHILIM_NS_END
\ No newline at end of file
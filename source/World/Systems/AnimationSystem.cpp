@@ -0,0 +1,43 @@
+#include <Nephilim/World/Systems/AnimationSystem.h>
+#include <Nephilim/World/World.h>
+#include <Nephilim/World/ASkeletalMeshComponent.h>
+#include <Nephilim/World/AFlipBookComponent.h>
+#include <Nephilim/World/AParticleEmitterComponent.h>
+
+NEPHILIM_NS_BEGIN
+
+/// Declares the component types stepped by update()
+AnimationSystem::AnimationSystem()
+: System()
+{
+	writes<ASkeletalMeshComponent>();
+	writes<AFlipBookComponent>();
+	writes<AParticleEmitterComponent>();
+}
+
+/// Step every skeletal mesh, flip book and particle emitter
+void AnimationSystem::update(const Time& deltaTime)
+{
+	if (!_World)
+		return;
+
+	const float seconds = deltaTime.seconds();
+
+	// Sampling a skeleton is the heavy one, a few meshes per job are enough
+	_World->parallelEach<ASkeletalMeshComponent>([&deltaTime](ASkeletalMeshComponent& skeletalMesh)
+	{
+		skeletalMesh.update(deltaTime);
+	}, 4);
+
+	_World->parallelEach<AFlipBookComponent>([seconds](AFlipBookComponent& flipBook)
+	{
+		flipBook.update(seconds);
+	});
+
+	_World->parallelEach<AParticleEmitterComponent>([seconds](AParticleEmitterComponent& particleEmitter)
+	{
+		particleEmitter.update(seconds);
+	});
+}
+
+NEPHILIM_NS_END
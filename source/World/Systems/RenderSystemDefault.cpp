@@ -7,6 +7,7 @@
 #include <Nephilim/World/Entity.h>
 #include <Nephilim/World/Entity.inl>
 
+#include <Nephilim/World/TransformHierarchy.h>
 #include <Nephilim/World/ATilemapComponent.h>
 #include <Nephilim/World/ATerrainComponent.h>
 #include <Nephilim/World/ACameraComponent.h>
@@ -24,6 +25,7 @@
 #include <Nephilim/Foundation/Logging.h>
 #include <Nephilim/Foundation/Path.h>
 #include <Nephilim/Foundation/File.h>
+#include <Nephilim/Foundation/Frustum.h>
 
 #include <Nephilim/Graphics/RectangleShape.h>
 #include <Nephilim/Graphics/TextureCube.h>
@@ -31,9 +33,11 @@
 #include <Nephilim/Graphics/Texture3D.h>
 #include <Nephilim/Graphics/Shader.h>
 #include <Nephilim/Graphics/Text.h>
+#include <Nephilim/Graphics/GlyphRunCache.h>
 
 #include <Nephilim/Graphics/GL/GLHelpers.h>
 
+#include <cmath>
 
 NEPHILIM_NS_BEGIN
 	
@@ -68,7 +72,7 @@ RenderSystemDefault::RenderSystemDefault()
 /// This function will initialize the frame buffer and other things in order to produce a new frame out of the scene
 void RenderSystemDefault::startFrame()
 {
-	
+	mRenderer->beginFrame();
 }
 
 /// This function will basically truncate the output buffer and apply any post processing needed, generating the final composite
@@ -98,6 +102,8 @@ void RenderSystemDefault::drawToBackBuffer()
 /// Render scene gets all scene render data and outputs it to the active target
 void RenderSystemDefault::renderScene()
 {	
+	PROFILE_ZONE("RenderSystemDefault::renderScene");
+
 	mRenderer->clearDepthBuffer();
 	mRenderer->setDefaultBlending();
 	mRenderer->setDefaultShader();
@@ -137,221 +143,192 @@ void RenderSystemDefault::renderScene()
 
 
 
-	// Don't have actors caching their components by type, need to go get them directly in the actor
-	for (std::size_t i = 0; i < _World->mPersistentLevel->gameObjects.size(); ++i)
+	// Each component type is drawn from the level type index, no need to probe every component of every actor
+	// The index holds the spawned actors and the game objects of every level, so all of them are drawn,
+	// not only the game objects of the persistent level
+	_World->each<ATilemapComponent>([this](ATilemapComponent& tilemapComponent)
+	{
+		Render(&tilemapComponent);
+	});
+
+	// All sprites go through one batch, drawn sorted by texture instead of one draw call each
+	mSpriteBatch.begin();
+	_World->each<ASpriteComponent>([this](ASpriteComponent& spriteComponent)
+	{
+		renderSprite(&spriteComponent);
+	});
+	mSpriteBatch.end(mRenderer);
+
+	_World->each<ATextComponent>([this](ATextComponent& textComponent)
 	{
-		Actor* actor = (Actor*)_World->mPersistentLevel->gameObjects[i];
-		for (std::size_t j = 0; j < actor->components.size(); ++j)
+		// Laid out once, then drawn from the cache while the text stays the same
+		const GlyphRunCache::Run& run = GlyphRunCache::instance().get(textComponent.text, mContentManager->font, 15);
+		mRenderer->setModelMatrix(textComponent.getWorldMatrix() * mat4::scale(1.f, -1.f, 1.f));
+		GlyphRunCache::draw(mRenderer, run);
+		mRenderer->setModelMatrix(mat4());
+	});
+
+	_World->each<AParticleEmitterComponent>([this](AParticleEmitterComponent& particleEmitter)
+	{
+		for (std::size_t k = 0; k < particleEmitter.particles.size(); ++k)
 		{
-			ASpriteComponent* spriteComponent = dynamic_cast<ASpriteComponent*>(actor->components[j]);
-			if (spriteComponent)
-			{
-				renderSprite(spriteComponent);
-			}
+			mat4 model = mat4::translate(particleEmitter.particles[k].position);
 
-			ATextComponent* textComponent = dynamic_cast<ATextComponent*>(actor->components[j]);
-			if (textComponent)
-			{
-				Text t;
-				t.setString(textComponent->text);
-				t.setFont(mContentManager->font);
-				t.setCharacterSize(15);
-				t.useOwnTransform = false;
-				mRenderer->setModelMatrix(textComponent->t.getMatrix() * mat4::scale(1.f, -1.f, 1.f));
-				mRenderer->draw(t);
-			}
+			RectangleShape c(FloatRect(0.f, 0.f, 30.f, 30.f), Color::Orange);
+			c.useOwnTransform = false;
+			mRenderer->setModelMatrix(model);
+			mRenderer->draw(c);
+		}
+	});
 
-			AParticleEmitterComponent* particleEmitter = dynamic_cast<AParticleEmitterComponent*>(actor->components[j]);
-			if (particleEmitter)
-			{
-				for (auto k = 0; k < particleEmitter->particles.size(); ++k)
-				{
-					mat4 model = mat4::translate(particleEmitter->particles[k].position);
-
-					RectangleShape c(FloatRect(0.f, 0.f, 30.f, 30.f), Color::Orange);
-					c.useOwnTransform = false;
-					mRenderer->setModelMatrix(model);
-					mRenderer->draw(c);
-				}
-			}
+	_World->each<AStaticMeshComponent>([this](AStaticMeshComponent& staticMeshComponent)
+	{
+		if (staticMeshComponent.staticMesh.ptr && staticMeshComponent.staticMesh->vertexBuffer._impl)
+		{
+			Render(&staticMeshComponent);
+		}
+	});
 
-			AStaticMeshComponent* staticMeshComponent = dynamic_cast<AStaticMeshComponent*>(actor->components[j]);
-			if (staticMeshComponent)
+	// Skeletal meshes need their owner's transform, so go through the lists directly
+	std::vector<Level::ComponentList*> skeletalMeshLists;
+	for (std::size_t i = 0; i < _World->levels.size(); ++i)
+		_World->levels[i]->getComponentLists<ASkeletalMeshComponent>(skeletalMeshLists);
+
+	for (std::size_t i = 0; i < skeletalMeshLists.size(); ++i)
+	{
+		Level::ComponentList* skeletalMeshes = skeletalMeshLists[i];
+		for (std::size_t j = 0; j < skeletalMeshes->components.size(); ++j)
+		{
+			Actor* actor = static_cast<Actor*>(skeletalMeshes->owners[j]);
+			ASkeletalMeshComponent* skeletalMeshComponent = static_cast<ASkeletalMeshComponent*>(skeletalMeshes->components[j]);
+
+			// Prepare the model matrices
+			mRenderer->setModelMatrix(actor->getActorTransform().getMatrix() * mat4::rotatey(math::pi));
+		
+			// Now activate the right shader and uniforms
+			Shader s;
+			s.shaderImpl = &skeletalMeshComponent->rigShader;
+			mRenderer->setShader(s);
+			
+			for (auto& m : skeletalMeshComponent->boneTransforms)
 			{
-				mat4 modelPose = staticMeshComponent->absoluteTransform;
-				
-				if (staticMeshComponent->staticMesh.ptr && staticMeshComponent->staticMesh->vertexBuffer._impl)
-				{
-					Render(staticMeshComponent);
-				}
+				//m = mat4::identity;
 			}
 
-			// Check for skeletal meshes
-			ASkeletalMeshComponent* skeletalMeshComponent = dynamic_cast<ASkeletalMeshComponent*>(actor->components[j]);
-			if (skeletalMeshComponent)
-			{
-				// Prepare the model matrices
-				mRenderer->setModelMatrix(actor->getActorTransform().getMatrix() * mat4::rotatey(math::pi));
+			int location = skeletalMeshComponent->rigShader.getUniformLocation("u_BoneTransform");
+			glUniformMatrix4fv(location, 128, false, reinterpret_cast<float*>(&skeletalMeshComponent->boneTransforms[0]));
+
+			//skeletalMeshComponent->model->render(mRenderer);
 			
-				// Now activate the right shader and uniforms
-				Shader s;
-				s.shaderImpl = &skeletalMeshComponent->rigShader;
-				mRenderer->setShader(s);
-				mRenderer->setModelMatrix(mRenderer->getModelMatrix());
-				mRenderer->setProjectionMatrix(mRenderer->getProjectionMatrix());
-				mRenderer->setViewMatrix(mRenderer->getViewMatrix());
+			if (skeletalMeshComponent->skeletalMeshAsset)
+			{
+				mRenderer->setTexture(skeletalMeshComponent->myT);
 				
-				for (auto& m : skeletalMeshComponent->boneTransforms)
-				{
-					//m = mat4::identity;
-				}
-
-				int location = glGetUniformLocation(skeletalMeshComponent->rigShader.m_id, "u_BoneTransform");
-				glUniformMatrix4fv(location, 128, false, reinterpret_cast<float*>(&skeletalMeshComponent->boneTransforms[0]));
-
-				//skeletalMeshComponent->model->render(mRenderer);
+				mRenderer->enableVertexAttribArray(0);
+				mRenderer->enableVertexAttribArray(1);
+				mRenderer->enableVertexAttribArray(2);
+				mRenderer->enableVertexAttribArray(3);
+				mRenderer->enableVertexAttribArray(4);
+				mRenderer->enableVertexAttribArray(5);
+
+				// positions
+				mRenderer->setVertexAttribPointer(0, 3, GL_FLOAT, false, skeletalMeshComponent->skeletalMeshAsset->_vertexArray.stride(), skeletalMeshComponent->skeletalMeshAsset->_vertexArray.data());
 				
-				if (skeletalMeshComponent->skeletalMeshAsset)
-				{
-					mRenderer->setTexture(skeletalMeshComponent->myT);
-					
-					mRenderer->enableVertexAttribArray(0);
-					mRenderer->enableVertexAttribArray(1);
-					mRenderer->enableVertexAttribArray(2);
-					mRenderer->enableVertexAttribArray(3);
-					mRenderer->enableVertexAttribArray(4);
-					mRenderer->enableVertexAttribArray(5);
-
-					// positions
-					mRenderer->setVertexAttribPointer(0, 3, GL_FLOAT, false, skeletalMeshComponent->skeletalMeshAsset->_vertexArray.stride(), skeletalMeshComponent->skeletalMeshAsset->_vertexArray.data());
-					
-					mRenderer->setVertexAttribPointer(1, 4, GL_FLOAT, false, skeletalMeshComponent->skeletalMeshAsset->_vertexArray.stride(), &skeletalMeshComponent->skeletalMeshAsset->_vertexArray._data[0] + skeletalMeshComponent->skeletalMeshAsset->_vertexArray.getAttributeOffset(1));
-					
-					// 2 = uv
-					mRenderer->setVertexAttribPointer(2, 2, GL_FLOAT, false, skeletalMeshComponent->skeletalMeshAsset->_vertexArray.stride(), &skeletalMeshComponent->skeletalMeshAsset->_vertexArray._data[0] + skeletalMeshComponent->skeletalMeshAsset->_vertexArray.getAttributeOffset(2));
+				mRenderer->setVertexAttribPointer(1, 4, GL_FLOAT, false, skeletalMeshComponent->skeletalMeshAsset->_vertexArray.stride(), &skeletalMeshComponent->skeletalMeshAsset->_vertexArray._data[0] + skeletalMeshComponent->skeletalMeshAsset->_vertexArray.getAttributeOffset(1));
 				
-					// 3 = n
-					mRenderer->setVertexAttribPointer(3, 3, GL_FLOAT, false, skeletalMeshComponent->skeletalMeshAsset->_vertexArray.stride(), &skeletalMeshComponent->skeletalMeshAsset->_vertexArray._data[0] + skeletalMeshComponent->skeletalMeshAsset->_vertexArray.getAttributeOffset(3));
-					mRenderer->setVertexAttribPointer(4, 4, GL_FLOAT, false, skeletalMeshComponent->skeletalMeshAsset->_vertexArray.stride(), &skeletalMeshComponent->skeletalMeshAsset->_vertexArray._data[0] + skeletalMeshComponent->skeletalMeshAsset->_vertexArray.getAttributeOffset(4));
-					mRenderer->setVertexAttribPointer(5, 4, GL_FLOAT, false, skeletalMeshComponent->skeletalMeshAsset->_vertexArray.stride(), &skeletalMeshComponent->skeletalMeshAsset->_vertexArray._data[0] + skeletalMeshComponent->skeletalMeshAsset->_vertexArray.getAttributeOffset(5));
-
-					glDrawElements(GL_TRIANGLES, skeletalMeshComponent->skeletalMeshAsset->_indexArray.size(), GL_UNSIGNED_SHORT, skeletalMeshComponent->skeletalMeshAsset->_indexArray.data());
+				// 2 = uv
+				mRenderer->setVertexAttribPointer(2, 2, GL_FLOAT, false, skeletalMeshComponent->skeletalMeshAsset->_vertexArray.stride(), &skeletalMeshComponent->skeletalMeshAsset->_vertexArray._data[0] + skeletalMeshComponent->skeletalMeshAsset->_vertexArray.getAttributeOffset(2));
+			
+				// 3 = n
+				mRenderer->setVertexAttribPointer(3, 3, GL_FLOAT, false, skeletalMeshComponent->skeletalMeshAsset->_vertexArray.stride(), &skeletalMeshComponent->skeletalMeshAsset->_vertexArray._data[0] + skeletalMeshComponent->skeletalMeshAsset->_vertexArray.getAttributeOffset(3));
+				mRenderer->setVertexAttribPointer(4, 4, GL_FLOAT, false, skeletalMeshComponent->skeletalMeshAsset->_vertexArray.stride(), &skeletalMeshComponent->skeletalMeshAsset->_vertexArray._data[0] + skeletalMeshComponent->skeletalMeshAsset->_vertexArray.getAttributeOffset(4));
+				mRenderer->setVertexAttribPointer(5, 4, GL_FLOAT, false, skeletalMeshComponent->skeletalMeshAsset->_vertexArray.stride(), &skeletalMeshComponent->skeletalMeshAsset->_vertexArray._data[0] + skeletalMeshComponent->skeletalMeshAsset->_vertexArray.getAttributeOffset(5));
 
-					mRenderer->disableVertexAttribArray(0);
-					mRenderer->disableVertexAttribArray(1);
-					mRenderer->disableVertexAttribArray(2);
-					mRenderer->disableVertexAttribArray(3);
-					mRenderer->disableVertexAttribArray(4);
-					mRenderer->disableVertexAttribArray(5);
+				glDrawElements(GL_TRIANGLES, skeletalMeshComponent->skeletalMeshAsset->_indexArray.size(), GL_UNSIGNED_SHORT, skeletalMeshComponent->skeletalMeshAsset->_indexArray.data());
 
-				}
+				mRenderer->disableVertexAttribArray(0);
+				mRenderer->disableVertexAttribArray(1);
+				mRenderer->disableVertexAttribArray(2);
+				mRenderer->disableVertexAttribArray(3);
+				mRenderer->disableVertexAttribArray(4);
+				mRenderer->disableVertexAttribArray(5);
 
-				mRenderer->setDefaultShader();
 			}
+
+			mRenderer->setDefaultShader();
 		}
 	}
 }
 
-void RenderSystemDefault::renderSprite(ASpriteComponent* sprite)
+namespace
 {
-	mRenderer->setModelMatrix(mat4::identity);
-
-	RectangleShape spriteRect;
-	spriteRect.setPosition(sprite->t.position.xy());
-	spriteRect.setSize(sprite->getSize());
-	spriteRect.setColor(sprite->color);
-	mRenderer->draw(spriteRect);
-
-	Log("RENDER SPRITE");
-
-	Texture2D* t = mContentManager->getTexture(sprite->tex);
-	if (!t)
+	/// Where a sprite is drawn, with the transforms of the components it is attached to
+	mat4 getSpriteMatrix(ASpriteComponent& sprite)
 	{
-		mContentManager->load(sprite->tex);
+		return sprite.getWorldMatrix();
 	}
-	else
-	{
-		VertexArray va;
-		va.addAttribute(sizeof(float), 2, VertexFormat::Position);
-		va.addAttribute(sizeof(float), 4, VertexFormat::Color);
-		va.addAttribute(sizeof(float), 2, VertexFormat::TexCoord);
-		va.allocateData(6);
-
-		struct vertex_f
-		{
-			vec2 p;
-			vec4 c;
-			vec2 uv;
-		};
-
-		//			Log("Rendering sprite %f %f", sprite->width, sprite->height);
-
-
-		vertex_f* va_raw = reinterpret_cast<vertex_f*>(&va._data[0]);
-
-		va_raw[0].p = vec2(sprite->width, 0.f);
-		va_raw[1].p = vec2(sprite->width, sprite->height);
-		va_raw[2].p = vec2(0.f, sprite->height);
-
-		va_raw[3].p = vec2(sprite->width, 0.f);
-		va_raw[4].p = vec2(0.f, sprite->height);
-		va_raw[5].p = vec2(0.f, 0.f);
-
-		va_raw[0].uv = vec2(1.f, 0.f);
-		va_raw[1].uv = vec2(1.f, 1.f);
-		va_raw[2].uv = vec2(0.f, 1.f);
 
-		va_raw[3].uv = vec2(1.f, 0.f);
-		va_raw[4].uv = vec2(0.f, 1.f);
-		va_raw[5].uv = vec2(0.f, 0.f);
-
-		if (sprite->tex_rect_size.x > 0.f && sprite->tex_rect_size.y > 0.f)
-		{
-			float x1 = sprite->tex_rect_pos.x / t->getSize().x;
-			float x2 = x1 + sprite->tex_rect_size.x / t->getSize().x;
-
-			float y1 = sprite->tex_rect_pos.y / t->getSize().y;
-			float y2 = y1 + sprite->tex_rect_size.y / t->getSize().y;
-
-			va_raw[0].uv = vec2(x2, y1);
-			va_raw[1].uv = vec2(x2, y2);
-			va_raw[2].uv = vec2(x1, y2);
-
-			va_raw[3].uv = vec2(x2, y1);
-			va_raw[4].uv = vec2(x1, y2);
-			va_raw[5].uv = vec2(x1, y1);
-		}
-
-		va_raw[0].c = vec4(float(sprite->color.r) / 255.f, float(sprite->color.g) / 255.f, float(sprite->color.b) / 255.f, float(sprite->color.a) / 255.f);
-		va_raw[1].c = vec4(float(sprite->color.r) / 255.f, float(sprite->color.g) / 255.f, float(sprite->color.b) / 255.f, float(sprite->color.a) / 255.f);
-		va_raw[2].c = vec4(float(sprite->color.r) / 255.f, float(sprite->color.g) / 255.f, float(sprite->color.b) / 255.f, float(sprite->color.a) / 255.f);
-		va_raw[3].c = vec4(float(sprite->color.r) / 255.f, float(sprite->color.g) / 255.f, float(sprite->color.b) / 255.f, float(sprite->color.a) / 255.f);
-		va_raw[4].c = vec4(float(sprite->color.r) / 255.f, float(sprite->color.g) / 255.f, float(sprite->color.b) / 255.f, float(sprite->color.a) / 255.f);
-		va_raw[5].c = vec4(float(sprite->color.r) / 255.f, float(sprite->color.g) / 255.f, float(sprite->color.b) / 255.f, float(sprite->color.a) / 255.f);
-
-		mRenderer->enableVertexAttribArray(0);
-		mRenderer->enableVertexAttribArray(1);
-		mRenderer->enableVertexAttribArray(2);
-
-		mRenderer->setVertexAttribPointer(0, 2, GL_FLOAT, false, va.getVertexSize(), &va._data[0] + va.getAttributeOffset(0));
-		mRenderer->setVertexAttribPointer(1, 4, GL_FLOAT, false, va.getVertexSize(), &va._data[0] + va.getAttributeOffset(1));
-		mRenderer->setVertexAttribPointer(2, 2, GL_FLOAT, false, va.getVertexSize(), &va._data[0] + va.getAttributeOffset(2));
-
-		//mRenderer->setModelMatrix(transform->getMatrix() * mat4::scale(sprite->scale.x, sprite->scale.y, 1.f) * mat4::translate(-sprite->width / 2.f, -sprite->height / 2.f, 0.f));
-
-		mRenderer->setTexture(*t);
-		mRenderer->drawArrays(Render::Primitive::Triangles, 0, 6);
+	/// Check that the rect of a sprite lands at the expected world position
+	bool isSpriteAt(ASpriteComponent& sprite, float x, float y)
+	{
+		const vec4 origin = getSpriteMatrix(sprite) * vec4(0.f, 0.f, 0.f, 1.f);
+		const vec4 corner = getSpriteMatrix(sprite) * vec4(sprite.width, sprite.height, 0.f, 1.f);
+		return std::fabs(origin.x - x) < 0.001f && std::fabs(origin.y - y) < 0.001f
+			&& std::fabs(corner.x - (x + sprite.width)) < 0.001f && std::fabs(corner.y - (y + sprite.height)) < 0.001f;
+	}
+}
 
-		mRenderer->disableVertexAttribArray(0);
-		mRenderer->disableVertexAttribArray(1);
-		mRenderer->disableVertexAttribArray(2);
+/// Queue a sprite into the frame's sprite batch
+void RenderSystemDefault::renderSprite(ASpriteComponent* sprite)
+{
+	// Streams the texture in on first sight, drawing the placeholder until it is ready
+	Texture2D* t = mContentManager->requestTexture(sprite->tex, GameContent::Visible).get();
 
-		mRenderer->setModelMatrix(mat4::identity);
-		mRenderer->setDefaultTexture();
+	FloatRect texRect(0.f, 0.f, 1.f, 1.f);
+	if (sprite->tex_rect_size.x > 0.f && sprite->tex_rect_size.y > 0.f)
+	{
+		texRect.left = sprite->tex_rect_pos.x / t->getSize().x;
+		texRect.top = sprite->tex_rect_pos.y / t->getSize().y;
+		texRect.width = sprite->tex_rect_size.x / t->getSize().x;
+		texRect.height = sprite->tex_rect_size.y / t->getSize().y;
+	}
 
-		//Log("RENDERING SPRITE");
+	const mat4 model = getSpriteMatrix(*sprite);
+	mSpriteBatch.draw(t, model, FloatRect(0.f, 0.f, sprite->width, sprite->height), texRect, sprite->color, Render::Blend::Alpha, model[14], sprite->layer);
+}
 
-	}
+/// Attach a sprite to a moving parent and check it is drawn where the parent took it
+bool RenderSystemDefault::verifySpriteHierarchy()
+{
+	TransformHierarchy hierarchy;
+	ASceneComponent parent;
+	ASpriteComponent sprite(vec2(16.f, 8.f), "");
+	sprite.setPosition(10.f, 20.f, 0.f);
+	sprite.attachTo(&parent);
+	hierarchy.add(&parent);
+	hierarchy.add(&sprite);
+
+	parent.setPosition(100.f, 50.f, 0.f);
+	const bool followsMove = isSpriteAt(sprite, 110.f, 70.f);
+
+	// Only the parent moves, the stored subtree is recomputed from it
+	hierarchy.update();
+	parent.setPosition(-30.f, 5.f, 0.f);
+	const bool followsUpdate = isSpriteAt(sprite, -20.f, 25.f);
+
+	// Out of any hierarchy, the matrix is computed from the parents on the spot
+	hierarchy.remove(&sprite);
+	hierarchy.remove(&parent);
+	parent.setPosition(1.f, 2.f, 0.f);
+	const bool followsUnstored = isSpriteAt(sprite, 11.f, 22.f);
+
+	sprite.detach();
+	const bool detached = isSpriteAt(sprite, 10.f, 20.f);
+
+	const bool passed = followsMove && followsUpdate && followsUnstored && detached;
+	Log("RenderSystemDefault: child sprite follows its parent when moved %s, after an update %s, outside a hierarchy %s, and stays put once detached %s: %s",
+		followsMove ? "yes" : "no", followsUpdate ? "yes" : "no", followsUnstored ? "yes" : "no", detached ? "yes" : "no", passed ? "passed" : "FAILED");
+	return passed;
 }
 
 void RenderSystemDefault::render()
@@ -377,14 +354,10 @@ void RenderSystemDefault::Render(AStaticMeshComponent* mesh)
 	}
 	else
 	{
-		Texture2D* texture = mContentManager->getTexture(mesh->staticMesh->TEX);
-		if (texture)
-			mRenderer->setTexture(*texture);
-		else
-			Log("FUCK");
+		mRenderer->setTexture(*mContentManager->requestTexture(mesh->staticMesh->TEX, GameContent::Visible).get());
 	}
 
-	mRenderer->setModelMatrix(mesh->t.getMatrix());
+	mRenderer->setModelMatrix(mesh->getWorldMatrix());
 	mRenderer->setVertexBuffer(&mesh->staticMesh->vertexBuffer);
 
 	mRenderer->enableVertexAttribArray(0);
@@ -402,4 +375,56 @@ void RenderSystemDefault::Render(AStaticMeshComponent* mesh)
 	mRenderer->setVertexBuffer(nullptr);
 }
 
-NEPHILIM_NS_END
\ No newline at end of file
+/// Draw the chunks of a tilemap that are inside the camera frustum
+void RenderSystemDefault::Render(ATilemapComponent* tilemap)
+{
+	mat4 model = tilemap->getWorldMatrix();
+
+	// Cull in the tilemap's own space, the chunk bounds never need transforming
+	Frustum frustum(mRenderer->getProjectionMatrix() * mRenderer->getViewMatrix() * model);
+	tilemap->getVisibleChunks(frustum, mVisibleChunks);
+	if (mVisibleChunks.empty())
+		return;
+
+	mRenderer->setModelMatrix(model);
+	mRenderer->enableVertexAttribArray(0);
+	mRenderer->enableVertexAttribArray(1);
+	mRenderer->enableVertexAttribArray(2);
+
+	const int stride = sizeof(float) * 8;
+	for (std::size_t i = 0; i < mVisibleChunks.size(); ++i)
+	{
+		ATilemapComponent::Chunk& chunk = tilemap->mChunks[mVisibleChunks[i]];
+		for (std::size_t l = 0; l < chunk.mLayers.size(); ++l)
+		{
+			Tilemap2DLayer& layer = chunk.mLayers[l];
+
+			// Chunks are uploaded the first time they are seen, and again only after an edit
+			layer.generateRenderData(mRenderer);
+
+			for (std::size_t j = 0; j < layer.mIndexCounts.size(); ++j)
+			{
+				if (layer.mIndexCounts[j] == 0)
+					continue;
+
+				mRenderer->setTexture(*mContentManager->requestTexture(layer.mTextureSets[j], GameContent::Visible).get());
+
+				mRenderer->setVertexBuffer(&layer.mVertexBuffers[j]);
+				mRenderer->setIndexBuffer(layer.mIndexBuffers[j]);
+				mRenderer->setVertexAttribPointer(0, 2, GL_FLOAT, false, stride, 0);
+				mRenderer->setVertexAttribPointer(1, 4, GL_FLOAT, false, stride, ((char*)0) + sizeof(float) * 2);
+				mRenderer->setVertexAttribPointer(2, 2, GL_FLOAT, false, stride, ((char*)0) + sizeof(float) * 6);
+				mRenderer->drawElements(Render::Primitive::Triangles, layer.mIndexCounts[j], 0);
+			}
+		}
+	}
+
+	mRenderer->disableVertexAttribArray(0);
+	mRenderer->disableVertexAttribArray(1);
+	mRenderer->disableVertexAttribArray(2);
+	mRenderer->setIndexBuffer(nullptr);
+	mRenderer->setVertexBuffer(nullptr);
+	mRenderer->setDefaultTexture();
+}
+
+NEPHILIM_NS_END
@@ -1,5 +1,43 @@
 #include <Nephilim/World/Systems/ScriptSystem.h>
+#include <Nephilim/World/AScriptComponent.h>
+#include <Nephilim/World/World.h>
 
 NEPHILIM_NS_BEGIN
 
-NEPHILIM_NS_END
\ No newline at end of file
+/// Tick every enabled scripted behavior of the world
+void ScriptSystem::update(const Time&)
+{
+	tickScripts();
+}
+
+/// Call "void Tick()" on every enabled AScriptComponent, one batch per script
+void ScriptSystem::tickScripts()
+{
+	if (!_World)
+		return;
+
+	for (std::map<IScript*, std::vector<void*> >::iterator it = mTickBatches.begin(); it != mTickBatches.end(); ++it)
+		it->second.clear();
+
+	std::map<IScript*, std::vector<void*> >& batches = mTickBatches;
+	_World->each<AScriptComponent>([&batches](AScriptComponent& component)
+	{
+		if (component.enabled && component._script && component.object)
+			batches[component._script].push_back(component.object);
+	});
+
+	for (std::map<IScript*, std::vector<void*> >::iterator it = mTickBatches.begin(); it != mTickBatches.end(); )
+	{
+		// Scripts with no instances left are forgotten, they may have been deleted since
+		if (it->second.empty())
+		{
+			mTickBatches.erase(it++);
+			continue;
+		}
+
+		it->first->callOnObjects("void Tick()", &it->second[0], it->second.size());
+		++it;
+	}
+}
+
+NEPHILIM_NS_END
@@ -1,10 +1,21 @@
 #include <Nephilim/World/Systems/System.h>
 
+#include <algorithm>
+#include <typeinfo>
+
+#if defined __GNUC__
+#include <cxxabi.h>
+#include <cstdlib>
+#endif
+
 NEPHILIM_NS_BEGIN
 
 /// Pass on the ReferenceObject constructor
 System::System()
 : ReferencedObject()
+, _World(nullptr)
+, mDeclaresAccess(false)
+, mProfileZone(nullptr)
 {
 
 }
@@ -25,4 +36,56 @@ World* System::getWorld()
 	return _World;
 }
 
+/// Check if the system declared the components it accesses, so it can run in parallel
+bool System::declaresAccess() const
+{
+	return mDeclaresAccess;
+}
+
+/// Check if this system and the other can't update at the same time
+bool System::conflictsWith(const System& other) const
+{
+	if (!mDeclaresAccess || !other.mDeclaresAccess)
+		return true;
+
+	for (std::size_t i = 0; i < mWrites.size(); ++i)
+	{
+		if (std::find(other.mWrites.begin(), other.mWrites.end(), mWrites[i]) != other.mWrites.end() ||
+			std::find(other.mReads.begin(), other.mReads.end(), mWrites[i]) != other.mReads.end())
+			return true;
+	}
+
+	for (std::size_t i = 0; i < other.mWrites.size(); ++i)
+	{
+		if (std::find(mReads.begin(), mReads.end(), other.mWrites[i]) != mReads.end())
+			return true;
+	}
+
+	return false;
+}
+
+/// Get the profiler zone its updates are timed as, named after the system's type
+const ProfileZone* System::getProfileZone()
+{
+	if (!mProfileZone)
+	{
+		String name = typeid(*this).name();
+
+#if defined __GNUC__
+		int status = 0;
+		char* demangled = abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+		if (demangled && status == 0)
+			name = demangled;
+		free(demangled);
+#else
+		if (name.compare(0, 6, "class ") == 0)
+			name = name.substr(6);
+#endif
+
+		mProfileZone = Profiler::internZone(name);
+	}
+
+	return mProfileZone;
+}
+
 NEPHILIM_NS_END
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include <Nephilim/World/TransformHierarchy.h>
+#include <Nephilim/World/ASceneComponent.h>
+
+#include <algorithm>
+
+NEPHILIM_NS_BEGIN
+
+/// Creates an empty hierarchy
+TransformHierarchy::TransformHierarchy()
+: mLayoutDirty(false)
+, mUpdating(false)
+, mLastUpdateCount(0)
+{
+}
+
+/// Releases all components still in it
+TransformHierarchy::~TransformHierarchy()
+{
+	for (std::size_t i = 0; i < mMembers.size(); ++i)
+	{
+		mMembers[i]->mHierarchy = nullptr;
+	}
+}
+
+/// Start tracking a scene component
+void TransformHierarchy::add(ASceneComponent* component)
+{
+	if (!component || component->mHierarchy == this)
+		return;
+
+	if (component->mHierarchy)
+		component->mHierarchy->remove(component);
+
+	component->mMemberIndex = static_cast<Uint32>(mMembers.size());
+	mMembers.push_back(component);
+	component->mHierarchy = this;
+	component->mTransformDirty = true;
+	invalidateLayout();
+}
+
+/// Stop tracking a scene component
+void TransformHierarchy::remove(ASceneComponent* component)
+{
+	if (!component || component->mHierarchy != this)
+		return;
+
+	// Members are in no particular order, the last one takes the place of the removed one
+	Uint32 index = component->mMemberIndex;
+	mMembers[index] = mMembers.back();
+	mMembers[index]->mMemberIndex = index;
+	mMembers.pop_back();
+
+	component->mHierarchy = nullptr;
+	invalidateLayout();
+}
+
+/// Get the number of components tracked
+std::size_t TransformHierarchy::size() const
+{
+	return mMembers.size();
+}
+
+/// A component moved, its subtree must be recomputed
+void TransformHierarchy::queueDirty(ASceneComponent* component)
+{
+	// A stale layout recomputes everything anyway, and indices aren't valid until then
+	if (!mLayoutDirty)
+	{
+		mDirty.push_back(component->mHierarchyIndex);
+	}
+}
+
+/// The parent/child links changed, the order must be rebuilt
+void TransformHierarchy::invalidateLayout()
+{
+	mLayoutDirty = true;
+	mDirty.clear();
+}
+
+/// Rebuild the breadth first order from the components' links
+void TransformHierarchy::rebuildLayout()
+{
+	mNodes.clear();
+	mParents.clear();
+	mFirstChild.assign(mMembers.size(), 0);
+	mChildCount.assign(mMembers.size(), 0);
+
+	// Anything whose parent isn't stored here is a root
+	for (std::size_t i = 0; i < mMembers.size(); ++i)
+	{
+		ASceneComponent* parent = mMembers[i]->mParent;
+		if (!parent || parent->mHierarchy != this)
+		{
+			mNodes.push_back(mMembers[i]);
+			mParents.push_back(-1);
+		}
+	}
+
+	// Appending the children of each node in order gives the breadth first layout
+	for (std::size_t i = 0; i < mNodes.size(); ++i)
+	{
+		ASceneComponent* node = mNodes[i];
+		node->mHierarchyIndex = static_cast<Uint32>(i);
+
+		mFirstChild[i] = static_cast<Uint32>(mNodes.size());
+		for (std::size_t c = 0; c < node->attachedComponents.size(); ++c)
+		{
+			ASceneComponent* child = node->attachedComponents[c];
+			if (child->mHierarchy == this)
+			{
+				mNodes.push_back(child);
+				mParents.push_back(static_cast<Int32>(i));
+				++mChildCount[i];
+			}
+		}
+	}
+
+	mWorldMatrices.resize(mNodes.size());
+	mLayoutDirty = false;
+}
+
+/// Bring every world matrix up to date, recomputing only the subtrees that moved
+void TransformHierarchy::update()
+{
+	// A parent outside of this hierarchy may ask us back while we're updating
+	if (mUpdating)
+		return;
+
+	mUpdating = true;
+	mLastUpdateCount = 0;
+
+	if (mLayoutDirty)
+	{
+		rebuildLayout();
+
+		// Parents come first, one linear pass does it all
+		for (std::size_t i = 0; i < mNodes.size(); ++i)
+		{
+			updateNode(static_cast<Uint32>(i));
+		}
+	}
+	else if (!mDirty.empty())
+	{
+		// Ancestors have lower indices, so their subtrees are done before any dirty node inside them is reached
+		std::sort(mDirty.begin(), mDirty.end());
+		for (std::size_t i = 0; i < mDirty.size(); ++i)
+		{
+			if (mNodes[mDirty[i]]->mTransformDirty)
+			{
+				updateSubtree(mDirty[i]);
+			}
+		}
+	}
+
+	mDirty.clear();
+	mUpdating = false;
+}
+
+/// Recompute the world matrix of the node and all its descendants
+void TransformHierarchy::updateSubtree(Uint32 index)
+{
+	mStack.push_back(index);
+	while (!mStack.empty())
+	{
+		Uint32 node = mStack.back();
+		mStack.pop_back();
+
+		updateNode(node);
+
+		for (Uint32 c = 0; c < mChildCount[node]; ++c)
+		{
+			mStack.push_back(mFirstChild[node] + c);
+		}
+	}
+}
+
+/// Recompute the world matrix of a single node, its parent is up to date
+void TransformHierarchy::updateNode(Uint32 index)
+{
+	ASceneComponent* node = mNodes[index];
+	mat4 local = node->t.getMatrix();
+
+	if (mParents[index] >= 0)
+		mWorldMatrices[index] = mWorldMatrices[mParents[index]] * local;
+	else if (node->mParent)
+		mWorldMatrices[index] = node->mParent->getWorldMatrix() * local;
+	else
+		mWorldMatrices[index] = local;
+
+	node->mTransformDirty = false;
+	++mLastUpdateCount;
+}
+
+/// Get the world matrix of a component by its index in the hierarchy
+const mat4& TransformHierarchy::getWorldMatrix(std::size_t index) const
+{
+	return mWorldMatrices[index];
+}
+
+/// Get the whole array of world matrices, in breadth first order
+const std::vector<mat4>& TransformHierarchy::getWorldMatrices() const
+{
+	return mWorldMatrices;
+}
+
+/// Get the component at a given index in the breadth first order
+ASceneComponent* TransformHierarchy::getComponent(std::size_t index) const
+{
+	return mNodes[index];
+}
+
+/// Get how many world matrices were recomputed by the last update()
+std::size_t TransformHierarchy::getLastUpdateCount() const
+{
+	return mLastUpdateCount;
+}
+
+NEPHILIM_NS_END
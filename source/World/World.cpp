@@ -4,6 +4,7 @@
 #include <Nephilim/World/Systems/PhysicsSystem.h>
 #include <Nephilim/World/Systems/AudioSystem.h>
 #include <Nephilim/World/Systems/NetworkSystem.h>
+#include <Nephilim/World/Systems/AnimationSystem.h>
 
 #include <Nephilim/World/AStaticMeshComponent.h>
 #include <Nephilim/World/ASpriteComponent.h>
@@ -19,6 +20,8 @@
 #include <Nephilim/Game/GameCore.h>
 #include <Nephilim/Graphics/Window.h>
 
+#include <algorithm>
+
 NEPHILIM_NS_BEGIN
 
 World::World()
@@ -34,6 +37,9 @@ World::World()
 
 	createNetworkSystem<NetworkSystem>();
 
+	// Declares what it writes, so it can step on a worker next to other declared systems
+	attachSystem(new AnimationSystem());
+
 	_renderSystem = createRenderSystem<RenderSystemDefault>();
 	_renderSystem->mRenderer = GraphicsDevice::instance();
 }
@@ -47,15 +53,70 @@ void World::initialize()
 /// Step the world state forward
 void World::update(const Time& deltaTime)
 {
-	for (std::size_t i = 0; i < mRegisteredSystems.size(); ++i)
+	PROFILE_ZONE("World::update");
+
+	if (jobSystem && jobSystem->isRunning())
 	{
-		mRegisteredSystems[i]->update(deltaTime);
+		updateSystemsInParallel(deltaTime);
+	}
+	else
+	{
+		for (std::size_t i = 0; i < mRegisteredSystems.size(); ++i)
+		{
+			PROFILE_SCOPE(mRegisteredSystems[i]->getProfileZone());
+			mRegisteredSystems[i]->update(deltaTime);
+		}
 	}
 
 	for (auto a : mPersistentLevel->actors)
 	{
 		a->update(deltaTime);
 	}
+
+	// Only what moved during this frame gets its world matrix recomputed
+	mPersistentLevel->transforms.update();
+}
+
+/// Update the systems as jobs, each one waiting only for the earlier systems it conflicts with
+void World::updateSystemsInParallel(const Time& deltaTime)
+{
+	std::vector<JobSystem::JobHandle> inFlight;
+	std::vector<System*> inFlightSystems;
+
+	for (std::size_t i = 0; i < mRegisteredSystems.size(); ++i)
+	{
+		System* system = mRegisteredSystems[i];
+		const ProfileZone* zone = system->getProfileZone();
+
+		// Systems that didn't declare their access act as a barrier, and stay on this thread
+		if (!system->declaresAccess())
+		{
+			jobSystem->wait(inFlight);
+			inFlight.clear();
+			inFlightSystems.clear();
+
+			PROFILE_SCOPE(zone);
+			system->update(deltaTime);
+			continue;
+		}
+
+		JobSystem::JobHandle job = jobSystem->createJob([system, zone, deltaTime]()
+		{
+			PROFILE_SCOPE(zone);
+			system->update(deltaTime);
+		});
+		for (std::size_t j = 0; j < inFlight.size(); ++j)
+		{
+			if (system->conflictsWith(*inFlightSystems[j]))
+				jobSystem->addDependency(job, inFlight[j]);
+		}
+		jobSystem->submit(job);
+
+		inFlight.push_back(job);
+		inFlightSystems.push_back(system);
+	}
+
+	jobSystem->wait(inFlight);
 }
 
 /// Get the window-space coordinate of where the point lies in
@@ -203,6 +264,7 @@ Actor* World::spawnActor()
 	Actor* actor = new Actor();
 	actor->_world = this;
 	mPersistentLevel->actors.push_back(actor);
+	mPersistentLevel->registerComponents(actor);
 	return actor;
 }
 
@@ -285,6 +347,15 @@ Entity World::getEntityByIndex(std::size_t index)
 
 void World::destroyActor(Actor* actor)
 {
+	if (mPersistentLevel)
+	{
+		mPersistentLevel->unregisterComponents(actor);
+
+		std::vector<Actor*>::iterator it = std::find(mPersistentLevel->actors.begin(), mPersistentLevel->actors.end(), actor);
+		if (it != mPersistentLevel->actors.end())
+			mPersistentLevel->actors.erase(it);
+	}
+
 	delete actor;
 }
 